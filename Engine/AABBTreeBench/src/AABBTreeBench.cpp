@@ -0,0 +1,283 @@
+/*
+ * FILE: AABBTreeBench.cpp
+ *
+ * DESCRIPTION: A headless benchmark of A3DAABBTree, it moves thousands of boxes every frame
+ *				and runs random ray and box queries on the tree and by brute force
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "A3DAABBTree.h"
+#include "A3DFuncs.h"
+#include "A3DErrLog.h"
+
+#define BENCH_WORLDSIZE			1000.0f
+#define BENCH_WORLDHEIGHT		50.0f
+
+typedef struct _BENCH_MODEL
+{
+	A3DVECTOR3		vCenter;
+	A3DVECTOR3		vExts;			// Half size of the box;
+	A3DVECTOR3		vVelocity;
+	int				nProxy;
+
+} BENCH_MODEL;
+
+static DWORD l_dwSeed = 12345;
+
+// A fixed sequence, so two runs do the same work;
+static FLOAT RandFloat(FLOAT vMin, FLOAT vMax)
+{
+	l_dwSeed = l_dwSeed * 1664525 + 1013904223;
+	return vMin + (vMax - vMin) * ((l_dwSeed >> 8) / 16777216.0f);
+}
+
+static inline void GetModelBox(const BENCH_MODEL& model, A3DVECTOR3& vMins, A3DVECTOR3& vMaxs)
+{
+	vMins = model.vCenter - model.vExts;
+	vMaxs = model.vCenter + model.vExts;
+}
+
+static bool SegmentHitsBox(const A3DVECTOR3& vecStart, const A3DVECTOR3& vecDelta, const A3DVECTOR3& vMins, const A3DVECTOR3& vMaxs)
+{
+	FLOAT t0 = 0.0f, t1 = 1.0f;
+	for(int i=0; i<3; i++)
+	{
+		if( vecDelta.m[i] == 0.0f )
+		{
+			if( vecStart.m[i] < vMins.m[i] || vecStart.m[i] > vMaxs.m[i] )
+				return false;
+			continue;
+		}
+
+		FLOAT a = (vMins.m[i] - vecStart.m[i]) / vecDelta.m[i];
+		FLOAT b = (vMaxs.m[i] - vecStart.m[i]) / vecDelta.m[i];
+		if( a > b )
+		{
+			FLOAT t = a; a = b; b = t;
+		}
+		t0 = max(t0, a);
+		t1 = min(t1, b);
+		if( t0 > t1 )
+			return false;
+	}
+	return true;
+}
+
+static inline bool BoxHitsBox(const A3DVECTOR3& vMins1, const A3DVECTOR3& vMaxs1, const A3DVECTOR3& vMins2, const A3DVECTOR3& vMaxs2)
+{
+	return vMins1.x <= vMaxs2.x && vMaxs1.x >= vMins2.x &&
+		vMins1.y <= vMaxs2.y && vMaxs1.y >= vMins2.y &&
+		vMins1.z <= vMaxs2.z && vMaxs1.z >= vMins2.z;
+}
+
+static void MoveModel(BENCH_MODEL& model)
+{
+	// Bounce at the bounds of the world;
+	model.vCenter = model.vCenter + model.vVelocity;
+	for(int i=0; i<3; i++)
+	{
+		FLOAT vBound = i == 2 ? BENCH_WORLDHEIGHT : BENCH_WORLDSIZE;
+		if( model.vCenter.m[i] < 0.0f || model.vCenter.m[i] > vBound )
+		{
+			model.vVelocity.m[i] = -model.vVelocity.m[i];
+			model.vCenter.m[i] = max(0.0f, min(vBound, model.vCenter.m[i]));
+		}
+	}
+}
+
+static void InitModel(BENCH_MODEL& model, FLOAT vSpeed)
+{
+	model.vCenter	= A3DVECTOR3(RandFloat(0.0f, BENCH_WORLDSIZE), RandFloat(0.0f, BENCH_WORLDSIZE), RandFloat(0.0f, BENCH_WORLDHEIGHT));
+	model.vExts		= A3DVECTOR3(RandFloat(0.5f, 2.0f), RandFloat(0.5f, 2.0f), RandFloat(0.5f, 2.0f));
+	model.vVelocity	= A3DVECTOR3(RandFloat(-vSpeed, vSpeed), RandFloat(-vSpeed, vSpeed), RandFloat(-vSpeed, vSpeed) * 0.1f);
+	model.nProxy	= A3DAABBTREE_NULL;
+}
+
+static bool AddModel(A3DAABBTree& tree, BENCH_MODEL& model)
+{
+	A3DVECTOR3 vMins, vMaxs;
+	GetModelBox(model, vMins, vMaxs);
+	model.nProxy = tree.CreateProxy(vMins, vMaxs, &model);
+	return A3DAABBTREE_NULL != model.nProxy;
+}
+
+static double GetSeconds(const LARGE_INTEGER& liStart, const LARGE_INTEGER& liEnd)
+{
+	LARGE_INTEGER liFreq;
+	QueryPerformanceFrequency(&liFreq);
+	return (double) (liEnd.QuadPart - liStart.QuadPart) / (double) liFreq.QuadPart;
+}
+
+static void Usage()
+{
+	printf("Usage: AABBTreeBench [-models <n>] [-frames <n>] [-queries <n>] [-speed <units a frame>]\n");
+	printf("    Move the models every frame, recreate 1%% of them, and run the queries as\n");
+	printf("    pairs of a random ray and a random box, on the tree and by brute force;\n");
+	printf("    the hits of both are compared, so a wrong tree fails the run\n");
+}
+
+int main(int argc, char * argv[])
+{
+	int		nNumModels	= 5000;
+	int		nNumFrames	= 100;
+	int		nNumQueries	= 500;
+	FLOAT	vSpeed		= 0.1f;
+
+	for(int i=1; i<argc; i++)
+	{
+		if( i + 1 < argc && 0 == _stricmp(argv[i], "-models") )
+			nNumModels = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-frames") )
+			nNumFrames = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-queries") )
+			nNumQueries = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-speed") )
+			vSpeed = (FLOAT) atof(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if( nNumModels <= 0 || nNumFrames <= 0 || nNumQueries <= 0 )
+	{
+		Usage();
+		return 1;
+	}
+
+	// The tree logs when it runs out of memory;
+	g_pA3DErrLog = new A3DErrLog();
+	g_pA3DErrLog->Init("AABBTreeBench.log");
+
+	A3DAABBTree tree;
+	tree.Init();
+
+	BENCH_MODEL * aModels = new BENCH_MODEL[nNumModels];
+	int i, nRet = 0;
+	for(i=0; i<nNumModels; i++)
+	{
+		InitModel(aModels[i], vSpeed);
+		if( !AddModel(tree, aModels[i]) )
+		{
+			printf("Not enough memory!\n");
+			nRet = 1;
+			goto Exit;
+		}
+	}
+
+	{
+		abase::vector<LPVOID> aResults;
+		double vRefitTime = 0.0, vTreeTime = 0.0, vBruteTime = 0.0;
+		int nNumReinserts = 0, nNumCandidates = 0, nNumHits = 0, nNumErrors = 0;
+		LARGE_INTEGER liStart, liEnd;
+
+		for(int nFrame=0; nFrame<nNumFrames; nFrame++)
+		{
+			QueryPerformanceCounter(&liStart);
+			for(i=0; i<nNumModels; i++)
+			{
+				A3DVECTOR3 vMins, vMaxs;
+				MoveModel(aModels[i]);
+				GetModelBox(aModels[i], vMins, vMaxs);
+				if( tree.MoveProxy(aModels[i].nProxy, vMins, vMaxs) )
+					nNumReinserts ++;
+			}
+
+			// Models which are removed and created again, as the objects come and go;
+			for(i=0; i<nNumModels / 100; i++)
+			{
+				BENCH_MODEL& model = aModels[(int) RandFloat(0.0f, (FLOAT) nNumModels) % nNumModels];
+				tree.DestroyProxy(model.nProxy);
+				InitModel(model, vSpeed);
+				if( !AddModel(tree, model) )
+				{
+					printf("Not enough memory!\n");
+					nRet = 1;
+					goto Exit;
+				}
+			}
+			QueryPerformanceCounter(&liEnd);
+			vRefitTime += GetSeconds(liStart, liEnd);
+
+			for(int nQuery=0; nQuery<nNumQueries; nQuery++)
+			{
+				A3DVECTOR3 vecStart(RandFloat(0.0f, BENCH_WORLDSIZE), RandFloat(0.0f, BENCH_WORLDSIZE), RandFloat(0.0f, BENCH_WORLDHEIGHT));
+				A3DVECTOR3 vecDelta(RandFloat(-100.0f, 100.0f), RandFloat(-100.0f, 100.0f), RandFloat(-10.0f, 10.0f));
+				A3DVECTOR3 vCenter(RandFloat(0.0f, BENCH_WORLDSIZE), RandFloat(0.0f, BENCH_WORLDSIZE), RandFloat(0.0f, BENCH_WORLDHEIGHT));
+				A3DVECTOR3 vExts(RandFloat(1.0f, 10.0f), RandFloat(1.0f, 10.0f), RandFloat(1.0f, 5.0f));
+				A3DVECTOR3 vBoxMins = vCenter - vExts;
+				A3DVECTOR3 vBoxMaxs = vCenter + vExts;
+				A3DVECTOR3 vMins, vMaxs;
+				int j, nTreeHits = 0, nBruteHits = 0;
+
+				// The candidates of the tree are tested as the world tests the models;
+				QueryPerformanceCounter(&liStart);
+				aResults.clear();
+				tree.QueryRay(vecStart, vecDelta, aResults);
+				nNumCandidates += aResults.size();
+				for(j=0; j<(int) aResults.size(); j++)
+				{
+					GetModelBox(*(BENCH_MODEL *) aResults[j], vMins, vMaxs);
+					if( SegmentHitsBox(vecStart, vecDelta, vMins, vMaxs) )
+						nTreeHits ++;
+				}
+
+				aResults.clear();
+				tree.QueryAABB(vBoxMins, vBoxMaxs, aResults);
+				nNumCandidates += aResults.size();
+				for(j=0; j<(int) aResults.size(); j++)
+				{
+					GetModelBox(*(BENCH_MODEL *) aResults[j], vMins, vMaxs);
+					if( BoxHitsBox(vBoxMins, vBoxMaxs, vMins, vMaxs) )
+						nTreeHits ++;
+				}
+				QueryPerformanceCounter(&liEnd);
+				vTreeTime += GetSeconds(liStart, liEnd);
+
+				QueryPerformanceCounter(&liStart);
+				for(j=0; j<nNumModels; j++)
+				{
+					GetModelBox(aModels[j], vMins, vMaxs);
+					if( SegmentHitsBox(vecStart, vecDelta, vMins, vMaxs) )
+						nBruteHits ++;
+					if( BoxHitsBox(vBoxMins, vBoxMaxs, vMins, vMaxs) )
+						nBruteHits ++;
+				}
+				QueryPerformanceCounter(&liEnd);
+				vBruteTime += GetSeconds(liStart, liEnd);
+
+				// The tree only drops the models which can not be hit;
+				nNumHits += nBruteHits;
+				if( nTreeHits != nBruteHits )
+					nNumErrors ++;
+			}
+		}
+
+		int nNumPairs = nNumFrames * nNumQueries;
+		printf("%d models, %d frames, %d ray and box query pairs a frame, tree height %d\n", nNumModels, nNumFrames, nNumQueries, tree.GetHeight());
+		printf("Refit:       %.3f ms a frame, %.1f reinserts a frame\n", vRefitTime * 1000.0 / nNumFrames, (double) nNumReinserts / nNumFrames);
+		printf("Tree:        %.2f us a pair, %.1f candidates a pair\n", vTreeTime * 1000000.0 / nNumPairs, (double) nNumCandidates / nNumPairs);
+		printf("Brute force: %.2f us a pair, %.1f hits a pair\n", vBruteTime * 1000000.0 / nNumPairs, (double) nNumHits / nNumPairs);
+
+		if( nNumErrors )
+		{
+			printf("%d query pairs of the tree missed some hits!\n", nNumErrors);
+			nRet = 1;
+		}
+	}
+
+Exit:
+	tree.Release();
+	delete [] aModels;
+
+	g_pA3DErrLog->Release();
+	delete g_pA3DErrLog;
+	g_pA3DErrLog = NULL;
+	return nRet;
+}
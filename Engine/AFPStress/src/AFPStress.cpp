@@ -0,0 +1,310 @@
+/*
+ * FILE: AFPStress.cpp
+ *
+ * DESCRIPTION: A stress test of AFilePackage::ReadFileConcurrent and ReadFilePart, several threads
+ *				read random files of a package at the same time and compare them with ReadFile
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "AF.h"
+
+#define AFPSTRESS_MAXTHREADS	MAXIMUM_WAIT_OBJECTS
+#define AFPSTRESS_TEMPPACKAGE	"AFPStress.pck"
+
+typedef struct _STRESS_FILE
+{
+	AFPCK_FILEENTRY		fileEntry;
+	LPBYTE				pImage;			// Content read by ReadFile on the main thread;
+
+} STRESS_FILE;
+
+typedef struct _STRESS_THREAD
+{
+	AFilePackage *		pPackage;
+	STRESS_FILE *		aFiles;
+	int					nNumFiles;
+	int					nNumReads;
+	DWORD				dwSeed;
+	double				vNumBytes;		// Bytes read and compared by the thread;
+
+} STRESS_THREAD;
+
+static LONG volatile	l_nNumErrors = 0;
+
+static DWORD l_dwSeed = 12345;
+
+// A fixed sequence, so two runs do the same work;
+static DWORD Rand(DWORD * pdwSeed)
+{
+	*pdwSeed = *pdwSeed * 1664525 + 1013904223;
+	return *pdwSeed >> 8;
+}
+
+static void Usage()
+{
+	printf("Usage: AFPStress [<package>] [-threads <n>] [-reads <n>]\n");
+	printf("    Read every file of the package with ReadFile first, then read random files\n");
+	printf("    and random parts of them with ReadFileConcurrent and ReadFilePart from the\n");
+	printf("    threads at the same time, and compare them; this is done with the package\n");
+	printf("    opened normally and opened mapped; if no package is given, a package of\n");
+	printf("    generated stored, zlib and lz4 files is created and removed at the end\n");
+}
+
+// Create a package of files which span several chunks, half of them compress well;
+static bool CreatePackage(char * szPackage)
+{
+	static char * aExts[] = { ".dds", ".mp3", ".txt" };
+	const int nMaxLength = AFPCK_CHUNKSIZE * 5;
+
+	LPBYTE pBuffer = (LPBYTE) malloc(nMaxLength);
+	if( NULL == pBuffer )
+	{
+		printf("Not enough memory!\n");
+		return false;
+	}
+
+	AFilePackage package;
+	package.SetFileCodec(".dds", AFPCK_CODEC_LZ4);
+	package.SetFileCodec(".mp3", AFPCK_CODEC_STORED);
+	package.SetDefaultCodec(AFPCK_CODEC_ZLIB);
+	if( !package.Open(szPackage, AFPCK_CREATENEW) )
+	{
+		printf("Can not create package [%s]!\n", szPackage);
+		free(pBuffer);
+		return false;
+	}
+
+	bool bRet = true;
+	for(int i=0; i<200; i++)
+	{
+		// Some empty and tiny files, the others up to several chunks;
+		DWORD dwLength = i < 4 ? i : Rand(&l_dwSeed) % nMaxLength;
+		bool bRandom = (i & 1) != 0;
+		for(DWORD j=0; j<dwLength; j++)
+			pBuffer[j] = bRandom ? (BYTE) Rand(&l_dwSeed) : (BYTE) ("Angelica File Package "[j % 22] + (j >> 12));
+
+		char szFileName[MAX_PATH];
+		sprintf(szFileName, "stress\\%04d%s", i, aExts[i % 3]);
+		if( !package.AppendFile(szFileName, pBuffer, dwLength) )
+		{
+			printf("Can not append file [%s]!\n", szFileName);
+			bRet = false;
+			break;
+		}
+	}
+
+	if( !package.Close() )
+		bRet = false;
+
+	free(pBuffer);
+	return bRet;
+}
+
+static DWORD WINAPI StressThread(LPVOID pArg)
+{
+	STRESS_THREAD * pThread = (STRESS_THREAD *) pArg;
+	DWORD dwMaxLength = 0;
+	int i;
+
+	for(i=0; i<pThread->nNumFiles; i++)
+		dwMaxLength = max(dwMaxLength, pThread->aFiles[i].fileEntry.dwLength);
+
+	// One byte more, so an empty file still has a buffer;
+	LPBYTE pBuffer = (LPBYTE) malloc(dwMaxLength + 1);
+	if( NULL == pBuffer )
+	{
+		printf("Not enough memory!\n");
+		InterlockedIncrement(&l_nNumErrors);
+		return 1;
+	}
+
+	for(i=0; i<pThread->nNumReads; i++)
+	{
+		STRESS_FILE& file = pThread->aFiles[Rand(&pThread->dwSeed) % pThread->nNumFiles];
+		DWORD dwLength = file.fileEntry.dwLength;
+		DWORD dwOffset, dwReadLen;
+		bool bRead;
+
+		// Every other read is of a part, which may start and end inside the chunks;
+		if( i & 1 )
+		{
+			dwOffset = dwLength ? Rand(&pThread->dwSeed) % dwLength : 0;
+			DWORD dwSize = Rand(&pThread->dwSeed) % (AFPCK_CHUNKSIZE * 2) + 1;
+			bRead = pThread->pPackage->ReadFilePart(file.fileEntry, pBuffer, dwOffset, dwSize, &dwReadLen);
+			if( bRead && dwReadLen != min(dwSize, dwLength - dwOffset) )
+				bRead = false;
+		}
+		else
+		{
+			// The whole file is read, ReadFileConcurrent does not return the length;
+			DWORD dwBufferLen = dwMaxLength + 1;
+			dwOffset = 0;
+			dwReadLen = dwLength;
+			bRead = pThread->pPackage->ReadFileConcurrent(file.fileEntry, pBuffer, 0, &dwBufferLen);
+		}
+
+		if( !bRead || memcmp(pBuffer, file.pImage + dwOffset, dwReadLen) )
+		{
+			printf("File [%s] read wrong at offset %u!\n", file.fileEntry.szFileName, dwOffset);
+			InterlockedIncrement(&l_nNumErrors);
+		}
+		else
+			pThread->vNumBytes += dwReadLen;
+	}
+
+	free(pBuffer);
+	return 0;
+}
+
+static bool StressPackage(char * szPackage, AFPCK_OPENMODE mode, int nNumThreads, int nNumReads)
+{
+	AFilePackage package;
+	if( !package.Open(szPackage, mode) )
+	{
+		printf("Can not open package [%s]!\n", szPackage);
+		return false;
+	}
+
+	int nNumFiles = package.GetFileNumber();
+	if( 0 == nNumFiles )
+	{
+		printf("Package [%s] is empty!\n", szPackage);
+		package.Close();
+		return false;
+	}
+
+	STRESS_FILE *	aFiles = (STRESS_FILE *) malloc(sizeof(STRESS_FILE) * nNumFiles);
+	STRESS_THREAD	aThreads[AFPSTRESS_MAXTHREADS];
+	HANDLE			aHandles[AFPSTRESS_MAXTHREADS];
+	int				i, nNumImages = 0, nNumStarted = 0;
+	bool			bRet = false;
+	double			vNumBytes = 0.0;
+	LARGE_INTEGER	liStart, liEnd, liFreq;
+
+	if( NULL == aFiles )
+	{
+		printf("Not enough memory!\n");
+		goto EXIT;
+	}
+
+	// The content read by the single-threaded path is the reference;
+	for(i=0; i<nNumFiles; i++)
+	{
+		STRESS_FILE& file = aFiles[i];
+		package.GetFileEntryByIndex(i, &file.fileEntry);
+		file.pImage = (LPBYTE) malloc(file.fileEntry.dwLength + 1);
+		if( NULL == file.pImage )
+		{
+			printf("Not enough memory!\n");
+			goto EXIT;
+		}
+		nNumImages ++;
+
+		DWORD dwBufferLen = file.fileEntry.dwLength + 1;
+		if( !package.ReadFile(file.fileEntry, file.pImage, 0, &dwBufferLen) )
+		{
+			printf("Can not read file [%s]!\n", file.fileEntry.szFileName);
+			goto EXIT;
+		}
+	}
+
+	l_nNumErrors = 0;
+
+	QueryPerformanceCounter(&liStart);
+	for(i=0; i<nNumThreads; i++)
+	{
+		aThreads[i].pPackage	= &package;
+		aThreads[i].aFiles		= aFiles;
+		aThreads[i].nNumFiles	= nNumFiles;
+		aThreads[i].nNumReads	= nNumReads;
+		aThreads[i].dwSeed		= Rand(&l_dwSeed);
+		aThreads[i].vNumBytes	= 0.0;
+
+		aHandles[i] = CreateThread(NULL, 0, StressThread, &aThreads[i], 0, NULL);
+		if( NULL == aHandles[i] )
+		{
+			printf("Can not create thread!\n");
+			InterlockedIncrement(&l_nNumErrors);
+			break;
+		}
+		nNumStarted ++;
+	}
+
+	WaitForMultipleObjects(nNumStarted, aHandles, TRUE, INFINITE);
+	QueryPerformanceCounter(&liEnd);
+	QueryPerformanceFrequency(&liFreq);
+
+	for(i=0; i<nNumStarted; i++)
+	{
+		CloseHandle(aHandles[i]);
+		vNumBytes += aThreads[i].vNumBytes;
+	}
+
+	printf("%s: %d files, %d threads, %d reads a thread, %.1f MB read in %.3f s, %d errors\n",
+		mode == AFPCK_OPENMAPPED ? "Mapped" : "Opened", nNumFiles, nNumStarted, nNumReads,
+		vNumBytes / 1048576.0, (double) (liEnd.QuadPart - liStart.QuadPart) / (double) liFreq.QuadPart, l_nNumErrors);
+
+	bRet = 0 == l_nNumErrors;
+
+EXIT:
+	for(i=0; i<nNumImages; i++)
+		free(aFiles[i].pImage);
+	if( aFiles )
+		free(aFiles);
+
+	package.Close();
+	return bRet;
+}
+
+int main(int argc, char * argv[])
+{
+	char *	szPackage	= NULL;
+	int		nNumThreads	= 8;
+	int		nNumReads	= 2000;
+
+	for(int i=1; i<argc; i++)
+	{
+		if( i + 1 < argc && 0 == _stricmp(argv[i], "-threads") )
+			nNumThreads = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-reads") )
+			nNumReads = atoi(argv[++i]);
+		else if( NULL == szPackage && argv[i][0] != '-' )
+			szPackage = argv[i];
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if( nNumThreads <= 0 || nNumThreads > AFPSTRESS_MAXTHREADS || nNumReads <= 0 )
+	{
+		Usage();
+		return 1;
+	}
+
+	AFileMod_Initialize(true);
+
+	int nRet = 1;
+	bool bTempPackage = NULL == szPackage;
+	if( bTempPackage )
+		szPackage = AFPSTRESS_TEMPPACKAGE;
+
+	if( !bTempPackage || CreatePackage(szPackage) )
+	{
+		if( StressPackage(szPackage, AFPCK_OPENEXIST, nNumThreads, nNumReads) &&
+			StressPackage(szPackage, AFPCK_OPENMAPPED, nNumThreads, nNumReads) )
+			nRet = 0;
+	}
+
+	if( bTempPackage )
+		DeleteFile(szPackage);
+
+	AFileMod_Finalize();
+	return nRet;
+}
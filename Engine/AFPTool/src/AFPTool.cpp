@@ -0,0 +1,351 @@
+/*
+ * FILE: AFPTool.cpp
+ *
+ * DESCRIPTION: A command line tool to maintain Angelica File Packages
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "AF.h"
+
+#define AFPTOOL_MAXNAMES		65536
+
+// The default codecs of the build command, the files loaded while streaming use AFLZ4,
+// which uncompresses much faster than zlib, and the files already compressed are stored;
+static struct
+{
+	char *	szExt;
+	DWORD	dwCodec;
+} l_aDefaultCodecs[] = 
+{
+	{ ".dds",	AFPCK_CODEC_LZ4 },
+	{ ".tga",	AFPCK_CODEC_LZ4 },
+	{ ".bmp",	AFPCK_CODEC_LZ4 },
+	{ ".mox",	AFPCK_CODEC_LZ4 },
+	{ ".mod",	AFPCK_CODEC_LZ4 },
+	{ ".gfx",	AFPCK_CODEC_LZ4 },
+	{ ".mp3",	AFPCK_CODEC_STORED },
+};
+
+static void Usage()
+{
+	printf("Usage: AFPTool compact <package> [-o <new package>] [-order <order file>]\n");
+	printf("    Rewrite the package without dead data; if no new package is given, the\n");
+	printf("    package is replaced; the order file lists the file names one per line,\n");
+	printf("    or is a trace file recorded by AFileMod_StartTrace, and their data will be\n");
+	printf("    placed first in that order\n");
+	printf("Usage: AFPTool build <package> <list file> [-dir <base dir>] [-level <1-9>] [-threads <n>]\n");
+	printf("                     [-codec <.ext> <stored|zlib|lz4>] [-default <stored|zlib|lz4>] [-noshare]\n");
+	printf("    Create a package of the files in the list file, one name per line, relative\n");
+	printf("    to the base dir; the package is the same whatever the number of threads is;\n");
+	printf("    textures, models and effects use lz4 and other files use zlib by default;\n");
+	printf("    identical files share one copy of data unless -noshare is given\n");
+	printf("Usage: AFPTool strtab <text table> <binary table>\n");
+	printf("    Compile a string table into a binary table with a perfect hash, which is\n");
+	printf("    loaded by AStringTable without parsing and looked up in constant time\n");
+}
+
+// Get the codec by its name, return AFPCK_NUMCODECS if unknown;
+static DWORD ParseCodec(char * szCodec)
+{
+	if( 0 == _stricmp(szCodec, "stored") )
+		return AFPCK_CODEC_STORED;
+	else if( 0 == _stricmp(szCodec, "zlib") )
+		return AFPCK_CODEC_ZLIB;
+	else if( 0 == _stricmp(szCodec, "lz4") )
+		return AFPCK_CODEC_LZ4;
+
+	printf("Unknown codec [%s]!\n", szCodec);
+	return AFPCK_NUMCODECS;
+}
+
+// Load the file names of a list file, one name per line;
+static int LoadNameList(char * szListFile, char ** aNames, int nMaxNames)
+{
+	FILE * pFile = fopen(szListFile, "rt");
+	if( NULL == pFile )
+	{
+		printf("Can not open list file [%s]!\n", szListFile);
+		return -1;
+	}
+
+	int		nNumNames = 0;
+	char	szLine[MAX_PATH];
+	while( nNumNames < nMaxNames && fgets(szLine, MAX_PATH, pFile) )
+	{
+		int nLength = strlen(szLine);
+		while( nLength > 0 && (szLine[nLength - 1] == '\n' || szLine[nLength - 1] == '\r') )
+			szLine[--nLength] = '\0';
+
+		if( 0 == nLength )
+			continue;
+
+		aNames[nNumNames] = (char *) malloc(nLength + 1);
+		if( NULL == aNames[nNumNames] )
+			break;
+		strcpy(aNames[nNumNames], szLine);
+		nNumNames ++;
+	}
+
+	fclose(pFile);
+	return nNumNames;
+}
+
+static int Compact(int argc, char * argv[])
+{
+	char *	szPackage = argv[2];
+	char *	szNewPackage = NULL;
+	char *	szOrderFile = NULL;
+	char	szTempPackage[MAX_PATH];
+	int		i;
+
+	for(i=3; i<argc; i++)
+	{
+		if( 0 == _stricmp(argv[i], "-o") && i + 1 < argc )
+			szNewPackage = argv[++i];
+		else if( 0 == _stricmp(argv[i], "-order") && i + 1 < argc )
+			szOrderFile = argv[++i];
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	char ** aNames = (char **) malloc(sizeof(char *) * AFPTOOL_MAXNAMES);
+	if( NULL == aNames )
+	{
+		printf("Not enough memory!\n");
+		return 1;
+	}
+
+	int nNumNames = 0;
+	if( szOrderFile )
+	{
+		// Try it as a trace file first;
+		nNumNames = AFileTrace_LoadNames(szOrderFile, aNames, AFPTOOL_MAXNAMES);
+		if( nNumNames < 0 )
+			nNumNames = LoadNameList(szOrderFile, aNames, AFPTOOL_MAXNAMES);
+		if( nNumNames < 0 )
+		{
+			free(aNames);
+			return 1;
+		}
+	}
+
+	// Compact into a temporary file first if the package should be replaced;
+	if( NULL == szNewPackage )
+	{
+		_snprintf(szTempPackage, MAX_PATH, "%s.tmp", szPackage);
+		szTempPackage[MAX_PATH - 1] = '\0';
+	}
+
+	int nRet = 1;
+	AFilePackage package;
+	if( !package.Open(szPackage, AFPCK_OPENMAPPED) )
+		printf("Can not open package [%s]!\n", szPackage);
+	else
+	{
+		DWORD dwSavedBytes;
+		bool bCompacted = package.Compact(szNewPackage ? szNewPackage : szTempPackage, aNames, nNumNames, &dwSavedBytes);
+		int nNumFiles = package.GetFileNumber();
+		package.Close();
+
+		if( !bCompacted )
+			printf("Can not compact package [%s]!\n", szPackage);
+		else if( NULL == szNewPackage && !MoveFileEx(szTempPackage, szPackage, MOVEFILE_REPLACE_EXISTING) )
+		{
+			printf("Can not replace package [%s]!\n", szPackage);
+			DeleteFile(szTempPackage);
+		}
+		else
+		{
+			printf("%d files, %d files ordered, %u bytes of dead data removed\n", nNumFiles, nNumNames, dwSavedBytes);
+			nRet = 0;
+		}
+	}
+
+	for(i=0; i<nNumNames; i++)
+		free(aNames[i]);
+	free(aNames);
+	return nRet;
+}
+
+static int Build(int argc, char * argv[])
+{
+	if( argc < 4 )
+	{
+		Usage();
+		return 1;
+	}
+
+	char *	szPackage = argv[2];
+	char *	szListFile = argv[3];
+	char *	szBaseDir = ".";
+	int		nLevel = 1;
+	int		nNumThreads = 0;
+	int		i;
+
+	AFilePackage package;
+	for(i=0; i<(int) (sizeof(l_aDefaultCodecs) / sizeof(l_aDefaultCodecs[0])); i++)
+		package.SetFileCodec(l_aDefaultCodecs[i].szExt, l_aDefaultCodecs[i].dwCodec);
+
+	for(i=4; i<argc; i++)
+	{
+		if( 0 == _stricmp(argv[i], "-dir") && i + 1 < argc )
+			szBaseDir = argv[++i];
+		else if( 0 == _stricmp(argv[i], "-level") && i + 1 < argc )
+			nLevel = atoi(argv[++i]);
+		else if( 0 == _stricmp(argv[i], "-threads") && i + 1 < argc )
+			nNumThreads = atoi(argv[++i]);
+		else if( 0 == _stricmp(argv[i], "-codec") && i + 2 < argc )
+		{
+			char * szExt = argv[++i];
+			if( !package.SetFileCodec(szExt, ParseCodec(argv[++i])) )
+			{
+				Usage();
+				return 1;
+			}
+		}
+		else if( 0 == _stricmp(argv[i], "-noshare") )
+			package.SetShareData(false);
+		else if( 0 == _stricmp(argv[i], "-default") && i + 1 < argc )
+		{
+			if( !package.SetDefaultCodec(ParseCodec(argv[++i])) )
+			{
+				Usage();
+				return 1;
+			}
+		}
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	char ** aNames = (char **) malloc(sizeof(char *) * AFPTOOL_MAXNAMES);
+	char ** aDiskFiles = (char **) malloc(sizeof(char *) * AFPTOOL_MAXNAMES);
+	if( NULL == aNames || NULL == aDiskFiles )
+	{
+		printf("Not enough memory!\n");
+		if( aNames )
+			free(aNames);
+		if( aDiskFiles )
+			free(aDiskFiles);
+		return 1;
+	}
+
+	int nNumNames = LoadNameList(szListFile, aNames, AFPTOOL_MAXNAMES);
+	if( nNumNames < 0 )
+	{
+		free(aNames);
+		free(aDiskFiles);
+		return 1;
+	}
+
+	// All disk paths are kept in one block;
+	char * pDiskPaths = (char *) malloc(MAX_PATH * (nNumNames + 1));
+	if( NULL == pDiskPaths )
+	{
+		printf("Not enough memory!\n");
+		for(i=0; i<nNumNames; i++)
+			free(aNames[i]);
+		free(aNames);
+		free(aDiskFiles);
+		return 1;
+	}
+
+	for(i=0; i<nNumNames; i++)
+	{
+		aDiskFiles[i] = pDiskPaths + i * MAX_PATH;
+		_snprintf(aDiskFiles[i], MAX_PATH, "%s\\%s", szBaseDir, aNames[i]);
+		aDiskFiles[i][MAX_PATH - 1] = '\0';
+	}
+
+	int nRet = 1;
+	if( !package.Open(szPackage, AFPCK_CREATENEW) )
+		printf("Can not create package [%s]!\n", szPackage);
+	else
+	{
+		package.SetCompressLevel(nLevel);
+		bool bBuilt = package.AppendFiles(aNames, aDiskFiles, nNumNames, nNumThreads);
+		int nNumShared = package.GetNumSharedFiles();
+		DWORD dwSharedBytes = package.GetSharedBytes();
+		package.Close();
+
+		if( !bBuilt )
+		{
+			printf("Can not build package [%s], see AF.log for details!\n", szPackage);
+			DeleteFile(szPackage);
+		}
+		else
+		{
+			printf("%d files added, %d identical files share data, %u bytes saved\n", nNumNames, nNumShared, dwSharedBytes);
+			nRet = 0;
+		}
+	}
+
+	for(i=0; i<nNumNames; i++)
+		free(aNames[i]);
+	free(aNames);
+	free(aDiskFiles);
+	free(pDiskPaths);
+	return nRet;
+}
+
+static int CompileStringTable(int argc, char * argv[])
+{
+	if( argc < 4 )
+	{
+		Usage();
+		return 1;
+	}
+
+	AStringTable table;
+	if( !table.Init(argv[2]) )
+	{
+		printf("Can not load string table [%s]!\n", argv[2]);
+		return 1;
+	}
+
+	if( !table.SaveTable(argv[3]) )
+	{
+		printf("Can not save string table [%s], see AF.log for details!\n", argv[3]);
+		return 1;
+	}
+
+	printf("%d entries compiled\n", table.GetEntryCount());
+	return 0;
+}
+
+int main(int argc, char * argv[])
+{
+	if( argc < 3 )
+	{
+		Usage();
+		return 1;
+	}
+
+	AFileMod_Initialize(true);
+
+	int nRet;
+	if( 0 == _stricmp(argv[1], "compact") )
+		nRet = Compact(argc, argv);
+	else if( 0 == _stricmp(argv[1], "build") )
+		nRet = Build(argc, argv);
+	else if( 0 == _stricmp(argv[1], "strtab") )
+		nRet = CompileStringTable(argc, argv);
+	else
+	{
+		Usage();
+		nRet = 1;
+	}
+
+	AFileMod_Finalize();
+	return nRet;
+}
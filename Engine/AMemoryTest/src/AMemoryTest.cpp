@@ -0,0 +1,276 @@
+/*
+ * FILE: AMemoryTest.cpp
+ *
+ * DESCRIPTION: A test of the tracking of a_malloc, it checks the counters of the allocation
+ *				sites with several sample rates, and that pointers which are not from a_malloc
+ *				are handled without touching the memory around them
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "amemory.h"
+
+#define TEST_PROFILEFILE		"AMemoryTest.txt"
+#define TEST_MAXBLOCKS			1000000
+
+// The blocks of each case are allocated at a site of their own, the line is only a key;
+enum
+{
+	TEST_SITE_EXACT = 1000001,
+	TEST_SITE_SAMPLED,
+	TEST_SITE_NONE,
+	TEST_SITE_REALLOC,
+};
+
+typedef struct _TEST_SITE
+{
+	DWORD			dwLiveBytes;
+	DWORD			dwLiveCount;
+	DWORD			dwTotalCount;
+
+} TEST_SITE;
+
+static DWORD l_dwSeed = 12345;
+static int l_nNumErrors = 0;
+
+// A fixed sequence, so two runs do the same work;
+static DWORD Rand()
+{
+	l_dwSeed = l_dwSeed * 1664525 + 1013904223;
+	return l_dwSeed >> 8;
+}
+
+static void Usage()
+{
+	printf("Usage: AMemoryTest [-blocks <n>] [-rate <n>]\n");
+	printf("    Allocate blocks with a_malloc at sample rates of 1, n and 0, free them in a\n");
+	printf("    random order and check the live and total counters of their sites in the heap\n");
+	printf("    profile, then realloc blocks with and without the guard bands and pass pointers\n");
+	printf("    which are not from a_malloc to a_free and a_realloc\n");
+}
+
+static void Check(bool bPassed, const char * szWhat)
+{
+	if( !bPassed )
+	{
+		printf("Failed: %s!\n", szWhat);
+		l_nNumErrors ++;
+	}
+}
+
+// Read the counters of a site from the heap profile, a site which is not there has zero counters;
+static bool GetSite(int nLine, TEST_SITE * pSite)
+{
+	memset(pSite, 0, sizeof(TEST_SITE));
+	if( amemory_dump_profile(TEST_PROFILEFILE) < 0 )
+		return false;
+
+	FILE * pFile = fopen(TEST_PROFILEFILE, "rt");
+	if( NULL == pFile )
+		return false;
+
+	char szLine[1024];
+	while( fgets(szLine, sizeof(szLine), pFile) )
+	{
+		// The site is the last field, as file(line);
+		unsigned __int64 nTotalBytes;
+		DWORD dwLiveBytes, dwLiveCount, dwTotalCount;
+		char * pParen = strrchr(szLine, '(');
+		if( NULL == pParen || 4 != sscanf(szLine, "%u %u %I64u %u", &dwLiveBytes, &dwLiveCount, &nTotalBytes, &dwTotalCount) )
+			continue;
+		size_t nFileLen = strlen(__FILE__);
+		if( atoi(pParen + 1) != nLine || (size_t) (pParen - szLine) < nFileLen || strncmp(pParen - nFileLen, __FILE__, nFileLen) )
+			continue;
+
+		pSite->dwLiveBytes	= dwLiveBytes;
+		pSite->dwLiveCount	= dwLiveCount;
+		pSite->dwTotalCount	= dwTotalCount;
+		break;
+	}
+
+	fclose(pFile);
+	return true;
+}
+
+// Allocate the blocks at a site with a rate, check the counters, free them in a random order
+// and check the counters again; the counts of a sampled site are estimates, so only the exact
+// ones are compared, the others must be multiples of the rate near the real count;
+static void TestSite(int nLine, int nRate, void ** aBlocks, int nNumBlocks)
+{
+	const DWORD dwSize = 48;
+	TEST_SITE site;
+	int i;
+
+	printf("Sample rate %d, %d blocks\n", nRate, nNumBlocks);
+	amemory_set_sample_rate(nRate);
+	Check(amemory_get_sample_rate() == nRate, "the sample rate is not set");
+
+	for(i=0; i<nNumBlocks; i++)
+	{
+		aBlocks[i] = a_malloc(dwSize, __FILE__, nLine);
+		Check(NULL != aBlocks[i], "a_malloc returns NULL");
+		if( NULL == aBlocks[i] )
+			return;
+		memset(aBlocks[i], i, dwSize);
+	}
+
+	Check(GetSite(nLine, &site), "the heap profile can not be written");
+	printf("    %u blocks alive, %u bytes\n", site.dwLiveCount, site.dwLiveBytes);
+	if( 0 == nRate )
+		Check(0 == site.dwTotalCount, "a site is counted with sampling off");
+	else if( 1 == nRate )
+		Check(site.dwLiveCount == (DWORD) nNumBlocks && site.dwTotalCount == (DWORD) nNumBlocks, "the counts of the site are wrong");
+	else
+		Check(site.dwLiveCount % nRate == 0 && site.dwLiveCount > (DWORD) nNumBlocks / 2 && site.dwLiveCount < (DWORD) nNumBlocks * 3 / 2,
+			"the estimated counts of the site are wrong");
+	Check(site.dwLiveBytes == site.dwLiveCount * dwSize, "the live bytes of the site are wrong");
+
+	// Free half of the blocks, picked at random, so the counts can be checked in the middle;
+	for(i=nNumBlocks-1; i>0; i--)
+	{
+		int j = Rand() % (i + 1);
+		void * p = aBlocks[i];
+		aBlocks[i] = aBlocks[j];
+		aBlocks[j] = p;
+	}
+
+	TEST_SITE siteFull = site;
+	for(i=0; i<nNumBlocks; i++)
+	{
+		if( i == nNumBlocks / 2 )
+		{
+			Check(GetSite(nLine, &site), "the heap profile can not be written");
+			if( 1 == nRate )
+				Check(site.dwLiveCount == (DWORD) (nNumBlocks - i), "the live count of the site is wrong after half are freed");
+			else
+				Check(site.dwLiveCount <= siteFull.dwLiveCount && site.dwLiveCount % max(nRate, 1) == 0, "the live count of the site is wrong after half are freed");
+		}
+		a_free(aBlocks[i], __FILE__, __LINE__);
+		aBlocks[i] = NULL;
+	}
+
+	Check(GetSite(nLine, &site), "the heap profile can not be written");
+	Check(0 == site.dwLiveCount && 0 == site.dwLiveBytes, "blocks are still alive after all are freed");
+	Check(site.dwTotalCount == siteFull.dwTotalCount, "the total count changes when the blocks are freed");
+}
+
+// Grow and shrink a block, the content and the counts must follow it;
+static void TestRealloc(int nGuardBand)
+{
+	printf("Realloc with guard band %d\n", nGuardBand);
+	amemory_set_sample_rate(1);
+	amemory_set_guard_band(nGuardBand);
+
+	BYTE * p = (BYTE *) a_malloc(16, __FILE__, TEST_SITE_REALLOC);
+	Check(NULL != p, "a_malloc returns NULL");
+	if( NULL == p )
+		return;
+
+	int i;
+	for(i=0; i<16; i++)
+		p[i] = (BYTE) i;
+
+	p = (BYTE *) a_realloc(p, 4096, __FILE__, TEST_SITE_REALLOC);
+	Check(NULL != p, "a_realloc returns NULL");
+	if( NULL == p )
+		return;
+	for(i=0; i<16; i++)
+		Check(p[i] == (BYTE) i, "a_realloc loses the content");
+	memset(p + 16, 0xcc, 4096 - 16);
+
+	p = (BYTE *) a_realloc(p, 8, __FILE__, TEST_SITE_REALLOC);
+	Check(NULL != p, "a_realloc returns NULL");
+	if( NULL == p )
+		return;
+	for(i=0; i<8; i++)
+		Check(p[i] == (BYTE) i, "a_realloc loses the content");
+
+	TEST_SITE site;
+	Check(GetSite(TEST_SITE_REALLOC, &site), "the heap profile can not be written");
+	Check(1 == site.dwLiveCount && 8 == site.dwLiveBytes, "the site does not follow the realloc");
+
+	a_free(p, __FILE__, __LINE__);
+	Check(GetSite(TEST_SITE_REALLOC, &site), "the heap profile can not be written");
+	Check(0 == site.dwLiveCount, "the realloced block is still alive");
+}
+
+// A pointer which is not from a_malloc is looked up before anything around it is read, so one at
+// the start of a region with nothing mapped before it must not fault;
+static void TestForeignPointers()
+{
+	printf("Pointers which are not from a_malloc\n");
+
+	BYTE * pRegion = (BYTE *) VirtualAlloc(NULL, 65536, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	Check(NULL != pRegion, "VirtualAlloc fails");
+	if( pRegion )
+	{
+		Check(NULL == a_realloc(pRegion, 64, __FILE__, __LINE__), "a_realloc accepts a foreign pointer");
+		VirtualFree(pRegion, 0, MEM_RELEASE);
+	}
+
+	// The old a_free gave these back to the CRT, and so does the new one;
+	void * p = malloc(64);
+	Check(NULL != p, "malloc returns NULL");
+	if( p )
+		a_free(p, __FILE__, __LINE__);
+}
+
+int main(int argc, char * argv[])
+{
+	int		nNumBlocks	= 100000;
+	int		nRate		= 16;
+
+	for(int i=1; i<argc; i++)
+	{
+		if( i + 1 < argc && 0 == _stricmp(argv[i], "-blocks") )
+			nNumBlocks = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-rate") )
+			nRate = atoi(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	// The estimate of a sampled site is only checked loosely, so it needs enough samples;
+	if( nNumBlocks <= 0 || nNumBlocks > TEST_MAXBLOCKS || nRate <= 1 || nNumBlocks / nRate < 100 )
+	{
+		Usage();
+		return 1;
+	}
+
+	void ** aBlocks = (void **) malloc(sizeof(void *) * nNumBlocks);
+	if( NULL == aBlocks )
+	{
+		printf("Not enough memory!\n");
+		return 1;
+	}
+
+	TestSite(TEST_SITE_EXACT, 1, aBlocks, nNumBlocks);
+	TestSite(TEST_SITE_SAMPLED, nRate, aBlocks, nNumBlocks);
+	TestSite(TEST_SITE_NONE, 0, aBlocks, nNumBlocks);
+	TestRealloc(1);
+	TestRealloc(0);
+	TestForeignPointers();
+
+	free(aBlocks);
+	DeleteFile(TEST_PROFILEFILE);
+
+	if( l_nNumErrors )
+	{
+		printf("%d checks failed!\n", l_nNumErrors);
+		return 1;
+	}
+
+	printf("All checks passed\n");
+	return 0;
+}
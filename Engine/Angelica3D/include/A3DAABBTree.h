@@ -0,0 +1,102 @@
+/*
+ * FILE: A3DAABBTree.h
+ *
+ * DESCRIPTION: A dynamic tree of axis aligned bounding boxes, which is used to find the
+ *				objects a trace may hit without testing all of them;
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#ifndef _A3DAABBTREE_H_
+#define _A3DAABBTREE_H_
+
+#include "A3DPlatform.h"
+#include "A3DTypes.h"
+#include "A3DData.h"
+#include "vector.h"
+
+#define A3DAABBTREE_NULL		-1
+
+// The default margin of the fat boxes of the proxies;
+#define A3DAABBTREE_MARGIN		0.5f
+
+/*
+	Each object is a proxy, which is a leaf of the tree. The box of a leaf is the box of the
+	object fattened by a margin, so an object which moves a little stays in its leaf and only
+	when it moves out of the fat box is the leaf taken out and inserted again. A new leaf goes
+	to the sibling which makes the least growth of surface area, and the branches are rotated
+	to keep the tree balanced, so a query visits O(log n) nodes for a small box or a short ray.
+	Proxy ids are node indices, they are stable until the proxy is destroyed;
+*/
+class A3DAABBTree : public A3DData
+{
+private:
+	typedef struct _A3DAABBTREE_NODE
+	{
+		A3DVECTOR3		vMins;
+		A3DVECTOR3		vMaxs;
+		LPVOID			pData;			// Data of a leaf;
+		int				nParent;		// Next free node when the node is free;
+		int				nChild1;		// A3DAABBTREE_NULL for a leaf;
+		int				nChild2;
+		int				nHeight;		// 0 for a leaf, -1 for a free node;
+
+	} A3DAABBTREE_NODE;
+
+	A3DAABBTREE_NODE *	m_aNodes;
+	int					m_nMaxNodes;
+	int					m_nNumNodes;		// Number of nodes which have ever been used;
+	int					m_nFreeNode;		// Head of the free node list;
+	int					m_nRoot;
+	int					m_nNumProxies;
+	FLOAT				m_vMargin;
+
+	abase::vector<int>	m_Stack;			// Nodes to visit in a query;
+
+	int AllocNode();
+	void FreeNode(int nNode);
+	bool InsertLeaf(int nLeaf);
+	void RemoveLeaf(int nLeaf);
+	// Rotate the node up if its children are not balanced, return the node at its place;
+	int Balance(int nNode);
+
+	inline bool IsLeaf(int nNode) { return A3DAABBTREE_NULL == m_aNodes[nNode].nChild1; }
+
+protected:
+public:
+	A3DAABBTree();
+	~A3DAABBTree();
+
+	bool Init(FLOAT vMargin=A3DAABBTREE_MARGIN);
+	bool Release();
+	// Destroy all proxies;
+	bool Reset();
+
+	// Return A3DAABBTREE_NULL if out of memory;
+	int CreateProxy(const A3DVECTOR3& vMins, const A3DVECTOR3& vMaxs, LPVOID pData);
+	void DestroyProxy(int nProxy);
+	// Return true if the proxy has moved out of its fat box and has been inserted again;
+	bool MoveProxy(int nProxy, const A3DVECTOR3& vMins, const A3DVECTOR3& vMaxs);
+
+	/*
+		The queries append the data of the proxies whose fat boxes may be hit to aResults,
+		without clearing it first; it may contain some which are not really hit, so the caller
+		still tests each of them
+	*/
+	// Proxies which overlap a box;
+	void QueryAABB(const A3DVECTOR3& vMins, const A3DVECTOR3& vMaxs, abase::vector<LPVOID>& aResults);
+	// Proxies which the segment from vecStart to vecStart + vecDelta passes through;
+	void QueryRay(const A3DVECTOR3& vecStart, const A3DVECTOR3& vecDelta, abase::vector<LPVOID>& aResults);
+
+	inline LPVOID GetProxyData(int nProxy) { return m_aNodes[nProxy].pData; }
+	inline int GetProxyCount() { return m_nNumProxies; }
+	inline int GetHeight() { return A3DAABBTREE_NULL == m_nRoot ? 0 : m_aNodes[m_nRoot].nHeight; }
+};
+
+typedef A3DAABBTree * PA3DAABBTree;
+
+#endif//_A3DAABBTREE_H_
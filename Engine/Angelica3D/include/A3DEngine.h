@@ -45,6 +45,7 @@ typedef class A3DFont * PA3DFont;
 typedef class A3DCounter * PA3DCounter;
 typedef class A3DMeshCollector * PA3DMeshCollector;
 typedef class A3DMeshSorter * PA3DMeshSorter;
+typedef class A3DFrameArena * PA3DFrameArena;
 typedef class A3DVertexCollector * PA3DVertexCollector;
 typedef class A3DPlants * PA3DPlants;
 
@@ -111,6 +112,7 @@ private:
 	A3DMeshCollector *			m_pA3DMeshCollector;
 	A3DVertexCollector *		m_pA3DVertexCollector;
 	A3DMeshSorter *				m_pA3DMeshSorter;
+	A3DFrameArena *				m_pA3DFrameArena;		// Memory only used in one frame, reset in BeginRender;
 	A3DMoxMan *					m_pA3DMoxMan;
 	A3DModelMan *				m_pA3DModelMan;
 	A3DSurfaceMan *				m_pA3DSurfaceMan;
@@ -241,6 +243,7 @@ public:
 	inline A3DMeshCollector * GetMeshCollector() { return m_pA3DMeshCollector; }
 	inline A3DVertexCollector * GetVertexCollector() { return m_pA3DVertexCollector; }
 	inline A3DMeshSorter * GetMeshSorter() { return m_pA3DMeshSorter; }
+	inline A3DFrameArena * GetFrameArena() { return m_pA3DFrameArena; }
 	inline A3DMoxMan * GetA3DMoxMan() { return m_pA3DMoxMan; };
 	inline A3DModelMan * GetA3DModelMan() { return m_pA3DModelMan; }
 	inline A3DSurfaceMan * GetA3DSurfaceMan() { return m_pA3DSurfaceMan; }
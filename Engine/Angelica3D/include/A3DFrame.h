@@ -19,6 +19,7 @@
 #include "A3DMesh.h"
 #include "A3DDevice.h"
 #include "AList.h"
+#include "A3DResCache.h"
 
 class A3DBox;
 
@@ -57,6 +58,7 @@ protected:
 	A3DVECTOR3			m_vecPos;
 
 	bool				m_bDuplicated;
+	A3DRESHANDLE		m_hMoxRes;		// Handle of the mox file in A3DMoxMan which this frame comes from;
 public:
 	A3DFrame(); 
 	~A3DFrame();
@@ -129,10 +131,15 @@ public:
 	inline int GetVertCount() { return m_nVertCount; }
 	inline int GetIndexCount() { return m_nIndexCount; }
 
+	inline A3DRESHANDLE GetMoxRes() { return m_hMoxRes; }
+	inline void SetMoxRes(A3DRESHANDLE hRes) { m_hMoxRes = hRes; }
+
 	bool SetExtraMaterial(A3DMaterial * pMaterial);
 
 	bool Save(AFile * pFileToSave);
 	bool Load(A3DDevice * pDevice, AFile * pFileToLoad);
+	// Whether the frame and its meshes and child frames hold the same data as pFrame, as they are saved;
+	bool Match(A3DFrame * pFrame);
 };
 
 typedef A3DFrame * PA3DFrame;
@@ -0,0 +1,100 @@
+/*
+ * FILE: A3DFrameArena.h
+ *
+ * DESCRIPTION: A linear allocator for the data which only lives in one frame
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.	
+ */
+
+#ifndef _A3DFRAMEARENA_H_
+#define _A3DFRAMEARENA_H_
+
+#include "A3DPlatform.h"
+
+#define A3DFRAMEARENA_DEFAULTSIZE	(256 * 1024)
+#define A3DFRAMEARENA_ALIGN			16
+
+typedef struct _A3DFRAMEARENA_MARK
+{
+	LPVOID		pBlock;
+	DWORD		dwUsed;
+} A3DFRAMEARENA_MARK;
+
+/*
+	Memory is taken from the arena by moving a pointer and is never freed one by one. Reset()
+	frees all of it at once and is called by A3DEngine::BeginRender, so the memory from the
+	engine's arena is only valid until the next frame begins. When one frame needs more than
+	the arena has, new blocks are added and on the next Reset() all blocks are replaced by one
+	which is large enough, so a steady frame does not touch the heap at all.
+*/
+class A3DFrameArena
+{
+private:
+	typedef struct _ARENA_BLOCK
+	{
+		_ARENA_BLOCK *	pPrev;
+		_ARENA_BLOCK *	pNext;		// Blocks after the current one are free to use;
+		DWORD			dwSize;		// Bytes after the header;
+		DWORD			dwUsed;
+
+	} ARENA_BLOCK;
+
+	ARENA_BLOCK *	m_pFirstBlock;
+	ARENA_BLOCK *	m_pCurBlock;
+	int				m_nNumBlocks;
+	DWORD			m_dwTotalSize;		// Bytes of all blocks;
+
+	DWORD			m_dwAllocCount;		// Allocations from the arena in this frame;
+	DWORD			m_dwHeapAllocCount;	// Allocations from the heap by the arena in this frame;
+	DWORD			m_dwLastAllocCount;
+	DWORD			m_dwLastHeapAllocCount;
+	DWORD			m_dwTotalHeapAllocCount;
+
+	ARENA_BLOCK * NewBlock(DWORD dwSize);
+	void FreeBlocks();
+
+protected:
+public:
+	A3DFrameArena();
+	~A3DFrameArena();
+
+	bool Init(DWORD dwInitSize=A3DFRAMEARENA_DEFAULTSIZE);
+	bool Release();
+
+	// Free all memory taken from the arena and start a new frame;
+	void Reset();
+
+	// dwAlign must be a power of 2 and not larger than A3DFRAMEARENA_ALIGN;
+	LPVOID Alloc(DWORD dwSize, DWORD dwAlign=A3DFRAMEARENA_ALIGN);
+
+	// Memory taken after a mark can be freed by FreeToMark, marks must be freed in reverse order;
+	A3DFRAMEARENA_MARK GetMark();
+	void FreeToMark(const A3DFRAMEARENA_MARK& mark);
+
+	inline DWORD GetTotalSize() { return m_dwTotalSize; }
+	inline int GetBlockCount() { return m_nNumBlocks; }
+	// The counters of the last finished frame;
+	inline DWORD GetLastFrameAllocCount() { return m_dwLastAllocCount; }
+	inline DWORD GetLastFrameHeapAllocCount() { return m_dwLastHeapAllocCount; }
+	inline DWORD GetTotalHeapAllocCount() { return m_dwTotalHeapAllocCount; }
+};
+
+// Free all memory taken from the arena in a scope;
+class A3DFrameArenaScope
+{
+private:
+	A3DFrameArena *		m_pArena;
+	A3DFRAMEARENA_MARK	m_mark;
+
+public:
+	A3DFrameArenaScope(A3DFrameArena * pArena) { m_pArena = pArena; m_mark = pArena->GetMark(); }
+	~A3DFrameArenaScope() { m_pArena->FreeToMark(m_mark); }
+};
+
+typedef A3DFrameArena * PA3DFrameArena;
+
+#endif//_A3DFRAMEARENA_H_
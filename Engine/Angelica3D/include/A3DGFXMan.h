@@ -18,6 +18,8 @@
 #include "A3DDevice.h"
 #include "A3DTypes.h"
 #include "AList.h"
+#include "ASlotList.h"
+#include "AFileAtom.h"
 #include "A3DGraphicsFX.h"
 #include "A3DGFXCollector.h"
 
@@ -28,9 +30,12 @@ private:
 	char			m_szTextureFolder[MAX_PATH];
 
 	A3DDevice		* m_pA3DDevice;
-	AList			m_GFXList;
+	ASlotList		m_GFXList;
 
 	AList			m_PreloadedGFXFilesList;
+	// Preloaded file images indexed by the atom of their file name;
+	typedef abase::flat_hashtab<AFileImage *, AFILEATOM, AFileAtom_Hash> FILEIMAGETAB;
+	FILEIMAGETAB	m_PreloadedGFXFilesTab;
 
 	AFileImage * 	FindFileImage(char * szFileName);
 
@@ -20,6 +20,7 @@
 #include "A3DDevice.h"
 #include "A3DTypes.h"
 #include "AList.h"
+#include "ASlotList.h"
 
 class A3DParticleSystem;
 class A3DSuperSpray;
@@ -124,7 +125,7 @@ private:
 	A3DMATRIX4			m_matParentTM;
 	A3DMATRIX4			m_matAbsoluteTM;
 
-	ALISTELEMENT		* m_pStoredElement; //Where this graphics fx is stored; used when release it;
+	ASLOTHANDLE			m_hStoredSlot; //Where this graphics fx is stored in gfx man; used when release it;
 	ALISTELEMENT		* m_pStoredElementInHost; //Where this graphics fx is stored in its host model;
 
 	FLOAT				m_vMaxDecalSize;
@@ -221,8 +222,8 @@ public:
 	inline A3DVECTOR3 GetDir() { return m_vecDir; }
 	inline A3DVECTOR3 GetUp()  { return m_vecUp; }
 
-	inline void SetStoredElement(ALISTELEMENT * pStoredElement) { m_pStoredElement = pStoredElement; }
-	inline ALISTELEMENT * GetStoredElement() { return m_pStoredElement; }
+	inline void SetStoredSlot(ASLOTHANDLE hStoredSlot) { m_hStoredSlot = hStoredSlot; }
+	inline ASLOTHANDLE GetStoredSlot() { return m_hStoredSlot; }
 
 	inline AList * GetSuperSprayList() { return &m_SuperSprayList; }
 	inline AList * GetPArrayList() { return &m_PArrayList; }
@@ -86,7 +86,6 @@ protected:
 	int							m_nNumFaces;		// Total faces of this scene;
 	A3DIBLVERTEX *				m_pAllFaces;		// Faces buffer that consist of seperate vertex;
 	A3DIBLSCENE_FACE_RECORD *	m_pFaceRecords;		// Buffer stores each face's texture id and reference info;
-	A3DIBLSCENE_SORTEDFACE *	m_pSortedFaces;		// Buffer used for sorts;
 
 	int							m_nNumVisibleFaces;	// Number of Visible Faces;
 
@@ -62,6 +62,10 @@ private:
 
 	char			m_szTextureMap[MAX_PATH];
 	char			m_szDetailTextureMap[MAX_PATH];
+	int				m_nTexturePathLen;	// Length of the texture path before the names in the maps, -1 if the maps were not set by Load;
+
+	// Get the texture name to save, Load expects it relative to the texture path of the mox file;
+	char * GetSavedTextureName(char * szTextureMap, A3DTexture * pTexture);
 
 public:
 	A3DMesh();
@@ -123,6 +127,8 @@ public:
 
 	bool Save(AFile * pFileToSave);
 	bool Load(A3DDevice * pDevice, AFile * pFileToLoad);
+	// Whether the mesh holds the same data as pMesh, as it is saved;
+	bool Match(A3DMesh * pMesh);
 
 private:
 	bool		m_bHasLOD;
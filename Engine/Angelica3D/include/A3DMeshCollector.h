@@ -61,7 +61,7 @@ public:		//	Types
 		MAXNUM_RENDERIDX	= 8192*2,	//	Maximum number of index can be rendered together
 	};
 
-	//	Mesh information
+	//	Mesh information, it is taken from engine's frame arena and only lives in one frame
 	typedef struct _MESHINFO
 	{
 		A3DMesh*		pMesh;			//	Mesh address
@@ -111,13 +111,9 @@ protected:	//	Attributes
 	WORD*		m_pIndexBuffer;		//	A3D index buffer
 	AList		m_TextureList;		//	Texture list
 
-	abase::vector<MESHINFO*>	m_aMeshPool;	//	Mesh information poor
-	int			m_iPoolCnt;						//	Pool counter
-
 protected:	//	Operations
 
 	void		ReleaseAllTextures(bool bReset);	//	Release all texture
-	void		ReleaseAllMeshInfo();				//	Release all mesh information
 };
 
 
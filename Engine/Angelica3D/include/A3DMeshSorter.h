@@ -49,20 +49,15 @@ class A3DMeshSorter
 {
 public:		//	Types
 
-	enum
-	{
-		SIZE_BUFGROUP	= 16,		//	Size of node buffer group
-		SIZE_NODEBUF	= 1024		//	Size of each node buffer
-	};
-
+	//	Mesh nodes are taken from engine's frame arena, so they only live in one frame
 	typedef	struct _MESHNODE
 	{
+		A3DMATRIX4			matTrans;		//	Mesh's translate matrix
 		A3DMesh*			pMesh;			//	Mesh's address
 		int					iCurFrame;		//	Mesh's current frame
-		A3DMATRIX4			matTrans;		//	Mesh's translate matrix
 		float				fWeight;		//	Mesh's weight used for sorting
 		A3DIBLLIGHTPARAM 	iblLightParam;	//	parameter describe current ibl light
-		ALISTELEMENT*		pRecordElement; //	Record element in the AList, used when delete it;
+		_MESHNODE*			pNext;			//	Next node in sorted list
 
 	} MESHNODE, *PMESHNODE;
 
@@ -91,23 +86,13 @@ protected:	//	Attributes
 	A3DDevice*	m_pDevice;			//	A3DDevice
 
 	bool		m_bIncrease;		//	true, increase sorting
-	AList		m_MeshList;			//	Mesh list
+	MESHNODE*	m_pMeshList;		//	Sorted mesh list
 	A3DVECTOR3	m_vCameraPos;		//	Camera position
-
-	MESHNODE*	m_aNodeBufs[SIZE_BUFGROUP];	//	Node buffer
-	int			m_iNumNode;			//	Current used number of node in last group
-	int			m_iCurGroup;		//	Current used group
-	int			m_iNumGroup;		//	Number of buffer group
-
-	ALISTELEMENT*	m_pCurNode;		//	Current mesh node
+	int			m_iNumNode;			//	Number of node in list
 
 	// IBL Light sections;
 	A3DLight	* m_pIBLStaticLight;//	a static light used for IBL scene
 	A3DLight	* m_pIBLDynamicLight;// a dynamic light used for IBL scene
-protected:	//	Operations
-
-	bool		AppendNodeBuffer();	//	Append a group of node buffer
-
 public:
 	inline void SetIBLLight(A3DLight * pStaticLight, A3DLight * pDynamicLight) 
 	{ m_pIBLStaticLight = pStaticLight; m_pIBLDynamicLight = pDynamicLight; }
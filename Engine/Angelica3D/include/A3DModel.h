@@ -20,8 +20,11 @@
 #include "A3DTexture.h"
 #include "A3DDevice.h"
 #include "AList.h"
+#include "ASlotList.h"
+#include "A3DResCache.h"
 #include "A3DTrace.h"
 #include "A3DBox.h"
+#include "A3DAABBTree.h"
 
 #include <AM3DSoundBuffer.h>
 
@@ -117,6 +120,69 @@ typedef struct _A3DMODEL_SFX_RECORD
 	
 } A3DMODEL_SFX_RECORD;
 
+// The binary model file is "MODEL: name", a header and a body which is read with one call;
+// the body holds the child frame and child model names, the records below and the properties;
+#define A3DMODEL_BINVERSION		1
+
+typedef struct _A3DMODEL_BINHEADER
+{
+	DWORD		dwVersion;
+	int			nNumChildFrames;
+	int			nNumChildModels;
+	int			nNumActions;
+	int			nNumGroupActions;
+	int			nNumGFXEvents;
+	int			nNumSFXEvents;
+	int			nNumLogicEvents;
+	DWORD		dwNameSize;		// Bytes of the names, padded to 4 bytes so the records are aligned;
+
+} A3DMODEL_BINHEADER;
+
+typedef struct _A3DMODEL_BINACTION
+{
+	char		szName[32];
+	int			nAnimStart;
+	int			nAnimEnd;
+	int			nLoop;
+
+} A3DMODEL_BINACTION;
+
+typedef struct _A3DMODEL_BINGROUPACTION
+{
+	char		szName[32];
+	char		aActionNames[A3D_GROUP_ACTION_MAX_ELEMENT][32];	// Empty slots are "";
+
+} A3DMODEL_BINGROUPACTION;
+
+typedef struct _A3DMODEL_BINGFXEVENT
+{
+	int			nFrame;
+	char		szGFXName[MAX_PATH];
+	int			nLinked;
+	FLOAT		vScale;
+	char		szParentName[32];
+	A3DVECTOR3	vecPos;
+	A3DVECTOR3	vecDir;
+	A3DVECTOR3	vecUp;
+
+} A3DMODEL_BINGFXEVENT;
+
+typedef struct _A3DMODEL_BINSFXEVENT
+{
+	int			nFrame;
+	char		szSFXName[MAX_PATH];
+	int			nLoop;
+	int			n2DSound;
+	FLOAT		vMinDis;
+	FLOAT		vMaxDis;
+	FLOAT		vVolume;
+	char		szParentName[32];
+	A3DVECTOR3	vecPos;
+	A3DVECTOR3	vecDir;
+	A3DVECTOR3	vecUp;
+
+} A3DMODEL_BINSFXEVENT;
+
 typedef void (* LOGIC_EVENT_CALLBACK)(A3DMODEL_LOGIC_EVENT * pLogicEvent, LPVOID pArg);
 
 class A3DModel : public A3DObject
@@ -131,6 +197,10 @@ private:
 
 	// Settle down in which container;
 	A3DCONTAINER		m_Container;
+	ASLOTHANDLE			m_hContainerSlot;	// Handle of this model in the container's list;
+	A3DRESHANDLE		m_hModelRes;		// Handle of the model file in A3DModelMan which this model comes from;
+	A3DAABBTree *		m_pTraceTree;		// The tree of the world which finds this model for the traces;
+	int					m_nTraceProxy;		// Proxy of this model in m_pTraceTree;
 
 	int					m_nHeartBeats;
 
@@ -160,7 +230,7 @@ private:
 	A3DVECTOR3			m_vecAABBTraceExtents;
 
 	bool				m_bHasMoved;
-	AList				m_ModelOBBList; // OBBs which art designer has pointed out handedly
+	ASlotList			m_ModelOBBList; // OBBs which art designer has pointed out handedly
 	A3DAABB				m_ModelAABB; //AABB of this model, calculated whether by obblist or auto obbs
 	A3DOBB				m_ModelOBB;
 
@@ -381,11 +451,27 @@ public:
 
 	bool UpdateAbsoluteTM();
 	bool UpdateRelativeTM();
+
+	// Put this model into a trace tree, or take it out with NULL; the proxy is refitted when
+	// the position or the model AABB changes;
+	bool SetTraceTree(A3DAABBTree * pTree);
+	// The box which bounds all that a trace may hit on this model;
+	void GetTraceBound(A3DVECTOR3& vecMins, A3DVECTOR3& vecMaxs);
+	inline void UpdateTraceProxy() { if( m_pTraceTree ) RefitTraceProxy(); }
 	
 	bool GetFrameLocation(char * szFrameName, A3DMATRIX4 matParent, A3DVECTOR3 * vecPos, A3DVECTOR3 * vecX, A3DVECTOR3 * vecY, A3DVECTOR3 * vecZ);
 
 	bool Save(AFile * pFileToSave);
 	bool Load(A3DDevice * pA3DDevice, AFile * pFileToLoad);
+	// Whether the model holds the same child frames and models, actions, events and properties as pModel;
+	bool Match(A3DModel * pModel);
+protected:
+	void RefitTraceProxy();
+	// Load a child frame from the mox file in the same folder as the model file;
+	bool LoadChildFrame(A3DDevice * pA3DDevice, AFile * pFileToLoad, char * szFrameName);
+	// Create the model from the body of a binary model file;
+	bool LoadBinaryBody(A3DDevice * pA3DDevice, AFile * pFileToLoad, A3DMODEL_BINHEADER& header, LPBYTE pBody);
+public:
 
 	bool LoadImmEffect();
 	bool UnloadImmEffect();
@@ -441,7 +527,7 @@ public:
 	inline AList * GetGFXList()	{ return &m_GFXList; }
 	inline AList * GetSFXEventList() { return &m_SFXEventList; }
 	inline AList * GetLogicEventList() { return &m_LogicEventList; }
-	inline AList * GetModelOBBList() { return &m_ModelOBBList; }
+	inline ASlotList * GetModelOBBList() { return &m_ModelOBBList; }
 	inline A3DModel * GetParentModel() { return m_pParentModel; }
 	inline A3DFrame * GetParentFrame() { return m_pParentFrame; }
 	inline bool IsChildModel() { return m_pParentFrame || m_pParentModel ? true : false; }
@@ -461,14 +547,19 @@ public:
 
 	inline A3DCONTAINER GetContainer() { return m_Container; }
 	inline void SetContainer(A3DCONTAINER container) { m_Container = container; }
+	inline ASLOTHANDLE GetContainerSlot() { return m_hContainerSlot; }
+	inline void SetContainerSlot(ASLOTHANDLE hSlot) { m_hContainerSlot = hSlot; }
+	inline A3DRESHANDLE GetModelRes() { return m_hModelRes; }
+	inline void SetModelRes(A3DRESHANDLE hRes) { m_hModelRes = hRes; }
 
 	inline void SetAABBTraceOnlyShape(A3DVECTOR3& vecLocalCenter, A3DVECTOR3& vecExtents)
 	{ 
 		m_vecAABBTraceCenter = vecLocalCenter;
 		m_vecAABBTraceExtents = vecExtents; 
 		m_bTraceMoveAABBOnly = true; 
+		UpdateTraceProxy();
 	}
-	inline void ClearAABBTraceExtents() { m_bTraceMoveAABBOnly = false; }
+	inline void ClearAABBTraceExtents() { m_bTraceMoveAABBOnly = false; UpdateTraceProxy(); }
 	inline bool GetTraceMoveAABBOnly() { return m_bTraceMoveAABBOnly; }
 
 	inline A3DModel * GetRealParentModel() { return m_pRealParentModel; }
@@ -18,27 +18,33 @@
 #include "A3DTypes.h"
 #include "A3DDevice.h"
 #include "A3DModel.h"
-#include "AList.h"
+#include "A3DResCache.h"
 #include "A3DModelCollector.h"
 
-typedef struct _MODELRECORD
-{
-	char		szFilename[MAX_PATH];
-	A3DModel	* pModel;
-} MODELRECORD, * PMODELRECORD;
+// Bytes of model files not used by any model to keep for the next load;
+#define A3DMODELMAN_CACHEBUDGET		(4 * 1024 * 1024)
 
+/*
+	The models given out are duplicates of the one loaded from the model file, they use its
+	action lists, so each of them holds a reference to the loaded one until it is released
+	by A3DModel::Release, either directly or by the model collector. A child model is the
+	loaded one itself, its parent holds a reference to it;
+*/
 class A3DModelMan : public A3DData
 {
 private:
 	char					m_szFolderName[MAX_PATH];
 
 	A3DDevice *				m_pA3DDevice;
-	AList					m_ListModel;
+	A3DResCache				m_ResCache;
 
 	A3DModelCollector *		m_pModelCollector;
 
-protected:
-	bool FindModelFile(char * szFilename, A3DModel ** ppFrame);
+	static void FreeModel(LPVOID pRes, LPVOID pArg);
+	// Give out a loaded model which holds a reference to hRes for the caller;
+	bool GiveModel(A3DModel * pModel, A3DRESHANDLE hRes, A3DModel ** ppModel, bool bChild);
+	// Load a compiled model file and compare it with the model loaded from the text file;
+	bool VerifyCompiledModel(A3DModel * pSrcModel, char * szDestFile);
 
 public:
 	A3DModelMan();
@@ -50,10 +56,18 @@ public:
 
 	bool LoadModelFile(char * szFilename, A3DModel ** ppModel, bool bChild=false);
 	bool ReleaseModel(A3DModel *& pModel);
+	// Release the reference held by a duplicated model, called by A3DModel::Release;
+	bool ReleaseModelRes(A3DRESHANDLE hRes);
+
+	// Load a text model file and save it as a binary one with the same relative name
+	// under szDestFolder, its child models and child frames' mox files are compiled too;
+	bool CompileModelFile(char * szFilename, char * szDestFolder);
 
 	inline void SetFolderName(char * szFolderName) { strcpy(m_szFolderName, szFolderName); }
 	inline char * GetFolderName() { return m_szFolderName; }
-	inline int GetModelCount() { return m_ListModel.GetSize(); }
+	inline int GetModelCount() { return m_ResCache.GetResCount(); }
+	inline void SetCacheBudget(DWORD dwBudget) { m_ResCache.SetBudget(dwBudget); }
+	inline void GetCacheStats(A3DRESCACHE_STATS * pStats) { m_ResCache.GetStats(pStats); }
 };
 
 typedef A3DModelMan * PA3DModelMan;
@@ -18,23 +18,30 @@
 #include "A3DTypes.h"
 #include "A3DDevice.h"
 #include "A3DFrame.h"
-#include "AList.h"
+#include "A3DResCache.h"
 
-typedef struct _MOXRECORD
-{
-	char		szFilename[MAX_PATH];
-	A3DFrame	* pFrame;
-} MOXRECORD, * PMOXRECORD;
+// Bytes of mox files not used by any frame to keep for the next load;
+#define A3DMOXMAN_CACHEBUDGET		(16 * 1024 * 1024)
 
+/*
+	The frames given out are duplicates of the one loaded from the mox file, they share its
+	meshes, so each of them holds a reference to the loaded one until it is released by
+	ReleaseFrame;
+*/
 class A3DMoxMan : public A3DData
 {
 private:
 	char		m_szFolderName[MAX_PATH];
 
 	A3DDevice * m_pA3DDevice;
-	AList	    m_ListMox;
+	A3DResCache	m_ResCache;
+
+	static void FreeFrame(LPVOID pRes, LPVOID pArg);
+	// Duplicate a frame which holds a reference to hRes for the new one;
+	bool DuplicateFrameOfRes(A3DFrame * pOrgFrame, A3DRESHANDLE hRes, A3DFrame ** ppNewFrame);
+	// Load a compiled mox file and compare it with the frame loaded from the text file;
+	bool VerifyCompiledMox(A3DFrame * pSrcFrame, char * szDestFile);
 
-	bool FindMoxFile(char * szFilename, A3DFrame ** ppFrame);
 public:
 	A3DMoxMan();
 	~A3DMoxMan();
@@ -46,10 +53,15 @@ public:
 	bool LoadMoxFile(char * szFilename, A3DFrame ** ppFrame);
 	bool ReleaseFrame(A3DFrame *& pFrame);
 	bool DuplicateFrame(A3DFrame * pOrgFrame, A3DFrame ** ppNewFrame);
+
+	// Load a text mox file and save it as a binary one with the same relative name under szDestFolder;
+	bool CompileMoxFile(char * szFilename, char * szDestFolder);
 					
 	inline void SetFolderName(char * szFolderName) { strcpy(m_szFolderName, szFolderName); }
 	inline char * GetFolderName() { return m_szFolderName; }
-	inline int GetMoxCount() { return m_ListMox.GetSize(); }
+	inline int GetMoxCount() { return m_ResCache.GetResCount(); }
+	inline void SetCacheBudget(DWORD dwBudget) { m_ResCache.SetBudget(dwBudget); }
+	inline void GetCacheStats(A3DRESCACHE_STATS * pStats) { m_ResCache.GetStats(pStats); }
 };
 
 typedef A3DMoxMan * PA3DMoxMan;
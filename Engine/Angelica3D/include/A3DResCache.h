@@ -0,0 +1,158 @@
+/*
+ * FILE: A3DResCache.h
+ *
+ * DESCRIPTION: A reference counted cache of the resources loaded from files, it is the
+ *				common part of the texture, model, mox and surface managers;
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#ifndef _A3DRESCACHE_H_
+#define _A3DRESCACHE_H_
+
+#include "A3DPlatform.h"
+#include "A3DData.h"
+#include "ASlotList.h"
+#include "AFileAtom.h"
+
+// A handle to a resource in the cache, it is not valid any more after the resource is freed;
+typedef ASLOTHANDLE A3DRESHANDLE;
+
+#define A3DRESHANDLE_NULL	ASLOTHANDLE_NULL
+
+// Called when the cache frees a resource, pArg is the one passed to Init;
+typedef void (* A3DRESCACHE_FREEFUNC)(LPVOID pRes, LPVOID pArg);
+
+// Number of the parameters in a key besides the file atom;
+#define A3DRESKEY_NUMPARAMS	4
+
+// The key of a resource, a file which is loaded with different parameters is kept once for each;
+typedef struct _A3DRESKEY
+{
+	AFILEATOM	atom;
+	DWORD		aParams[A3DRESKEY_NUMPARAMS];	// 0 if not used;
+
+	inline bool operator==(const _A3DRESKEY& rhs) const { return 0 == memcmp(this, &rhs, sizeof(_A3DRESKEY)); }
+} A3DRESKEY;
+
+typedef struct _A3DRESCACHE_STATS
+{
+	DWORD		dwHits;
+	DWORD		dwMisses;
+	DWORD		dwEvictions;
+	DWORD		dwLoadTime;			// Milliseconds spent to load the missed resources;
+	DWORD		dwResidentBytes;	// Estimated size of all resources in the cache;
+	int			nNumRes;
+	int			nNumReferenced;
+} A3DRESCACHE_STATS;
+
+/*
+	Each resource is keyed by the atom of its file name and the parameters it is loaded with,
+	and holds a reference count. When the
+	count falls to 0 the resource is not freed but kept in a LRU list, so the next load of the
+	same file is a hit; the least recently used ones are evicted when the resident size is over
+	the budget. A budget of 0 frees a resource as soon as it is not referenced.
+	The free function may call back into the cache, eg. to release the resources which the
+	freed one refers to;
+*/
+class A3DResCache : public A3DData
+{
+private:
+	typedef struct _A3DRESCACHE_NODE
+	{
+		A3DRESKEY		key;
+		LPVOID			pRes;
+		DWORD			dwSize;
+		int				nRefCount;
+		A3DRESHANDLE	hRes;			// Handle of the node in m_ListNode;
+
+		_A3DRESCACHE_NODE *	pPrevLRU;	// Only unreferenced nodes are in the LRU list;
+		_A3DRESCACHE_NODE *	pNextLRU;
+
+	} A3DRESCACHE_NODE;
+
+	struct RESKEY_HASH
+	{
+		inline unsigned long operator()(const A3DRESKEY& key) const
+		{
+			unsigned long h = key.atom;
+			for(int i=0; i<A3DRESKEY_NUMPARAMS; i++)
+				h = (h ^ key.aParams[i]) * 16777619;
+			return h;
+		}
+	};
+
+	typedef abase::flat_hashtab<A3DRESCACHE_NODE *, A3DRESKEY, RESKEY_HASH> KEYTAB;
+	typedef abase::flat_hashtab<A3DRESCACHE_NODE *, LPVOID, abase::_hash_function> RESTAB;
+
+	A3DRESCACHE_FREEFUNC	m_pfnFree;
+	LPVOID					m_pFreeArg;
+
+	ASlotList				m_ListNode;
+	KEYTAB					m_KeyTab;
+	RESTAB					m_ResTab;
+
+	A3DRESCACHE_NODE *		m_pLRUHead;		// The least recently used one;
+	A3DRESCACHE_NODE *		m_pLRUTail;
+
+	DWORD					m_dwBudget;		// Max bytes of resources to keep;
+	A3DRESCACHE_STATS		m_stats;
+
+	inline A3DRESCACHE_NODE * GetNode(A3DRESHANDLE hRes) { return (A3DRESCACHE_NODE *) m_ListNode.GetData(hRes); }
+	void AddToLRU(A3DRESCACHE_NODE * pNode);
+	void RemoveFromLRU(A3DRESCACHE_NODE * pNode);
+	void FreeNode(A3DRESCACHE_NODE * pNode);
+	// Evict the unreferenced resources until we are in the budget;
+	void Trim();
+
+protected:
+public:
+	A3DResCache();
+	~A3DResCache();
+
+	bool Init(DWORD dwBudget, A3DRESCACHE_FREEFUNC pfnFree, LPVOID pFreeArg);
+	// Free all resources, referenced or not;
+	bool Release();
+	// Evict the unreferenced resources which are out of the budget, the others are kept warm;
+	bool Reset();
+
+	/*
+		Find a resource and add a reference to it, the lookup is counted as a hit or a miss;
+		return NULL if it is not in the cache, then the caller loads it and calls AddRes
+	*/
+	LPVOID AcquireRes(const A3DRESKEY& key, A3DRESHANDLE * phRes=NULL);
+	LPVOID AcquireRes(AFILEATOM atom, A3DRESHANDLE * phRes=NULL);
+	// Add a loaded resource with one reference, dwSize is its estimated size in bytes;
+	A3DRESHANDLE AddRes(const A3DRESKEY& key, LPVOID pRes, DWORD dwSize, DWORD dwLoadTime);
+	A3DRESHANDLE AddRes(AFILEATOM atom, LPVOID pRes, DWORD dwSize, DWORD dwLoadTime);
+	bool AddRef(A3DRESHANDLE hRes);
+	// Return false if the handle is not valid any more;
+	bool ReleaseRes(A3DRESHANDLE hRes);
+	// Free a resource now however many references it has;
+	bool FreeRes(A3DRESHANDLE hRes);
+
+	// Return A3DRESHANDLE_NULL if the resource is not in the cache;
+	A3DRESHANDLE FindHandle(LPVOID pRes);
+	LPVOID GetRes(A3DRESHANDLE hRes);
+	int GetRefCount(A3DRESHANDLE hRes);
+
+	// Free all unreferenced resources;
+	void Flush();
+
+	void SetBudget(DWORD dwBudget);
+	inline DWORD GetBudget() { return m_dwBudget; }
+	inline void GetStats(A3DRESCACHE_STATS * pStats) { *pStats = m_stats; }
+
+	// All resources in the cache, the order is changed when one is freed;
+	inline int GetResCount() { return m_ListNode.GetSize(); }
+	inline LPVOID GetResAt(int nIndex) { return ((A3DRESCACHE_NODE *) m_ListNode.GetAt(nIndex))->pRes; }
+	inline A3DRESHANDLE GetHandleAt(int nIndex) { return m_ListNode.GetHandleByIndex(nIndex); }
+};
+
+typedef A3DResCache * PA3DResCache;
+
+#endif//_A3DRESCACHE_H_
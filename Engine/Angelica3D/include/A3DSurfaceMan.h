@@ -17,12 +17,25 @@
 #include "A3DTypes.h"
 #include "A3DDevice.h"
 #include "A3DSurface.h"
+#include "A3DResCache.h"
 
+// Bytes of unreferenced surfaces to keep for the next load;
+#define A3DSURFACEMAN_CACHEBUDGET		(8 * 1024 * 1024)
+
+/*
+	The surfaces are shared by all the loads of the same file with the same size and color key,
+	they should be taken as read-only;
+*/
 class A3DSurfaceMan : public A3DData
 {
 private:
 	A3DDevice *				m_pA3DDevice;
 	char					m_szFolderName[MAX_PATH];
+	A3DResCache				m_ResCache;
+
+	static void FreeSurface(LPVOID pRes, LPVOID pArg);
+	// The key of a surface in the cache is made of the atom of the file name and the parameters;
+	static void MakeSurfaceKey(A3DRESKEY * pKey, AFILEATOM atom, int nWidth, int nHeight, A3DCOLOR colorKey, bool bCursor);
 
 public:
 	A3DSurfaceMan();
@@ -37,6 +50,9 @@ public:
 	bool ReleaseSurface(PA3DSurface& pSurface);
 
 	inline void SetFolderName(char * szFolderName) { strncpy(m_szFolderName, szFolderName, MAX_PATH); }
+	inline int GetSurfaceCount() { return m_ResCache.GetResCount(); }
+	inline void SetCacheBudget(DWORD dwBudget) { m_ResCache.SetBudget(dwBudget); }
+	inline void GetCacheStats(A3DRESCACHE_STATS * pStats) { m_ResCache.GetStats(pStats); }
 };
 
 typedef A3DSurfaceMan * PA3DSurfaceMan;
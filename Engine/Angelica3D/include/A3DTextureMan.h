@@ -17,22 +17,19 @@
 #include "A3DTypes.h"
 #include "A3DDevice.h"
 #include "A3DTexture.h"
-#include "AList.h"
+#include "A3DResCache.h"
 
-typedef struct _TEXTURERECORD
-{
-	char				szFilename[MAX_PATH];
-	A3DTexture			*pA3DTexture;
-	int					nRefCount;
-} TEXTURERECORD, * PTEXTURERECORD;
+// Bytes of unreferenced textures to keep for the next load;
+#define A3DTEXTUREMAN_CACHEBUDGET		(32 * 1024 * 1024)
 
 class A3DTextureMan : public A3DData
 {
 private:
-	A3DDevice * m_pA3DDevice;
-	AList	    m_ListTexture;
+	A3DDevice *		m_pA3DDevice;
+	A3DResCache		m_ResCache;
 
-	bool FindTexture(char * szFilename, A3DTexture ** ppA3DTexture);
+	static void FreeTexture(LPVOID pRes, LPVOID pArg);
+	static DWORD GetTextureSize(A3DTexture * pTexture);
 
 public:
 	A3DTextureMan();
@@ -54,7 +51,9 @@ public:
 	
 	bool PrecacheAllTexture();
 
-	inline int GetTextureCount() { return m_ListTexture.GetSize(); }
+	inline int GetTextureCount() { return m_ResCache.GetResCount(); }
+	inline void SetCacheBudget(DWORD dwBudget) { m_ResCache.SetBudget(dwBudget); }
+	inline void GetCacheStats(A3DRESCACHE_STATS * pStats) { m_ResCache.GetStats(pStats); }
 };
 
 typedef A3DTextureMan * PA3DTextureMan;
@@ -20,7 +20,8 @@
 #include "A3DEsp.h"
 #include "A3DTerrain.h"
 #include "A3DSky.h"
-#include "AList.h"
+#include "ASlotList.h"
+#include "A3DAABBTree.h"
 #include "A3DTrace.h"
 #include "A3DLamp.h"   
 #include "A3DScene.h"
@@ -112,9 +113,12 @@ private:
 	A3DScene *		m_pA3DScene;
 
 	//Building Model List;
-	AList			m_ListBuildingModels;
+	ASlotList		m_ListBuildingModels;
 	//Object Model List;
-	AList			m_ListObjectModels;
+	ASlotList		m_ListObjectModels;
+	//Tree of the object models, the traces only test the models it finds;
+	A3DAABBTree		m_ObjectTree;
+	abase::vector<LPVOID>	m_aTraceModels;
 
 	DWORD			m_dwModelRayTraceMask;
 	DWORD			m_dwModelAABBTraceMask;
@@ -131,10 +135,10 @@ public:
 	bool Render(A3DViewport * pCurrentViewport);
 	bool TickAnimation();
 
-	bool AddBuildingModel(A3DModel * pBuildingModel, A3DVECTOR3 vecPos, A3DVECTOR3 vecDir, A3DVECTOR3 vecUp, ALISTELEMENT ** ppElement);
-	bool AddObjectModel(A3DModel * pObjectModel, A3DVECTOR3 vecPos, A3DVECTOR3 vecDir, A3DVECTOR3 vecUp, ALISTELEMENT ** ppElement);
+	bool AddBuildingModel(A3DModel * pBuildingModel, A3DVECTOR3 vecPos, A3DVECTOR3 vecDir, A3DVECTOR3 vecUp, ASLOTHANDLE * phSlot);
+	bool AddObjectModel(A3DModel * pObjectModel, A3DVECTOR3 vecPos, A3DVECTOR3 vecDir, A3DVECTOR3 vecUp, ASLOTHANDLE * phSlot);
 
-	bool DeleteObjectModel(ALISTELEMENT * pElement);
+	bool DeleteObjectModel(ASLOTHANDLE hSlot);
 	bool DeleteObjectModel(A3DModel * pModel);
 	bool DeleteBuildingModel(A3DModel * pModel);
 
@@ -177,8 +181,9 @@ public:
 	inline void ClearModelAABBTraceMask(DWORD dwMask) { m_dwModelAABBTraceMask &= ~dwMask; }
 	inline DWORD GetModelRayTraceMask() { return m_dwModelRayTraceMask; }
 	inline DWORD GetModelAABBTraceMask() { return m_dwModelAABBTraceMask; }
-	inline AList * GetObjectsList() { return &m_ListObjectModels; }
-	inline AList * GetBuildingsList() { return &m_ListBuildingModels; }
+	inline ASlotList * GetObjectsList() { return &m_ListObjectModels; }
+	inline ASlotList * GetBuildingsList() { return &m_ListBuildingModels; }
+	inline A3DAABBTree * GetObjectTree() { return &m_ObjectTree; }
 };
 
 typedef A3DWorld * PA3DWorld;
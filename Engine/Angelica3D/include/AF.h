@@ -22,5 +22,10 @@
 #include "AStringTable.h"
 
 #include "AFilePackage.h"
+#include "AFilePrefetch.h"
+#include "AFileImageCache.h"
+#include "AFileMount.h"
+#include "AFileTrace.h"
+#include "AFileTokenizer.h"
 
 #endif
\ No newline at end of file
@@ -36,6 +36,80 @@ void AFileMod_GetFullPath(char * szFullPath, char * szFileName);
 void AFileMod_GetRelativePath(char * szFullPath, char * szFolderName, char * szRelativePath);
 void AFileMod_GetRelativePath(char * szFullPath, char * szRelativePath);
 
+// Callback of a prefetched file, it is called on an IO thread;
+typedef void (*AFPREFETCH_CALLBACK)(char * szFileName, bool bSuccess, LPVOID pArg);
+
+// Start and stop the IO threads which load files ahead of time; AFileImage::Open
+// will take the prefetched images instead of reading the files again;
+bool AFileMod_StartPrefetch(int nNumThreads=2);
+bool AFileMod_StopPrefetch();
+
+// Queue some files to be read by the IO threads, szFileNames are full paths,
+// return the number of files queued;
+int AFileMod_Prefetch(char ** aFileNames, int nNumFiles, AFPREFETCH_CALLBACK pfnCallback=NULL, LPVOID pArg=NULL);
+
+// Wait until all queued files have been read;
+bool AFileMod_WaitPrefetch(DWORD dwTimeOut=INFINITE);
+
+// Free all prefetched images which have not been used;
+void AFileMod_DiscardPrefetch();
+
+typedef struct _AFIMAGECACHE_STATS
+{
+	DWORD		dwHits;				// Opens served from the cache;
+	DWORD		dwMisses;			// Opens which have to read the package;
+	DWORD		dwEvictions;		// Images evicted to keep in the budget;
+	DWORD		dwResidentBytes;	// Bytes of images in the cache;
+	int			nNumImages;			// Number of images in the cache;
+	int			nNumReferenced;		// Number of images being used;
+} AFIMAGECACHE_STATS;
+
+// Enable a cache of uncompressed package file images, so files opened many times by
+// AFileImage will be read and uncompressed only once; dwBudget is the max bytes of 
+// images to keep, the images being used will never be evicted;
+bool AFileMod_EnableImageCache(DWORD dwBudget);
+bool AFileMod_DisableImageCache();
+bool AFileMod_GetImageCacheStats(AFIMAGECACHE_STATS * pStats);
+
+// Mount a package or a directory as a layer of the file system, then AFileImage will
+// find the files in the layers instead of g_pAFilePackage; a file in a layer of higher
+// priority hides the same file in the lower layers, so patches can be mounted over 
+// the base package; the files of a directory are scanned when mounting;
+bool AFileMod_MountPackage(char * szPackFile, int nPriority, bool bMapped=false);
+bool AFileMod_MountDir(char * szDir, int nPriority);
+bool AFileMod_Unmount(char * szPath);
+bool AFileMod_UnmountAll();
+
+// I/O counters of the file module since initialized or reset, they are DWORDs and may 
+// wrap in a very long run; the time is in microseconds;
+typedef struct _AFILE_IOSTATS
+{
+	DWORD		dwFileOpens;		// Files opened by AFile;
+	DWORD		dwFileBytesRead;	// Bytes read by AFile;
+	DWORD		dwFileSeeks;		// AFile::Seek calls;
+	DWORD		dwImageOpens;		// Files opened by AFileImage;
+	DWORD		dwImageBytes;		// Uncompressed bytes of the images opened;
+	DWORD		dwPrefetchHits;		// Images taken from the prefetcher;
+	DWORD		dwPackageReads;		// Reads of package entries;
+	DWORD		dwPackageBytes;		// Uncompressed bytes of the package entries read;
+	DWORD		dwPackageCompressedBytes;	// Bytes read from the package files;
+	DWORD		dwPackageSeeks;		// Package reads not following the last read of the same package;
+	DWORD		dwUncompressTime;	// Time spent uncompressing package entries;
+} AFILE_IOSTATS;
+
+bool AFileMod_GetIOStats(AFILE_IOSTATS * pStats);
+void AFileMod_ResetIOStats();
+
+// Write the I/O counters and the read statistics of each entry of g_pAFilePackage and the
+// mounted packages into a text file;
+bool AFileMod_DumpIOStats(char * szDumpFile);
+
+// Record the relative names of the files opened by AFileImage in order into a binary 
+// trace file, AFileTrace_LoadNames can read it back, and it can be used as the order 
+// to compact a package by AFPTool;
+bool AFileMod_StartTrace(char * szTraceFile);
+bool AFileMod_StopTrace();
+
 // Get the file's title in the filename string;
 // Note: lpszFile and lpszTitle should be different buffer;
 bool AFileMod_GetFileTitle(char * lpszFile, char * lpszTitle, WORD cbBuf);
@@ -43,4 +117,9 @@ bool AFileMod_GetFileTitle(char * lpszFile, char * lpszTitle, WORD cbBuf);
 // Get the file's path in the filename string;
 // Note: lpszFile and lpszPath should be different buffer;
 bool AFileMod_GetFilePath(char * lpszFile, char * lpszPath, WORD cbBuf);
+
+// Create the folders in the path of a file which do not exist, so the file can be created;
+// return false if the folder of the file still does not exist
+bool AFileMod_CreateFilePath(char * szFileName);
+
 #endif
\ No newline at end of file
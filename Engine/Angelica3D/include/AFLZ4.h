@@ -0,0 +1,45 @@
+/*
+ * FILE: AFLZ4.h
+ *
+ * DESCRIPTION: The LZ4 block codec used by the file package for files which should be
+ *				uncompressed as fast as possible, it calls the lz4 library in Dependency
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#ifndef _AFLZ4_H_
+#define _AFLZ4_H_
+
+#include "AFPlatform.h"
+
+// The max compressed length of nSrcLength bytes, the same as LZ4_COMPRESSBOUND;
+#define AFLZ4_COMPRESSBOUND(nSrcLength)		((nSrcLength) + (nSrcLength) / 255 + 16)
+
+/*
+	Compress a block of data
+	parameter:
+		IN: pSrc			the data to compress
+		IN: nSrcLength		the data length
+		OUT: pDest			buffer to contain the compressed data
+		IN: nDestCapacity	size of pDest
+	return the compressed length, or 0 if it can not fit in nDestCapacity
+*/
+int AFLZ4_Compress(const BYTE * pSrc, int nSrcLength, BYTE * pDest, int nDestCapacity);
+
+/*
+	Uncompress a block of data, malformed data will be detected and never read or 
+	write out of the buffers
+	parameter:
+		IN: pSrc			the compressed data
+		IN: nSrcLength		the compressed data length
+		OUT: pDest			buffer to contain the uncompressed data
+		IN: nDestCapacity	size of pDest
+	return the uncompressed length, or -1 if the data is malformed
+*/
+int AFLZ4_Uncompress(const BYTE * pSrc, int nSrcLength, BYTE * pDest, int nDestCapacity);
+
+#endif//_AFLZ4_H_
@@ -14,6 +14,7 @@
 #define _AFPI_H_
 
 #include "AFPlatform.h"
+#include "AFI.h"
 #include "ZLib\ZLib.h"
 
 extern ALog *			g_pAFErrLog;
@@ -25,5 +26,15 @@ extern bool				g_bCompressEnable;
 
 #define AFERRLOG(fmt) {if(g_pAFErrLog) g_pAFErrLog->Log fmt;}
 
+// I/O counters, they are updated by several threads;
+extern AFILE_IOSTATS	g_AFileIOStats;
+
+#define AFSTAT_INC(member)		InterlockedIncrement((LONG volatile *) &g_AFileIOStats.member)
+#define AFSTAT_ADD(member, n)	InterlockedExchangeAdd((LONG volatile *) &g_AFileIOStats.member, (LONG) (n))
+
+// Get a performance counter value and the microseconds since it;
+LONGLONG AFileStat_GetTicks();
+DWORD AFileStat_GetMicroSec(LONGLONG nStartTicks);
+
 #endif
 
@@ -25,6 +25,7 @@
 #define AFILE_BINARY				0x00000010
 
 #define AFILE_LINEMAXLEN			2048
+#define AFILE_READBUFFERSIZE		65536	// Read buffer of the files opened only for reading;
 
 #define AFILE_SEEK_SET				SEEK_SET
 #define AFILE_SEEK_CUR				SEEK_CUR
@@ -35,6 +36,21 @@ class AFile
 private:
 	FILE *	m_pFile;
 
+	// The read buffer holds the file data from m_dwBufferStart, only files opened only for
+	// reading in binary mode use it;
+	LPBYTE	m_pReadBuffer;
+	DWORD	m_dwBufferStart;	// File offset of the first byte in the buffer;
+	DWORD	m_dwBufferLen;		// Valid bytes in the buffer;
+	DWORD	m_dwBufferPtr;		// Current read position in the buffer;
+	bool	m_bBufferEOF;		// The end of the file has been read into the buffer;
+	char *	m_pLineBuffer;		// Used by ReadLineView when there is no read buffer;
+	DWORD	m_dwLineBytes;		// Bytes read by lines and strings, added into the statistics on Close;
+
+	// Move the unread bytes to the beginning and read more data, return false if nothing more was read;
+	bool FillReadBuffer();
+	// Get the length of the next line in the buffer including \n, at most dwMaxLength, 0 means the end of file;
+	DWORD LocateLine(DWORD dwMaxLength);
+
 protected:
 	// An fullpath file name;
 	char	m_szFileName[MAX_PATH];
@@ -46,6 +62,16 @@ protected:
 
 	bool	m_bHasOpened;
 
+	// Get the length of a line without at most two trailing \r or \n;
+	static inline DWORD ChopLineEnd(const char * pLine, DWORD dwLength)
+	{
+		if( dwLength > 0 && (pLine[dwLength - 1] == '\n' || pLine[dwLength - 1] == '\r') )
+			dwLength --;
+		if( dwLength > 0 && (pLine[dwLength - 1] == '\n' || pLine[dwLength - 1] == '\r') )
+			dwLength --;
+		return dwLength;
+	}
+
 public:
 	AFile();
 	virtual ~AFile();
@@ -59,6 +85,15 @@ public:
 	virtual bool Write(LPVOID pBuffer, DWORD dwBufferLength, DWORD * pWriteLength);
 	virtual bool ReadLine(char * szLineBuffer, DWORD dwBufferLength, DWORD * pdwReadLength);
 	virtual bool ReadString(char * szLineBuffer, DWORD dwBufferLength, DWORD * pdwReadLength);
+	/*
+		Read a line without copying it, the line points into the read buffer or the file image
+		and is valid until the next read or seek, it is not terminated by '\0' and has no \r\n
+		parameter:
+			OUT: ppLine			the line
+			OUT: pdwLength		the line length
+		return false if there is no more line
+	*/
+	virtual bool ReadLineView(const char ** ppLine, DWORD * pdwLength);
 	virtual bool WriteLine(char * szLineBuffer);
 	virtual bool GetStringAfter(char * szBuffer, char * szTag, char * szResult);
 	virtual DWORD GetPos();
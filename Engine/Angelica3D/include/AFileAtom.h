@@ -0,0 +1,95 @@
+/*
+ * FILE: AFileAtom.h
+ *
+ * DESCRIPTION: A process wide table which interns file names into 32-bit atoms
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#ifndef _AFILEATOM_H_
+#define _AFILEATOM_H_
+
+#include "AFPlatform.h"
+#include "flat_hashtab.h"
+
+/*
+	A file name is normalized as AFilePackage_NormalizeFileName does and folded to lower
+	case before it is interned, so all the names which refer to the same file the way the
+	package and _stricmp see it share one atom. Atoms are numbered from 1 in the order they
+	are created and are never freed, so a resource manager can keep an atom instead of a
+	copy of the name and compare two names by comparing two integers;
+*/
+typedef DWORD AFILEATOM;
+
+#define AFILEATOM_NULL		0
+
+// Hash function to key an abase::flat_hashtab on atoms;
+struct AFileAtom_Hash
+{
+	inline unsigned long operator()(AFILEATOM atom) const { return atom; }
+};
+
+class AFileAtomTable
+{
+private:
+	typedef struct _ATOMKEY
+	{
+		const char *	szName;		// Normalized and lower case name;
+		DWORD			dwHash;
+
+		inline bool operator==(const _ATOMKEY& rhs) const { return dwHash == rhs.dwHash && 0 == strcmp(szName, rhs.szName); }
+	} ATOMKEY;
+
+	struct ATOMKEY_HASH
+	{
+		inline unsigned long operator()(const ATOMKEY& key) const { return key.dwHash; }
+	};
+
+	typedef abase::flat_hashtab<AFILEATOM, ATOMKEY, ATOMKEY_HASH> ATOMTAB;
+
+	CRITICAL_SECTION	m_csAccess;
+	ATOMTAB				m_AtomTab;
+
+	ATOMKEY *			m_aAtoms;		// Names of the atoms, atom n is at n - 1;
+	int					m_nNumAtoms;
+	int					m_nMaxAtoms;
+
+	// Names are copied into big blocks, so the pointer to a name never changes;
+	LPBYTE				m_pNameBlock;	// The current block, the first DWORD points to the last block;
+	DWORD				m_dwBlockUsed;
+	DWORD				m_dwNameBytes;
+
+	// Normalize and fold the name into szKey, return its hash;
+	static DWORD MakeKey(const char * szFileName, char * szKey);
+	AFILEATOM FindKey(const ATOMKEY& key);
+	const char * CopyName(const char * szName, int nLength);
+
+protected:
+public:
+	AFileAtomTable();
+	~AFileAtomTable();
+
+	// Get the atom of a file name, the atom is created if the name has not been interned;
+	AFILEATOM GetAtom(const char * szFileName);
+	// Get the atom of a file name, return AFILEATOM_NULL if the name has not been interned;
+	AFILEATOM FindAtom(const char * szFileName);
+	// Get the normalized and lower case name of an atom, the pointer is valid in the process;
+	const char * GetName(AFILEATOM atom);
+
+	inline int GetAtomCount() { return m_nNumAtoms; }
+	inline DWORD GetNameBytes() { return m_dwNameBytes; }
+};
+
+typedef class AFileAtomTable * PAFileAtomTable;
+
+extern AFileAtomTable	g_AFileAtomTable;
+
+inline AFILEATOM AFileAtom_Get(const char * szFileName) { return g_AFileAtomTable.GetAtom(szFileName); }
+inline AFILEATOM AFileAtom_Find(const char * szFileName) { return g_AFileAtomTable.FindAtom(szFileName); }
+inline const char * AFileAtom_GetName(AFILEATOM atom) { return g_AFileAtomTable.GetName(atom); }
+
+#endif//_AFILEATOM_H_
@@ -15,6 +15,7 @@
 
 #include "AFPlatform.h"
 #include "AFile.h"
+#include "AFilePackage.h"
 
 class AFileImage : public AFile
 {
@@ -22,15 +23,34 @@ private:
 	LPBYTE			m_pFileImage;	// Memory pointer of the file image in memory;
 	int				m_nCurPtr;		// In index into the file image buffer;
 	int				m_nFileLength;	// File length;
+	bool			m_bMappedImage;	// The image points into a mapped package, so it should not be freed;
+	LPVOID			m_hCachedImage;	// The image is shared in an AFileImageCache, so it should be released there;
 
 	bool fimg_read(LPBYTE pBuffer, int nSize, int * pReadSize); // read some size of data into a buffer;
-	bool fimg_read_line(char * szLineBuffer, int nMaxLength, int * pReadSize); // read a line into a buffer;
+	bool fimg_read_line(char * szLineBuffer, int nMaxLength, int * pReadSize); // read a line into a buffer without \r\n;
+	int fimg_locate_line(int nMaxLength, int * pnLineLength); // get the bytes of the next line and its length without \r\n;
 	bool fimg_seek(int nOffset, int startPos); // offset current pointer
 
+	static bool ReadDiskImage(char * szFullName, LPBYTE * ppImage, int * pnLength);
+	static bool ReadPackageImage(AFilePackage * pPackage, AFPCK_FILEENTRY& fileEntry, LPBYTE * ppImage, int * pnLength, bool * pbMapped);
+
 protected:
 	bool Init(char * szFullPath);
 	bool Release();
 
+public:
+	/*
+		Read the whole image of a file from the mounted layers, the package or the disk, this 
+		can be called from several threads at the same time
+		parameter:
+			IN: szFullName			full path of the file
+			IN: szRelativeName		path relative to the base dir, used in the package
+			OUT: ppImage			the image, should be freed with free() unless *pbMapped is true
+			OUT: pnLength			the image length
+			OUT: pbMapped			true if the image points into a mapped package
+	*/
+	static bool ReadImage(char * szFullName, char * szRelativeName, LPBYTE * ppImage, int * pnLength, bool * pbMapped);
+
 public:
 	AFileImage();
 	~AFileImage();
@@ -45,13 +65,15 @@ public:
 
 	bool ReadLine(char * szLineBuffer, DWORD dwBufferLength, DWORD * pdwReadLength);
 	bool ReadString(char * szLineBuffer, DWORD dwBufferLength, DWORD * pdwReadLength);
+	bool ReadLineView(const char ** ppLine, DWORD * pdwLength);
 
 	bool WriteLine(char * szLineBuffer);
 	
 	DWORD GetPos();
 	bool Seek(DWORD dwBytes, int iOrigin);
 
-	inline LPBYTE GetFileBuffer() { return m_pFileImage; }
+	// The image may point into a mapped package or be shared in the image cache, so it is read-only;
+	inline const BYTE * GetFileBuffer() { return m_pFileImage; }
 	inline int GetFileLength() { return m_nFileLength; }
 };
 
@@ -0,0 +1,102 @@
+/*
+ * FILE: AFileImageCache.h
+ *
+ * DESCRIPTION: A cache of uncompressed package file images shared by AFileImage
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#ifndef _AFILEIMAGECACHE_H_
+#define _AFILEIMAGECACHE_H_
+
+#include "AFPlatform.h"
+#include "AFI.h"
+#include "AFilePackage.h"
+
+#define AFIMAGECACHE_BUCKETNUM		4096	// Must be power of 2;
+
+class AFileImageCache
+{
+private:
+	typedef struct _AFIMAGECACHE_NODE
+	{
+		AFileImageCache *	pCache;			// The cache which owns this node;
+		AFilePackage *		pPackage;		// The package and the entry's offset in it are the key;
+		DWORD				dwOffset;
+		DWORD				dwLength;
+		LPBYTE				pImage;
+		int					nRefCount;
+		bool				bOrphan;		// Removed from the cache by Flush, but still referenced;
+
+		_AFIMAGECACHE_NODE *	pNextInBucket;
+		_AFIMAGECACHE_NODE *	pPrevLRU;	// Only unreferenced nodes are in the LRU list;
+		_AFIMAGECACHE_NODE *	pNextLRU;
+
+	} AFIMAGECACHE_NODE;
+
+	CRITICAL_SECTION		m_csAccess;
+
+	AFIMAGECACHE_NODE *		m_aBuckets[AFIMAGECACHE_BUCKETNUM];
+	AFIMAGECACHE_NODE *		m_pLRUHead;		// The least recently used one;
+	AFIMAGECACHE_NODE *		m_pLRUTail;
+
+	DWORD					m_dwBudget;		// Max bytes of images to keep;
+	AFIMAGECACHE_STATS		m_stats;
+
+	int						m_nNumOrphans;	// Flushed nodes which are still referenced;
+	bool					m_bDetached;	// The cache is no longer used, it will be deleted with the last orphan;
+
+	AFIMAGECACHE_NODE * FindNode(AFilePackage * pPackage, DWORD dwOffset, DWORD dwLength);
+	void RemoveFromTable(AFIMAGECACHE_NODE * pNode);
+	void AddToLRU(AFIMAGECACHE_NODE * pNode);
+	void RemoveFromLRU(AFIMAGECACHE_NODE * pNode);
+	void FreeNode(AFIMAGECACHE_NODE * pNode);
+	// Return true if the cache has been detached and this is its last orphan;
+	bool ReleaseNode(AFIMAGECACHE_NODE * pNode);
+	// Evict the unreferenced images until we are in the budget;
+	void Trim();
+
+protected:
+public:
+	AFileImageCache();
+	~AFileImageCache();
+
+	bool Init(DWORD dwBudget);
+	bool Release();
+
+	/*
+		Get the uncompressed image of a file in the mounted packages or g_pAFilePackage, if it
+		is not cached, it will be read and kept in the cache;
+		parameter:
+			IN: szRelativeName	path relative to the base dir
+			OUT: ppImage		the image, it is shared and read-only
+			OUT: pnLength		the image length
+		return a handle which should be passed to ReleaseImage, or NULL if the file is not
+		in the package or can be used from a mapped package directly
+	*/
+	LPVOID AcquireImage(char * szRelativeName, LPBYTE * ppImage, int * pnLength);
+	// The node knows its cache, so an image can be released after the cache has been disabled;
+	static void ReleaseImage(LPVOID hImage);
+
+	// Remove all images from the cache, the referenced ones will be freed when released;
+	void Flush();
+	/*
+		Flush the cache and mark it as no longer used, the images still referenced keep it
+		alive and the last one released will delete it;
+		return true if nothing is referenced, then the caller should delete the cache now
+	*/
+	bool Detach();
+
+	void SetBudget(DWORD dwBudget);
+	void GetStats(AFIMAGECACHE_STATS * pStats);
+};
+
+typedef class AFileImageCache * PAFileImageCache;
+
+extern AFileImageCache *	g_pAFileImageCache;
+
+#endif//_AFILEIMAGECACHE_H_
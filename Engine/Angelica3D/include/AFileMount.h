@@ -0,0 +1,138 @@
+/*
+ * FILE: AFileMount.h
+ *
+ * DESCRIPTION: A mount table which layers several packages and directories into one
+ *				file system, with a merged file name index
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#ifndef _AFILEMOUNT_H_
+#define _AFILEMOUNT_H_
+
+#include "AFPlatform.h"
+#include "AFilePackage.h"
+
+#define AFMOUNT_MAXLAYER		32
+
+// Where a file of the mount table is;
+typedef struct _AFMOUNT_FILE
+{
+	AFilePackage *		pPackage;				// The package containing the file, NULL if it is on the disk;
+	AFPCK_FILEENTRY		fileEntry;				// The entry in pPackage;
+	char				szDiskPath[MAX_PATH];	// The full path on the disk if pPackage is NULL;
+} AFMOUNT_FILE;
+
+class AFileMountTable
+{
+private:
+	typedef struct _AFMOUNT_LAYER
+	{
+		char			szPath[MAX_PATH];	// The package file or the directory;
+		int				nPriority;
+		AFilePackage *	pPackage;			// NULL for a directory;
+
+		char *			pDirNames;			// File names of a directory, each ends with '\0';
+		int				nDirNamesSize;
+		int				nDirNamesCapacity;
+		int				nNumDirNames;
+	} AFMOUNT_LAYER;
+
+	// A file in the merged index, it is the one in the layer of the highest priority;
+	typedef struct _AFMOUNT_NODE
+	{
+		DWORD			dwNameHash;
+		int				nNameOffset;		// Offset of the normalized name in m_pNamePool, -1 if only a package has the name;
+		int				nLayer;
+		int				nEntry;				// Entry index in the layer's package, -1 for a directory;
+	} AFMOUNT_NODE;
+
+	CRITICAL_SECTION	m_csAccess;
+
+	// Layers sorted by priority from low to high, layers of the same priority are in the mount order;
+	AFMOUNT_LAYER		m_aLayers[AFMOUNT_MAXLAYER];
+	int					m_nNumLayers;
+
+	AFMOUNT_NODE *		m_pNodes;
+	int					m_nNumNodes;
+	int					m_nMaxNodes;
+	int *				m_pHashBuckets;		// Head node index of each bucket, -1 means empty;
+	int *				m_pHashNext;		// Next node index in the same bucket;
+	int					m_nNumBuckets;		// Always power of 2;
+	char *				m_pNamePool;
+	int					m_nNamePoolSize;
+	int					m_nNamePoolUsed;
+
+	// Insert a layer into m_aLayers by its priority;
+	int InsertLayer(const char * szPath, int nPriority);
+	void RemoveLayer(int nLayer);
+	bool ScanDir(AFMOUNT_LAYER * pLayer, const char * szSubDir);
+
+	// Build the merged index of all layers;
+	bool BuildIndex();
+	void ReleaseIndex();
+	// Add a file of a directory layer;
+	bool AddName(const char * szFileName, int nLayer);
+	// Add an entry of a package layer with the name hash kept in the package;
+	bool AddEntry(int nLayer, int nEntry);
+	bool AddNode(DWORD dwNameHash, int nNameOffset, int nLayer, int nEntry);
+	// Put a normalized name into m_pNamePool, return its offset or -1 if out of memory;
+	int AddToNamePool(const char * szNormalizedName);
+	// Get the normalized name of a node, szBuffer of MAX_PATH is used if the name is not in m_pNamePool;
+	const char * GetNodeName(int nNode, char * szBuffer);
+	int FindNode(DWORD dwNameHash, const char * szNormalizedName);
+
+protected:
+public:
+	AFileMountTable();
+	~AFileMountTable();
+
+	bool Init();
+	bool Release();
+
+	/*
+		Mount a package or a directory; a file in a layer of higher priority hides the 
+		same file in the layers of lower priority; of the layers with the same priority,
+		the one mounted later wins
+		parameter:
+			IN: szPath			the package file, or the directory whose files will be used 
+								by their paths relative to it; the files of a directory are 
+								scanned when mounting, files added later will not be seen
+			IN: nPriority		priority of the layer
+			IN: mode			the package's open mode, AFPCK_OPENEXIST or AFPCK_OPENMAPPED
+	*/
+	bool MountPackage(char * szPackFile, int nPriority, AFPCK_OPENMODE mode=AFPCK_OPENEXIST);
+	bool MountDir(char * szDir, int nPriority);
+
+	// Unmount a layer by the path it was mounted with;
+	bool Unmount(char * szPath);
+	void UnmountAll();
+
+	/*
+		Find which layer a file is in, it costs only one hash lookup however many layers are mounted;
+		it can be called from several threads, but no layer should be mounted or unmounted while
+		the files are being read
+		parameter:
+			IN: szRelativeName	path relative to the base dir
+			OUT: pFile			where the file is
+		return false if the file is in none of the layers
+	*/
+	bool FindFile(const char * szRelativeName, AFMOUNT_FILE * pFile);
+
+	inline int GetNumLayers() { return m_nNumLayers; }
+	inline int GetNumFiles() { return m_nNumNodes; }
+
+	// Get the path and package of a layer, the package is NULL for a directory;
+	inline const char * GetLayerPath(int nLayer) { return m_aLayers[nLayer].szPath; }
+	inline AFilePackage * GetLayerPackage(int nLayer) { return m_aLayers[nLayer].pPackage; }
+};
+
+typedef class AFileMountTable * PAFileMountTable;
+
+extern AFileMountTable *	g_pAFileMountTable;
+
+#endif//_AFILEMOUNT_H_
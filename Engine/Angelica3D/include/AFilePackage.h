@@ -21,7 +21,33 @@
 
 //#define AFPCK_VERSION			0x00010001
 //#define AFPCK_VERSION			0x00010002 // Add compression
-#define AFPCK_VERSION			0x00010003 // The final release version on June 2002
+//#define AFPCK_VERSION			0x00010003 // The final release version on June 2002
+//#define AFPCK_VERSION			0x00010004 // Compressed files are stored in independent chunks
+//#define AFPCK_VERSION			0x00010005 // Add codec of each entry
+#define AFPCK_VERSION			0x00010006 // Entry list with a name pool
+
+// The uncompressed size of each chunk of a compressed file in version 1.4 packages;
+// a compressed file's data begins with a DWORD offset table of (number of chunks + 1) elements,
+// the offsets are from the beginning of the file's data, and the last one is the end of last chunk;
+// a chunk which can not be compressed is stored as it is
+#define AFPCK_CHUNKSIZE			0x00010000
+
+// How the data of an entry is compressed, all chunks of a file use the same codec;
+#define AFPCK_CODEC_STORED		0	// Not compressed
+#define AFPCK_CODEC_ZLIB		1	// zlib, better ratio
+#define AFPCK_CODEC_LZ4			2	// AFLZ4, much faster to uncompress, only in version 1.5 and later
+#define AFPCK_NUMCODECS			3
+
+#define AFPCK_MAXEXTCODECS		64
+
+// The entry list of version 1.6 is an array of AFPCK_PACKEDENTRY, an array of DWORD which has 
+// the name offset in the name pool in low bits and the codec in high bits, a DWORD of the name 
+// pool size and the name pool, in which each name ends with '\0';
+#define AFPCK_NAMEOFFSETMASK	0x0fffffff
+#define AFPCK_NAMECODECSHIFT	28
+
+// Max number of threads used by AFilePackage::AppendFiles;
+#define AFPCK_MAXBUILDTHREAD	32
 
 typedef struct _AFPCK_FILEENTRY
 {
@@ -29,9 +55,31 @@ typedef struct _AFPCK_FILEENTRY
 	DWORD		dwOffset; // The offset from the beginning of the package file;
 	DWORD		dwLength; // The length of this file;
 	DWORD		dwCompressedLength; // The compressed data length;
+	DWORD		dwCodec; // AFPCK_CODEC_xxx, in the package since version 1.5, deduced for older packages;
+	int			nIndex; // Index in the entry list, filled when the entry is got from the package, not in the package file;
 
 } AFPCK_FILEENTRY, * PAFPCK_FILEENTRY;
 
+// An entry kept in the package, its name and codec are kept in another array;
+typedef struct _AFPCK_PACKEDENTRY
+{
+	DWORD		dwOffset;
+	DWORD		dwLength;
+	DWORD		dwCompressedLength;
+	DWORD		dwNameHash; // Hash of the normalized file name;
+
+} AFPCK_PACKEDENTRY, * PAFPCK_PACKEDENTRY;
+
+// Read statistics of an entry since the package is opened;
+typedef struct _AFPCK_ENTRYSTATS
+{
+	DWORD		dwReads; // Number of reads, a whole file read by AFileImage is one read;
+	DWORD		dwBytes; // Uncompressed bytes read;
+	DWORD		dwPackageBytes; // Bytes read from the package file, they are compressed bytes for a compressed file;
+	DWORD		dwUncompressTime; // Microseconds spent uncompressing;
+
+} AFPCK_ENTRYSTATS, * PAFPCK_ENTRYSTATS;
+
 typedef struct _AFPCK_FILEHEADER
 {
 	DWORD		dwVersion; // Composed by two word version, major part and minor part;
@@ -42,9 +90,13 @@ typedef struct _AFPCK_FILEHEADER
 enum AFPCK_OPENMODE
 {
 	AFPCK_OPENEXIST = 0,
-	AFPCK_CREATENEW = 1
+	AFPCK_CREATENEW = 1,
+	AFPCK_OPENMAPPED = 2	// Read only, the whole package is mapped into memory;
 };
 
+struct _AFPCK_BUILDJOB;
+struct _AFPCK_DATAREGION;
+
 class AFilePackage
 {
 private:
@@ -55,18 +107,120 @@ private:
 	AFPCK_OPENMODE		m_mode;
 
 	int					m_nNumFiles;
-	AFPCK_FILEENTRY *	m_pFileEntries;
+	AFPCK_PACKEDENTRY *	m_pEntries;
+	DWORD *				m_pEntryNames;	// Name offset in m_pNamePool and codec of each entry;
+	char *				m_pNamePool;	// File names of the entries, removed ones are left until saved;
+	DWORD				m_dwNamePoolSize;
+	DWORD				m_dwNamePoolCapacity;
 
 	FILE *				m_fpPackageFile;
+	HANDLE				m_hReadFile;	// A read only handle for positional reads from several threads;
 
 	LPBYTE				m_pBuffer;		// A buffer for compression and uncompression;
 	DWORD				m_dwBufferLen;	// The length of the buffer;
+	int					m_nCompressLevel;	// zlib compression level, 1 by default;
+
+	struct
+	{
+		char			szExt[16];
+		DWORD			dwCodec;
+	}					m_aExtCodecs[AFPCK_MAXEXTCODECS];	// Codecs chosen by file extension;
+	int					m_nNumExtCodecs;
+	DWORD				m_dwDefaultCodec;	// Codec of files whose extension is not in m_aExtCodecs;
+
+	int *				m_pHashBuckets;	// Head entry index of each hash bucket, -1 means empty;
+	int					m_nNumBuckets;	// Number of hash buckets, always power of 2;
+	int *				m_pHashNext;	// Next entry index in the same bucket, -1 means end;
+
+	HANDLE				m_hFileMapping;	// File mapping object when opened with AFPCK_OPENMAPPED;
+	const BYTE *		m_pMappedBase;	// The view of the whole package file;
+	DWORD				m_dwMappedSize;	// The size of the mapped view;
 
-	bool				m_bHasSorted;	// Flag indicating whether the file entry has been sorted;
+	AFPCK_ENTRYSTATS *	m_pEntryStats;	// Read statistics of each entry;
+	volatile DWORD		m_dwLastReadEnd;	// Where the last read of the package file ends;
+	volatile LONG		m_nNumSeeks;	// Number of reads not following the last one;
+	volatile DWORD		m_dwQuietThread;	// The thread reading the package for itself, its reads are not recorded;
+
+	bool				m_bShareData;	// Whether identical files share one copy of data;
+	struct _AFPCK_DATAREGION *	m_pDataRegions;	// Data written since opened, hashed by content;
+	int					m_nNumDataRegions;
+	int					m_nMaxDataRegions;
+	int *				m_pDataBuckets;	// Head region index of each bucket, -1 means empty;
+	int					m_nNumDataBuckets;
+	int					m_nNumSharedFiles;	// Files which share the data written before;
+	DWORD				m_dwSharedBytes;	// Bytes not written for the shared files;
 
 	// Prepare a compression usage buffer;
 	bool PrepareBuffer(DWORD dwBufferLen);
 
+	// Read the file entries of an existing package;
+	bool LoadEntries();
+	bool LoadPackedEntries();
+	// Write the file entries at m_header.dwEntryOffset, return the bytes written;
+	DWORD WriteEntries();
+
+	// Put the name of an entry into the name pool and set its codec;
+	bool SetEntryName(int nIndex, const char * szFileName, DWORD dwCodec);
+	inline const char * GetEntryName(int nIndex) { return m_pNamePool + (m_pEntryNames[nIndex] & AFPCK_NAMEOFFSETMASK); }
+	inline DWORD GetEntryCodec(int nIndex) { return m_pEntryNames[nIndex] >> AFPCK_NAMECODECSHIFT; }
+	void FillFileEntry(int nIndex, AFPCK_FILEENTRY * pFileEntry);
+	// Make the arrays of entries have room for nNumFiles entries;
+	bool ResizeEntries(int nNumFiles);
+
+	// Rebuild the hashed file name index of all entries;
+	bool BuildIndex();
+	// Add one entry into the hashed file name index;
+	bool AddToIndex(int nIndex);
+	void ReleaseIndex();
+	// Find the entry index of a normalized file name, return -1 if not found;
+	int FindEntry(DWORD dwNameHash, const char * szNormalizedName);
+
+	// Read some data at a position of the package file, it does not touch the file pointer so it is thread safe;
+	bool ReadPackageAt(DWORD dwPos, LPVOID pBuffer, DWORD dwSize);
+	// Get some data of the package file, return the mapped data directly or read it into *ppPrivateBuffer,
+	// which should be freed by the caller;
+	const BYTE * GetPackageData(DWORD dwPos, DWORD dwSize, LPBYTE * ppPrivateBuffer);
+
+	// Compress a file into m_pBuffer in the format of this package's version;
+	// return the compressed length, or dwFileLength if it is not compressed;
+	DWORD CompressFile(LPBYTE pFileBuffer, DWORD dwFileLength, DWORD dwCodec);
+	// Compress a file into a buffer of at least GetCompressBound(dwFileLength) bytes, this does not
+	// touch m_pBuffer, so it can be called from several threads at the same time;
+	DWORD CompressFileInto(LPBYTE pFileBuffer, DWORD dwFileLength, LPBYTE pOutBuffer, DWORD dwCodec);
+	DWORD CompressFileChunked(LPBYTE pFileBuffer, DWORD dwFileLength, LPBYTE pOutBuffer, DWORD dwCodec);
+	DWORD GetCompressBound(DWORD dwFileLength);
+	// Uncompress a chunk of a file, the chunk must be uncompressed to exactly dwDestLength bytes;
+	static bool UncompressChunk(DWORD dwCodec, LPBYTE pDest, DWORD dwDestLength, const BYTE * pSrc, DWORD dwSrcLength);
+
+	// Write a file's data at the end of the data part and add its entry;
+	bool AppendFileData(char * szFileName, LPBYTE pData, DWORD dwFileLength, DWORD dwCompressedLength, DWORD dwCodec);
+	// Add an entry at the end of the entry list;
+	bool AddEntry(char * szFileName, DWORD dwOffset, DWORD dwLength, DWORD dwCompressedLength, DWORD dwCodec);
+
+	// Find the data written before which is the same as a file, return -1 if not found;
+	int FindDataRegion(LPBYTE pFileBuffer, DWORD dwFileLength, DWORD dwCRC);
+	// Remember the data of an entry just written, so identical files can share it;
+	void AddDataRegion(DWORD dwCRC, int nIndex);
+	// Add an entry which uses the data of a region;
+	bool AddSharedEntry(char * szFileName, int nRegion);
+	void ReleaseDataRegions();
+
+	// Read and compress a file of AppendFiles, called on the build threads;
+	bool PrepareBuildJob(char * szFileName, char * szDiskFile, struct _AFPCK_BUILDJOB * pJob);
+	static DWORD WINAPI BuildThread(LPVOID pArg);
+
+	// Whether a file's data is compressed in chunks;
+	inline bool IsChunked(AFPCK_FILEENTRY& fileEntry) 
+	{ return m_header.dwVersion >= 0x00010004 && fileEntry.dwLength > fileEntry.dwCompressedLength; }
+
+	// Record a read of an entry and an access of the package file, they are called from several threads;
+	void RecordRead(AFPCK_FILEENTRY& fileEntry, DWORD dwBytes, DWORD dwPackageBytes, DWORD dwUncompressTime);
+	void RecordAccess(DWORD dwPos, DWORD dwSize);
+
+	// Map the whole package file into memory;
+	bool MapPackage();
+	void UnmapPackage();
+
 protected:
 public:
 	AFilePackage();
@@ -84,6 +238,18 @@ public:
 	*/
 	bool AppendFile(char * szFileName, LPBYTE pFileBuffer, DWORD dwFileLength);
 
+	/*
+		Append many files on the disk into the package, the files are read and compressed 
+		on several threads, but they are written in the order given, so the package will 
+		be the same whatever the number of threads is
+		parameter:
+			IN: aFileNames		file names in the package
+			IN: aDiskFiles		paths of the files on the disk, NULL means the same as aFileNames
+			IN: nNumFiles		number of files
+			IN: nNumThreads		number of compression threads, 0 means the number of processors
+	*/
+	bool AppendFiles(char ** aFileNames, char ** aDiskFiles, int nNumFiles, int nNumThreads=0);
+
 	/*
 		Remove a file from the package, we will only remove the file entry from the package;
 		the file's data will remain in the package
@@ -100,6 +266,23 @@ public:
 	*/
 	bool ReplaceFile(char * szFileName, LPBYTE pFileBuffer, DWORD dwFileLength);
 
+	// Sort the file entry list by name, the hashed index will be rebuilt;
+	bool ResortEntries();
+
+	/*
+		Write all files into a new package without the dead data left by RemoveFile and ReplaceFile;
+		the data is copied as it is, so nothing will be compressed again, and the entry list keeps
+		the same order; entries sharing data still share it in the new package
+		parameter:
+			IN: szNewPckPath		the new package file, it must not be this package
+			IN: aOrderNames			files whose data should be placed first and in this order, such as 
+									the files recorded in a load trace; names not in the package are 
+									skipped; the other files follow in their old order; can be NULL
+			IN: nNumOrderNames		number of names in aOrderNames
+			OUT: pdwSavedBytes		bytes of dead data removed, can be NULL
+	*/
+	bool Compact(char * szNewPckPath, char ** aOrderNames, int nNumOrderNames, DWORD * pdwSavedBytes=NULL);
+
 	/*
 		Read the file's content from the package
 		parameter: 
@@ -109,25 +292,95 @@ public:
 			IN/OUT: pdwBufferLen	in: the max buffer size of pFileBuffer, out: the actually filled length of pFileBuffer;
 
 	*/
-
-	// Sort the file entry list;
-	bool ResortEntries();
-
 	bool ReadFile(char * szFileName, LPBYTE pFileBuffer, DWORD dwOffset, DWORD * pdwBufferLen);
 	bool ReadFile(AFPCK_FILEENTRY& fileEntry, LPBYTE pFileBuffer, DWORD dwOffset, DWORD * pdwBufferLen);
 
+	/*
+		Read the file's content from the package, this can be called from several threads
+		at the same time, for it uses positional reads and a private uncompression buffer
+		of each call; the package should not be changed while reading
+		parameters are the same as ReadFile
+	*/
+	bool ReadFileConcurrent(char * szFileName, LPBYTE pFileBuffer, DWORD dwOffset, DWORD * pdwBufferLen);
+	bool ReadFileConcurrent(AFPCK_FILEENTRY& fileEntry, LPBYTE pFileBuffer, DWORD dwOffset, DWORD * pdwBufferLen);
+
+	/*
+		Read part of a file's content from the package, for a chunked compressed file only the chunks 
+		touched will be uncompressed; this can be called from several threads at the same time
+		parameter:
+			IN: fileEntry			file entry
+			IN: pBuffer				buffer to contain the content, at least dwSize bytes
+			IN: dwOffset			offset of the file to read start;
+			IN: dwSize				the size to read;
+			OUT: pdwReadLen			the actually read length, may be less than dwSize at the end of the file;
+	*/
+	bool ReadFilePart(AFPCK_FILEENTRY& fileEntry, LPBYTE pBuffer, DWORD dwOffset, DWORD dwSize, DWORD * pdwReadLen);
+
 	// Find a file entry;
 	// return true if found, false if not found;
 	bool GetFileEntry(char * szFileName, AFPCK_FILEENTRY * pFileEntry, int * pnIndex=NULL);
+	// Find a file entry with a name hash returned by AFilePackage_NormalizeFileName, so the name need not be hashed again;
+	bool GetFileEntry(DWORD dwNameHash, char * szFileName, AFPCK_FILEENTRY * pFileEntry, int * pnIndex=NULL);
 	bool GetFileEntryByIndex(int nIndex, AFPCK_FILEENTRY * pFileEntry);
 
+	/*
+		Get a read-only view of a stored file's content in a mapped package, no copy is made;
+		the view is valid until the package is closed
+		parameter:
+			IN: fileEntry			file entry
+		return NULL if the package is not opened with AFPCK_OPENMAPPED or the file is compressed
+	*/
+	const BYTE * GetMappedFile(AFPCK_FILEENTRY& fileEntry);
+
+	// Set the zlib compression level used by AppendFile, AppendFiles and ReplaceFile, from 1 to 9;
+	// a higher level only slows down building, uncompressing is as fast as before;
+	inline void SetCompressLevel(int nLevel) { m_nCompressLevel = max(1, min(nLevel, 9)); }
+	inline int GetCompressLevel() { return m_nCompressLevel; }
+
+	// Choose the codec of the files with an extension, such as ".dds", when they are added into the package;
+	bool SetFileCodec(const char * szExt, DWORD dwCodec);
+	// Choose the codec of the files whose extension has no codec set, AFPCK_CODEC_ZLIB by default;
+	bool SetDefaultCodec(DWORD dwCodec);
+	// Get the codec a file will be added with;
+	DWORD GetFileCodec(const char * szFileName);
+
+	// Let identical files appended or replaced share one copy of data, it is enabled by default;
+	// only the data written since the package is opened will be shared;
+	inline void SetShareData(bool bShare) { m_bShareData = bShare; }
+	inline int GetNumSharedFiles() { return m_nNumSharedFiles; }
+	inline DWORD GetSharedBytes() { return m_dwSharedBytes; }
+
+	// Get the read statistics of an entry, they are cleared when the entries are resorted;
+	bool GetEntryStats(int nIndex, AFPCK_ENTRYSTATS * pStats);
+	inline int GetNumSeeks() { return m_nNumSeeks; }
+
+	// Write the statistics of the entries which have been read as text lines;
+	bool DumpStats(FILE * fpDump);
+
+	inline bool IsMapped() { return m_pMappedBase != NULL; }
 	inline int GetFileNumber() { return m_nNumFiles; }
+	// Get the name of an entry as it is stored and the hash of its normalized name;
+	inline const char * GetFileName(int nIndex) { return GetEntryName(nIndex); }
+	inline DWORD GetFileNameHash(int nIndex) { return m_pEntries[nIndex].dwNameHash; }
 	inline AFPCK_FILEHEADER GetFileHeader() { return m_header; }
 };
 
 typedef class AFilePackage * PAFilePackage;
 
-bool OpenFilePackage(char * szPackFile);
+/*
+	Normalize a file name the way the package stores it: path seperator united to '\',
+	preceding .\ and tailing spaces removed
+	parameter:
+		IN: szFileName			file name
+		OUT: szNormalized		buffer of at least MAX_PATH to contain the normalized name
+	return the case insensitive hash of the normalized name
+*/
+DWORD AFilePackage_NormalizeFileName(const char * szFileName, char * szNormalized);
+
+// Get the case insensitive hash of a normalized file name;
+DWORD AFilePackage_HashFileName(const char * szFileName);
+
+bool OpenFilePackage(char * szPackFile, AFPCK_OPENMODE mode=AFPCK_OPENEXIST);
 bool CloseFilePackage();
 
 extern AFilePackage *	g_pAFilePackage;
@@ -0,0 +1,118 @@
+/*
+ * FILE: AFilePrefetch.h
+ *
+ * DESCRIPTION: A class which loads file images ahead of time on background threads
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#ifndef _AFILEPREFETCH_H_
+#define _AFILEPREFETCH_H_
+
+#include "AFPlatform.h"
+#include "AFI.h"
+
+#define AFPREFETCH_MAXTHREAD		8
+#define AFPREFETCH_BUCKETNUM		1024	// Must be power of 2;
+
+class AFilePrefetcher
+{
+private:
+	enum
+	{
+		AFPREFETCH_QUEUED = 0,		// Waiting for an IO thread;
+		AFPREFETCH_LOADING,			// An IO thread is reading it;
+		AFPREFETCH_READY,			// The image is ready to be taken;
+		AFPREFETCH_TAKEN			// Taken, discarded or failed, removed from the name table;
+	};
+
+	typedef struct _AFPREFETCH_ITEM
+	{
+		char				szFullName[MAX_PATH];
+		char				szRelativeName[MAX_PATH];	// Normalized relative name;
+		DWORD				dwNameHash;
+		int					nState;
+		LPBYTE				pImage;
+		int					nLength;
+
+		AFPREFETCH_CALLBACK	pfnCallback;
+		LPVOID				pArg;
+
+		HANDLE				hDone;			// Signaled when the IO thread has finished reading it;
+		int					nNumWaiters;	// Number of threads waiting for hDone;
+		bool				bInQueue;
+
+		_AFPREFETCH_ITEM *	pNextInBucket;
+		_AFPREFETCH_ITEM *	pNextInQueue;
+
+	} AFPREFETCH_ITEM;
+
+	CRITICAL_SECTION	m_csAccess;			// Protect all data below;
+	HANDLE				m_hQueueSemaphore;	// Count of items in the queue;
+	HANDLE				m_hIdleEvent;		// Signaled when there is no queued or loading item;
+
+	HANDLE				m_aThreads[AFPREFETCH_MAXTHREAD];
+	int					m_nNumThreads;
+	volatile bool		m_bQuit;
+
+	AFPREFETCH_ITEM *	m_pQueueHead;
+	AFPREFETCH_ITEM *	m_pQueueTail;
+	AFPREFETCH_ITEM *	m_aBuckets[AFPREFETCH_BUCKETNUM];
+	int					m_nNumBusy;			// Queued and loading items;
+	DWORD				m_dwReadyBytes;		// Bytes of images ready to be taken;
+
+	AFPREFETCH_ITEM * FindItem(DWORD dwNameHash, const char * szRelativeName);
+	void RemoveFromTable(AFPREFETCH_ITEM * pItem);
+	void FreeItemIfUnused(AFPREFETCH_ITEM * pItem);
+	void LoadItem(AFPREFETCH_ITEM * pItem);
+
+	static DWORD WINAPI IOThread(LPVOID pArg);
+
+protected:
+public:
+	AFilePrefetcher();
+	~AFilePrefetcher();
+
+	bool Init(int nNumThreads);
+	bool Release();
+
+	/*
+		Queue some files to be read by the IO threads, files which have been queued or are ready
+		will be skipped;
+		parameter:
+			IN: aFileNames		full path of the files, the same as AFileImage::Open uses
+			IN: nNumFiles		number of files
+			IN: pfnCallback		called on an IO thread when each queued file has been read, can be NULL
+			IN: pArg			argument passed to pfnCallback
+		return the number of files queued
+	*/
+	int Prefetch(char ** aFileNames, int nNumFiles, AFPREFETCH_CALLBACK pfnCallback, LPVOID pArg);
+
+	/*
+		Take a prefetched file image, if the file is being read, this will wait for it;
+		parameter:
+			IN: szRelativeName	path relative to the base dir
+			OUT: ppImage		the image, the caller owns it and should free it with free()
+			OUT: pnLength		the image length
+		return false if the file has not been prefetched
+	*/
+	bool TakeFile(char * szRelativeName, LPBYTE * ppImage, int * pnLength);
+
+	// Wait until all queued files have been read;
+	bool WaitIdle(DWORD dwTimeOut);
+
+	// Free all images which have not been taken and cancel the queued files;
+	void DiscardAll();
+
+	inline DWORD GetReadyBytes() { return m_dwReadyBytes; }
+};
+
+typedef class AFilePrefetcher * PAFilePrefetcher;
+
+extern AFilePrefetcher *	g_pAFilePrefetcher;
+
+#endif//_AFILEPREFETCH_H_
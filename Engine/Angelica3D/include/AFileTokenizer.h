@@ -0,0 +1,55 @@
+/*
+ * FILE: AFileTokenizer.h
+ *
+ * DESCRIPTION: A tokenizer which parses the lines returned by AFile::ReadLineView in place
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#ifndef _AFILETOKENIZER_H_
+#define _AFILETOKENIZER_H_
+
+#include "AFPlatform.h"
+
+/*
+	The text is not copied and need not be terminated by '\0', so the tokenizer is only valid
+	while the line it points to is valid. Blanks, tabs and the separators ",()[]{}:" are
+	skipped before each number, so a line like "(1.0, 2.0, 3.0)" can be read by three GetFloat;
+*/
+class AFileTokenizer
+{
+private:
+	const char *	m_pCur;
+	const char *	m_pEnd;
+
+	void SkipSeparators();
+
+protected:
+public:
+	AFileTokenizer() { m_pCur = m_pEnd = NULL; }
+	AFileTokenizer(const char * pText, DWORD dwLength) { Init(pText, dwLength); }
+
+	inline void Init(const char * pText, DWORD dwLength) { m_pCur = pText; m_pEnd = pText + dwLength; }
+
+	// Skip the tag if the text left starts with it, this is the same as AFile::GetStringAfter;
+	bool SkipPrefix(const char * szTag);
+	// Skip blanks and tabs only;
+	void SkipBlanks();
+
+	bool GetInt(int * pnValue);
+	bool GetFloat(FLOAT * pvValue);
+	// Get all the text left, the result is not terminated by '\0';
+	void GetRest(const char ** ppText, DWORD * pdwLength);
+	// Copy all the text left into a buffer and terminate it with '\0';
+	bool CopyRest(char * szBuffer, DWORD dwBufferLength);
+
+	inline bool IsEmpty() { return m_pCur >= m_pEnd; }
+	// Whether the whole text is exactly the string;
+	static bool IsEqual(const char * pText, DWORD dwLength, const char * szString);
+};
+
+#endif//_AFILETOKENIZER_H_
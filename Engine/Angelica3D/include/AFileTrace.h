@@ -0,0 +1,72 @@
+/*
+ * FILE: AFileTrace.h
+ *
+ * DESCRIPTION: A class which records the sequence of opened files into a trace file
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#ifndef _AFILETRACE_H_
+#define _AFILETRACE_H_
+
+#include "AFPlatform.h"
+#include "AFI.h"
+
+#define AFTRACE_MAGIC		0x52544641	// 'AFTR'
+#define AFTRACE_VERSION		1
+
+/*
+	The trace file is a header followed by the records of each open in order, a record is
+	a DWORD time in milliseconds since the trace started, a WORD name length and the relative 
+	name without '\0';
+*/
+typedef struct _AFTRACE_HEADER
+{
+	DWORD		dwMagic;		// AFTRACE_MAGIC;
+	DWORD		dwVersion;		// AFTRACE_VERSION;
+	DWORD		dwNumRecords;	// Written when the trace is closed;
+
+} AFTRACE_HEADER, * PAFTRACE_HEADER;
+
+class AFileTracer
+{
+private:
+	CRITICAL_SECTION	m_csAccess;
+	FILE *				m_fpTrace;
+	DWORD				m_dwStartTime;
+	DWORD				m_dwNumRecords;
+
+protected:
+public:
+	AFileTracer();
+	~AFileTracer();
+
+	bool Init(char * szTraceFile);
+	bool Release();
+
+	// Record a file opened, it can be called from several threads;
+	void RecordOpen(const char * szRelativeName);
+
+	inline DWORD GetNumRecords() { return m_dwNumRecords; }
+};
+
+typedef class AFileTracer * PAFileTracer;
+
+extern AFileTracer *	g_pAFileTracer;
+
+/*
+	Read the names in a trace file in the order they were opened, a file opened several
+	times is only given at its first open;
+	parameter:
+		IN: szTraceFile		the trace file
+		OUT: aNames			the names, each one should be freed with free()
+		IN: nMaxNames		max number of names to read
+	return the number of names read, or -1 if it is not a trace file
+*/
+int AFileTrace_LoadNames(char * szTraceFile, char ** aNames, int nMaxNames);
+
+#endif//_AFILETRACE_H_
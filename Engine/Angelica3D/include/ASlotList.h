@@ -0,0 +1,89 @@
+/*
+ * FILE: ASlotList.h
+ *
+ * DESCRIPTION: A class which keeps a list of pointers in one dense array and hands out
+ *				stable handles to them;
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#ifndef _ASLOTLIST_H_
+#define _ASLOTLIST_H_
+
+#include "A3DPlatform.h"
+#include "A3DData.h"
+
+/*
+	A handle keeps the slot index in its low ASLOT_INDEXBITS bits and the generation of that
+	slot in the high bits. The generation of a slot changes every time its element is deleted,
+	so a handle of a deleted element is never valid again, even after the slot is reused.
+	A slot is reused until its generation reaches ASLOT_GENMASK, then it is retired, so the
+	list can only run out of slots after ASLOT_MAXSIZE * ASLOT_GENMASK deletions.
+	A handle with generation 0, including ASLOTHANDLE_NULL, is never valid;
+*/
+typedef DWORD ASLOTHANDLE;
+
+#define ASLOTHANDLE_NULL	0
+#define ASLOT_INDEXBITS		20
+#define ASLOT_INDEXMASK		((1 << ASLOT_INDEXBITS) - 1)
+#define ASLOT_GENMASK		((1 << (32 - ASLOT_INDEXBITS)) - 1)
+#define ASLOT_MAXSIZE		ASLOT_INDEXMASK
+
+/*
+	The data are kept in one array without holes, so a walk is a plain loop from 0 to GetSize()
+	over GetAt(). Delete moves the last element into the hole, so the order is not kept after
+	a deletion; to delete elements during a walk, walk from the end, or do not advance the
+	index after DeleteAt();
+*/
+class ASlotList : public A3DData
+{
+private:
+	typedef struct _ASLOT
+	{
+		int			nIndex;			// Index in m_aData when used, next free slot when free;
+		DWORD		dwGeneration;	// Generation of the handle which refers to this slot, 0 if retired;
+	} ASLOT;
+
+	LPVOID *	m_aData;		// The dense data array;
+	int *		m_aSlotOf;		// The slot of each element in m_aData;
+	ASLOT *		m_aSlots;
+	int			m_nSize;
+	int			m_nMaxSize;		// Capacity of all three arrays;
+	int			m_nNumSlots;	// Number of slots which have ever been used;
+	int			m_nFreeSlot;	// Head of the free slot list, -1 if none;
+
+	bool Grow();
+	inline ASLOTHANDLE MakeHandle(int nSlot) { return (m_aSlots[nSlot].dwGeneration << ASLOT_INDEXBITS) | (DWORD) nSlot; }
+
+public:
+	ASlotList();
+	~ASlotList();
+
+	bool Init(int nInitSize=16);
+	bool Release();
+	bool Reset();
+
+	bool Append(LPVOID pDataToAppend, ASLOTHANDLE * phSlot = NULL);
+	bool Delete(ASLOTHANDLE hSlot);
+	bool DeleteByData(LPVOID pData);
+	bool DeleteAt(int nIndex);
+
+	bool IsValid(ASLOTHANDLE hSlot);
+	// Return NULL if the handle is not valid any more;
+	LPVOID GetData(ASLOTHANDLE hSlot);
+	// Return -1 if not found;
+	int FindIndexByData(LPVOID pData);
+	ASLOTHANDLE GetHandleByIndex(int nIndex);
+
+	inline int GetSize() { return m_nSize; }
+	inline LPVOID GetAt(int nIndex) { return m_aData[nIndex]; }
+	inline LPVOID * GetDataArray() { return m_aData; }
+};
+
+typedef ASlotList * PASlotList;
+
+#endif//_ASLOTLIST_H_
@@ -15,6 +15,43 @@
 
 #include "AFPlatform.h"
 
+class AFileImage;
+
+#define ASTRTAB_MAGIC			0x42545341	// 'ASTB'
+#define ASTRTAB_VERSION			1
+
+// A displacement with this bit set is the slot of a bucket which has only one entry;
+#define ASTRTAB_DIRECTSLOT		0x80000000
+
+/*
+	A compiled table is a header, the displacements of the buckets, the slots and the string
+	blob, all offsets are from the beginning of the table. An entry name is hashed into a
+	bucket and the displacement of the bucket moves each name in it to its own slot, so a
+	lookup reads one displacement and one slot and compares one name. There are as many
+	slots as entries; the names and data in the blob end with '\0';
+*/
+typedef struct _ASTRTAB_HEADER
+{
+	DWORD		dwMagic;		// ASTRTAB_MAGIC;
+	DWORD		dwVersion;		// ASTRTAB_VERSION;
+	DWORD		dwNumEntries;
+	DWORD		dwNumBuckets;
+	DWORD		dwDispOffset;	// DWORD displacement of each bucket;
+	DWORD		dwSlotOffset;	// ASTRTAB_SLOT of each entry;
+	DWORD		dwBlobOffset;
+	DWORD		dwBlobSize;
+
+} ASTRTAB_HEADER, * PASTRTAB_HEADER;
+
+typedef struct _ASTRTAB_SLOT
+{
+	DWORD		dwHash;			// The first hash of the name, most misses are found without a compare;
+	DWORD		dwName;			// Offset of the name in the blob;
+	DWORD		dwData;			// Offset of the data in the blob;
+	DWORD		dwDataLen;		// Length of the data without '\0';
+
+} ASTRTAB_SLOT, * PASTRTAB_SLOT;
+
 typedef struct _ASTRING_ENTRY
 {
 	int				pEntryName; // Offset relative to the beginning of m_pCharBuffer;
@@ -34,6 +71,24 @@ private:
 
 	bool				m_bHasSorted;			// Flag indicating that the entries has been sorted according to its entry name;
 
+	// The compiled table, the entries above are only those added after it is built;
+	const BYTE *		m_pTable;				// Header first, NULL if there is no compiled table;
+	DWORD				m_dwTableSize;
+	AFileImage *		m_pTableImage;			// The binary file which m_pTable is the image of, it is kept open so the table is never copied; NULL if m_pTable is built in memory
+	DWORD *				m_aDisps;
+	ASTRTAB_SLOT *		m_aSlots;
+	const char *		m_pBlob;
+
+	void FreeEntries();
+	void FreeTable();
+	bool LoadTable(AFileImage * pImage);
+	const ASTRTAB_SLOT * FindSlot(const char * szEntryName);
+	int FindEntry(const char * szEntryName);
+	const char * GetEntryNamePtr(int nIndex);
+	const char * GetEntryDataPtr(int nIndex);
+
+	inline int GetNumCompiled() { return m_pTable ? (int) ((ASTRTAB_HEADER *) m_pTable)->dwNumEntries : 0; }
+
 protected:
 	int CompareTwoEntry(int nEntry1, int nEntry2);
 
@@ -41,6 +96,7 @@ public:
 	AStringTable();
 	~AStringTable();
 
+	// Load a text table of name and data pairs, or a binary table saved by SaveTable();
 	bool Init(char * szFilename);
 	bool Release();
 
@@ -56,6 +112,10 @@ public:
 	//		false		if pEntryData is too short, and pdwBufferLen will contain the length needed;
 	//		true		success
 	bool GetEntry(char * szEntryName, char * pszEntryData, DWORD dwBufLen, DWORD * pdwBufOutLen);
+	// Get a entry's string value without a copy, the pointer is valid until the table is
+	// built again or released; return NULL if not found. pdwDataLen can be NULL, it receives
+	// the length without '\0'
+	const char * GetEntry(const char * szEntryName, DWORD * pdwDataLen=NULL);
 	bool GetEntryDataByIndex(int nIndex, char * pszEntryData, DWORD dwBufLen, DWORD * pdwBufOutLen);
 	bool GetEntryNameByIndex(int nIndex, char * pszEntryName, DWORD dwBufLen, DWORD * pdwBufOutLen);
 
@@ -68,7 +128,15 @@ public:
 	// Sort the entries according to each entry's name;
 	bool ResortEntry();
 
-	inline int GetEntryCount() { return m_nEntryCount; }
+	// Compile all entries into a table with a minimal perfect hash, so that a lookup is O(1);
+	// Init() calls it after a text table is loaded
+	bool BuildTable();
+	// Save the compiled table as a binary file, the entries added since it was built are
+	// compiled first;
+	bool SaveTable(char * szFilename);
+
+	// Entries of the compiled table come first, then the ones added after it was built;
+	inline int GetEntryCount() { return GetNumCompiled() + m_nEntryCount; }
 };
 
 typedef class AStringTable * PAStringTable;
@@ -10,7 +10,7 @@
 #include "APlatform.h"
 #include "AStringArray.h"
 #include "ABinString.h"
-#include <hashtab.h>
+#include <flat_hashtab.h>
 
 class	A3DASSISTCACHEUNIT
 {
@@ -169,7 +169,7 @@ struct HASHSTR
 	inline bool operator ==(const HASHSTR &rhs) const
 	{ return (!strcmp(_reference, rhs)); }
 };
-typedef	abase::hashtab<int, HASHSTR, abase::_hash_function>	AAC_StrTab;
+typedef	abase::flat_hashtab<int, HASHSTR, abase::_hash_function>	AAC_StrTab;
 // 含二进制数据的字串
 struct HASHBINSTR
 {
@@ -193,7 +193,7 @@ struct _binstr_hash_function
 		return	BinStrHash(s);
 	}
 };
-typedef	abase::hashtab<int, HASHBINSTR, _binstr_hash_function>	AAC_BinStrTab;
+typedef	abase::flat_hashtab<int, HASHBINSTR, _binstr_hash_function>	AAC_BinStrTab;
 // 真正的应用类
 typedef		A3DAssistCache_StrNoDup<AAC_StrTab, AStringArray>		A3DAssistCache_String;
 typedef		A3DAssistCache_StrNoDup<AAC_BinStrTab, ABinStringArray>	A3DAssistCache_BinString;
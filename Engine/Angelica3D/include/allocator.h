@@ -46,13 +46,60 @@ public:
 	int  check(int type);		//0 ʾûκδ
 
 public:
-	allocator(size_t __block_size, size_t __default_n, size_t __grow);
+	allocator(size_t __block_size, size_t __default_n, size_t __grow, size_t __align = sizeof(void *));
 	~allocator();
 
 	void *  alloc();
 	void	free(void *);
 	void	release();	//release with custom support
 };
+
+/*
+	Size-classed allocator for small objects. Sizes up to MAX_SIZE are rounded up to one of
+	the size classes and served from CHUNK_SIZE chunks, each thread keeps a small cache of
+	free blocks for each class and exchanges them with the locked central pools in batches.
+	Chunks whose blocks are all free are given back to the OS. Larger sizes go to align_malloc.
+
+	All blocks are aligned to ALIGN bytes. The size passed to free() must be the one passed
+	to alloc(), the debug build asserts it. A thread should call flush_thread_cache() before it exits, or the blocks
+	cached by it are lost; the engine's own threads do it by afastflush().
+*/
+class fast_allocator
+{
+public:
+	enum{
+		MAX_SIZE	= 4096,
+		ALIGN		= 16,
+		CHUNK_SIZE	= 65536		//the allocation granularity of VirtualAlloc
+	};
+
+	struct stats{
+		size_t	chunk_count;		//chunks held by the central pools
+		size_t	large_count;		//blocks larger than MAX_SIZE not freed yet
+	};
+
+	static void *	alloc(size_t __size);
+	static void		free(void * __p, size_t __size);
+
+	static void		flush_thread_cache();
+	static void		trim();			//give all empty chunks back to the OS
+	static void		get_stats(stats * __stats);
+};
 }
 
+//Opt-in replacement of malloc/free for the engine's small allocations, define
+//_A3D_USE_FASTALLOC in the project settings to enable it. It serves the blocks which come
+//and go all the time, the AList elements and the gfx records of A3DModel; the particle
+//buffers are far larger than MAX_SIZE so they stay on malloc, and the mesh nodes of
+//A3DMeshSorter already come from the engine's frame arena.
+#ifdef _A3D_USE_FASTALLOC
+#define afastalloc(x) abase::fast_allocator::alloc(x)
+#define afastfree(x,size) abase::fast_allocator::free(x,size)
+#define afastflush() abase::fast_allocator::flush_thread_cache()
+#else
+#define afastalloc(x) malloc(x)
+#define afastfree(x,size) free(x)
+#define afastflush()
+#endif
+
 #endif
@@ -32,6 +32,21 @@ void	* align_malloc_rl(size_t size, int align);
 void	align_free_rl(void *pdata);
 void	amemory_write_log(const char * fmt, ...);
 
+/*
+	tracking options of a_malloc, they can also be set by the environment variables
+	AMEMORY_SAMPLE_RATE and AMEMORY_GUARD_BAND before the first allocation.
+	sample rate: 1 counts every block to its site (default), N counts one of N blocks and 0
+	counts none. every block is still tracked, so the leaks at exit are always listed.
+	guard band: non-zero pads each block with bands which are checked when it is freed.
+*/
+void	amemory_set_sample_rate(int rate);
+int		amemory_get_sample_rate();
+void	amemory_set_guard_band(int enable);
+
+//write the live bytes and blocks of each allocation site sorted by the live bytes,
+//to the memory log if filename is NULL. return number of sites or -1 if failed
+int		amemory_dump_profile(const char * filename);
+
 #ifdef __cplusplus
 }
 #endif
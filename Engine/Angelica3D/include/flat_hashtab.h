@@ -0,0 +1,300 @@
+/*
+ * FILE: flat_hashtab.h
+ *
+ * DESCRIPTION: open addressing hash table
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+*/
+
+#ifndef __ABASE_FLAT_HASH_TABLE_H__
+#define __ABASE_FLAT_HASH_TABLE_H__
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "hashtab.h"
+
+namespace abase{
+
+/*
+	flat_hashtab has the same put/get/erase/enum_element as hashtab, but keeps the elements in
+	two arrays of a power of 2 size and finds them by linear probing, so there is no allocation
+	per element. The hashes are kept apart from the keys and values, so a probe scans a dense
+	array of hashes and only reads the slot whose hash matches.
+	Unlike hashtab, the pointer returned by get is only valid until the next put or resize.
+	If the arrays can not be allocated, put fails and the old table is kept.
+*/
+template <class _Value, class _Key, class _HashFunc>
+class flat_hashtab
+{
+private:
+typedef _Key	key_type;
+typedef _Value	value_type;
+struct _Slot
+{
+	_Key	_key;
+	_Value	_val;
+};
+enum { _empty = 0, _deleted = 1, _min_size = 8 };
+
+private:
+	_HashFunc		_hash;
+	size_t			_num_elements;
+	size_t			_num_deleted;
+	size_t			_mask;			//number of slots - 1
+	unsigned int *	_hashes;		//_empty, _deleted or the hash of the key in the slot
+	_Slot *			_slots;
+
+	static unsigned int	_S_no_hashes[1];	//the table of no slot when out of memory
+
+public:
+	flat_hashtab(size_t __n,
+		const _HashFunc & __hf)
+	:_hash(__hf)
+	{
+		_M_initialize(__n);
+	}
+
+	flat_hashtab(size_t __n):_hash()
+	{
+		_M_initialize(__n);
+	}
+
+	~flat_hashtab()
+	{
+		clear();
+		if (_hashes != _S_no_hashes) free(_hashes);
+	}
+
+	size_t size() const { return _num_elements; }
+	size_t max_size() const { return size_t(-1); }
+	bool empty() const { return size() == 0; }
+	size_t bucket_count() const { return _mask + 1; }
+	//bytes used by the table itself, not counting what the keys and values point to
+	size_t memory_usage() const { return sizeof(*this) + (_mask + 1) * (sizeof(unsigned int) + sizeof(_Slot)); }
+	void clear();
+	void resize(size_t __num_elements_hint);
+	inline bool put(const key_type & __key , const value_type & __val){
+		if((_num_elements + _num_deleted + 1) * 4 > (_mask + 1) * 3 && !_M_rehash(_num_elements + 1))
+			return false;
+		return put_noresize(__key,__val);
+	}
+	bool put_noresize(const key_type & __key , const value_type & __val);
+	pair<value_type *, bool> get(const key_type &__key) const;
+	bool erase(const key_type &__key);
+
+	template<class _EnumFunc>
+	void enum_element(_EnumFunc & __func)
+	{
+		for (size_t __i = 0; __i <= _mask; __i ++) {
+			if (_hashes[__i] > _deleted)
+				__func(_slots[__i]._val);
+		}
+	}
+
+private:
+	flat_hashtab(const flat_hashtab &);
+	flat_hashtab & operator=(const flat_hashtab &);
+
+	//pointers and small integers are poor hash values for a power of 2 table with linear
+	//probing, so every bit is mixed into the low bits before they are masked
+	inline unsigned int _M_hash(const key_type & __key) const
+	{
+		unsigned int __h = (unsigned int)_hash(__key);
+		__h ^= __h >> 16;
+		__h *= 0x85ebca6bu;
+		__h ^= __h >> 13;
+		__h *= 0xc2b2ae35u;
+		__h ^= __h >> 16;
+		return __h > _deleted ? __h : __h + 2;
+	}
+
+	static size_t _M_next_size(size_t __n)
+	{
+		size_t __size = _min_size;
+		while(__size * 3 < __n * 4) __size <<= 1;
+		return __size;
+	}
+
+	void _M_initialize(size_t __n);
+	bool _M_allocate(size_t __size);
+	bool _M_rehash(size_t __num_elements_hint);
+};
+
+template <class _Value, class _Key, class _HashFunc>
+unsigned int flat_hashtab<_Value,_Key,_HashFunc>::_S_no_hashes[1] = { _empty };
+
+template <class _Value, class _Key, class _HashFunc>
+bool flat_hashtab<_Value,_Key,_HashFunc>::
+	_M_allocate(size_t __size)
+{
+	//one block for the two arrays, the slots start at a 16 bytes boundary
+	size_t __hash_bytes = (__size * sizeof(unsigned int) + 15) & ~15;
+	char * __buf = (char *)malloc(__hash_bytes + __size * sizeof(_Slot));
+	if(!__buf) return false;
+
+	_hashes = (unsigned int *)__buf;
+	_slots = (_Slot *)(__buf + __hash_bytes);
+	memset(_hashes, 0, __size * sizeof(unsigned int));
+	_mask = __size - 1;
+	_num_deleted = 0;
+	return true;
+}
+
+template <class _Value, class _Key, class _HashFunc>
+void flat_hashtab<_Value,_Key,_HashFunc>::
+	_M_initialize(size_t __n)
+{
+	_num_elements = 0;
+	if(!_M_allocate(_M_next_size(__n)))
+	{
+		//an empty table of one slot, every put will try to allocate again
+		_hashes = _S_no_hashes;
+		_slots = NULL;
+		_mask = 0;
+		_num_deleted = 0;
+	}
+}
+
+template <class _Value, class _Key, class _HashFunc>
+bool flat_hashtab<_Value,_Key,_HashFunc>::
+	_M_rehash(size_t __num_elements_hint)
+{
+	unsigned int * __old_hashes = _hashes;
+	_Slot * __old_slots = _slots;
+	size_t __old_n = _mask + 1;
+
+	//if most of the used slots are deleted ones, just clean them in a table of the same size
+	size_t __n = _M_next_size(__num_elements_hint);
+	if(__n < __old_n) __n = __old_n;
+	if(!_M_allocate(__n)) return false;
+
+	for (size_t __i = 0; __i < __old_n; __i ++) {
+		unsigned int __h = __old_hashes[__i];
+		if (__h <= _deleted) continue;
+
+		size_t __slot = __h & _mask;
+		while (_hashes[__slot] != _empty) __slot = (__slot + 1) & _mask;
+		_hashes[__slot] = __h;
+		new ((void *)&_slots[__slot]._key) key_type(__old_slots[__i]._key);
+		new ((void *)&_slots[__slot]._val) value_type(__old_slots[__i]._val);
+		__old_slots[__i]._key.~key_type();
+		__old_slots[__i]._val.~value_type();
+	}
+	if(__old_hashes != _S_no_hashes) free(__old_hashes);
+	return true;
+}
+
+template <class _Value, class _Key, class _HashFunc>
+void flat_hashtab<_Value,_Key,_HashFunc>::
+	resize(size_t __num_elements_hint)
+{
+	if(__num_elements_hint * 4 > (_mask + 1) * 3)
+		_M_rehash(__num_elements_hint);
+}
+
+template <class _Value, class _Key, class _HashFunc>
+bool flat_hashtab<_Value,_Key,_HashFunc>::
+	put_noresize(const key_type & __key , const value_type & __val)
+{
+	//at least one slot must stay empty to end the probes
+	if (_num_elements + _num_deleted + 1 > _mask) return false;
+
+	unsigned int __h = _M_hash(__key);
+	size_t __slot = __h & _mask;
+	size_t __free_slot = size_t(-1);
+
+	for (;;) {
+		unsigned int __cur = _hashes[__slot];
+		if (__cur == _empty) break;
+		if (__cur == _deleted) {
+			if (__free_slot == size_t(-1)) __free_slot = __slot;
+		}
+		else if (__cur == __h && _slots[__slot]._key == __key)
+			return false;
+		__slot = (__slot + 1) & _mask;
+	}
+
+	if (__free_slot != size_t(-1)) {
+		__slot = __free_slot;
+		_num_deleted --;
+	}
+	_hashes[__slot] = __h;
+	new ((void *)&_slots[__slot]._key) key_type(__key);
+	new ((void *)&_slots[__slot]._val) value_type(__val);
+	++_num_elements;
+	return true;
+}
+
+template <class _Value, class _Key, class _HashFunc>
+void flat_hashtab<_Value,_Key,_HashFunc>::
+	clear()
+{
+	for (size_t __i = 0; __i <= _mask; __i ++) {
+		if (_hashes[__i] > _deleted) {
+			_slots[__i]._key.~key_type();
+			_slots[__i]._val.~value_type();
+		}
+		_hashes[__i] = _empty;
+	}
+	_num_elements = 0;
+	_num_deleted = 0;
+}
+
+template <class _Value, class _Key, class _HashFunc>
+pair<_Value *, bool> flat_hashtab<_Value,_Key,_HashFunc>::
+	get(const key_type &__key) const
+{
+	unsigned int __h = _M_hash(__key);
+	size_t __slot = __h & _mask;
+
+	for (;;) {
+		unsigned int __cur = _hashes[__slot];
+		if (__cur == _empty) break;
+		if (__cur == __h && _slots[__slot]._key == __key)
+			return pair<_Value *,bool>(&_slots[__slot]._val,true);
+		__slot = (__slot + 1) & _mask;
+	}
+	return pair<_Value *,bool>((_Value *)NULL,false);
+}
+
+template <class _Value, class _Key, class _HashFunc>
+bool flat_hashtab<_Value,_Key,_HashFunc>::
+	erase(const key_type &__key)
+{
+	unsigned int __h = _M_hash(__key);
+	size_t __slot = __h & _mask;
+
+	for (;;) {
+		unsigned int __cur = _hashes[__slot];
+		if (__cur == _empty) return false;
+		if (__cur == __h && _slots[__slot]._key == __key) break;
+		__slot = (__slot + 1) & _mask;
+	}
+
+	_slots[__slot]._key.~key_type();
+	_slots[__slot]._val.~value_type();
+	_num_elements --;
+
+	//no probe can pass an empty slot, so when the next one is empty this slot and the
+	//deleted ones before it can be emptied too
+	if (_hashes[(__slot + 1) & _mask] == _empty) {
+		_hashes[__slot] = _empty;
+		__slot = (__slot - 1) & _mask;
+		while (_hashes[__slot] == _deleted) {
+			_hashes[__slot] = _empty;
+			_num_deleted --;
+			__slot = (__slot - 1) & _mask;
+		}
+	}
+	else {
+		_hashes[__slot] = _deleted;
+		_num_deleted ++;
+	}
+	return true;
+}
+}
+#endif
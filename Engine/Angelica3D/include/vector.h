@@ -14,6 +14,7 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <new>
 
 namespace abase
@@ -28,22 +29,63 @@ inline void swap(T & lhs,T & rhs)
 	rhs = tmp;
 }
 
-template <class T> 
+/*
+	A type is relocatable when moving an object to another address is the same as copying
+	its bytes and forgetting the old ones. vector grows with realloc and inserts and erases
+	with memmove for such types, other types are copied and destroyed one by one. Copies
+	of the elements are only made by memcpy when the type is trivially copyable.
+	Types with trivial copy and destructor are relocatable, a class which does not point to
+	itself (it may own buffers through pointers) can be declared by ABASE_DECLARE_RELOCATABLE
+	after the class, outside any namespace.
+*/
+template <class T>
+struct is_trivially_copyable
+{
+	enum { value = __has_trivial_copy(T) && __has_trivial_destructor(T) };
+};
+
+template <class T>
+struct is_relocatable
+{
+	enum { value = is_trivially_copyable<T>::value };
+};
+
+#define ABASE_DECLARE_RELOCATABLE(T)	namespace abase { template<> struct is_relocatable<T > { enum { value = 1 }; }; }
+
+template <class T>
 class vector
 {
 protected:
 	inline T * _M_allocate(size_t __n) { return (T*)malloc(__n * sizeof(T));}
 	inline void _M_deallocate(T* __p, size_t __n){free(__p);}
-	inline T *_M_allocate_and_copy(size_t __n, T *start, T * finish){
-		T * tmp = _M_allocate(__n);
-		T * tmp2;
-		tmp2 = tmp;
-		while(start != finish && (__n--)>0)
+	//move [first, last) to the raw memory at dest, the source is left as raw memory
+	inline static void _M_relocate(T * dest, T * first, T * last)
+	{
+		if(is_relocatable<T>::value)
 		{
-			new ((void *)&*tmp++) T(*start++);
+			if(last > first) memcpy((void *)dest, (void *)first, (last - first) * sizeof(T));
+			return;
+		}
+		while(first != last)
+		{
+			new ((void *)dest++) T(*first);
+			first++->~T();
 		}
-		return tmp;
 	}
+	//change the capacity to __n which is not less than size(), elements are relocated
+	void _M_reallocate(size_t __n);
+	//make room for __n more elements with the growth of push_back
+	inline void _M_grow_for(size_t __n)
+	{
+		if(_cur_size + __n > _max_size)
+		{
+			size_t newsize = _cur_size + (_cur_size > 2? _cur_size>>1 : _cur_size);
+			if(newsize < _cur_size + __n) newsize = _cur_size + __n;
+			_M_reallocate(newsize);
+		}
+	}
+	//open a gap of __n raw elements at index idx, capacity must be enough
+	void _M_open_gap(size_t idx, size_t __n);
 protected:
 	T * _data;
 	T * _finish;
@@ -76,19 +118,47 @@ public:
 	inline void clear(){ erase(begin(),end());}
 
 	void reserve(size_t __n) {
-		if (capacity() < __n) {
-			const size_t __old_size = size();
-			T * __tmp = _M_allocate_and_copy(__n, _data, _finish);
-			for(T * fp = _data;fp < _finish;fp ++)
-				fp->~T();
-			_M_deallocate(_data, _max_size);
-			_data		= __tmp;
-			_finish		= __tmp + __old_size;
-			_max_size	= __n;
-		}
+		if (capacity() < __n)
+			_M_reallocate(__n);
 	}
 	void push_back(const T & x);
 	void pop_back() {_finish--;_cur_size --;_finish->~T();}
+
+	//construct the new element in place with the arguments of one of T's constructors,
+	//this saves a temporary and a copy for big elements. The arguments must not refer to
+	//the elements of this vector
+	inline T & emplace_back()
+	{
+		_M_grow_for(1);
+		new ((void *)_finish) T();
+		_cur_size ++;
+		return *_finish++;
+	}
+	template <class A1>
+	inline T & emplace_back(const A1 & a1)
+	{
+		_M_grow_for(1);
+		new ((void *)_finish) T(a1);
+		_cur_size ++;
+		return *_finish++;
+	}
+	template <class A1, class A2>
+	inline T & emplace_back(const A1 & a1, const A2 & a2)
+	{
+		_M_grow_for(1);
+		new ((void *)_finish) T(a1, a2);
+		_cur_size ++;
+		return *_finish++;
+	}
+	template <class A1, class A2, class A3>
+	inline T & emplace_back(const A1 & a1, const A2 & a2, const A3 & a3)
+	{
+		_M_grow_for(1);
+		new ((void *)_finish) T(a1, a2, a3);
+		_cur_size ++;
+		return *_finish++;
+	}
+	void append(const T * first, const T * last);	// append [first, last) in one growth
 	T *insert(T * data,const T& x);
 	void insert(T *it, size_t n, const T& x);
 	void swap(vector<T> & x);
@@ -98,6 +168,13 @@ public:
 
 };
 
+//vector only points to its heap buffer, so it can be relocated whatever T is
+template <class T>
+struct is_relocatable<vector<T> >
+{
+	enum { value = 1 };
+};
+
 template <class T>
 vector<T>::vector(int n)
 {
@@ -125,88 +202,126 @@ vector<T>::vector(const vector<T> & rhs)
 	_cur_size	= rhs._cur_size;
 	_data		= _M_allocate(_max_size);
 	_finish		= _data;
+	if(is_trivially_copyable<T>::value)
+	{
+		if(_cur_size) memcpy((void *)_data, (const void *)rhs.begin(), _cur_size * sizeof(T));
+		_finish += _cur_size;
+		return;
+	}
 	int n = _cur_size;
-	T * it = rhs.begin();
+	const T * it = rhs.begin();
 	while(n--) new((void*)&*_finish++) T(*it++);
 }
 
 template <class T>
 vector<T>::~vector()
-{	
+{
 	clear();
 	_M_deallocate(_data,_max_size);
 }
 
 template <class T>
-void vector<T>::push_back(const T & x)
+void vector<T>::_M_reallocate(size_t __n)
 {
-	if(_cur_size == _max_size)
+	T * newdata;
+	if(is_relocatable<T>::value)
+	{
+		newdata = (T *)realloc(_data, (__n ? __n : 1) * sizeof(T));
+		assert(newdata);
+	}
+	else
 	{
-		size_t newsize;
-		size_t i;
-		T * newdata,*tmp1,*tmp2;
-		newsize = _cur_size;
-		if(newsize == 0) 
-			newsize = 1;
-		else
-			newsize += _cur_size > 2? _cur_size>>1 : _cur_size;
-		newdata = _M_allocate(newsize);
+		newdata = _M_allocate(__n ? __n : 1);
 		assert(newdata);
-		tmp1 = newdata;
-		tmp2 = _data;
-		for(i = 0; i < _cur_size;i++)
-			new ((void *)&*tmp1++) T(*tmp2++);
+		_M_relocate(newdata, _data, _finish);
+		_M_deallocate(_data,_max_size);
+	}
+	_max_size = __n;
+	_data = newdata;
+	_finish = _data + _cur_size;
+}
 
-		tmp2 = _data;
-		for(i = 0; i < _cur_size; i++)
-			tmp2++->~T();
+template <class T>
+void vector<T>::_M_open_gap(size_t idx, size_t __n)
+{
+	T * pos = _data + idx;
+	if(is_relocatable<T>::value)
+	{
+		memmove((void *)(pos + __n), (void *)pos, (_cur_size - idx) * sizeof(T));
+		return;
+	}
+	//construct the tail from the back, so nothing is overwritten before it is copied
+	for(T * tp = _finish;tp > pos;)
+	{
+		tp --;
+		new ((void *)(tp + __n)) T(*tp);
+		tp->~T();
+	}
+}
 
-		_M_deallocate(_data,_max_size);
-		_max_size = newsize;
-		_data = newdata;
-		_finish = _data + _cur_size;
+template <class T>
+void vector<T>::push_back(const T & x)
+{
+	if(_cur_size == _max_size)
+	{
+		//x may be an element of this vector, keep it alive until it is copied
+		if(&x >= _data && &x < _finish)
+		{
+			T tmp(x);
+			_M_grow_for(1);
+			new ((void *)&*(_finish)) T(tmp);
+			_cur_size ++;
+			_finish ++;
+			return;
+		}
+		_M_grow_for(1);
 	}
-	
+
 	new ((void *)&*(_finish)) T(x);
 	_cur_size ++;
 	_finish ++;
 }
 
 template <class T>
-T *vector<T>::insert(T * data,const T& x)
+void vector<T>::append(const T * first, const T * last)
 {
-	int idx;
-	idx = data - _data;
-	if(_cur_size == _max_size)
+	size_t n = last - first;
+	if(n == 0) return;
+	if(_cur_size + n > _max_size)
 	{
-		int newsize;
-		T * newdata,*tmp1,*tmp2;
-		newsize = _cur_size > 0?_cur_size * 2 : 1;
-		newdata = _M_allocate(newsize);
-		assert(newdata);
-		tmp1 = newdata;
-		tmp2 = _data;
-
-		while(tmp2 < data)
-			new ((void *)&*tmp1++) T(*tmp2++);
-
-		new ((void *)&*tmp1++) T(x);
-
-		while(tmp2 < _finish)
-			new ((void *)&*tmp1++) T(*tmp2++);
-
-		_M_deallocate(_data,_max_size);
-		_max_size = newsize;
-		_data = newdata;
-		_finish = _data + _cur_size;
+		if(first >= _data && first < _finish)
+		{
+			//the range is inside this vector, copy it out before the growth
+			vector<T> tmp(n);
+			tmp.append(first, last);
+			append(tmp.begin(), tmp.end());
+			return;
+		}
+		_M_grow_for(n);
 	}
+
+	if(is_trivially_copyable<T>::value)
+		memcpy((void *)_finish, (const void *)first, n * sizeof(T));
 	else
 	{
-		new ((void*)_finish) T(*(_finish -1));
-		for(T * tp = _finish - 1;tp > data;tp --)
-			*tp = *(tp-1);
-		*data = x;
+		for(const T * it = first; it != last; it++)
+			new ((void *)(_finish + (it - first))) T(*it);
 	}
+	_cur_size += n;
+	_finish += n;
+}
+
+template <class T>
+T *vector<T>::insert(T * data,const T& x)
+{
+	int idx;
+	idx = data - _data;
+	T tmp(x);	//x may be an element of this vector
+	if(_cur_size == _max_size)
+		_M_reallocate(_cur_size > 0?_cur_size * 2 : 1);
+
+	_M_open_gap(idx, 1);
+	new ((void *)(_data + idx)) T(tmp);
 	_cur_size ++;
 	_finish ++;
 	return _data + idx;
@@ -217,36 +332,14 @@ void vector<T>::insert(T *it, size_t n, const T& x)
 {
 	int idx;
 	idx = it - _data;
+	if(n == 0) return;
+	T tmp(x);	//x may be an element of this vector
 	if(_cur_size + n > _max_size)
-	{
-		int newsize;
-		T * newdata,*tmp1,*tmp2;
-		newsize = (_cur_size + n) * 2; //$$
-		newdata = _M_allocate(newsize);
-		assert(newdata);
-		tmp1 = newdata;
-		tmp2 = _data;
-
-		while(tmp2 < it)
-			new ((void *)&*tmp1++) T(*tmp2++);
-
-		for(int i = 0; i< n; i++) new ((void *)&*tmp1++) T(x);
+		_M_reallocate((_cur_size + n) * 2); //$$
 
-		while(tmp2 < _finish)
-			new ((void *)&*tmp1++) T(*tmp2++);
-
-		_M_deallocate(_data,_max_size);
-		_max_size = newsize;
-		_data = newdata;
-		_finish = _data + _cur_size;
-	}
-	else
-	{
-		for(T * tp = _finish - 1;tp >= it;tp --)
-			*(tp + n) = *tp;
-		for(T *tp2 = it; tp2 < it + n; tp2++)
-			*tp2 = x;
-	}
+	_M_open_gap(idx, n);
+	for(T *tp2 = _data + idx; tp2 < _data + idx + n; tp2++)
+		new ((void *)tp2) T(tmp);
 	_cur_size += n;
 	_finish += n;
 	return;
@@ -257,15 +350,7 @@ void vector<T>::erase(T *obj)
 {
 	if(_cur_size)
 	{
-		int idx = obj - _data;
-
-		for(T * fp = obj;fp < _finish - 1;fp++)
-		{
-			*fp = *(fp+1);
-		}
-		_cur_size --;
-		_finish --;
-		_finish->~T();	//destroy the last
+		erase(obj, obj + 1);
 	}
 
 }
@@ -282,16 +367,26 @@ void vector<T>::swap(vector<T> & __x)
 template <class T>
 void vector<T>::erase(T *first, T * last)
 {
+	if(first == last) return;
 	T * fp;
 	T * fp2;
-	for(fp = last,fp2 = first; fp < _finish;fp++,fp2++)
+	if(is_relocatable<T>::value)
 	{
-		*fp2 = *fp;
+		for(fp = first; fp < last; fp++)
+			fp->~T();
+		memmove((void *)first, (void *)last, (_finish - last) * sizeof(T));
 	}
-
-	for(;fp2 < _finish; fp2++)
+	else
 	{
-		fp2->~T();
+		for(fp = last,fp2 = first; fp < _finish;fp++,fp2++)
+		{
+			*fp2 = *fp;
+		}
+
+		for(;fp2 < _finish; fp2++)
+		{
+			fp2->~T();
+		}
 	}
 	_finish   -= (last - first);
 	_cur_size -= (last - first);
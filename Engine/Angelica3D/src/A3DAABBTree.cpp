@@ -0,0 +1,513 @@
+/*
+ * FILE: A3DAABBTree.cpp
+ *
+ * DESCRIPTION: A dynamic tree of axis aligned bounding boxes, which is used to find the
+ *				objects a trace may hit without testing all of them;
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "A3DAABBTree.h"
+#include "A3DFuncs.h"
+#include "A3DErrLog.h"
+#include "amemory.h"
+
+// Half of the surface area, it is the cost of visiting a box;
+static inline FLOAT GetBoxArea(const A3DVECTOR3& vMins, const A3DVECTOR3& vMaxs)
+{
+	FLOAT dx = vMaxs.x - vMins.x;
+	FLOAT dy = vMaxs.y - vMins.y;
+	FLOAT dz = vMaxs.z - vMins.z;
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static inline void UnionBox(const A3DVECTOR3& vMins1, const A3DVECTOR3& vMaxs1, const A3DVECTOR3& vMins2, const A3DVECTOR3& vMaxs2,
+							A3DVECTOR3& vMins, A3DVECTOR3& vMaxs)
+{
+	vMins.x = min(vMins1.x, vMins2.x);
+	vMins.y = min(vMins1.y, vMins2.y);
+	vMins.z = min(vMins1.z, vMins2.z);
+	vMaxs.x = max(vMaxs1.x, vMaxs2.x);
+	vMaxs.y = max(vMaxs1.y, vMaxs2.y);
+	vMaxs.z = max(vMaxs1.z, vMaxs2.z);
+}
+
+A3DAABBTree::A3DAABBTree() : m_Stack(64)
+{
+	m_aNodes		= NULL;
+	m_nMaxNodes		= 0;
+	m_nNumNodes		= 0;
+	m_nFreeNode		= A3DAABBTREE_NULL;
+	m_nRoot			= A3DAABBTREE_NULL;
+	m_nNumProxies	= 0;
+	m_vMargin		= A3DAABBTREE_MARGIN;
+}
+
+A3DAABBTree::~A3DAABBTree()
+{
+	Release();
+}
+
+bool A3DAABBTree::Init(FLOAT vMargin)
+{
+	Release();
+
+	m_vMargin = vMargin;
+	return true;
+}
+
+bool A3DAABBTree::Release()
+{
+	if( m_aNodes )
+	{
+		afree(m_aNodes);
+		m_aNodes = NULL;
+	}
+
+	m_nMaxNodes		= 0;
+	m_nNumNodes		= 0;
+	m_nFreeNode		= A3DAABBTREE_NULL;
+	m_nRoot			= A3DAABBTREE_NULL;
+	m_nNumProxies	= 0;
+	return true;
+}
+
+bool A3DAABBTree::Reset()
+{
+	// Keep the nodes for the next proxies;
+	m_nNumNodes		= 0;
+	m_nFreeNode		= A3DAABBTREE_NULL;
+	m_nRoot			= A3DAABBTREE_NULL;
+	m_nNumProxies	= 0;
+	return true;
+}
+
+int A3DAABBTree::AllocNode()
+{
+	if( A3DAABBTREE_NULL == m_nFreeNode && m_nNumNodes == m_nMaxNodes )
+	{
+		int nNewMax = m_nMaxNodes ? m_nMaxNodes * 2 : 64;
+		A3DAABBTREE_NODE * aNewNodes = (A3DAABBTREE_NODE *) amalloc(sizeof(A3DAABBTREE_NODE) * nNewMax);
+		if( NULL == aNewNodes )
+		{
+			g_pA3DErrLog->ErrLog("A3DAABBTree::AllocNode(), Not enough memory!");
+			return A3DAABBTREE_NULL;
+		}
+
+		if( m_aNodes )
+		{
+			memcpy(aNewNodes, m_aNodes, sizeof(A3DAABBTREE_NODE) * m_nNumNodes);
+			afree(m_aNodes);
+		}
+
+		m_aNodes = aNewNodes;
+		m_nMaxNodes = nNewMax;
+	}
+
+	int nNode;
+	if( A3DAABBTREE_NULL != m_nFreeNode )
+	{
+		nNode = m_nFreeNode;
+		m_nFreeNode = m_aNodes[nNode].nParent;
+	}
+	else
+		nNode = m_nNumNodes ++;
+
+	A3DAABBTREE_NODE * pNode = &m_aNodes[nNode];
+	pNode->pData	= NULL;
+	pNode->nParent	= A3DAABBTREE_NULL;
+	pNode->nChild1	= A3DAABBTREE_NULL;
+	pNode->nChild2	= A3DAABBTREE_NULL;
+	pNode->nHeight	= 0;
+	return nNode;
+}
+
+void A3DAABBTree::FreeNode(int nNode)
+{
+	m_aNodes[nNode].nParent = m_nFreeNode;
+	m_aNodes[nNode].nHeight = -1;
+	m_nFreeNode = nNode;
+}
+
+int A3DAABBTree::CreateProxy(const A3DVECTOR3& vMins, const A3DVECTOR3& vMaxs, LPVOID pData)
+{
+	int nProxy = AllocNode();
+	if( A3DAABBTREE_NULL == nProxy )
+		return A3DAABBTREE_NULL;
+
+	A3DAABBTREE_NODE * pNode = &m_aNodes[nProxy];
+	pNode->vMins = vMins - A3DVECTOR3(m_vMargin);
+	pNode->vMaxs = vMaxs + A3DVECTOR3(m_vMargin);
+	pNode->pData = pData;
+
+	if( !InsertLeaf(nProxy) )
+	{
+		FreeNode(nProxy);
+		return A3DAABBTREE_NULL;
+	}
+
+	m_nNumProxies ++;
+	return nProxy;
+}
+
+void A3DAABBTree::DestroyProxy(int nProxy)
+{
+	if( nProxy < 0 || nProxy >= m_nNumNodes || !IsLeaf(nProxy) || m_aNodes[nProxy].nHeight < 0 )
+		return;
+
+	RemoveLeaf(nProxy);
+	FreeNode(nProxy);
+	m_nNumProxies --;
+}
+
+bool A3DAABBTree::MoveProxy(int nProxy, const A3DVECTOR3& vMins, const A3DVECTOR3& vMaxs)
+{
+	A3DAABBTREE_NODE * pNode = &m_aNodes[nProxy];
+
+	// Stay in the fat box, unless the object has become much smaller than the box;
+	FLOAT vLimit = m_vMargin * 4.0f;
+	if( pNode->vMins.x <= vMins.x && pNode->vMins.y <= vMins.y && pNode->vMins.z <= vMins.z &&
+		pNode->vMaxs.x >= vMaxs.x && pNode->vMaxs.y >= vMaxs.y && pNode->vMaxs.z >= vMaxs.z &&
+		vMins.x - pNode->vMins.x <= vLimit && vMins.y - pNode->vMins.y <= vLimit && vMins.z - pNode->vMins.z <= vLimit &&
+		pNode->vMaxs.x - vMaxs.x <= vLimit && pNode->vMaxs.y - vMaxs.y <= vLimit && pNode->vMaxs.z - vMaxs.z <= vLimit )
+		return false;
+
+	// The parent freed by RemoveLeaf() is used again, so InsertLeaf() never fails here;
+	RemoveLeaf(nProxy);
+
+	pNode->vMins = vMins - A3DVECTOR3(m_vMargin);
+	pNode->vMaxs = vMaxs + A3DVECTOR3(m_vMargin);
+
+	InsertLeaf(nProxy);
+	return true;
+}
+
+bool A3DAABBTree::InsertLeaf(int nLeaf)
+{
+	if( A3DAABBTREE_NULL == m_nRoot )
+	{
+		m_nRoot = nLeaf;
+		m_aNodes[nLeaf].nParent = A3DAABBTREE_NULL;
+		return true;
+	}
+
+	// Find the best sibling, going down to the child which grows the least;
+	A3DVECTOR3 vLeafMins = m_aNodes[nLeaf].vMins;
+	A3DVECTOR3 vLeafMaxs = m_aNodes[nLeaf].vMaxs;
+	A3DVECTOR3 vMins, vMaxs;
+
+	int nNode = m_nRoot;
+	while( !IsLeaf(nNode) )
+	{
+		A3DAABBTREE_NODE * pNode = &m_aNodes[nNode];
+		int nChild1 = pNode->nChild1;
+		int nChild2 = pNode->nChild2;
+
+		FLOAT vArea = GetBoxArea(pNode->vMins, pNode->vMaxs);
+		UnionBox(pNode->vMins, pNode->vMaxs, vLeafMins, vLeafMaxs, vMins, vMaxs);
+		FLOAT vCombinedArea = GetBoxArea(vMins, vMaxs);
+
+		// Cost of making a new parent of this node and the leaf;
+		FLOAT vCost = 2.0f * vCombinedArea;
+		// Minimum cost of pushing the leaf further down the tree;
+		FLOAT vInheritCost = 2.0f * (vCombinedArea - vArea);
+
+		FLOAT vCost1, vCost2;
+		A3DAABBTREE_NODE * pChild = &m_aNodes[nChild1];
+		UnionBox(pChild->vMins, pChild->vMaxs, vLeafMins, vLeafMaxs, vMins, vMaxs);
+		vCost1 = GetBoxArea(vMins, vMaxs) + vInheritCost;
+		if( !IsLeaf(nChild1) )
+			vCost1 -= GetBoxArea(pChild->vMins, pChild->vMaxs);
+
+		pChild = &m_aNodes[nChild2];
+		UnionBox(pChild->vMins, pChild->vMaxs, vLeafMins, vLeafMaxs, vMins, vMaxs);
+		vCost2 = GetBoxArea(vMins, vMaxs) + vInheritCost;
+		if( !IsLeaf(nChild2) )
+			vCost2 -= GetBoxArea(pChild->vMins, pChild->vMaxs);
+
+		if( vCost < vCost1 && vCost < vCost2 )
+			break;
+
+		nNode = vCost1 < vCost2 ? nChild1 : nChild2;
+	}
+
+	// Make a new parent of the sibling and the leaf, the nodes may move in AllocNode();
+	int nSibling = nNode;
+	int nOldParent = m_aNodes[nSibling].nParent;
+	int nNewParent = AllocNode();
+	if( A3DAABBTREE_NULL == nNewParent )
+		return false;
+
+	A3DAABBTREE_NODE * pNewParent = &m_aNodes[nNewParent];
+	pNewParent->nParent = nOldParent;
+	UnionBox(m_aNodes[nSibling].vMins, m_aNodes[nSibling].vMaxs, vLeafMins, vLeafMaxs, pNewParent->vMins, pNewParent->vMaxs);
+	pNewParent->nHeight = m_aNodes[nSibling].nHeight + 1;
+	pNewParent->nChild1 = nSibling;
+	pNewParent->nChild2 = nLeaf;
+	m_aNodes[nSibling].nParent = nNewParent;
+	m_aNodes[nLeaf].nParent = nNewParent;
+
+	if( A3DAABBTREE_NULL != nOldParent )
+	{
+		if( m_aNodes[nOldParent].nChild1 == nSibling )
+			m_aNodes[nOldParent].nChild1 = nNewParent;
+		else
+			m_aNodes[nOldParent].nChild2 = nNewParent;
+	}
+	else
+		m_nRoot = nNewParent;
+
+	// Refit the boxes and heights up to the root;
+	nNode = m_aNodes[nLeaf].nParent;
+	while( A3DAABBTREE_NULL != nNode )
+	{
+		nNode = Balance(nNode);
+
+		A3DAABBTREE_NODE * pNode = &m_aNodes[nNode];
+		A3DAABBTREE_NODE * pChild1 = &m_aNodes[pNode->nChild1];
+		A3DAABBTREE_NODE * pChild2 = &m_aNodes[pNode->nChild2];
+		pNode->nHeight = 1 + max(pChild1->nHeight, pChild2->nHeight);
+		UnionBox(pChild1->vMins, pChild1->vMaxs, pChild2->vMins, pChild2->vMaxs, pNode->vMins, pNode->vMaxs);
+
+		nNode = pNode->nParent;
+	}
+
+	return true;
+}
+
+void A3DAABBTree::RemoveLeaf(int nLeaf)
+{
+	if( nLeaf == m_nRoot )
+	{
+		m_nRoot = A3DAABBTREE_NULL;
+		return;
+	}
+
+	int nParent = m_aNodes[nLeaf].nParent;
+	int nGrandParent = m_aNodes[nParent].nParent;
+	int nSibling = m_aNodes[nParent].nChild1 == nLeaf ? m_aNodes[nParent].nChild2 : m_aNodes[nParent].nChild1;
+
+	// The sibling takes the place of the parent;
+	FreeNode(nParent);
+	m_aNodes[nSibling].nParent = nGrandParent;
+	if( A3DAABBTREE_NULL == nGrandParent )
+	{
+		m_nRoot = nSibling;
+		return;
+	}
+
+	if( m_aNodes[nGrandParent].nChild1 == nParent )
+		m_aNodes[nGrandParent].nChild1 = nSibling;
+	else
+		m_aNodes[nGrandParent].nChild2 = nSibling;
+
+	int nNode = nGrandParent;
+	while( A3DAABBTREE_NULL != nNode )
+	{
+		nNode = Balance(nNode);
+
+		A3DAABBTREE_NODE * pNode = &m_aNodes[nNode];
+		A3DAABBTREE_NODE * pChild1 = &m_aNodes[pNode->nChild1];
+		A3DAABBTREE_NODE * pChild2 = &m_aNodes[pNode->nChild2];
+		pNode->nHeight = 1 + max(pChild1->nHeight, pChild2->nHeight);
+		UnionBox(pChild1->vMins, pChild1->vMaxs, pChild2->vMins, pChild2->vMaxs, pNode->vMins, pNode->vMaxs);
+
+		nNode = pNode->nParent;
+	}
+}
+
+int A3DAABBTree::Balance(int nA)
+{
+	A3DAABBTREE_NODE * pA = &m_aNodes[nA];
+	if( IsLeaf(nA) || pA->nHeight < 2 )
+		return nA;
+
+	int nB = pA->nChild1;
+	int nC = pA->nChild2;
+	A3DAABBTREE_NODE * pB = &m_aNodes[nB];
+	A3DAABBTREE_NODE * pC = &m_aNodes[nC];
+
+	int nBalance = pC->nHeight - pB->nHeight;
+
+	if( nBalance > 1 )
+	{
+		// Rotate C up, A becomes a child of C and takes the lower child of C;
+		int nF = pC->nChild1;
+		int nG = pC->nChild2;
+		A3DAABBTREE_NODE * pF = &m_aNodes[nF];
+		A3DAABBTREE_NODE * pG = &m_aNodes[nG];
+
+		pC->nChild1 = nA;
+		pC->nParent = pA->nParent;
+		pA->nParent = nC;
+
+		if( A3DAABBTREE_NULL != pC->nParent )
+		{
+			if( m_aNodes[pC->nParent].nChild1 == nA )
+				m_aNodes[pC->nParent].nChild1 = nC;
+			else
+				m_aNodes[pC->nParent].nChild2 = nC;
+		}
+		else
+			m_nRoot = nC;
+
+		if( pF->nHeight > pG->nHeight )
+		{
+			pC->nChild2 = nF;
+			pA->nChild2 = nG;
+			pG->nParent = nA;
+			UnionBox(pB->vMins, pB->vMaxs, pG->vMins, pG->vMaxs, pA->vMins, pA->vMaxs);
+			UnionBox(pA->vMins, pA->vMaxs, pF->vMins, pF->vMaxs, pC->vMins, pC->vMaxs);
+			pA->nHeight = 1 + max(pB->nHeight, pG->nHeight);
+			pC->nHeight = 1 + max(pA->nHeight, pF->nHeight);
+		}
+		else
+		{
+			pC->nChild2 = nG;
+			pA->nChild2 = nF;
+			pF->nParent = nA;
+			UnionBox(pB->vMins, pB->vMaxs, pF->vMins, pF->vMaxs, pA->vMins, pA->vMaxs);
+			UnionBox(pA->vMins, pA->vMaxs, pG->vMins, pG->vMaxs, pC->vMins, pC->vMaxs);
+			pA->nHeight = 1 + max(pB->nHeight, pF->nHeight);
+			pC->nHeight = 1 + max(pA->nHeight, pG->nHeight);
+		}
+		return nC;
+	}
+
+	if( nBalance < -1 )
+	{
+		// Rotate B up, A becomes a child of B and takes the lower child of B;
+		int nD = pB->nChild1;
+		int nE = pB->nChild2;
+		A3DAABBTREE_NODE * pD = &m_aNodes[nD];
+		A3DAABBTREE_NODE * pE = &m_aNodes[nE];
+
+		pB->nChild1 = nA;
+		pB->nParent = pA->nParent;
+		pA->nParent = nB;
+
+		if( A3DAABBTREE_NULL != pB->nParent )
+		{
+			if( m_aNodes[pB->nParent].nChild1 == nA )
+				m_aNodes[pB->nParent].nChild1 = nB;
+			else
+				m_aNodes[pB->nParent].nChild2 = nB;
+		}
+		else
+			m_nRoot = nB;
+
+		if( pD->nHeight > pE->nHeight )
+		{
+			pB->nChild2 = nD;
+			pA->nChild1 = nE;
+			pE->nParent = nA;
+			UnionBox(pC->vMins, pC->vMaxs, pE->vMins, pE->vMaxs, pA->vMins, pA->vMaxs);
+			UnionBox(pA->vMins, pA->vMaxs, pD->vMins, pD->vMaxs, pB->vMins, pB->vMaxs);
+			pA->nHeight = 1 + max(pC->nHeight, pE->nHeight);
+			pB->nHeight = 1 + max(pA->nHeight, pD->nHeight);
+		}
+		else
+		{
+			pB->nChild2 = nE;
+			pA->nChild1 = nD;
+			pD->nParent = nA;
+			UnionBox(pC->vMins, pC->vMaxs, pD->vMins, pD->vMaxs, pA->vMins, pA->vMaxs);
+			UnionBox(pA->vMins, pA->vMaxs, pE->vMins, pE->vMaxs, pB->vMins, pB->vMaxs);
+			pA->nHeight = 1 + max(pC->nHeight, pD->nHeight);
+			pB->nHeight = 1 + max(pA->nHeight, pE->nHeight);
+		}
+		return nB;
+	}
+
+	return nA;
+}
+
+void A3DAABBTree::QueryAABB(const A3DVECTOR3& vMins, const A3DVECTOR3& vMaxs, abase::vector<LPVOID>& aResults)
+{
+	if( A3DAABBTREE_NULL == m_nRoot )
+		return;
+
+	m_Stack.clear();
+	m_Stack.push_back(m_nRoot);
+	while( !m_Stack.empty() )
+	{
+		A3DAABBTREE_NODE * pNode = &m_aNodes[m_Stack.back()];
+		m_Stack.pop_back();
+
+		if( pNode->vMins.x > vMaxs.x || pNode->vMaxs.x < vMins.x ||
+			pNode->vMins.y > vMaxs.y || pNode->vMaxs.y < vMins.y ||
+			pNode->vMins.z > vMaxs.z || pNode->vMaxs.z < vMins.z )
+			continue;
+
+		if( A3DAABBTREE_NULL == pNode->nChild1 )
+			aResults.push_back(pNode->pData);
+		else
+		{
+			m_Stack.push_back(pNode->nChild1);
+			m_Stack.push_back(pNode->nChild2);
+		}
+	}
+}
+
+void A3DAABBTree::QueryRay(const A3DVECTOR3& vecStart, const A3DVECTOR3& vecDelta, abase::vector<LPVOID>& aResults)
+{
+	if( A3DAABBTREE_NULL == m_nRoot )
+		return;
+
+	// The box of the whole segment rejects most nodes before the slab test;
+	A3DVECTOR3 vecEnd = vecStart + vecDelta;
+	A3DVECTOR3 vSegMins(min(vecStart.x, vecEnd.x), min(vecStart.y, vecEnd.y), min(vecStart.z, vecEnd.z));
+	A3DVECTOR3 vSegMaxs(max(vecStart.x, vecEnd.x), max(vecStart.y, vecEnd.y), max(vecStart.z, vecEnd.z));
+
+	// A axis the segment does not move along is only tested by the segment box;
+	FLOAT vInvDelta[3];
+	for(int i=0; i<3; i++)
+		vInvDelta[i] = vecDelta.m[i] != 0.0f ? 1.0f / vecDelta.m[i] : 0.0f;
+
+	m_Stack.clear();
+	m_Stack.push_back(m_nRoot);
+	while( !m_Stack.empty() )
+	{
+		A3DAABBTREE_NODE * pNode = &m_aNodes[m_Stack.back()];
+		m_Stack.pop_back();
+
+		if( pNode->vMins.x > vSegMaxs.x || pNode->vMaxs.x < vSegMins.x ||
+			pNode->vMins.y > vSegMaxs.y || pNode->vMaxs.y < vSegMins.y ||
+			pNode->vMins.z > vSegMaxs.z || pNode->vMaxs.z < vSegMins.z )
+			continue;
+
+		// Clip the segment [0, 1] by the slabs of the box;
+		FLOAT vEnter = 0.0f, vLeave = 1.0f;
+		for(int i=0; i<3; i++)
+		{
+			if( 0.0f == vInvDelta[i] )
+				continue;
+
+			FLOAT t1 = (pNode->vMins.m[i] - vecStart.m[i]) * vInvDelta[i];
+			FLOAT t2 = (pNode->vMaxs.m[i] - vecStart.m[i]) * vInvDelta[i];
+			if( t1 > t2 )
+			{
+				FLOAT t = t1;
+				t1 = t2;
+				t2 = t;
+			}
+			if( t1 > vEnter )	vEnter = t1;
+			if( t2 < vLeave )	vLeave = t2;
+		}
+
+		if( vEnter > vLeave )
+			continue;
+
+		if( A3DAABBTREE_NULL == pNode->nChild1 )
+			aResults.push_back(pNode->pData);
+		else
+		{
+			m_Stack.push_back(pNode->nChild1);
+			m_Stack.push_back(pNode->nChild2);
+		}
+	}
+}
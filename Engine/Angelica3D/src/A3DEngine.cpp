@@ -22,6 +22,7 @@
 #include "A3DMeshSorter.h"
 #include "A3DMeshCollector.h"
 #include "A3DVertexCollector.h"
+#include "A3DFrameArena.h"
 #include "A3DPlants.h"
 
 A3DEngine::A3DEngine()
@@ -32,6 +33,7 @@ A3DEngine::A3DEngine()
 	m_pA3DMeshCollector = NULL;
 	m_pA3DVertexCollector = NULL;
 	m_pA3DMeshSorter	= NULL;
+	m_pA3DFrameArena	= NULL;
 	m_pA3DMoxMan		= NULL;
 	m_pA3DModelMan		= NULL;
 	m_pA3DSurfaceMan	= NULL;
@@ -237,6 +239,18 @@ bool A3DEngine::Init(HINSTANCE hInstance, HWND hDeviceWnd, A3DDEVFMT * pA3DDevFm
 		return false;
 	}
 
+	m_pA3DFrameArena = new A3DFrameArena();
+	if( NULL == m_pA3DFrameArena )
+	{
+		g_pA3DErrLog->ErrLog("A3DEngine::Init() Not enough memory!");
+		return false;
+	}
+	if( !m_pA3DFrameArena->Init() )
+	{
+		g_pA3DErrLog->ErrLog("A3DEngine::Init() Init Frame Arena Fail!");
+		return false;
+	}
+
 	m_pA3DMeshCollector = new A3DMeshCollector();
 	if( NULL == m_pA3DMeshCollector )
 	{
@@ -512,6 +526,12 @@ bool A3DEngine::Release()
 		delete m_pA3DVertexCollector;
 		m_pA3DVertexCollector = NULL;
 	}
+	if( m_pA3DFrameArena )
+	{
+		m_pA3DFrameArena->Release();
+		delete m_pA3DFrameArena;
+		m_pA3DFrameArena = NULL;
+	}
 	if( m_pA3DLightMan )
 	{
 		m_pA3DLightMan->Release();
@@ -589,6 +609,14 @@ bool A3DEngine::Release()
 
 bool A3DEngine::BeginRender()
 {
+	// Nothing taken from the frame arena in last frame should be referenced any more;
+	if( m_pA3DMeshSorter )
+		m_pA3DMeshSorter->RemoveAllMeshes();
+	if( m_pA3DMeshCollector )
+		m_pA3DMeshCollector->RemoveUnrenderedMeshes();
+	if( m_pA3DFrameArena )
+		m_pA3DFrameArena->Reset();
+
 	return m_pA3DDevice->BeginRender();
 }
 
@@ -1065,6 +1093,32 @@ bool A3DEngine::DisplayPerformanceRecord()
 	m_pConsoleFont->TextOut(400, 100 + 16 * i, szInfo, A3DCOLORRGBA(0, 255, 0, 255));
 	i++;
 
+	sprintf(szInfo, "%s:%6d/%6d", "Arena Alloc/Heap    ", m_pA3DFrameArena->GetLastFrameAllocCount(), m_pA3DFrameArena->GetLastFrameHeapAllocCount());
+	m_pConsoleFont->TextOut(400, 100 + 16 * i, szInfo, A3DCOLORRGBA(0, 255, 0, 255));
+	i++;
+
+	// Resident kilobytes, hits and misses of the resource caches;
+	A3DRESCACHE_STATS cacheStats;
+	m_pA3DTextureMan->GetCacheStats(&cacheStats);
+	sprintf(szInfo, "%s:%6d/%6d/%6d", "Texture KB/Hit/Miss ", cacheStats.dwResidentBytes / 1024, cacheStats.dwHits, cacheStats.dwMisses);
+	m_pConsoleFont->TextOut(400, 100 + 16 * i, szInfo, A3DCOLORRGBA(0, 255, 0, 255));
+	i++;
+
+	m_pA3DModelMan->GetCacheStats(&cacheStats);
+	sprintf(szInfo, "%s:%6d/%6d/%6d", "Model KB/Hit/Miss   ", cacheStats.dwResidentBytes / 1024, cacheStats.dwHits, cacheStats.dwMisses);
+	m_pConsoleFont->TextOut(400, 100 + 16 * i, szInfo, A3DCOLORRGBA(0, 255, 0, 255));
+	i++;
+
+	m_pA3DMoxMan->GetCacheStats(&cacheStats);
+	sprintf(szInfo, "%s:%6d/%6d/%6d", "Mox KB/Hit/Miss     ", cacheStats.dwResidentBytes / 1024, cacheStats.dwHits, cacheStats.dwMisses);
+	m_pConsoleFont->TextOut(400, 100 + 16 * i, szInfo, A3DCOLORRGBA(0, 255, 0, 255));
+	i++;
+
+	m_pA3DSurfaceMan->GetCacheStats(&cacheStats);
+	sprintf(szInfo, "%s:%6d/%6d/%6d", "Surface KB/Hit/Miss ", cacheStats.dwResidentBytes / 1024, cacheStats.dwHits, cacheStats.dwMisses);
+	m_pConsoleFont->TextOut(400, 100 + 16 * i, szInfo, A3DCOLORRGBA(0, 255, 0, 255));
+	i++;
+
 	sprintf(szInfo, "%s:%6d", "GraphicsFX Count    ", m_pA3DGFXMan->GetGFXCount());
 	m_pConsoleFont->TextOut(400, 100 + 16 * i, szInfo, A3DCOLORRGBA(0, 255, 0, 255));
 	i++;
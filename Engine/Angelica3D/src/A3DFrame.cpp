@@ -9,6 +9,7 @@
 #include "A3DViewport.h"
 #include "A3DConfig.h"
 #include "A3DCollision.h"
+#include "AFileTokenizer.h"
 
 A3DFrame::A3DFrame()
 {
@@ -32,6 +33,7 @@ A3DFrame::A3DFrame()
 	m_nIndexCount = 0;
 
 	m_bDuplicated = false;
+	m_hMoxRes = A3DRESHANDLE_NULL;
 }
 
 A3DFrame::~A3DFrame()
@@ -463,6 +465,49 @@ A3DVECTOR3 A3DFrame::InverseTransform(A3DVECTOR3 vec)
 	return ret;
 }
 
+bool A3DFrame::Match(A3DFrame * pFrame)
+{
+	int i;
+
+	if( strcmp(GetName(), pFrame->GetName()) || m_nFrameCount != pFrame->m_nFrameCount ||
+		m_nBoundingBoxNum != pFrame->m_nBoundingBoxNum || m_MeshList.GetSize() != pFrame->m_MeshList.GetSize() ||
+		m_ChildList.GetSize() != pFrame->m_ChildList.GetSize() )
+		return false;
+
+	if( memcmp(m_pRelativeTM, pFrame->m_pRelativeTM, sizeof(A3DMATRIX4) * m_nFrameCount) )
+		return false;
+
+	for(i=0; i<m_nBoundingBoxNum; i++)
+	{
+		A3DFRAMEOBB& frameOBB = m_pBoundingBox[i];
+		A3DFRAMEOBB& otherOBB = pFrame->m_pBoundingBox[i];
+		if( strncmp(frameOBB.szName, otherOBB.szName, 32) || memcmp(&frameOBB.a3dOBB, &otherOBB.a3dOBB, sizeof(A3DOBB)) ||
+			memcmp(&frameOBB.property, &otherOBB.property, sizeof(A3DFRAMEOBB_PROP)) )
+			return false;
+	}
+
+	ALISTELEMENT * pElement = m_MeshList.GetFirst();
+	ALISTELEMENT * pOtherElement = pFrame->m_MeshList.GetFirst();
+	while( pElement != m_MeshList.GetTail() )
+	{
+		if( !((A3DMesh *) pElement->pData)->Match((A3DMesh *) pOtherElement->pData) )
+			return false;
+		pElement = pElement->pNext;
+		pOtherElement = pOtherElement->pNext;
+	}
+
+	pElement = m_ChildList.GetFirst();
+	pOtherElement = pFrame->m_ChildList.GetFirst();
+	while( pElement != m_ChildList.GetTail() )
+	{
+		if( !((A3DFrame *) pElement->pData)->Match((A3DFrame *) pOtherElement->pData) )
+			return false;
+		pElement = pElement->pNext;
+		pOtherElement = pOtherElement->pNext;
+	}
+	return true;
+}
+
 bool A3DFrame::Save(AFile * pFileToSave)
 {
 	if( pFileToSave->IsBinary() )
@@ -691,18 +736,28 @@ bool A3DFrame::Load(A3DDevice * pDevice, AFile * pFileToLoad)
 		if( strcmp(szLineBuffer, "{") != 0 )
 			return false;
 
+		// The matrices are parsed in place, without copying the lines;
+		const char *	pLine;
+		DWORD			dwLineLen;
+		AFileTokenizer	tokenizer;
 		for(i=0; i<m_nFrameCount; i++)
 		{
 			int n;
-			pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
-			sscanf(szLineBuffer, "\t(%d):", &n);
-			if( n != i )
+			if( !pFileToLoad->ReadLineView(&pLine, &dwLineLen) )
+				return false;
+			tokenizer.Init(pLine, dwLineLen);
+			if( !tokenizer.GetInt(&n) || n != i )
 				return false;
 			for(int j=0; j<4; j++)
 			{
-				pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
-				sscanf(szLineBuffer, "\t\t[%f, %f, %f, %f]", &m_pRelativeTM[i].m[j][0],
-					&m_pRelativeTM[i].m[j][1], &m_pRelativeTM[i].m[j][2], &m_pRelativeTM[i].m[j][3]);
+				// \t\t[m0, m1, m2, m3]
+				if( !pFileToLoad->ReadLineView(&pLine, &dwLineLen) )
+					return false;
+				tokenizer.Init(pLine, dwLineLen);
+				tokenizer.GetFloat(&m_pRelativeTM[i].m[j][0]);
+				tokenizer.GetFloat(&m_pRelativeTM[i].m[j][1]);
+				tokenizer.GetFloat(&m_pRelativeTM[i].m[j][2]);
+				tokenizer.GetFloat(&m_pRelativeTM[i].m[j][3]);
 			}
 		}
 
@@ -0,0 +1,177 @@
+/*
+ * FILE: A3DFrameArena.cpp
+ *
+ * DESCRIPTION: A linear allocator for the data which only lives in one frame
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.	
+ */
+
+#include "A3DFrameArena.h"
+#include "A3DErrLog.h"
+#include "amemory.h"
+
+// The data of a block starts after its header and is aligned to A3DFRAMEARENA_ALIGN;
+#define ARENA_HEADERSIZE	((sizeof(ARENA_BLOCK) + A3DFRAMEARENA_ALIGN - 1) & ~(A3DFRAMEARENA_ALIGN - 1))
+#define ARENA_BLOCKDATA(p)	((LPBYTE)(p) + ARENA_HEADERSIZE)
+
+A3DFrameArena::A3DFrameArena()
+{
+	m_pFirstBlock			= NULL;
+	m_pCurBlock				= NULL;
+	m_nNumBlocks			= 0;
+	m_dwTotalSize			= 0;
+
+	m_dwAllocCount			= 0;
+	m_dwHeapAllocCount		= 0;
+	m_dwLastAllocCount		= 0;
+	m_dwLastHeapAllocCount	= 0;
+	m_dwTotalHeapAllocCount	= 0;
+}
+
+A3DFrameArena::~A3DFrameArena()
+{
+	FreeBlocks();
+}
+
+A3DFrameArena::ARENA_BLOCK * A3DFrameArena::NewBlock(DWORD dwSize)
+{
+	ARENA_BLOCK * pBlock = (ARENA_BLOCK *) align_malloc(ARENA_HEADERSIZE + dwSize, A3DFRAMEARENA_ALIGN);
+	if( NULL == pBlock )
+	{
+		g_pA3DErrLog->ErrLog("A3DFrameArena::NewBlock(), Not enough memory!");
+		return NULL;
+	}
+
+	pBlock->pPrev	= NULL;
+	pBlock->pNext	= NULL;
+	pBlock->dwSize	= dwSize;
+	pBlock->dwUsed	= 0;
+
+	m_nNumBlocks ++;
+	m_dwTotalSize += dwSize;
+	m_dwHeapAllocCount ++;
+	m_dwTotalHeapAllocCount ++;
+	return pBlock;
+}
+
+void A3DFrameArena::FreeBlocks()
+{
+	ARENA_BLOCK * pBlock = m_pFirstBlock;
+	while( pBlock )
+	{
+		ARENA_BLOCK * pNext = pBlock->pNext;
+		align_free(pBlock);
+		pBlock = pNext;
+	}
+
+	m_pFirstBlock	= NULL;
+	m_pCurBlock		= NULL;
+	m_nNumBlocks	= 0;
+	m_dwTotalSize	= 0;
+}
+
+bool A3DFrameArena::Init(DWORD dwInitSize)
+{
+	FreeBlocks();
+
+	m_pFirstBlock = m_pCurBlock = NewBlock(dwInitSize);
+	if( NULL == m_pFirstBlock )
+		return false;
+
+	return true;
+}
+
+bool A3DFrameArena::Release()
+{
+	FreeBlocks();
+	return true;
+}
+
+void A3DFrameArena::Reset()
+{
+	// Several blocks were needed in this frame, so replace them by one which can hold them all;
+	if( m_nNumBlocks > 1 )
+	{
+		DWORD dwSize = m_dwTotalSize;
+		FreeBlocks();
+		m_pFirstBlock = m_pCurBlock = NewBlock(dwSize);
+	}
+	else if( m_pFirstBlock )
+		m_pFirstBlock->dwUsed = 0;
+
+	m_dwLastAllocCount		= m_dwAllocCount;
+	m_dwLastHeapAllocCount	= m_dwHeapAllocCount;
+	m_dwAllocCount			= 0;
+	m_dwHeapAllocCount		= 0;
+}
+
+LPVOID A3DFrameArena::Alloc(DWORD dwSize, DWORD dwAlign)
+{
+	m_dwAllocCount ++;
+
+	// Blocks' data are aligned to A3DFRAMEARENA_ALIGN, so aligning the offset is enough;
+	DWORD dwMask = dwAlign - 1;
+	while( m_pCurBlock )
+	{
+		DWORD dwOffset = (m_pCurBlock->dwUsed + dwMask) & ~dwMask;
+		if( dwOffset + dwSize <= m_pCurBlock->dwSize )
+		{
+			m_pCurBlock->dwUsed = dwOffset + dwSize;
+			return ARENA_BLOCKDATA(m_pCurBlock) + dwOffset;
+		}
+
+		// The blocks after the current one were freed by FreeToMark;
+		if( !m_pCurBlock->pNext || m_pCurBlock->pNext->dwSize < dwSize )
+			break;
+
+		m_pCurBlock = m_pCurBlock->pNext;
+		m_pCurBlock->dwUsed = 0;
+	}
+
+	// Double the arena each time, so only a few blocks are added in one frame;
+	ARENA_BLOCK * pBlock = NewBlock(max(dwSize, m_dwTotalSize ? m_dwTotalSize : A3DFRAMEARENA_DEFAULTSIZE));
+	if( NULL == pBlock )
+		return NULL;
+
+	if( m_pCurBlock )
+	{
+		pBlock->pPrev = m_pCurBlock;
+		pBlock->pNext = m_pCurBlock->pNext;
+		if( pBlock->pNext )
+			pBlock->pNext->pPrev = pBlock;
+		m_pCurBlock->pNext = pBlock;
+	}
+	else
+		m_pFirstBlock = pBlock;
+
+	m_pCurBlock = pBlock;
+	m_pCurBlock->dwUsed = dwSize;
+	return ARENA_BLOCKDATA(m_pCurBlock);
+}
+
+A3DFRAMEARENA_MARK A3DFrameArena::GetMark()
+{
+	A3DFRAMEARENA_MARK mark;
+	mark.pBlock = m_pCurBlock;
+	mark.dwUsed = m_pCurBlock ? m_pCurBlock->dwUsed : 0;
+	return mark;
+}
+
+void A3DFrameArena::FreeToMark(const A3DFRAMEARENA_MARK& mark)
+{
+	// Keep the blocks added after the mark, they will be used again before any new block;
+	if( mark.pBlock )
+	{
+		m_pCurBlock = (ARENA_BLOCK *) mark.pBlock;
+		m_pCurBlock->dwUsed = mark.dwUsed;
+	}
+	else if( m_pFirstBlock )
+	{
+		m_pCurBlock = m_pFirstBlock;
+		m_pCurBlock->dwUsed = 0;
+	}
+}
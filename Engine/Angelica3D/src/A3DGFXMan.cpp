@@ -15,7 +15,7 @@
 #include "A3DGFXMan.h"
 #include "A3DConfig.h"
 
-A3DGFXMan::A3DGFXMan()
+A3DGFXMan::A3DGFXMan() : m_PreloadedGFXFilesTab(256)
 {
 	m_szFolderName[0]	= '\0';
 	m_pA3DDevice		= NULL;
@@ -76,6 +76,7 @@ bool A3DGFXMan::Init(A3DDevice * pA3DDevice)
 		}
 
 		m_PreloadedGFXFilesList.Append((LPVOID) pFileImage);
+		m_PreloadedGFXFilesTab.put(AFileAtom_Get(pFileImage->GetFileName()), pFileImage);
 	}
 	gfxListFile.Close();
 	return true;
@@ -83,18 +84,14 @@ bool A3DGFXMan::Init(A3DDevice * pA3DDevice)
 
 bool A3DGFXMan::Release()
 {
-	ALISTELEMENT * pThisElement = m_GFXList.GetFirst();
-	while( pThisElement != m_GFXList.GetTail() )
+	for(int i=0; i<m_GFXList.GetSize(); i++)
 	{
-		A3DGraphicsFX * pGFX = (A3DGraphicsFX *) pThisElement->pData;
+		A3DGraphicsFX * pGFX = (A3DGraphicsFX *) m_GFXList.GetAt(i);
 		pGFX->Release();
 		delete pGFX;
 		pGFX = NULL;
-
-		ALISTELEMENT * pElementToDelete = pThisElement;
-		pThisElement = pThisElement->pNext;
-		m_GFXList.Delete(pElementToDelete);
 	}
+	m_GFXList.Reset();
 	
 	if( m_pGFXCollector )
 	{
@@ -105,7 +102,7 @@ bool A3DGFXMan::Release()
 		delete pCollector;
 	}
 
-	pThisElement = m_PreloadedGFXFilesList.GetFirst();
+	ALISTELEMENT * pThisElement = m_PreloadedGFXFilesList.GetFirst();
 	while( pThisElement != m_PreloadedGFXFilesList.GetTail() )
 	{
 		AFileImage * pFileImage = (AFileImage *) pThisElement->pData;
@@ -114,6 +111,7 @@ bool A3DGFXMan::Release()
 		pThisElement = pThisElement->pNext;
 	}
 
+	m_PreloadedGFXFilesTab.clear();
 	m_PreloadedGFXFilesList.Release();
 	m_GFXList.Release();
 	return true;
@@ -189,6 +187,7 @@ bool A3DGFXMan::LoadGFXFromFile(char * szGFXFile, A3DModel * pModel, char * szPa
 
 					// Add it into the file image list;
 					m_PreloadedGFXFilesList.Append((LPVOID) pFileImage);
+					m_PreloadedGFXFilesTab.put(AFileAtom_Get(pFileImage->GetFileName()), pFileImage);
 					g_pA3DErrLog->ErrLog("A3DGFXMan::LoadGFXFromFile(), Load a file image [%s] from file done!", szFullPath);
 				}
 
@@ -305,17 +304,17 @@ bool A3DGFXMan::ReleaseGFX(PA3DGraphicsFX& pGFX)
 // Remove the reference from m_GFXList, but not release it;
 bool A3DGFXMan::DeleteGFX(PA3DGraphicsFX& pGFX)
 {
-	if( NULL == pGFX->GetStoredElement() )
+	if( ASLOTHANDLE_NULL == pGFX->GetStoredSlot() )
 		return true;
 
-	m_GFXList.Delete(pGFX->GetStoredElement());
-	pGFX->SetStoredElement(NULL);
+	m_GFXList.Delete(pGFX->GetStoredSlot());
+	pGFX->SetStoredSlot(ASLOTHANDLE_NULL);
 	return true;
 }
 
 bool A3DGFXMan::IsGFXAlive(A3DGraphicsFX * pGFX)
 {
-	if( m_GFXList.FindElementByData(pGFX) )
+	if( m_GFXList.FindIndexByData(pGFX) >= 0 )
 		return true;
 
 	return false;
@@ -324,18 +323,15 @@ bool A3DGFXMan::IsGFXAlive(A3DGraphicsFX * pGFX)
 bool A3DGFXMan::Render(A3DViewport * pCurrentViewport, int nCategoryMask)
 {
 	m_pA3DDevice->GetA3DEngine()->BeginPerformanceRecord(A3DENGINE_PERFORMANCE_WORLD_GFXMAN_RENDER);
-	ALISTELEMENT * pThisElement = m_GFXList.GetFirst();
-	while( pThisElement != m_GFXList.GetTail() )
+	for(int i=0; i<m_GFXList.GetSize(); i++)
 	{
-		A3DGraphicsFX * pGFX = (A3DGraphicsFX *) pThisElement->pData;
+		A3DGraphicsFX * pGFX = (A3DGraphicsFX *) m_GFXList.GetAt(i);
 
 		if( !pGFX->IsExpired() && (nCategoryMask & pGFX->GetCategory()) && pGFX->IsDrawByMan() )
 		{
 			if( !pGFX->Render(pCurrentViewport) )
 				return false;
 		}
-
-		pThisElement = pThisElement->pNext;
 	}
 
 	m_pA3DDevice->GetA3DEngine()->EndPerformanceRecord(A3DENGINE_PERFORMANCE_WORLD_GFXMAN_RENDER);
@@ -344,23 +340,27 @@ bool A3DGFXMan::Render(A3DViewport * pCurrentViewport, int nCategoryMask)
 
 bool A3DGFXMan::TickAnimation()
 {
-	ALISTELEMENT * pThisElement = m_GFXList.GetFirst();
-	while( pThisElement != m_GFXList.GetTail() )
+	// Removing an expired gfx moves the last one into its place, so the same index is
+	// checked again; gfx started during the tick are appended and ticked in this frame too;
+	int i = 0;
+	while( i < m_GFXList.GetSize() )
 	{
-		A3DGraphicsFX * pGFX = (A3DGraphicsFX *) pThisElement->pData;
+		A3DGraphicsFX * pGFX = (A3DGraphicsFX *) m_GFXList.GetAt(i);
 		
 		if( !pGFX->IsExpired() && !pGFX->TickAnimation() )
 			return false;
 
-		pThisElement = pThisElement->pNext;
-
 		if( pGFX->IsExpired() )
 		{
 			if( pGFX->IsDead() )
 				ReleaseGFX(pGFX);
 			else
 				DeleteGFX(pGFX);
+
+			if( i < m_GFXList.GetSize() && m_GFXList.GetAt(i) != (LPVOID) pGFX )
+				continue;
 		}
+		i ++;
 	}
 	return true;
 }
@@ -368,15 +368,12 @@ bool A3DGFXMan::TickAnimation()
 bool A3DGFXMan::Reset()
 {
 	// Release all created A3DGraphicsFX class objects;
-	ALISTELEMENT * pThisElement = m_GFXList.GetFirst();
-	while( pThisElement != m_GFXList.GetTail() )
+	for(int i=0; i<m_GFXList.GetSize(); i++)
 	{
-		A3DGraphicsFX * pGFX = (A3DGraphicsFX *) pThisElement->pData;
+		A3DGraphicsFX * pGFX = (A3DGraphicsFX *) m_GFXList.GetAt(i);
 		pGFX->Release();
 		delete pGFX;
 		pGFX = NULL;
-
-		pThisElement = pThisElement->pNext;
 	}
 	m_GFXList.Reset();
 
@@ -400,29 +397,25 @@ bool A3DGFXMan::AddGFX(A3DGraphicsFX * pGFX)
 	if( g_pA3DConfig->GetRunEnv() == A3DRUNENV_PURESERVER )
 		return true;
 
-	ALISTELEMENT * pStoredElement = NULL;
+	ASLOTHANDLE hStoredSlot = ASLOTHANDLE_NULL;
 
-	if( pGFX->GetStoredElement() )
+	if( pGFX->GetStoredSlot() )
 		return true;
 
-	m_GFXList.Append((LPVOID) pGFX, &pStoredElement);
-	pGFX->SetStoredElement(pStoredElement);
+	m_GFXList.Append((LPVOID) pGFX, &hStoredSlot);
+	pGFX->SetStoredSlot(hStoredSlot);
 	return true;
 }
 
 AFileImage * A3DGFXMan::FindFileImage(char * szFileName)
 {
-	ALISTELEMENT * pThisElement = m_PreloadedGFXFilesList.GetFirst();
-	while( pThisElement != m_PreloadedGFXFilesList.GetTail() )
-	{
-		AFileImage * pFileImage = (AFileImage *) pThisElement->pData;
+	AFILEATOM atomFileName = AFileAtom_Find(szFileName);
+	if( AFILEATOM_NULL == atomFileName )
+		return NULL;
 
-		if( 0 == _stricmp(pFileImage->GetFileName(), szFileName) )
-		{
-			return pFileImage;
-		}
-		pThisElement = pThisElement->pNext;
-	}
+	abase::pair<AFileImage **, bool> result = m_PreloadedGFXFilesTab.get(atomFileName);
+	if( !result.second )
+		return NULL;
 
-	return NULL;
+	return *result.first;
 }
\ No newline at end of file
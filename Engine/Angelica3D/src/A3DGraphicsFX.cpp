@@ -26,7 +26,7 @@ A3DGraphicsFX::A3DGraphicsFX()
 	m_pA3DDevice	= NULL;
 	m_bHWIGFX		= false;
 
-	m_pStoredElement = NULL;
+	m_hStoredSlot = ASLOTHANDLE_NULL;
 
 	m_bExpired		= true;
 	m_bDieOnExpired = true;
@@ -656,7 +656,7 @@ bool A3DGraphicsFX::Start(bool bDieOnExpired)
 		return true;
 	}
 
-	if( m_pStoredElement )
+	if( m_hStoredSlot )
 	{
 		//We don't need to add it into GFXMan, for it has the reference already;
 	}
@@ -782,7 +782,7 @@ bool A3DGraphicsFX::Stop(bool bDieOnExpired)
 	m_bExpired = bForceStop;
 	m_bDieOnExpired = bDieOnExpired;
 
-	if( !m_pStoredElement )
+	if( !m_hStoredSlot )
 	{
 		// Have not started yet, so we have to add it into the gfx man list, let gfx man auto release it;
 		m_pA3DDevice->GetA3DEngine()->GetA3DGFXMan()->AddGFX(this);
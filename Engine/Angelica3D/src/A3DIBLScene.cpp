@@ -17,6 +17,7 @@
 #include "A3DTextureMan.h"
 #include "A3DConfig.h"
 #include "A3DLamp.h"
+#include "A3DFrameArena.h"
 
 A3DIBLLightGrid * A3DIBLScene::m_pGlobalLightGrid = NULL;
 A3DIBLScene::A3DIBLScene()
@@ -27,7 +28,6 @@ A3DIBLScene::A3DIBLScene()
 
 	m_nNumFaces			= 0;
 	m_pAllFaces			= NULL;
-	m_pSortedFaces		= NULL;
 
 	m_nNumTextures		= 0;
 	m_pTextureRecords	= NULL;
@@ -88,12 +88,6 @@ bool A3DIBLScene::Release()
 		m_pFaceRecords = NULL;
 	}
 
-	if( m_pSortedFaces )
-	{
-		free(m_pSortedFaces);
-		m_pSortedFaces = NULL;
-	}
-
 	if( m_pAllFaces )
 	{
 		free(m_pAllFaces);
@@ -174,13 +168,6 @@ bool A3DIBLScene::Load(A3DDevice * pA3DDevice, AFile * pFileToLoad)
 			return false;
 		}
 
-		m_pSortedFaces = (A3DIBLSCENE_SORTEDFACE *) malloc(sizeof(A3DIBLSCENE_SORTEDFACE) * m_nNumFaces);
-		if( NULL == m_pSortedFaces )
-		{
-			g_pA3DErrLog->ErrLog("A3DIBLScene::Load(), Not enough memory!");
-			return false;
-		}
-
 		m_pFaceRecords = (A3DIBLSCENE_FACE_RECORD *) malloc(sizeof(A3DIBLSCENE_FACE_RECORD) * m_nNumFaces);
 		if( NULL == m_pFaceRecords )
 		{
@@ -304,12 +291,6 @@ bool A3DIBLScene::AddTriFace(char * szTextureName, char * szLightMapName, bool b
 		g_pA3DErrLog->ErrLog("A3DIBLScene::AddTriFace(), Not enough memory!");
 		return false;
 	}
-	m_pSortedFaces = (A3DIBLSCENE_SORTEDFACE *) realloc(m_pSortedFaces, m_nNumFaces * sizeof(A3DIBLSCENE_SORTEDFACE));
-	if( NULL == m_pSortedFaces )
-	{
-		g_pA3DErrLog->ErrLog("A3DIBLScene::AddTriFace(), Not enough memory!");
-		return false;
-	}
 	m_pFaceRecords = (A3DIBLSCENE_FACE_RECORD *) realloc(m_pFaceRecords, m_nNumFaces * sizeof(A3DIBLSCENE_FACE_RECORD));
 	if( NULL == m_pFaceRecords )
 	{
@@ -428,10 +409,26 @@ bool A3DIBLScene::RenderSort(A3DViewport * pCurrentViewport, DWORD dwFlag, bool
 
 	A3DVECTOR3		vecCamPos = pCurrentViewport->GetCamera()->GetPos();
 
-	// First construct sorting buffer;
+	// First construct sorting buffer, it is only used in this call;
 	int				i, n;
 	int				nSortedFaceNum = 0;
 
+	for(i=0; i<m_nNumTextures; i++)
+	{
+		if( dwFlag & m_pTextureRecords[i].dwRenderFlag )
+			nSortedFaceNum += m_pTextureRecords[i].nFaceVisible;
+	}
+
+	A3DFrameArenaScope arenaScope(m_pA3DDevice->GetA3DEngine()->GetFrameArena());
+	A3DIBLSCENE_SORTEDFACE * pSortedFaces = (A3DIBLSCENE_SORTEDFACE *)
+		m_pA3DDevice->GetA3DEngine()->GetFrameArena()->Alloc(sizeof(A3DIBLSCENE_SORTEDFACE) * nSortedFaceNum);
+	if( NULL == pSortedFaces )
+	{
+		g_pA3DErrLog->ErrLog("A3DIBLScene::RenderSort(), Not enough memory!");
+		return false;
+	}
+
+	nSortedFaceNum = 0;
 	for(i=0; i<m_nNumTextures; i++)
 	{
 		if( !(dwFlag & m_pTextureRecords[i].dwRenderFlag) )
@@ -445,15 +442,15 @@ bool A3DIBLScene::RenderSort(A3DViewport * pCurrentViewport, DWORD dwFlag, bool
 			vecCenter.x = (pVerts[n * 3].x + pVerts[n * 3 + 1].x + pVerts[n * 3 + 2].x) / 3.0f;
 			vecCenter.y = (pVerts[n * 3].y + pVerts[n * 3 + 1].y + pVerts[n * 3 + 2].y) / 3.0f;
 			vecCenter.z = (pVerts[n * 3].z + pVerts[n * 3 + 1].z + pVerts[n * 3 + 2].z) / 3.0f;
-			m_pSortedFaces[nSortedFaceNum].vDisToCam = Magnitude(vecCamPos - vecCenter) * (bNear2Far ? 1.0f : -1.0f);
-			m_pSortedFaces[nSortedFaceNum].pTexRecord = &m_pTextureRecords[i];
-			m_pSortedFaces[nSortedFaceNum].wIndexInTexVisible = n;
+			pSortedFaces[nSortedFaceNum].vDisToCam = Magnitude(vecCamPos - vecCenter) * (bNear2Far ? 1.0f : -1.0f);
+			pSortedFaces[nSortedFaceNum].pTexRecord = &m_pTextureRecords[i];
+			pSortedFaces[nSortedFaceNum].wIndexInTexVisible = n;
 
 			nSortedFaceNum ++;
 		}
 	}
 
-	qsort(m_pSortedFaces, nSortedFaceNum, sizeof(A3DIBLSCENE_SORTEDFACE), IBLFaceSortCompare);
+	qsort(pSortedFaces, nSortedFaceNum, sizeof(A3DIBLSCENE_SORTEDFACE), IBLFaceSortCompare);
 
 	// Now render the sorted faces;
 	SetDeviceState();
@@ -465,7 +462,7 @@ bool A3DIBLScene::RenderSort(A3DViewport * pCurrentViewport, DWORD dwFlag, bool
 
 	for(i=0; i<nSortedFaceNum; i++)
 	{
-		A3DIBLSCENE_TEXTURE_RECORD *	pThisTex = m_pSortedFaces[i].pTexRecord;
+		A3DIBLSCENE_TEXTURE_RECORD *	pThisTex = pSortedFaces[i].pTexRecord;
 
 		if( pThisTex != pLastTex )
 		{
@@ -499,9 +496,9 @@ bool A3DIBLScene::RenderSort(A3DViewport * pCurrentViewport, DWORD dwFlag, bool
 			pLastTex = pThisTex;
 		}
 
-		pRenderVerts[nRenderFaceNum * 3    ] = pThisTex->pVerts[m_pSortedFaces[i].wIndexInTexVisible * 3    ];
-		pRenderVerts[nRenderFaceNum * 3 + 1] = pThisTex->pVerts[m_pSortedFaces[i].wIndexInTexVisible * 3 + 1];
-		pRenderVerts[nRenderFaceNum * 3 + 2] = pThisTex->pVerts[m_pSortedFaces[i].wIndexInTexVisible * 3 + 2];
+		pRenderVerts[nRenderFaceNum * 3    ] = pThisTex->pVerts[pSortedFaces[i].wIndexInTexVisible * 3    ];
+		pRenderVerts[nRenderFaceNum * 3 + 1] = pThisTex->pVerts[pSortedFaces[i].wIndexInTexVisible * 3 + 1];
+		pRenderVerts[nRenderFaceNum * 3 + 2] = pThisTex->pVerts[pSortedFaces[i].wIndexInTexVisible * 3 + 2];
 		nRenderFaceNum ++;
 
 		if( nRenderFaceNum >= MAX_RENDER_FACE )
@@ -12,6 +12,7 @@
 #include "A3DEngine.h"
 #include "A3DTextureMan.h"
 #include "A3DConfig.h"
+#include "AFileTokenizer.h"
 
 A3DMesh::A3DMesh()
 {
@@ -46,6 +47,7 @@ A3DMesh::A3DMesh()
 
 	m_szTextureMap[0] = '\0';
 	m_szDetailTextureMap[0] = '\0';
+	m_nTexturePathLen = -1;
 }
 
 A3DMesh::~A3DMesh()
@@ -153,6 +155,8 @@ bool A3DMesh::SetDetailTexture(char * szDetailTextureName, A3DMATRIX4 matDetailT
 	if( !m_pA3DDevice->GetA3DEngine()->GetA3DTextureMan()->LoadTextureFromFile(szDetailTextureName, &m_pDetailTexture, A3DTF_DETAILMAP) )
 		return false;
 
+	// The maps are not the loaded ones any more;
+	m_nTexturePathLen = -1;
 	m_matDetailTM = matDetailTM;
 	return true;
 }
@@ -171,9 +175,19 @@ bool A3DMesh::SetTexture(char * szTextureName)
 	if( !m_pA3DDevice->GetA3DEngine()->GetA3DTextureMan()->LoadTextureFromFile(szTextureName, &m_pTexture) )
 		return false;
 
+	// The maps are not the loaded ones any more;
+	m_nTexturePathLen = -1;
 	return true;
 }
 
+char * A3DMesh::GetSavedTextureName(char * szTextureMap, A3DTexture * pTexture)
+{
+	if( m_nTexturePathLen >= 0 && (int) strlen(szTextureMap) > m_nTexturePathLen )
+		return szTextureMap + m_nTexturePathLen + 1;
+
+	return pTexture ? pTexture->GetMapFile() : "";
+}
+
 bool A3DMesh::Release()
 {
 	if( m_bHWIMesh )	return true;
@@ -420,6 +434,45 @@ bool A3DMesh::UpdateToFrame(int nFrame)
 	return true;
 }
 
+bool A3DMesh::Match(A3DMesh * pMesh)
+{
+	if( m_bHWIMesh || pMesh->m_bHWIMesh )
+		return m_bHWIMesh == pMesh->m_bHWIMesh;
+
+	if( strcmp(GetName(), pMesh->GetName()) || m_nVertCount != pMesh->m_nVertCount || 
+		m_nIndexCount != pMesh->m_nIndexCount || m_nFrameCount != pMesh->m_nFrameCount ||
+		m_bHasLOD != pMesh->m_bHasLOD || m_bWire != pMesh->m_bWire )
+		return false;
+
+	if( memcmp(&m_property, &pMesh->m_property, sizeof(m_property)) ||
+		memcmp(m_pIndices, pMesh->m_pIndices, sizeof(WORD) * m_nIndexCount) )
+		return false;
+
+	if( m_bHasLOD )
+	{
+		if( m_vLODMinDis != pMesh->m_vLODMinDis || m_vLODMaxDis != pMesh->m_vLODMaxDis || 
+			m_iLODLimit != pMesh->m_iLODLimit || memcmp(m_pMapTable, pMesh->m_pMapTable, sizeof(WORD) * m_nVertCount) )
+			return false;
+	}
+
+	for(int i=0; i<m_nFrameCount; i++)
+	{
+		if( memcmp(m_ppVertsBuffer[i], pMesh->m_ppVertsBuffer[i], sizeof(A3DVERTEX) * m_nVertCount) )
+			return false;
+	}
+
+	// The texture names are compared as they are saved, the loads may use different texture paths;
+	if( (m_pDetailTexture != NULL) != (pMesh->m_pDetailTexture != NULL) )
+		return false;
+	if( m_pDetailTexture && (memcmp(&m_matDetailTM, &pMesh->m_matDetailTM, sizeof(A3DMATRIX4)) ||
+		_stricmp(GetSavedTextureName(m_szDetailTextureMap, m_pDetailTexture), pMesh->GetSavedTextureName(pMesh->m_szDetailTextureMap, pMesh->m_pDetailTexture))) )
+		return false;
+	if( _stricmp(GetSavedTextureName(m_szTextureMap, m_pTexture), pMesh->GetSavedTextureName(pMesh->m_szTextureMap, pMesh->m_pTexture)) )
+		return false;
+
+	return m_Material.Match(&pMesh->m_Material) && m_Material.Is2Sided() == pMesh->m_Material.Is2Sided();
+}
+
 bool A3DMesh::Save(AFile * pFileToSave)
 {
 	if( m_bHWIMesh )	return true;
@@ -465,17 +518,14 @@ bool A3DMesh::Save(AFile * pFileToSave)
 
 		if( m_pDetailTexture )
 		{
-			sprintf(szLineBuffer, "DETAILTEXTURE: %s", m_pDetailTexture->GetMapFile());
+			sprintf(szLineBuffer, "DETAILTEXTURE: %s", GetSavedTextureName(m_szDetailTextureMap, m_pDetailTexture));
 			pFileToSave->Write(szLineBuffer, strlen(szLineBuffer) + 1, &dwWriteLength);
 
 			pFileToSave->Write(&m_matDetailTM, sizeof(A3DMATRIX4), &dwWriteLength);
 		}
 
 		//Texture;
-		if( m_pTexture )
-			sprintf(szLineBuffer, "TEXTURE: %s", m_pTexture->GetMapFile());
-		else
-			sprintf(szLineBuffer, "TEXTURE: %s", "");
+		sprintf(szLineBuffer, "TEXTURE: %s", GetSavedTextureName(m_szTextureMap, m_pTexture));
 		pFileToSave->Write(szLineBuffer, strlen(szLineBuffer) + 1, &dwWriteLength);
 
 		//Material
@@ -573,7 +623,7 @@ bool A3DMesh::Save(AFile * pFileToSave)
 
 		if( m_pDetailTexture )
 		{
-			sprintf(szLineBuffer, "DETAILTEXTURE: %s", m_pDetailTexture->GetMapFile());
+			sprintf(szLineBuffer, "DETAILTEXTURE: %s", GetSavedTextureName(m_szDetailTextureMap, m_pDetailTexture));
 			pFileToSave->WriteLine(szLineBuffer);
 
 			sprintf(szLineBuffer, "(%f, %f, %f, %f)", m_matDetailTM._11, m_matDetailTM._12, m_matDetailTM._13, m_matDetailTM._14);
@@ -586,10 +636,7 @@ bool A3DMesh::Save(AFile * pFileToSave)
 			pFileToSave->WriteLine(szLineBuffer);
 		}
 
-		if( m_pTexture )
-			sprintf(szLineBuffer, "TEXTURE: %s", m_pTexture->GetMapFile());
-		else
-			sprintf(szLineBuffer, "TEXTURE: %s", "");
+		sprintf(szLineBuffer, "TEXTURE: %s", GetSavedTextureName(m_szTextureMap, m_pTexture));
 		pFileToSave->WriteLine(szLineBuffer);
 
 		if( !m_Material.Save(pFileToSave) )
@@ -607,6 +654,7 @@ bool A3DMesh::Load(A3DDevice * pDevice, AFile * pFileToLoad)
 	char szTexturePath[MAX_PATH];
 	AFileMod_GetFilePath(pFileToLoad->GetRelativeName(), szMoxRelativePath, MAX_PATH);
 	sprintf(szTexturePath, "%s\\Textures", szMoxRelativePath);
+	m_nTexturePathLen = strlen(szTexturePath);
 
 	if( pFileToLoad->IsBinary() )
 	{
@@ -741,6 +789,10 @@ bool A3DMesh::Load(A3DDevice * pDevice, AFile * pFileToLoad)
 		DWORD dwReadLen;
 		A3DMESH_PROP property;
 		int nval;
+		// The index and vertex lines are parsed in place, without copying them;
+		const char * pLine;
+		DWORD dwLineLen;
+		AFileTokenizer tokenizer;
 
 		pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
 		pFileToLoad->GetStringAfter(szLineBuffer, "MESH: ", szResult);
@@ -791,14 +843,16 @@ bool A3DMesh::Load(A3DDevice * pDevice, AFile * pFileToLoad)
 			{
 				for(int n=0; n<m_nIndexCount / 2; n++)
 				{
-					pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
+					if( !pFileToLoad->ReadLineView(&pLine, &dwLineLen) )
+						return false;
 				}
 			}
 			else
 			{
 				for(int n=0; n<m_nIndexCount / 3; n++)
 				{
-					pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
+					if( !pFileToLoad->ReadLineView(&pLine, &dwLineLen) )
+						return false;
 				}
 			}
 
@@ -814,7 +868,8 @@ bool A3DMesh::Load(A3DDevice * pDevice, AFile * pFileToLoad)
 				pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
 				for(int n=0; n<m_nVertCount; n++)
 				{
-					pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
+					if( !pFileToLoad->ReadLineView(&pLine, &dwLineLen) )
+						return false;
 				}
 				//<== VERTMAP: {
 				pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
@@ -829,7 +884,8 @@ bool A3DMesh::Load(A3DDevice * pDevice, AFile * pFileToLoad)
 				pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
 				for(int v=0; v<m_nVertCount; v++)
 				{
-					pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
+					if( !pFileToLoad->ReadLineView(&pLine, &dwLineLen) )
+						return false;
 				}
 				//<==FRAME%d{
 				pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
@@ -866,8 +922,11 @@ bool A3DMesh::Load(A3DDevice * pDevice, AFile * pFileToLoad)
 			{
 				for(int n=0; n<m_nIndexCount / 2; n++)
 				{
-					pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
-					sscanf(szLineBuffer, "%d, %d", &n0, &n1);
+					if( !pFileToLoad->ReadLineView(&pLine, &dwLineLen) )
+						return false;
+					tokenizer.Init(pLine, dwLineLen);
+					tokenizer.GetInt(&n0);
+					tokenizer.GetInt(&n1);
 					m_pIndices[n * 2] = n0;
 					m_pIndices[n * 2 + 1] = n1;
 				}
@@ -876,8 +935,12 @@ bool A3DMesh::Load(A3DDevice * pDevice, AFile * pFileToLoad)
 			{
 				for(int n=0; n<m_nIndexCount / 3; n++)
 				{
-					pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
-					sscanf(szLineBuffer, "%d, %d, %d", &n0, &n1, &n2);
+					if( !pFileToLoad->ReadLineView(&pLine, &dwLineLen) )
+						return false;
+					tokenizer.Init(pLine, dwLineLen);
+					tokenizer.GetInt(&n0);
+					tokenizer.GetInt(&n1);
+					tokenizer.GetInt(&n2);
 					m_pIndices[n * 3] = n0;
 					m_pIndices[n * 3 + 1] = n1;
 					m_pIndices[n * 3 + 2] = n2;
@@ -911,8 +974,10 @@ bool A3DMesh::Load(A3DDevice * pDevice, AFile * pFileToLoad)
 
 				for(int n=0; n<m_nVertCount; n++)
 				{
-					pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
-					sscanf(szLineBuffer, "%d", &n0);
+					if( !pFileToLoad->ReadLineView(&pLine, &dwLineLen) )
+						return false;
+					tokenizer.Init(pLine, dwLineLen);
+					tokenizer.GetInt(&n0);
 					m_pMapTable[n] = n0;
 				}
 				//<== VERTMAP: {
@@ -946,12 +1011,20 @@ bool A3DMesh::Load(A3DDevice * pDevice, AFile * pFileToLoad)
 				
 				for(int v=0; v<m_nVertCount; v++)
 				{
-					pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
+					A3DVERTEX * pVert = &m_ppVertsBuffer[i][v];
 
-					sscanf(szLineBuffer, "(%f, %f, %f, %f, %f, %f, %f, %f)",
-						&m_ppVertsBuffer[i][v].x, &m_ppVertsBuffer[i][v].y, &m_ppVertsBuffer[i][v].z,
-						&m_ppVertsBuffer[i][v].nx, &m_ppVertsBuffer[i][v].ny, &m_ppVertsBuffer[i][v].nz,
-						&m_ppVertsBuffer[i][v].tu, &m_ppVertsBuffer[i][v].tv);
+					// (x, y, z, nx, ny, nz, tu, tv)
+					if( !pFileToLoad->ReadLineView(&pLine, &dwLineLen) )
+						return false;
+					tokenizer.Init(pLine, dwLineLen);
+					tokenizer.GetFloat(&pVert->x);
+					tokenizer.GetFloat(&pVert->y);
+					tokenizer.GetFloat(&pVert->z);
+					tokenizer.GetFloat(&pVert->nx);
+					tokenizer.GetFloat(&pVert->ny);
+					tokenizer.GetFloat(&pVert->nz);
+					tokenizer.GetFloat(&pVert->tu);
+					tokenizer.GetFloat(&pVert->tv);
 				}
 				//<==FRAME%d{
 				pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
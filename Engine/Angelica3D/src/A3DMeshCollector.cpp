@@ -15,6 +15,7 @@
 #include "A3DViewport.h"
 #include "A3DEngine.h"
 #include "A3DTextureMan.h"
+#include "A3DFrameArena.h"
 
 ///////////////////////////////////////////////////////////////////////////
 //
@@ -50,10 +51,9 @@
 //
 ///////////////////////////////////////////////////////////////////////////
 
-A3DMeshCollector::A3DMeshCollector() : m_aMeshPool(100)
+A3DMeshCollector::A3DMeshCollector()
 {
 	m_pA3DDevice	= NULL;
-	m_iPoolCnt		= 0;
 }
 
 A3DMeshCollector::~A3DMeshCollector()
@@ -90,8 +90,6 @@ bool A3DMeshCollector::Init(A3DDevice* pA3DDevice)
 		return false;
 	}
 
-	m_iPoolCnt = 0;
-
 	return true;
 }
 
@@ -99,7 +97,6 @@ bool A3DMeshCollector::Init(A3DDevice* pA3DDevice)
 void A3DMeshCollector::Release()
 {
 	ReleaseAllTextures(false);
-	ReleaseAllMeshInfo();
 
 	//	Release vertex buffer and index buffer;
 	if (m_pVertexBuffer)
@@ -115,15 +112,12 @@ void A3DMeshCollector::Release()
 	}
 
 	m_pA3DDevice	= NULL;
-	m_iPoolCnt		= 0;
 }
 
 //	Reset mesh collector
 bool A3DMeshCollector::Reset()
 {
 	ReleaseAllTextures(true);
-	ReleaseAllMeshInfo();
-	m_iPoolCnt = 0;
 	return true;
 }
 
@@ -154,16 +148,6 @@ void A3DMeshCollector::ReleaseAllTextures(bool bReset)
 		m_TextureList.Release();
 }
 
-//	Release all mesh information
-void A3DMeshCollector::ReleaseAllMeshInfo()
-{
-	size_t i;
-	for (i=0; i < m_aMeshPool.size(); i++)
-		delete m_aMeshPool[i];
-	
-	m_aMeshPool.clear();
-}
-
 /*	Add mesh's texture and material information then create a texture information
 	slot, if this information don't exist.
 
@@ -238,31 +222,24 @@ bool A3DMeshCollector::PrepareMeshToRender(A3DMesh* pMesh, int iCurFrame, A3DMAT
 										   DWORD hTexture)
 {
 	//	Get a new mesh information structure
-	if (m_iPoolCnt == m_aMeshPool.size())
+	MESHINFO* pMeshInfo = (MESHINFO*)m_pA3DDevice->GetA3DEngine()->GetFrameArena()->Alloc(sizeof (MESHINFO));
+	if (!pMeshInfo)
 	{
-		MESHINFO* pMeshInfo = new MESHINFO;
-		pMeshInfo->pMesh		= pMesh;
-		pMeshInfo->iCurFrame	= iCurFrame;
-		pMeshInfo->matTrans		= matTrans;
-		m_aMeshPool.push_back(pMeshInfo);
-	}
-	else
-	{
-		MESHINFO* pMeshInfo = m_aMeshPool[m_iPoolCnt];
-		pMeshInfo->pMesh		= pMesh;
-		pMeshInfo->iCurFrame	= iCurFrame;
-		pMeshInfo->matTrans		= matTrans;
+		g_pA3DErrLog->ErrLog("A3DMeshCollector::PrepareMeshToRender, Not enough memory");
+		return false;
 	}
 
-	m_iPoolCnt++;
+	pMeshInfo->pMesh		= pMesh;
+	pMeshInfo->iCurFrame	= iCurFrame;
+	pMeshInfo->matTrans		= matTrans;
 
 	//	Search a proper texture slot
 	TEXTURESLOT* pSlot = (TEXTURESLOT*)((ALISTELEMENT*)hTexture)->pData;
 
 	if (pSlot->iMeshCnt == pSlot->aMeshInfo.size())
-		pSlot->aMeshInfo.push_back(m_aMeshPool[m_iPoolCnt-1]);
+		pSlot->aMeshInfo.push_back(pMeshInfo);
 	else
-		pSlot->aMeshInfo[pSlot->iMeshCnt] = m_aMeshPool[m_iPoolCnt-1];
+		pSlot->aMeshInfo[pSlot->iMeshCnt] = pMeshInfo;
 
 	pSlot->iMeshCnt++;
 
@@ -281,9 +258,6 @@ bool A3DMeshCollector::Render(A3DViewport* pCurViewport)
 	m_pA3DDevice->SetWorldMatrix(matWorld);
 	m_pA3DDevice->GetD3DDevice()->SetVertexShader(A3DFVF_A3DVERTEX);
 
-	//	Clear pool counter for next frame
-	m_iPoolCnt = 0;
-
 	if (1)
 	{
 		while (pElem != m_TextureList.GetTail())
@@ -413,6 +387,4 @@ void A3DMeshCollector::RemoveUnrenderedMeshes()
 		pSlot->iMeshCnt = 0;
 		pElem = pElem->pNext;
 	}
-
-	m_iPoolCnt = 0;
 }
@@ -14,6 +14,8 @@
 #include "A3DErrLog.h"
 #include "A3DConfig.h"
 #include "A3DIBLScene.h"
+#include "A3DEngine.h"
+#include "A3DFrameArena.h"
 
 ///////////////////////////////////////////////////////////////////////////
 //
@@ -52,15 +54,12 @@
 A3DMeshSorter::A3DMeshSorter()
 {
 	m_bIncrease	= false;
-	m_pCurNode	= NULL;
-	m_iNumGroup	= 0;
+	m_pMeshList	= NULL;
 	m_iNumNode	= 0;
 	m_pDevice	= NULL;
 
 	m_pIBLStaticLight = NULL;
 	m_pIBLDynamicLight = NULL;
-
-	memset(m_aNodeBufs, 0, sizeof (m_aNodeBufs));
 }
 
 A3DMeshSorter::~A3DMeshSorter()
@@ -73,24 +72,7 @@ bool A3DMeshSorter::Init(A3DDevice* pDevice)
 	if( g_pA3DConfig->GetRunEnv() == A3DRUNENV_PURESERVER )
 		return true;
 
-	if (!m_MeshList.Init())
-	{
-		g_pA3DErrLog->ErrLog("A3DMeshSorter::Init initialize mesh list failed");
-		return false;
-	}
-
-	MESHNODE* pNodeBuf;
-
-	//	Allocate 1024 item as the first node buffer group
-	if (!(pNodeBuf = (MESHNODE*)malloc(SIZE_NODEBUF * sizeof (MESHNODE))))
-	{
-		g_pA3DErrLog->ErrLog("A3DMeshSorter::Init Not enough memory");
-		return false;
-	}
-
-	m_aNodeBufs[0]	= pNodeBuf;
-	m_iNumGroup		= 1;
-	m_iCurGroup		= 0;
+	m_pMeshList		= NULL;
 	m_iNumNode		= 0;
 	m_vCameraPos	= A3DVECTOR3(0.0f);
 	m_pDevice		= pDevice;
@@ -103,21 +85,9 @@ void A3DMeshSorter::Release()
 {
 	if( !m_pDevice ) return;
 
-	for (int i=0; i < m_iNumGroup; i++)
-	{
-		if (m_aNodeBufs[i])
-		{
-			free(m_aNodeBufs[i]);
-			m_aNodeBufs[i] = NULL;
-		}
-	}
-
-	m_iNumGroup	= 0;
-	m_iCurGroup	= 0;
+	m_pMeshList	= NULL;
 	m_iNumNode	= 0;
 	m_pDevice	= NULL;
-
-	m_MeshList.Release();
 }
 
 /*	Insert a mesh to list.
@@ -138,14 +108,13 @@ bool A3DMeshSorter::InsertMesh(A3DMATRIX4& matTrans, A3DIBLLIGHTPARAM& iblLightP
 		return false;
 	}
 
-	//	Current node buffer has been used up
-	if (m_iNumNode >= SIZE_NODEBUF)
+	MESHNODE* pMeshNode = (MESHNODE*)m_pDevice->GetA3DEngine()->GetFrameArena()->Alloc(sizeof (MESHNODE));
+	if (!pMeshNode)
 	{
-		if (!AppendNodeBuffer())
-			return false;
+		g_pA3DErrLog->ErrLog("A3DMeshSorter::InsertMesh, Not enough memory");
+		return false;
 	}
 
-	MESHNODE* pMeshNode  = &m_aNodeBufs[m_iCurGroup][m_iNumNode++];
 	pMeshNode->pMesh	 = pMesh;
 	pMeshNode->iCurFrame = iCurFrame;
 	pMeshNode->matTrans	 = matTrans;
@@ -157,87 +126,36 @@ bool A3DMeshSorter::InsertMesh(A3DMATRIX4& matTrans, A3DIBLLIGHTPARAM& iblLightP
 
 	pMeshNode->fWeight = DotProduct(vPos, vPos);
 
-	//	Insert to a proper position in list
-	ALISTELEMENT* pListElem = m_MeshList.GetFirst();
+	//	Insert to a proper position in list, the same weight ones are kept in inserting order
+	MESHNODE** ppLink = &m_pMeshList;
 
 	if (m_bIncrease)	//	Increasing order
 	{
-		while (pListElem != m_MeshList.GetTail())
-		{
-			if (pMeshNode->fWeight < ((MESHNODE*)pListElem->pData)->fWeight)
-			{
-				m_MeshList.Insert(pMeshNode, pListElem, &pMeshNode->pRecordElement);
-				return true;
-			}
-
-			pListElem = pListElem->pNext;
-		}
+		while (*ppLink && !(pMeshNode->fWeight < (*ppLink)->fWeight))
+			ppLink = &(*ppLink)->pNext;
 	}
 	else	//	Decreasing order
 	{
-		while (pListElem != m_MeshList.GetTail())
-		{
-			if (pMeshNode->fWeight > ((MESHNODE*)pListElem->pData)->fWeight)
-			{
-				m_MeshList.Insert(pMeshNode, pListElem, &pMeshNode->pRecordElement);
-				return true;
-			}
-
-			pListElem = pListElem->pNext;
-		}
+		while (*ppLink && !(pMeshNode->fWeight > (*ppLink)->fWeight))
+			ppLink = &(*ppLink)->pNext;
 	}
 
-	//	Add this element to tail
-	m_MeshList.Insert(pMeshNode, m_MeshList.GetTail(), &pMeshNode->pRecordElement);
+	pMeshNode->pNext = *ppLink;
+	*ppLink = pMeshNode;
+	m_iNumNode++;
 
 	return true;
 }
 
-//	Remove all meshes from list. Note: this function only reset mesh list but not 
-//	mesh buffer. To release mesh buffers call Release().
+//	Remove all meshes from list. The nodes will be freed when the frame arena is reset.
 void A3DMeshSorter::RemoveAllMeshes()
 {
 	if( !m_pDevice ) return;
 
-	m_MeshList.Reset();
-
-	m_iCurGroup	= 0;
+	m_pMeshList	= NULL;
 	m_iNumNode	= 0;
 }
 
-/*	Append a node buffer group. 
-
-	Return true for success, otherwise return false.
-*/
-bool A3DMeshSorter::AppendNodeBuffer()
-{
-	if (m_iCurGroup+1 < m_iNumGroup)
-	{
-		m_iCurGroup++;
-		m_iNumNode = 0;
-		return true;
-	}
-
-	if (m_iNumGroup >= SIZE_BUFGROUP)
-	{
-		g_pA3DErrLog->ErrLog("A3DMeshSorter::AppendNodeBuffer, too much mesh inserted");
-		return false;
-	}
-
-	MESHNODE* pNodeBuf = (MESHNODE*)malloc(SIZE_NODEBUF * sizeof (MESHNODE));
-	if (!pNodeBuf)
-	{
-		g_pA3DErrLog->ErrLog("A3DMeshSorter::AppendNodeBuffer, Not enough memory");
-		return false;
-	}
-
-	m_iCurGroup++;
-	m_iNumGroup++;
-	m_iNumNode = 0;
-
-	return true;
-}
-
 /*	Render sorted meshes.
 
 	pCurViewport: current viewport's address
@@ -246,13 +164,11 @@ bool A3DMeshSorter::Render(A3DViewport* pCurViewport)
 {
 	if( !m_pDevice ) return true;
 
-	MESHNODE* pMeshNode;
+	MESHNODE* pMeshNode = m_pMeshList;
 	A3DMesh* pMesh;
-	ALISTELEMENT* pListElem = m_MeshList.GetFirst();	
 
-	while (pListElem != m_MeshList.GetTail())
+	while (pMeshNode)
 	{
-		pMeshNode	= (MESHNODE*)pListElem->pData;
 		pMesh		= pMeshNode->pMesh;
 
 		m_pDevice->SetWorldMatrix(pMeshNode->matTrans);
@@ -285,7 +201,7 @@ bool A3DMeshSorter::Render(A3DViewport* pCurViewport)
 		if (!pMesh->Render(pCurViewport))
 			return false;
 
-		pListElem = pListElem->pNext;
+		pMeshNode = pMeshNode->pNext;
 	}
 
 	if( A3DIBLScene::GetGobalLightGrid() )
@@ -11,6 +11,7 @@
 #include "A3DGraphicsFX.h"
 #include "A3DGFXMan.h"
 #include "A3DConfig.h"
+#include "allocator.h"
 
 #include <assert.h>
 #include <AM3DSoundBufferMan.h>
@@ -62,6 +63,10 @@ A3DModel::A3DModel() : A3DObject()
 	m_dwAABBTraceBits = 0xffffffff;
 
 	m_Container	= A3DCONTAINER_NULL;
+	m_hContainerSlot = ASLOTHANDLE_NULL;
+	m_hModelRes = A3DRESHANDLE_NULL;
+	m_pTraceTree = NULL;
+	m_nTraceProxy = A3DAABBTREE_NULL;
 	m_bZPull = false;
 
 	m_vecScale = A3DVECTOR3(1.0f);
@@ -334,7 +339,7 @@ bool A3DModel::Release()
 			pGFX->Stop(true);
 		}
 
-		free(pGFXRecord);
+		afastfree(pGFXRecord, sizeof(A3DMODEL_GFX_RECORD));
 		pGFXElement = pGFXElement->pNext;
 	}
 	m_GFXList.Release();
@@ -394,16 +399,22 @@ bool A3DModel::Release()
 	m_LogicEventList.Release();
 
 	//Rlease OBB Datas;
-	ALISTELEMENT * pOBBElement = m_ModelOBBList.GetFirst();
-	while( pOBBElement != m_ModelOBBList.GetTail() )
+	for(int i=0; i<m_ModelOBBList.GetSize(); i++)
 	{
-		A3DMODELOBB * pOBB = (A3DMODELOBB *) pOBBElement->pData;
+		A3DMODELOBB * pOBB = (A3DMODELOBB *) m_ModelOBBList.GetAt(i);
 		free(pOBB);
-		pOBBElement = pOBBElement->pNext;
 	}
 	
 	m_ModelOBBList.Release();
 	m_ChildModelList.Release();
+
+	// A duplicated model uses the action lists of the one loaded by A3DModelMan, so it holds
+	// a reference to that one till now;
+	if( m_bDuplicatedOne && m_pA3DDevice && m_pA3DDevice->GetA3DEngine()->GetA3DModelMan() )
+		m_pA3DDevice->GetA3DEngine()->GetA3DModelMan()->ReleaseModelRes(m_hModelRes);
+	m_hModelRes = A3DRESHANDLE_NULL;
+
+	SetTraceTree(NULL);
 	return true;
 }
 
@@ -696,12 +707,242 @@ bool A3DModel::UpdateAllInfos()
 	return true;
 }
 
+bool A3DModel::Match(A3DModel * pModel)
+{
+	ALISTELEMENT * pElement, * pOtherElement;
+	int i;
+
+	// The name of the model itself is the name of its file, Load does not set it;
+	if( m_ChildFrameList.GetSize() != pModel->m_ChildFrameList.GetSize() ||
+		m_ChildModelList.GetSize() != pModel->m_ChildModelList.GetSize() ||
+		m_pActionDefinitionList->GetSize() != pModel->m_pActionDefinitionList->GetSize() ||
+		m_pActionGroupList->GetSize() != pModel->m_pActionGroupList->GetSize() ||
+		m_GFXEventList.GetSize() != pModel->m_GFXEventList.GetSize() ||
+		m_SFXEventList.GetSize() != pModel->m_SFXEventList.GetSize() ||
+		m_LogicEventList.GetSize() != pModel->m_LogicEventList.GetSize() )
+		return false;
+
+	pElement = m_ChildFrameList.GetFirst();
+	pOtherElement = pModel->m_ChildFrameList.GetFirst();
+	while( pElement != m_ChildFrameList.GetTail() )
+	{
+		if( !((A3DFrame *) pElement->pData)->Match((A3DFrame *) pOtherElement->pData) )
+			return false;
+		pElement = pElement->pNext;
+		pOtherElement = pOtherElement->pNext;
+	}
+
+	pElement = m_ChildModelList.GetFirst();
+	pOtherElement = pModel->m_ChildModelList.GetFirst();
+	while( pElement != m_ChildModelList.GetTail() )
+	{
+		A3DModel * pChildModel = (A3DModel *) pElement->pData;
+		A3DModel * pOtherChildModel = (A3DModel *) pOtherElement->pData;
+		if( _stricmp(pChildModel->GetName(), pOtherChildModel->GetName()) || !pChildModel->Match(pOtherChildModel) )
+			return false;
+		pElement = pElement->pNext;
+		pOtherElement = pOtherElement->pNext;
+	}
+
+	pElement = m_pActionDefinitionList->GetFirst();
+	pOtherElement = pModel->m_pActionDefinitionList->GetFirst();
+	while( pElement != m_pActionDefinitionList->GetTail() )
+	{
+		A3DACTION * pAction = (A3DACTION *) pElement->pData;
+		A3DACTION * pOtherAction = (A3DACTION *) pOtherElement->pData;
+		if( strncmp(pAction->szName, pOtherAction->szName, 32) || pAction->nAnimStart != pOtherAction->nAnimStart ||
+			pAction->nAnimEnd != pOtherAction->nAnimEnd || pAction->bAnimLoop != pOtherAction->bAnimLoop )
+			return false;
+		pElement = pElement->pNext;
+		pOtherElement = pOtherElement->pNext;
+	}
+
+	pElement = m_pActionGroupList->GetFirst();
+	pOtherElement = pModel->m_pActionGroupList->GetFirst();
+	while( pElement != m_pActionGroupList->GetTail() )
+	{
+		A3DGROUPACTION * pGroupAction = (A3DGROUPACTION *) pElement->pData;
+		A3DGROUPACTION * pOtherGroupAction = (A3DGROUPACTION *) pOtherElement->pData;
+		if( strncmp(pGroupAction->szName, pOtherGroupAction->szName, 32) || pGroupAction->nActionNum != pOtherGroupAction->nActionNum )
+			return false;
+		for(i=0; i<pGroupAction->nActionNum && i<A3D_GROUP_ACTION_MAX_ELEMENT; i++)
+		{
+			if( strncmp(pGroupAction->pActionElement[i]->szName, pOtherGroupAction->pActionElement[i]->szName, 32) )
+				return false;
+		}
+		pElement = pElement->pNext;
+		pOtherElement = pOtherElement->pNext;
+	}
+
+	pElement = m_GFXEventList.GetFirst();
+	pOtherElement = pModel->m_GFXEventList.GetFirst();
+	while( pElement != m_GFXEventList.GetTail() )
+	{
+		A3DMODEL_GFX_EVENT * pEvent = (A3DMODEL_GFX_EVENT *) pElement->pData;
+		A3DMODEL_GFX_EVENT * pOtherEvent = (A3DMODEL_GFX_EVENT *) pOtherElement->pData;
+		if( pEvent->nFrame != pOtherEvent->nFrame || _stricmp(pEvent->szGFXName, pOtherEvent->szGFXName) ||
+			pEvent->bLinked != pOtherEvent->bLinked || strncmp(pEvent->szParentName, pOtherEvent->szParentName, 32) ||
+			pEvent->vScale != pOtherEvent->vScale || memcmp(&pEvent->vecPos, &pOtherEvent->vecPos, sizeof(A3DVECTOR3)) ||
+			memcmp(&pEvent->vecDir, &pOtherEvent->vecDir, sizeof(A3DVECTOR3)) || memcmp(&pEvent->vecUp, &pOtherEvent->vecUp, sizeof(A3DVECTOR3)) )
+			return false;
+		pElement = pElement->pNext;
+		pOtherElement = pOtherElement->pNext;
+	}
+
+	pElement = m_SFXEventList.GetFirst();
+	pOtherElement = pModel->m_SFXEventList.GetFirst();
+	while( pElement != m_SFXEventList.GetTail() )
+	{
+		A3DMODEL_SFX_EVENT * pEvent = (A3DMODEL_SFX_EVENT *) pElement->pData;
+		A3DMODEL_SFX_EVENT * pOtherEvent = (A3DMODEL_SFX_EVENT *) pOtherElement->pData;
+		if( pEvent->nFrame != pOtherEvent->nFrame || _stricmp(pEvent->szSFXName, pOtherEvent->szSFXName) ||
+			pEvent->b2DSound != pOtherEvent->b2DSound || pEvent->bLoop != pOtherEvent->bLoop ||
+			strncmp(pEvent->szParentName, pOtherEvent->szParentName, 32) || pEvent->vVolume != pOtherEvent->vVolume ||
+			pEvent->vMinDis != pOtherEvent->vMinDis || pEvent->vMaxDis != pOtherEvent->vMaxDis ||
+			memcmp(&pEvent->vecPos, &pOtherEvent->vecPos, sizeof(A3DVECTOR3)) || memcmp(&pEvent->vecDir, &pOtherEvent->vecDir, sizeof(A3DVECTOR3)) || memcmp(&pEvent->vecUp, &pOtherEvent->vecUp, sizeof(A3DVECTOR3)) )
+			return false;
+		pElement = pElement->pNext;
+		pOtherElement = pOtherElement->pNext;
+	}
+
+	pElement = m_LogicEventList.GetFirst();
+	pOtherElement = pModel->m_LogicEventList.GetFirst();
+	while( pElement != m_LogicEventList.GetTail() )
+	{
+		A3DMODEL_LOGIC_EVENT * pEvent = (A3DMODEL_LOGIC_EVENT *) pElement->pData;
+		A3DMODEL_LOGIC_EVENT * pOtherEvent = (A3DMODEL_LOGIC_EVENT *) pOtherElement->pData;
+		if( pEvent->nFrame != pOtherEvent->nFrame || strncmp(pEvent->szNotifyString, pOtherEvent->szNotifyString, 32) )
+			return false;
+		pElement = pElement->pNext;
+		pOtherElement = pOtherElement->pNext;
+	}
+
+	return 0 == memcmp(m_pProperties, pModel->m_pProperties, A3DMODEL_PROPERTY_SIZE);
+}
+
 bool A3DModel::Save(AFile * pFileToSave)
 {
 	//We should save the action definition list here;
 	if( pFileToSave->IsBinary() )
 	{
+		char	szLineBuffer[AFILE_LINEMAXLEN];
+		DWORD	dwWriteLength;
+		A3DMODEL_BINHEADER header;
+		ALISTELEMENT * pElement;
+		int		i, j;
+
+		sprintf(szLineBuffer, "MODEL: %s", GetName());
+		pFileToSave->Write(szLineBuffer, strlen(szLineBuffer) + 1, &dwWriteLength);
+
+		ZeroMemory(&header, sizeof(header));
+		header.dwVersion		= A3DMODEL_BINVERSION;
+		header.nNumChildFrames	= m_ChildFrameList.GetSize();
+		header.nNumChildModels	= m_ChildModelList.GetSize();
+		header.nNumActions		= m_pActionDefinitionList->GetSize();
+		header.nNumGroupActions	= m_pActionGroupList->GetSize();
+		header.nNumGFXEvents	= m_GFXEventList.GetSize();
+		header.nNumSFXEvents	= m_SFXEventList.GetSize();
+		header.nNumLogicEvents	= m_LogicEventList.GetSize();
+
+		for(i=0; i<header.nNumChildFrames; i++)
+			header.dwNameSize += strlen(((A3DFrame *) m_ChildFrameList.GetElementByOrder(i)->pData)->GetName()) + 1;
+		for(i=0; i<header.nNumChildModels; i++)
+			header.dwNameSize += strlen(((A3DModel *) m_ChildModelList.GetElementByOrder(i)->pData)->GetName()) + 1;
+		DWORD dwNamePad = ((header.dwNameSize + 3) & ~3) - header.dwNameSize;
+		header.dwNameSize += dwNamePad;
+
+		pFileToSave->Write(&header, sizeof(header), &dwWriteLength);
+
+		//Child frame and child model names;
+		for(i=0; i<header.nNumChildFrames; i++)
+		{
+			char * szName = ((A3DFrame *) m_ChildFrameList.GetElementByOrder(i)->pData)->GetName();
+			pFileToSave->Write(szName, strlen(szName) + 1, &dwWriteLength);
+		}
+		for(i=0; i<header.nNumChildModels; i++)
+		{
+			char * szName = ((A3DModel *) m_ChildModelList.GetElementByOrder(i)->pData)->GetName();
+			pFileToSave->Write(szName, strlen(szName) + 1, &dwWriteLength);
+		}
+		DWORD dwZero = 0;
+		if( dwNamePad )
+			pFileToSave->Write(&dwZero, dwNamePad, &dwWriteLength);
+
+		pElement = m_pActionDefinitionList->GetFirst();
+		while( pElement != m_pActionDefinitionList->GetTail() )
+		{
+			A3DACTION * pAction = (A3DACTION *) pElement->pData;
+			A3DMODEL_BINACTION action;
+			ZeroMemory(&action, sizeof(action));
+			strncpy(action.szName, pAction->szName, 32);
+			action.nAnimStart	= pAction->nAnimStart;
+			action.nAnimEnd		= pAction->nAnimEnd;
+			action.nLoop		= pAction->bAnimLoop;
+			pFileToSave->Write(&action, sizeof(action), &dwWriteLength);
+			pElement = pElement->pNext;
+		}
+
+		pElement = m_pActionGroupList->GetFirst();
+		while( pElement != m_pActionGroupList->GetTail() )
+		{
+			A3DGROUPACTION * pGroupAction = (A3DGROUPACTION *) pElement->pData;
+			A3DMODEL_BINGROUPACTION groupAction;
+			ZeroMemory(&groupAction, sizeof(groupAction));
+			strncpy(groupAction.szName, pGroupAction->szName, 32);
+			for(j=0; j<pGroupAction->nActionNum && j<A3D_GROUP_ACTION_MAX_ELEMENT; j++)
+				strncpy(groupAction.aActionNames[j], pGroupAction->pActionElement[j]->szName, 32);
+			pFileToSave->Write(&groupAction, sizeof(groupAction), &dwWriteLength);
+			pElement = pElement->pNext;
+		}
 
+		pElement = m_GFXEventList.GetFirst();
+		while( pElement != m_GFXEventList.GetTail() )
+		{
+			A3DMODEL_GFX_EVENT * pGFXEvent = (A3DMODEL_GFX_EVENT *) pElement->pData;
+			A3DMODEL_BINGFXEVENT gfxEvent;
+			ZeroMemory(&gfxEvent, sizeof(gfxEvent));
+			gfxEvent.nFrame		= pGFXEvent->nFrame;
+			strncpy(gfxEvent.szGFXName, pGFXEvent->szGFXName, MAX_PATH);
+			gfxEvent.nLinked	= pGFXEvent->bLinked;
+			gfxEvent.vScale		= pGFXEvent->vScale;
+			strncpy(gfxEvent.szParentName, pGFXEvent->szParentName, 32);
+			gfxEvent.vecPos		= pGFXEvent->vecPos;
+			gfxEvent.vecDir		= pGFXEvent->vecDir;
+			gfxEvent.vecUp		= pGFXEvent->vecUp;
+			pFileToSave->Write(&gfxEvent, sizeof(gfxEvent), &dwWriteLength);
+			pElement = pElement->pNext;
+		}
+
+		pElement = m_SFXEventList.GetFirst();
+		while( pElement != m_SFXEventList.GetTail() )
+		{
+			A3DMODEL_SFX_EVENT * pSFXEvent = (A3DMODEL_SFX_EVENT *) pElement->pData;
+			A3DMODEL_BINSFXEVENT sfxEvent;
+			ZeroMemory(&sfxEvent, sizeof(sfxEvent));
+			sfxEvent.nFrame		= pSFXEvent->nFrame;
+			strncpy(sfxEvent.szSFXName, pSFXEvent->szSFXName, MAX_PATH);
+			sfxEvent.nLoop		= pSFXEvent->bLoop;
+			sfxEvent.n2DSound	= pSFXEvent->b2DSound;
+			sfxEvent.vMinDis	= pSFXEvent->vMinDis;
+			sfxEvent.vMaxDis	= pSFXEvent->vMaxDis;
+			sfxEvent.vVolume	= pSFXEvent->vVolume;
+			strncpy(sfxEvent.szParentName, pSFXEvent->szParentName, 32);
+			sfxEvent.vecPos		= pSFXEvent->vecPos;
+			sfxEvent.vecDir		= pSFXEvent->vecDir;
+			sfxEvent.vecUp		= pSFXEvent->vecUp;
+			pFileToSave->Write(&sfxEvent, sizeof(sfxEvent), &dwWriteLength);
+			pElement = pElement->pNext;
+		}
+
+		pElement = m_LogicEventList.GetFirst();
+		while( pElement != m_LogicEventList.GetTail() )
+		{
+			A3DMODEL_LOGIC_EVENT * pLogicEvent = (A3DMODEL_LOGIC_EVENT *) pElement->pData;
+			pFileToSave->Write(pLogicEvent, sizeof(A3DMODEL_LOGIC_EVENT), &dwWriteLength);
+			pElement = pElement->pNext;
+		}
+
+		pFileToSave->Write(m_pProperties, A3DMODEL_PROPERTY_SIZE, &dwWriteLength);
 	}	
 	else
 	{
@@ -895,6 +1136,211 @@ bool A3DModel::Save(AFile * pFileToSave)
 	return true;
 }
 
+bool A3DModel::LoadChildFrame(A3DDevice * pA3DDevice, AFile * pFileToLoad, char * szFrameName)
+{
+	A3DFrame * pChildFrame = NULL;
+
+	// For current, we use only bare name of the mox file
+	// But the mox file exists in some folder, now is same as model file
+	// In future, mox file will contain a relative path? No, We'd better not
+	// So this solution is best, the only thing to do is to modify the 
+	// function call to let the relative path of modeljust passed in;
+	// But please note we have to set the frame's name to the bare one;
+	char szModelName[MAX_PATH];
+	char szMoxName[MAX_PATH];
+	char szModelPath[MAX_PATH];
+
+	APath_GetRelativePath(pFileToLoad->GetRelativeName(), 
+		m_pA3DDevice->GetA3DEngine()->GetA3DModelMan()->GetFolderName(), szModelName);
+	AFileMod_GetFilePath(szModelName, szModelPath, MAX_PATH);
+	if( szModelPath[0] )
+		sprintf(szMoxName, "%s\\%s", szModelPath, szFrameName);
+	else
+		strcpy(szMoxName, szFrameName);
+
+	if( !pA3DDevice )
+	{
+		//Used out of A3D Engine, so we have to new a A3DFrame here;
+		pChildFrame = new A3DFrame();
+		if( NULL == pChildFrame )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load Not enough memory!");
+			return false;
+		}
+
+		AFile modelFile;
+		if( !modelFile.Open(szMoxName, AFILE_OPENEXIST) )
+		{
+			delete pChildFrame;
+			g_pA3DErrLog->ErrLog("A3DModel::Load() Can not open file %s", szFrameName);
+			return false;
+		}
+		if( !pChildFrame->Load(pA3DDevice, &modelFile) )
+		{
+			pChildFrame->Release();
+			delete pChildFrame;
+			g_pA3DErrLog->ErrLog("A3DModel::Load() Child Frame load fail!");
+			return false;
+		}
+		modelFile.Close();
+	}
+	else
+	{
+		if( !m_pA3DDevice->GetA3DEngine()->GetA3DMoxMan()->LoadMoxFile(szMoxName, &pChildFrame) )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load Can't load child mox file: %s", szFrameName);
+			return false;
+		}
+	}
+	pChildFrame->SetName(szFrameName);
+	if( !AddChildFrame(pChildFrame) )
+		return false;
+
+	return true;
+}
+
+// Copy a fixed size name in the binary model file and terminate it;
+static void CopyBinName(char * szDest, const char * szSrc, int nSize)
+{
+	memcpy(szDest, szSrc, nSize);
+	szDest[nSize] = '\0';
+}
+
+// Get the next name in the name block of the binary model file, NULL if it is not terminated;
+static char * GetNextBinName(char ** ppName, char * pNameEnd)
+{
+	char * szName = *ppName;
+	char * pTerminator = (char *) memchr(szName, 0, pNameEnd - szName);
+	if( !pTerminator )
+		return NULL;
+
+	*ppName = pTerminator + 1;
+	return szName;
+}
+
+bool A3DModel::LoadBinaryBody(A3DDevice * pA3DDevice, AFile * pFileToLoad, A3DMODEL_BINHEADER& header, LPBYTE pBody)
+{
+	int i, j;
+
+	// Fix up the pointers of the sections in the body;
+	char * pName = (char *) pBody;
+	char * pNameEnd = pName + header.dwNameSize;
+	A3DMODEL_BINACTION * pActions = (A3DMODEL_BINACTION *) pNameEnd;
+	A3DMODEL_BINGROUPACTION * pGroupActions = (A3DMODEL_BINGROUPACTION *) (pActions + header.nNumActions);
+	A3DMODEL_BINGFXEVENT * pGFXEvents = (A3DMODEL_BINGFXEVENT *) (pGroupActions + header.nNumGroupActions);
+	A3DMODEL_BINSFXEVENT * pSFXEvents = (A3DMODEL_BINSFXEVENT *) (pGFXEvents + header.nNumGFXEvents);
+	A3DMODEL_LOGIC_EVENT * pLogicEvents = (A3DMODEL_LOGIC_EVENT *) (pSFXEvents + header.nNumSFXEvents);
+	LPBYTE pProperties = (LPBYTE) (pLogicEvents + header.nNumLogicEvents);
+
+	for(i=0; i<header.nNumChildFrames; i++)
+	{
+		char * szFrameName = GetNextBinName(&pName, pNameEnd);
+		if( !szFrameName )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load() Bad child frame name in [%s]!", pFileToLoad->GetRelativeName());
+			return false;
+		}
+		if( !LoadChildFrame(pA3DDevice, pFileToLoad, szFrameName) )
+			return false;
+	}
+
+	// If the device has not be created, we shall not process any more!
+	if( !m_pA3DDevice )
+		return true;
+
+	for(i=0; i<header.nNumChildModels; i++)
+	{
+		A3DModel * pChildModel = NULL;
+		char * szModelName = GetNextBinName(&pName, pNameEnd);
+		if( !szModelName )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load() Bad child model name in [%s]!", pFileToLoad->GetRelativeName());
+			return false;
+		}
+		if( !m_pA3DDevice->GetA3DEngine()->GetA3DModelMan()->LoadModelFile(szModelName, &pChildModel, true) )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load Can't load child model file: %s", szModelName);
+			return false;
+		}
+		if( !AddChildModel(pChildModel) )
+			return false;
+		if( !pChildModel->SetParentModel(this) )
+			return false;
+	}
+
+	for(i=0; i<header.nNumActions; i++)
+	{
+		char szName[33];
+		CopyBinName(szName, pActions[i].szName, 32);
+		if( !DefineAction(NULL, szName, pActions[i].nAnimStart, pActions[i].nAnimEnd, pActions[i].nLoop ? true : false) )
+			return false;
+	}
+
+	for(i=0; i<header.nNumGroupActions; i++)
+	{
+		char szName[33];
+		CopyBinName(szName, pGroupActions[i].szName, 32);
+		if( !AddGroupAction(NULL, szName, "") )
+			return false;
+		for(j=0; j<A3D_GROUP_ACTION_MAX_ELEMENT; j++)
+		{
+			char szActionName[33];
+			CopyBinName(szActionName, pGroupActions[i].aActionNames[j], 32);
+			if( szActionName[0] == '\0' )//Empty Slot
+				continue;
+
+			if( !AddGroupAction(NULL, szName, szActionName) )
+				return false;
+		}
+	}
+
+	for(i=0; i<header.nNumGFXEvents; i++)
+	{
+		A3DMODEL_BINGFXEVENT * pEvent = &pGFXEvents[i];
+		char szGFXFile[MAX_PATH + 1];
+		char szParentName[33];
+		CopyBinName(szGFXFile, pEvent->szGFXName, MAX_PATH);
+		CopyBinName(szParentName, pEvent->szParentName, 32);
+
+		if( !AddGFXEvent(pEvent->nFrame, szGFXFile, pEvent->nLinked ? true : false, pEvent->vScale, szParentName, 
+			pEvent->vecPos, pEvent->vecDir, pEvent->vecUp) )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load() AddGFXEvent Fail!");
+			return false;
+		}
+	}
+
+	for(i=0; i<header.nNumSFXEvents; i++)
+	{
+		A3DMODEL_BINSFXEVENT * pEvent = &pSFXEvents[i];
+		char szSFXFile[MAX_PATH + 1];
+		char szParentName[33];
+		CopyBinName(szSFXFile, pEvent->szSFXName, MAX_PATH);
+		CopyBinName(szParentName, pEvent->szParentName, 32);
+
+		if( !AddSFXEvent(pEvent->nFrame, szSFXFile, pEvent->nLoop ? true : false, pEvent->n2DSound ? true : false, 
+			pEvent->vMinDis, pEvent->vMaxDis, pEvent->vVolume, szParentName, pEvent->vecPos, pEvent->vecDir, pEvent->vecUp) )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load() AddSFXEvent Fail!");
+			return false;
+		}
+	}
+
+	for(i=0; i<header.nNumLogicEvents; i++)
+	{
+		char szNotifyString[33];
+		CopyBinName(szNotifyString, pLogicEvents[i].szNotifyString, 32);
+		if( !AddLogicEvent(pLogicEvents[i].nFrame, szNotifyString) )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load() AddLogicEvent Fail!");
+			return false;
+		}
+	}
+
+	memcpy(m_pProperties, pProperties, A3DMODEL_PROPERTY_SIZE);
+	return true;
+}
+
 bool A3DModel::Load(A3DDevice * pA3DDevice, AFile * pFileToLoad)
 {
 	if( !strstr(pFileToLoad->GetFileName(), ".mod") )
@@ -909,7 +1355,73 @@ bool A3DModel::Load(A3DDevice * pA3DDevice, AFile * pFileToLoad)
 	//We should load the action definition list here;
 	if( pFileToLoad->IsBinary() )
 	{
+		char	szLineBuffer[AFILE_LINEMAXLEN];
+		char	szResult[AFILE_LINEMAXLEN];
+		DWORD	dwReadLen;
+		A3DMODEL_BINHEADER header;
+
+		pFileToLoad->ReadString(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
+		if( !pFileToLoad->GetStringAfter(szLineBuffer, "MODEL: ", szResult) )
+			return false;
+
+		pFileToLoad->Read(&header, sizeof(header), &dwReadLen);
+		if( dwReadLen != sizeof(header) || header.dwVersion != A3DMODEL_BINVERSION )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load(), Unknown binary model format [%s]", pFileToLoad->GetFileName());
+			return false;
+		}
+
+		if( header.nNumChildFrames < 0 || header.nNumChildModels < 0 || header.nNumActions < 0 || 
+			header.nNumGroupActions < 0 || header.nNumGFXEvents < 0 || header.nNumSFXEvents < 0 || 
+			header.nNumLogicEvents < 0 || (header.dwNameSize & 3) )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load(), Bad binary model header [%s]", pFileToLoad->GetFileName());
+			return false;
+		}
+
+		// All the rest is read with one call, then the sections are located in it; the counts
+		// come from the file, so the size is summed in 64 bits and must fit in the rest of the file;
+		__int64 nBodySize = (__int64) header.dwNameSize + 
+			(__int64) header.nNumActions * sizeof(A3DMODEL_BINACTION) + 
+			(__int64) header.nNumGroupActions * sizeof(A3DMODEL_BINGROUPACTION) + 
+			(__int64) header.nNumGFXEvents * sizeof(A3DMODEL_BINGFXEVENT) + 
+			(__int64) header.nNumSFXEvents * sizeof(A3DMODEL_BINSFXEVENT) + 
+			(__int64) header.nNumLogicEvents * sizeof(A3DMODEL_LOGIC_EVENT) + A3DMODEL_PROPERTY_SIZE;
+
+		DWORD dwBodyPos = pFileToLoad->GetPos();
+		pFileToLoad->Seek(0, AFILE_SEEK_END);
+		DWORD dwFileEnd = pFileToLoad->GetPos();
+		pFileToLoad->Seek(dwBodyPos, AFILE_SEEK_SET);
+		if( dwFileEnd < dwBodyPos || nBodySize > (__int64) (dwFileEnd - dwBodyPos) )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load(), Binary model file [%s] is truncated", pFileToLoad->GetFileName());
+			return false;
+		}
+
+		DWORD dwBodySize = (DWORD) nBodySize;
+		LPBYTE pBody = (LPBYTE) malloc(dwBodySize);
+		if( NULL == pBody )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load() Not enough memory!");
+			return false;
+		}
 
+		pFileToLoad->Read(pBody, dwBodySize, &dwReadLen);
+		if( dwReadLen != dwBodySize )
+		{
+			g_pA3DErrLog->ErrLog("A3DModel::Load(), Binary model file [%s] is truncated", pFileToLoad->GetFileName());
+			free(pBody);
+			return false;
+		}
+
+		bool bLoaded = LoadBinaryBody(pA3DDevice, pFileToLoad, header, pBody);
+		free(pBody);
+		if( !bLoaded )
+			return false;
+
+		// The same as the text file, nothing more is done without a device;
+		if( !m_pA3DDevice )
+			return true;
 	}
 	else
 	{
@@ -937,63 +1449,8 @@ bool A3DModel::Load(A3DDevice * pA3DDevice, AFile * pFileToLoad)
 				return false;
 			for(i=0; i<nChildFrameCount; i++)
 			{
-				A3DFrame * pChildFrame = NULL;
 				pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
-
-				// For current, we use only bare name of the mox file
-				// But the mox file exists in some folder, now is same as model file
-				// In future, mox file will contain a relative path? No, We'd better not
-				// So this solution is best, the only thing to do is to modify the 
-				// function call to let the relative path of modeljust passed in;
-				// But please note we have to set the frame's name to the bare one;
-				char szModelName[MAX_PATH];
-				char szMoxName[MAX_PATH];
-				char szModelPath[MAX_PATH];
-
-				APath_GetRelativePath(pFileToLoad->GetRelativeName(), 
-					m_pA3DDevice->GetA3DEngine()->GetA3DModelMan()->GetFolderName(), szModelName);
-				AFileMod_GetFilePath(szModelName, szModelPath, MAX_PATH);
-				if( szModelPath[0] )
-					sprintf(szMoxName, "%s\\%s", szModelPath, szLineBuffer);
-				else
-					strcpy(szMoxName, szLineBuffer);
-
-				if( !pA3DDevice )
-				{
-					//Used out of A3D Engine, so we have to new a A3DFrame here;
-					pChildFrame = new A3DFrame();
-					if( NULL == pChildFrame )
-					{
-						g_pA3DErrLog->ErrLog("A3DModel::Load Not enough memory!");
-						return false;
-					}
-
-					AFile modelFile;
-					if( !modelFile.Open(szMoxName, AFILE_OPENEXIST) )
-					{
-						delete pChildFrame;
-						g_pA3DErrLog->ErrLog("A3DModel::Load() Can not open file %s", szLineBuffer);
-						return false;
-					}
-					if( !pChildFrame->Load(pA3DDevice, &modelFile) )
-					{
-						pChildFrame->Release();
-						delete pChildFrame;
-						g_pA3DErrLog->ErrLog("A3DModel::Load() Child Frame load fail!");
-						return false;
-					}
-					modelFile.Close();
-				}
-				else
-				{
-					if( !m_pA3DDevice->GetA3DEngine()->GetA3DMoxMan()->LoadMoxFile(szMoxName, &pChildFrame) )
-					{
-						g_pA3DErrLog->ErrLog("A3DModel::Load Can't load child mox file: %s", szLineBuffer);
-						return false;
-					}
-				}
-				pChildFrame->SetName(szLineBuffer);
-				if( !AddChildFrame(pChildFrame) )
+				if( !LoadChildFrame(pA3DDevice, pFileToLoad, szLineBuffer) )
 					return false;
 			}
 			pFileToLoad->ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
@@ -1333,10 +1790,9 @@ bool A3DModel::UpdateModelOBB()
 
 	if( m_ModelOBBList.GetSize() > 0 ) // Use ModelOBBList;
 	{
-		ALISTELEMENT * pModelOBBElement = m_ModelOBBList.GetFirst();
-		while( pModelOBBElement != m_ModelOBBList.GetTail() )
+		for(int i=0; i<m_ModelOBBList.GetSize(); i++)
 		{
-			A3DMODELOBB * pModelOBB = (A3DMODELOBB *) pModelOBBElement->pData;
+			A3DMODELOBB * pModelOBB = (A3DMODELOBB *) m_ModelOBBList.GetAt(i);
 			
 			A3DMATRIX4	matTM;
 			A3DOBB		bb = pModelOBB->frameOBB.a3dOBB;
@@ -1358,8 +1814,6 @@ bool A3DModel::UpdateModelOBB()
 			else
 				m_ModelOBB = GetOBB(m_ModelOBB, pModelOBB->obb);
 #endif
-			//Then move to next element;
-			pModelOBBElement = pModelOBBElement->pNext;
 		}
 
 		if( m_bAutoAABBEnabled )
@@ -1465,6 +1919,8 @@ NEXTFRAME:
 	CompleteAABB(&m_ModelAutoAABB);
 
 	m_bBuildOBBBevels = true;
+
+	UpdateTraceProxy();
 	return true;
 }
 
@@ -1768,9 +2224,64 @@ bool A3DModel::UpdateRelativeTM()
 	
 
 	m_bHasMoved = true;
+
+	// The AABB trace only shape moves with the position at once;
+	if( m_bTraceMoveAABBOnly )
+		UpdateTraceProxy();
 	return true;
 }
 
+bool A3DModel::SetTraceTree(A3DAABBTree * pTree)
+{
+	if( m_pTraceTree )
+	{
+		m_pTraceTree->DestroyProxy(m_nTraceProxy);
+		m_nTraceProxy = A3DAABBTREE_NULL;
+	}
+
+	m_pTraceTree = pTree;
+	if( NULL == m_pTraceTree )
+		return true;
+
+	A3DVECTOR3 vecMins, vecMaxs;
+	GetTraceBound(vecMins, vecMaxs);
+	m_nTraceProxy = m_pTraceTree->CreateProxy(vecMins, vecMaxs, this);
+	if( A3DAABBTREE_NULL == m_nTraceProxy )
+	{
+		m_pTraceTree = NULL;
+		return false;
+	}
+	return true;
+}
+
+void A3DModel::GetTraceBound(A3DVECTOR3& vecMins, A3DVECTOR3& vecMaxs)
+{
+	vecMins = m_ModelAABB.Mins;
+	vecMaxs = m_ModelAABB.Maxs;
+
+	if( m_bTraceMoveAABBOnly )
+	{
+		A3DVECTOR3 vecCenter = m_vecPos + m_vecAABBTraceCenter;
+		vecMins.x = min(vecMins.x, vecCenter.x - m_vecAABBTraceExtents.x);
+		vecMins.y = min(vecMins.y, vecCenter.y - m_vecAABBTraceExtents.y);
+		vecMins.z = min(vecMins.z, vecCenter.z - m_vecAABBTraceExtents.z);
+		vecMaxs.x = max(vecMaxs.x, vecCenter.x + m_vecAABBTraceExtents.x);
+		vecMaxs.y = max(vecMaxs.y, vecCenter.y + m_vecAABBTraceExtents.y);
+		vecMaxs.z = max(vecMaxs.z, vecCenter.z + m_vecAABBTraceExtents.z);
+	}
+
+	// The model AABB is left cleared when there is nothing in it;
+	if( vecMins.x > vecMaxs.x || vecMins.y > vecMaxs.y || vecMins.z > vecMaxs.z )
+		vecMins = vecMaxs = m_vecPos;
+}
+
+void A3DModel::RefitTraceProxy()
+{
+	A3DVECTOR3 vecMins, vecMaxs;
+	GetTraceBound(vecMins, vecMaxs);
+	m_pTraceTree->MoveProxy(m_nTraceProxy, vecMins, vecMaxs);
+}
+
 bool A3DModel::SetAnimRange(int nAnimStart, int nAnimEnd, bool bAnimLoop)
 {
 	if( nAnimStart > nAnimEnd )
@@ -2438,10 +2949,9 @@ bool A3DModel::RayTrace(A3DVECTOR3& vecStart, A3DVECTOR3& vecDelta, RAYTRACE * p
 		}
 		else
 		{
-			ALISTELEMENT * pOBBElement = m_ModelOBBList.GetFirst();
-			while( pOBBElement != m_ModelOBBList.GetTail() )
+			for(int i=0; i<m_ModelOBBList.GetSize(); i++)
 			{
-				A3DMODELOBB * pModelOBB = (A3DMODELOBB *)pOBBElement->pData; 
+				A3DMODELOBB * pModelOBB = (A3DMODELOBB *) m_ModelOBBList.GetAt(i);
 
 				if( CLS_RayToOBB3(vecStart, vecDelta, pModelOBB->obb, vecPoint, &vFraction, vecNormal) )
 				{
@@ -2456,8 +2966,6 @@ bool A3DModel::RayTrace(A3DVECTOR3& vecStart, A3DVECTOR3& vecDelta, RAYTRACE * p
 						pRayTrace->pModelOBB	= pModelOBB;
 					}
 				}
-
-				pOBBElement = pOBBElement->pNext;
 			}
 		}
 	}
@@ -2517,10 +3025,9 @@ bool A3DModel::OBBTrace(A3DOBB& obb, OBBSHAPE& obbShape, OBBTRACE * pOBBTrace, D
 	{
 		pOBBTrace->fFraction = 1.0f;
 
-		ALISTELEMENT * pOBBElement = m_ModelOBBList.GetFirst();
-		while( pOBBElement != m_ModelOBBList.GetTail() )
+		for(int i=0; i<m_ModelOBBList.GetSize(); i++)
 		{
-			A3DMODELOBB * pModelOBB = (A3DMODELOBB *)pOBBElement->pData; 
+			A3DMODELOBB * pModelOBB = (A3DMODELOBB *) m_ModelOBBList.GetAt(i);
 
 			if( OBBTraceOBB(obb, pModelOBB->obb, &vFraction, &vecNormal) )
 			{
@@ -2534,8 +3041,6 @@ bool A3DModel::OBBTrace(A3DOBB& obb, OBBSHAPE& obbShape, OBBTRACE * pOBBTrace, D
 					pOBBTrace->pModelOBB	= pModelOBB;
 				}
 			}
-
-			pOBBElement = pOBBElement->pNext;
 		}
 
 		if( pOBBTrace->fFraction < 1.0f )
@@ -2855,19 +3360,14 @@ bool A3DModel::AABBTrace(PAABBTRACEINFO pInfo, PAABBTRACE pTrace, DWORD dwTraceM
 		}
 
 		// Else we should descent into obbs;
-		ALISTELEMENT* pOBBElement;
-		pOBBElement = m_ModelOBBList.GetFirst();
-		while (pOBBElement != m_ModelOBBList.GetTail())
+		for(int i=0; i<m_ModelOBBList.GetSize(); i++)
 		{
-			A3DMODELOBB* pModelOBB = (A3DMODELOBB*)pOBBElement->pData;
+			A3DMODELOBB * pModelOBB = (A3DMODELOBB *) m_ModelOBBList.GetAt(i);
 
 			//	Fast check AABB at first
 			ExpandAABB(&aabb, pModelOBB->obb);
 			if (!CLS_AABBToAABB(pInfo->BoundAABB.Center, pInfo->BoundAABB.Extents, aabb.Center, aabb.Extents))
-			{
-				pOBBElement = pOBBElement->pNext;
 				continue;
-			}
 
 			if (m_bBuildOBBBevels)
 				TRA_BuildOBBBevels(pModelOBB->obb, &pModelOBB->Bevels);
@@ -2884,8 +3384,6 @@ bool A3DModel::AABBTrace(PAABBTRACEINFO pInfo, PAABBTRACE pTrace, DWORD dwTraceM
 					pTrace->pModelOBB	 = pModelOBB;
 				}
 			}
-
-			pOBBElement = pOBBElement->pNext;
 		}
 
 		m_bBuildOBBBevels = false;
@@ -3004,7 +3502,7 @@ bool A3DModel::AddGFX(A3DGraphicsFX * pGFX, bool bLinked, FLOAT vScale, char * s
 
 	// We must record each enabled gfx here;
 	// we should record that gfx and update its position at proper time;
-	A3DMODEL_GFX_RECORD	* pNewGFX = (A3DMODEL_GFX_RECORD *) malloc(sizeof(A3DMODEL_GFX_RECORD));
+	A3DMODEL_GFX_RECORD	* pNewGFX = (A3DMODEL_GFX_RECORD *) afastalloc(sizeof(A3DMODEL_GFX_RECORD));
 	if( !pNewGFX )
 	{
 		g_pA3DErrLog->ErrLog("A3DModel::AddGFX() Not enough memory!");
@@ -3060,7 +3558,7 @@ bool A3DModel::AddGFXByName(char * szGFXFile, bool bLinked, char * szParentName,
 		return true; // For that gfx will have no relation with the model any more;
 
 	// Else we should record that gfx and update its position at proper time;
-	A3DMODEL_GFX_RECORD	* pNewGFX = (A3DMODEL_GFX_RECORD *) malloc(sizeof(A3DMODEL_GFX_RECORD));
+	A3DMODEL_GFX_RECORD	* pNewGFX = (A3DMODEL_GFX_RECORD *) afastalloc(sizeof(A3DMODEL_GFX_RECORD));
 	if( !pNewGFX )
 	{
 		g_pA3DErrLog->ErrLog("A3DModel::AddGFXByName() Not enough memory!");
@@ -3247,7 +3745,7 @@ bool A3DModel::RemoveGFX(A3DMODEL_GFX_RECORD * pGFXRecord)
 		((A3DMODEL_GFX_EVENT *)pGFXRecord->pGFXEvent)->pGFXRecord = NULL;
 	}
 	
-	free(pGFXRecord);
+	afastfree(pGFXRecord, sizeof(A3DMODEL_GFX_RECORD));
 	return true;
 }
 
@@ -3300,7 +3798,7 @@ bool A3DModel::SoftStopAllGFX()
 			((A3DMODEL_GFX_EVENT *)pGFXRecord->pGFXEvent)->pGFXRecord = NULL;
 		}
 
-		free(pGFXRecord);
+		afastfree(pGFXRecord, sizeof(A3DMODEL_GFX_RECORD));
 
 		pThisGFXElement = pThisGFXElement->pNext;
 	}
@@ -3744,6 +4242,7 @@ bool A3DModel::Reset()
 	m_dwAABBTraceBits = 0xffffffff;
 
 	m_Container	= A3DCONTAINER_NULL;
+	m_hContainerSlot = ASLOTHANDLE_NULL;
 	m_bZPull = false;
 	return true;
 }
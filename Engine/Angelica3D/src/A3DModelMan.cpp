@@ -3,6 +3,7 @@
 #include "A3DFuncs.h"
 #include "A3DEngine.h"
 #include "A3DModelCollector.h"
+#include "vector.h"
 
 A3DModelMan::A3DModelMan()
 {
@@ -19,7 +20,8 @@ bool A3DModelMan::Init(A3DDevice * pDevice)
 {
 	strcpy(m_szFolderName, "Models");
 	m_pA3DDevice = pDevice;
-	m_ListModel.Init();
+	if( !m_ResCache.Init(A3DMODELMAN_CACHEBUDGET, FreeModel, this) )
+		return false;
 
 	m_pModelCollector = new A3DModelCollector(100);
 	if( NULL == m_pModelCollector )
@@ -42,24 +44,31 @@ bool A3DModelMan::Release()
 		delete pCollector;
 	}
 
-	ALISTELEMENT * pThisModelElement = m_ListModel.GetFirst();
+	m_ResCache.Release();
+	return true;
+}
 
-	while( pThisModelElement != m_ListModel.GetTail() )
+void A3DModelMan::FreeModel(LPVOID pRes, LPVOID pArg)
+{
+	A3DModelMan *	pModelMan = (A3DModelMan *) pArg;
+	A3DModel *		pModel = (A3DModel *) pRes;
+
+	// The child models are the loaded ones, the references to them are released after
+	// the parent is freed;
+	abase::vector<A3DRESHANDLE> aChildRes;
+	AList * pChildModelList = pModel->GetChildModelList();
+	ALISTELEMENT * pChildElement = pChildModelList->GetFirst();
+	while( pChildElement != pChildModelList->GetTail() )
 	{
-		MODELRECORD * pModelRecord = (MODELRECORD *) pThisModelElement->pData;
-		
-		A3DModel * pModel = pModelRecord->pModel;
-
-		pModel->Release();
-		delete pModel;
-		pModel = NULL;
-
-		free(pModelRecord);
-		pThisModelElement = pThisModelElement->pNext;
+		aChildRes.push_back(((A3DModel *) pChildElement->pData)->GetModelRes());
+		pChildElement = pChildElement->pNext;
 	}
 
-	m_ListModel.Release();
-	return true;
+	pModel->Release();
+	delete pModel;
+
+	for(size_t i=0; i<aChildRes.size(); i++)
+		pModelMan->m_ResCache.ReleaseRes(aChildRes[i]);
 }
 
 bool A3DModelMan::ReleaseModel(A3DModel *& pModel)
@@ -84,26 +93,40 @@ bool A3DModelMan::ReleaseModel(A3DModel *& pModel)
 	return true;
 }
 
-bool A3DModelMan::FindModelFile(char * szFilename, A3DModel ** ppModel)
+bool A3DModelMan::ReleaseModelRes(A3DRESHANDLE hRes)
 {
-	ALISTELEMENT * pThisModelElement = m_ListModel.GetFirst();
+	return m_ResCache.ReleaseRes(hRes);
+}
 
-	while( pThisModelElement != m_ListModel.GetTail() )
+bool A3DModelMan::GiveModel(A3DModel * pModel, A3DRESHANDLE hRes, A3DModel ** ppModel, bool bChild)
+{
+	if( NULL == ppModel )
+	{
+		// It is only loaded into the cache;
+		m_ResCache.ReleaseRes(hRes);
+		return true;
+	}
+
+	if( bChild )
 	{
-		MODELRECORD * pModelRecord = (MODELRECORD *) pThisModelElement->pData;
-		if( 0 == _stricmp(szFilename, pModelRecord->szFilename) )
-		{
-			*ppModel = pModelRecord->pModel;
-			return true;
-		}
-		pThisModelElement = pThisModelElement->pNext;
+		*ppModel = pModel;
+		return true;
+	}
+
+	if( !pModel->Duplicate(ppModel) )
+	{
+		m_ResCache.ReleaseRes(hRes);
+		return false;
 	}
+
+	(*ppModel)->SetModelRes(hRes);
 	return true;
 }
 
 bool A3DModelMan::LoadModelFile(char * szFilename, A3DModel **ppModel, bool bChild)
 {
-	A3DModel * pNewModel = NULL;
+	A3DModel *		pNewModel = NULL;
+	A3DRESHANDLE	hRes;
 
 	if( ppModel ) *ppModel = NULL;
 
@@ -120,22 +143,12 @@ bool A3DModelMan::LoadModelFile(char * szFilename, A3DModel **ppModel, bool bChi
 		return true;
 	}
 
-	if( !FindModelFile(szFilename, &pNewModel) )
-		return false;
-
+	// A name which has never been interned can not have been loaded;
+	pNewModel = (A3DModel *) m_ResCache.AcquireRes(AFileAtom_Find(szFilename), &hRes);
 	if( pNewModel ) 
-	{
-		if( ppModel )
-		{
-			if( bChild )
-				*ppModel = pNewModel;
-			else
-				return pNewModel->Duplicate(ppModel);
-			return true;
-		}
-		else
-			return true;
-	}
+		return GiveModel(pNewModel, hRes, ppModel, bChild);
+
+	DWORD dwLoadStart = timeGetTime();
 
 	// Now open the file;
 	AFileImage aFile;
@@ -161,66 +174,146 @@ bool A3DModelMan::LoadModelFile(char * szFilename, A3DModel **ppModel, bool bChi
 		return false;
 	}
 
+	// The size of the file is taken as the size of the model, its frames are counted
+	// by A3DMoxMan;
+	DWORD dwSize = aFile.GetFileLength();
 	aFile.Close();
 	
 	pNewModel->SetName(szFilename);
 
-	MODELRECORD * pNewModelRecord = (MODELRECORD *) malloc(sizeof(MODELRECORD));
-	if( NULL == pNewModelRecord ) 
+	hRes = m_ResCache.AddRes(AFileAtom_Get(szFilename), pNewModel, dwSize, timeGetTime() - dwLoadStart);
+	if( A3DRESHANDLE_NULL == hRes )
 	{
 		g_pA3DErrLog->ErrLog("A3DModelMan::LoadModelFile Not Enough Memory!");
-		if( pNewModel )
-		{
-			pNewModel->Release();
-			delete pNewModel;
-		}
+		FreeModel(pNewModel, this);
 		return false;
 	}
-	strncpy(pNewModelRecord->szFilename, szFilename, MAX_PATH);
-	pNewModelRecord->pModel = pNewModel;
-	
-	if( !m_ListModel.Append((LPVOID)pNewModelRecord) )
-		return false;
+	pNewModel->SetModelRes(hRes);
 
-	if( ppModel )
+	if( ppModel && !bChild )
 	{
-		if( bChild )
-			*ppModel = pNewModel;
-		else
-		{
-			// We can unload the record model's sound
-			pNewModel->UnloadSFX();
-			pNewModel->UnloadImmEffect();
-			return pNewModel->Duplicate(ppModel);
-		}
-		return true;
+		// We can unload the record model's sound
+		pNewModel->UnloadSFX();
+		pNewModel->UnloadImmEffect();
 	}
-	else
-		return true;
+
+	return GiveModel(pNewModel, hRes, ppModel, bChild);
 }
 
 bool A3DModelMan::Reset()
 {
+	// The models in the collector are freed, so the loaded ones they use are not referenced
+	// any more, they are kept warm in the budget for the next scene;
 	if( m_pModelCollector )
 	{
 		m_pModelCollector->Release();
 	}
 
-	ALISTELEMENT * pThisModelElement = m_ListModel.GetFirst();
+	return m_ResCache.Reset();
+}
+
+bool A3DModelMan::VerifyCompiledModel(A3DModel * pSrcModel, char * szDestFile)
+{
+	AFile binFile;
+	if( !binFile.Open(szDestFile, AFILE_OPENEXIST) )
+		return false;
+
+	A3DModel * pModel = new A3DModel();
+	if( NULL == pModel )
+	{
+		binFile.Close();
+		return false;
+	}
+
+	// Compare the frames, meshes, actions and events of the two loads themselves;
+	bool bSame = pModel->Load(m_pA3DDevice, &binFile) && pSrcModel->Match(pModel);
+	binFile.Close();
+
+	pModel->Release();
+	delete pModel;
+	return bSame;
+}
+
+bool A3DModelMan::CompileModelFile(char * szFilename, char * szDestFolder)
+{
+	// Load the model directly, the one in the list or the collector may have been changed;
+	AFileImage aFile;
+	if( !aFile.Open(m_szFolderName, szFilename, AFILE_OPENEXIST) )
+	{
+		g_pA3DErrLog->ErrLog("A3DModelMan::CompileModelFile(), [%s] can not be located in the package.", szFilename);
+		return false;
+	}
 
-	while( pThisModelElement != m_ListModel.GetTail() )
+	A3DModel * pModel = new A3DModel();
+	if( NULL == pModel )
 	{
-		MODELRECORD * pModelRecord = (MODELRECORD *) pThisModelElement->pData;
-		
-		A3DModel * pModel = pModelRecord->pModel;
+		g_pA3DErrLog->ErrLog("A3DModelMan::CompileModelFile Not enough memory!");
+		aFile.Close();
+		return false;
+	}
+	if( !pModel->Load(m_pA3DDevice, &aFile) )
+	{
+		g_pA3DErrLog->ErrLog("A3DModelMan::CompileModelFile File %s parsed error!", szFilename);
 		pModel->Release();
 		delete pModel;
-		pModel = NULL;
+		aFile.Close();
+		return false;
+	}
+	aFile.Close();
+	pModel->SetName(szFilename);
 
-		free(pModelRecord);
-		pThisModelElement = pThisModelElement->pNext;
+	char szDestFile[MAX_PATH];
+	sprintf(szDestFile, "%s\\%s", szDestFolder, szFilename);
+
+	AFile destFile;
+	if( !AFileMod_CreateFilePath(szDestFile) || !destFile.Open(szDestFile, AFILE_CREATENEW | AFILE_BINARY) )
+	{
+		g_pA3DErrLog->ErrLog("A3DModelMan::CompileModelFile() Can not create file [%s]!", szDestFile);
+		pModel->Release();
+		delete pModel;
+		return false;
+	}
+	bool bCompiled = pModel->Save(&destFile);
+	destFile.Close();
+
+	if( bCompiled && !VerifyCompiledModel(pModel, szDestFile) )
+	{
+		g_pA3DErrLog->ErrLog("A3DModelMan::CompileModelFile() [%s] does not load the same as [%s]!", szDestFile, szFilename);
+		bCompiled = false;
+	}
+
+	// The child frames' mox files are in the same folder as the model file;
+	char szModelPath[MAX_PATH];
+	char szMoxName[MAX_PATH];
+	int  i;
+	AFileMod_GetFilePath(szFilename, szModelPath, MAX_PATH);
+
+	AList * pChildFrameList = pModel->GetChildFrameList();
+	for(i=0; bCompiled && i<pChildFrameList->GetSize(); i++)
+	{
+		A3DFrame * pFrame = (A3DFrame *) pChildFrameList->GetElementByOrder(i)->pData;
+		if( szModelPath[0] )
+			sprintf(szMoxName, "%s\\%s", szModelPath, pFrame->GetName());
+		else
+			strcpy(szMoxName, pFrame->GetName());
+
+		bCompiled = m_pA3DDevice->GetA3DEngine()->GetA3DMoxMan()->CompileMoxFile(szMoxName, szDestFolder);
+	}
+
+	AList * pChildModelList = pModel->GetChildModelList();
+	for(i=0; bCompiled && i<pChildModelList->GetSize(); i++)
+	{
+		A3DModel * pChildModel = (A3DModel *) pChildModelList->GetElementByOrder(i)->pData;
+		bCompiled = CompileModelFile(pChildModel->GetName(), szDestFolder);
 	}
 
-	m_ListModel.Reset();
+	pModel->Release();
+	delete pModel;
+
+	if( !bCompiled )
+	{
+		g_pA3DErrLog->ErrLog("A3DModelMan::CompileModelFile() Compile [%s] fail!", szFilename);
+		return false;
+	}
 	return true;
-}
\ No newline at end of file
+}
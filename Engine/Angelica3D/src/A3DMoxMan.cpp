@@ -16,59 +16,34 @@ bool A3DMoxMan::Init(A3DDevice * pDevice)
 {
 	strcpy(m_szFolderName, "Models");
 	m_pA3DDevice = pDevice;
- 	m_ListMox.Init();
 
-	return true;
+	return m_ResCache.Init(A3DMOXMAN_CACHEBUDGET, FreeFrame, this);
 }
 
 bool A3DMoxMan::Release()
 {
-	ALISTELEMENT * pThisMoxElement = m_ListMox.GetFirst();
-
-	while( pThisMoxElement != m_ListMox.GetTail() )
-	{
-		MOXRECORD * pMox = (MOXRECORD *) pThisMoxElement->pData;
-		
-		A3DFrame * pFrame = pMox->pFrame;
-		pFrame->Release();
-		delete pFrame;
-		pFrame = NULL;
-
-		free(pMox);
-		pThisMoxElement = pThisMoxElement->pNext;
-	}
-
-	m_ListMox.Release();
+	m_ResCache.Release();
 	return true;
 }
 
-bool A3DMoxMan::FindMoxFile(char * szFilename, A3DFrame ** ppFrame)
+void A3DMoxMan::FreeFrame(LPVOID pRes, LPVOID pArg)
 {
-	ALISTELEMENT * pThisMoxElement = m_ListMox.GetFirst();
-
-	while( pThisMoxElement != m_ListMox.GetTail() )
-	{
-		MOXRECORD * pMox = (MOXRECORD *) pThisMoxElement->pData;
-		if( 0 == _stricmp(szFilename, pMox->szFilename) )
-		{
-			*ppFrame = pMox->pFrame;
-			return true;
-		}
-		pThisMoxElement = pThisMoxElement->pNext;
-	}
-	return true;
+	A3DFrame * pFrame = (A3DFrame *) pRes;
+	pFrame->Release();
+	delete pFrame;
 }
 
 bool A3DMoxMan::LoadMoxFile(char * szFilename, A3DFrame **ppFrame)
 {
-	A3DFrame * pOrgFrame = NULL;
+	A3DRESHANDLE hRes;
 	*ppFrame = NULL;
 
-	if( !FindMoxFile(szFilename, &pOrgFrame) )
-		return false;
-
+	// A name which has never been interned can not have been loaded;
+	A3DFrame * pOrgFrame = (A3DFrame *) m_ResCache.AcquireRes(AFileAtom_Find(szFilename), &hRes);
 	if( pOrgFrame )
-		return DuplicateFrame(pOrgFrame, ppFrame);
+		return DuplicateFrameOfRes(pOrgFrame, hRes, ppFrame);
+
+	DWORD dwLoadStart = timeGetTime();
 	
 	//Now open the file;
 	AFileImage aFile;
@@ -93,6 +68,9 @@ bool A3DMoxMan::LoadMoxFile(char * szFilename, A3DFrame **ppFrame)
 		aFile.Close();
 		return false;
 	}
+
+	// The size of the file is taken as the size of the frame;
+	DWORD dwSize = aFile.GetFileLength();
 	aFile.Close();
 
 	pNewFrame->SetName(szFilename);
@@ -106,72 +84,150 @@ bool A3DMoxMan::LoadMoxFile(char * szFilename, A3DFrame **ppFrame)
 	if( m_pA3DDevice->GetA3DEngine()->GetUseOBBFlag() && !pNewFrame->BuildAutoOBB() )
 		return false;
 
-	MOXRECORD * pNewMox = (MOXRECORD *) malloc(sizeof(MOXRECORD));
-	if( NULL == pNewMox ) 
+	hRes = m_ResCache.AddRes(AFileAtom_Get(szFilename), pNewFrame, dwSize, timeGetTime() - dwLoadStart);
+	if( A3DRESHANDLE_NULL == hRes )
 	{
 		g_pA3DErrLog->ErrLog("A3DMoxMan::LoadMoxFile Not enough Memory!");
-		if( pNewFrame )
-		{
-			pNewFrame->Release();
-			delete pNewFrame;
-		}
+		FreeFrame(pNewFrame, this);
 		return false;
 	}
-	strncpy(pNewMox->szFilename, szFilename, MAX_PATH);//AGetFileTitle(szFilename, pNewMox->szFilename, MAX_PATH);
-	pNewMox->pFrame = pNewFrame;
-	
-	if( !m_ListMox.Append((LPVOID)pNewMox) )
-		return false;
+	pNewFrame->SetMoxRes(hRes);
 
-	return DuplicateFrame(pNewFrame, ppFrame);
+	return DuplicateFrameOfRes(pNewFrame, hRes, ppFrame);
 }
 
 bool A3DMoxMan::Reset()
 {
-	ALISTELEMENT * pThisMoxElement = m_ListMox.GetFirst();
-
-	while( pThisMoxElement != m_ListMox.GetTail() )
-	{
-		MOXRECORD * pMox = (MOXRECORD *) pThisMoxElement->pData;
-		
-		A3DFrame * pFrame = pMox->pFrame;
-		pFrame->Release();
-		delete pFrame;
-		pFrame = NULL;
-
-		free(pMox);
-		pThisMoxElement = pThisMoxElement->pNext;
-	}
-
-	m_ListMox.Reset();
-
-	return true;
+	// The mox files which are not used by any frame are kept warm in the budget, so the
+	// next scene need not load them again;
+	return m_ResCache.Reset();
 }
 
 bool A3DMoxMan::ReleaseFrame(A3DFrame *& pFrame)
 {
+	A3DRESHANDLE hRes = pFrame->GetMoxRes();
+
 	pFrame->Release();
 	delete pFrame;
 
+	// The handle is not valid if the frame does not come from here;
+	m_ResCache.ReleaseRes(hRes);
+
 	pFrame = NULL;
 	return true;
 }
 
 bool A3DMoxMan::DuplicateFrame(A3DFrame * pOrgFrame, A3DFrame ** ppNewFrame)
+{
+	// The new frame shares the meshes of the mox file as the original one does;
+	A3DRESHANDLE hRes = pOrgFrame->GetMoxRes();
+	if( !m_ResCache.AddRef(hRes) )
+		hRes = A3DRESHANDLE_NULL;
+
+	return DuplicateFrameOfRes(pOrgFrame, hRes, ppNewFrame);
+}
+
+bool A3DMoxMan::DuplicateFrameOfRes(A3DFrame * pOrgFrame, A3DRESHANDLE hRes, A3DFrame ** ppNewFrame)
 {
 	A3DFrame * pNewFrame = new A3DFrame();
 	if( NULL == pNewFrame )
 	{
 		g_pA3DErrLog->ErrLog("A3DMoxMan::DuplicateFrame() Not enough memory!");
+		m_ResCache.ReleaseRes(hRes);
 		return false;
 	}
 
 	if( !pNewFrame->Duplicate(m_pA3DDevice, pOrgFrame) )
 	{
 		g_pA3DErrLog->ErrLog("A3DMoxMan::DuplicateFrame(), Duplicate child frame fail!");
+		m_ResCache.ReleaseRes(hRes);
 		return false;
 	}
 
+	pNewFrame->SetMoxRes(hRes);
 	*ppNewFrame = pNewFrame;
 	return true;
-}
\ No newline at end of file
+}
+
+bool A3DMoxMan::VerifyCompiledMox(A3DFrame * pSrcFrame, char * szDestFile)
+{
+	AFile binFile;
+	if( !binFile.Open(szDestFile, AFILE_OPENEXIST) )
+		return false;
+
+	A3DFrame * pFrame = new A3DFrame();
+	if( NULL == pFrame )
+	{
+		binFile.Close();
+		return false;
+	}
+
+	// Compare the frame tree and the meshes of the two loads themselves;
+	bool bSame = pFrame->Load(m_pA3DDevice, &binFile) && pSrcFrame->Match(pFrame);
+	binFile.Close();
+
+	pFrame->Release();
+	delete pFrame;
+	return bSame;
+}
+
+bool A3DMoxMan::CompileMoxFile(char * szFilename, char * szDestFolder)
+{
+	// Meshes loaded in pure server mode keep no vertex data, so nothing can be saved;
+	if( g_pA3DConfig->GetRunEnv() == A3DRUNENV_PURESERVER )
+	{
+		g_pA3DErrLog->ErrLog("A3DMoxMan::CompileMoxFile(), Can not compile mox file in pure server mode!");
+		return false;
+	}
+
+	AFileImage aFile;
+	if( !aFile.Open(m_szFolderName, szFilename, AFILE_OPENEXIST) )
+	{
+		g_pA3DErrLog->ErrLog("A3DMoxMan::CompileMoxFile [%s] can not be found!", szFilename);
+		return false;
+	}
+
+	A3DFrame * pFrame = new A3DFrame();
+	if( NULL == pFrame )
+	{
+		g_pA3DErrLog->ErrLog("A3DMoxMan::CompileMoxFile Not enough memory!");
+		aFile.Close();
+		return false;
+	}
+	if( !pFrame->Load(m_pA3DDevice, &aFile) )
+	{
+		g_pA3DErrLog->ErrLog("A3DMoxMan::CompileMoxFile() File [%s] parsed error!", szFilename);
+		pFrame->Release();
+		delete pFrame;
+		aFile.Close();
+		return false;
+	}
+	aFile.Close();
+
+	char szDestFile[MAX_PATH];
+	sprintf(szDestFile, "%s\\%s", szDestFolder, szFilename);
+
+	AFile destFile;
+	if( !AFileMod_CreateFilePath(szDestFile) || !destFile.Open(szDestFile, AFILE_CREATENEW | AFILE_BINARY) )
+	{
+		g_pA3DErrLog->ErrLog("A3DMoxMan::CompileMoxFile() Can not create file [%s]!", szDestFile);
+		pFrame->Release();
+		delete pFrame;
+		return false;
+	}
+
+	bool bCompiled = pFrame->Save(&destFile);
+	destFile.Close();
+
+	if( !bCompiled )
+		g_pA3DErrLog->ErrLog("A3DMoxMan::CompileMoxFile() Save [%s] fail!", szDestFile);
+	else if( !VerifyCompiledMox(pFrame, szDestFile) )
+	{
+		g_pA3DErrLog->ErrLog("A3DMoxMan::CompileMoxFile() [%s] does not load the same as [%s]!", szDestFile, szFilename);
+		bCompiled = false;
+	}
+
+	pFrame->Release();
+	delete pFrame;
+	return bCompiled;
+}
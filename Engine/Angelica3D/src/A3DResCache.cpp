@@ -0,0 +1,277 @@
+/*
+ * FILE: A3DResCache.cpp
+ *
+ * DESCRIPTION: A reference counted cache of the resources loaded from files, it is the
+ *				common part of the texture, model, mox and surface managers;
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "A3DResCache.h"
+#include "A3DErrLog.h"
+
+A3DResCache::A3DResCache() : m_KeyTab(256), m_ResTab(256)
+{
+	m_pfnFree	= NULL;
+	m_pFreeArg	= NULL;
+
+	m_pLRUHead	= NULL;
+	m_pLRUTail	= NULL;
+
+	m_dwBudget	= 0;
+	ZeroMemory(&m_stats, sizeof(m_stats));
+}
+
+A3DResCache::~A3DResCache()
+{
+}
+
+bool A3DResCache::Init(DWORD dwBudget, A3DRESCACHE_FREEFUNC pfnFree, LPVOID pFreeArg)
+{
+	m_dwBudget	= dwBudget;
+	m_pfnFree	= pfnFree;
+	m_pFreeArg	= pFreeArg;
+
+	return m_ListNode.Init(256);
+}
+
+bool A3DResCache::Release()
+{
+	// The free function may free other nodes, so always take the last one again;
+	while( m_ListNode.GetSize() > 0 )
+		FreeNode((A3DRESCACHE_NODE *) m_ListNode.GetAt(m_ListNode.GetSize() - 1));
+
+	m_KeyTab.clear();
+	m_ResTab.clear();
+	m_ListNode.Release();
+
+	m_pLRUHead = m_pLRUTail = NULL;
+	m_stats.dwResidentBytes = 0;
+	m_stats.nNumRes = 0;
+	m_stats.nNumReferenced = 0;
+	return true;
+}
+
+bool A3DResCache::Reset()
+{
+	Trim();
+	return true;
+}
+
+void A3DResCache::AddToLRU(A3DRESCACHE_NODE * pNode)
+{
+	pNode->pPrevLRU = m_pLRUTail;
+	pNode->pNextLRU = NULL;
+	if( m_pLRUTail )
+		m_pLRUTail->pNextLRU = pNode;
+	else
+		m_pLRUHead = pNode;
+	m_pLRUTail = pNode;
+}
+
+void A3DResCache::RemoveFromLRU(A3DRESCACHE_NODE * pNode)
+{
+	if( pNode->pPrevLRU )
+		pNode->pPrevLRU->pNextLRU = pNode->pNextLRU;
+	else
+		m_pLRUHead = pNode->pNextLRU;
+
+	if( pNode->pNextLRU )
+		pNode->pNextLRU->pPrevLRU = pNode->pPrevLRU;
+	else
+		m_pLRUTail = pNode->pPrevLRU;
+
+	pNode->pPrevLRU = NULL;
+	pNode->pNextLRU = NULL;
+}
+
+void A3DResCache::FreeNode(A3DRESCACHE_NODE * pNode)
+{
+	// Take the node out of the cache before the resource is freed, for the free function
+	// may call back into the cache;
+	if( pNode->nRefCount > 0 )
+		m_stats.nNumReferenced --;
+	else
+		RemoveFromLRU(pNode);
+
+	// A newer node may have been added with the same key;
+	abase::pair<A3DRESCACHE_NODE **, bool> result = m_KeyTab.get(pNode->key);
+	if( result.second && *result.first == pNode )
+		m_KeyTab.erase(pNode->key);
+
+	m_ResTab.erase(pNode->pRes);
+	m_ListNode.Delete(pNode->hRes);
+
+	m_stats.dwResidentBytes -= pNode->dwSize;
+	m_stats.nNumRes --;
+
+	if( m_pfnFree )
+		(*m_pfnFree)(pNode->pRes, m_pFreeArg);
+
+	delete pNode;
+}
+
+void A3DResCache::Trim()
+{
+	while( m_pLRUHead && m_stats.dwResidentBytes > m_dwBudget )
+	{
+		m_stats.dwEvictions ++;
+		FreeNode(m_pLRUHead);
+	}
+}
+
+LPVOID A3DResCache::AcquireRes(AFILEATOM atom, A3DRESHANDLE * phRes)
+{
+	A3DRESKEY key;
+	ZeroMemory(&key, sizeof(key));
+	key.atom = atom;
+	return AcquireRes(key, phRes);
+}
+
+LPVOID A3DResCache::AcquireRes(const A3DRESKEY& key, A3DRESHANDLE * phRes)
+{
+	abase::pair<A3DRESCACHE_NODE **, bool> result(NULL, false);
+	if( AFILEATOM_NULL != key.atom )
+		result = m_KeyTab.get(key);
+
+	if( !result.second )
+	{
+		m_stats.dwMisses ++;
+		if( phRes )
+			*phRes = A3DRESHANDLE_NULL;
+		return NULL;
+	}
+
+	A3DRESCACHE_NODE * pNode = *result.first;
+	if( 0 == pNode->nRefCount ++ )
+	{
+		RemoveFromLRU(pNode);
+		m_stats.nNumReferenced ++;
+	}
+
+	m_stats.dwHits ++;
+	if( phRes )
+		*phRes = pNode->hRes;
+	return pNode->pRes;
+}
+
+A3DRESHANDLE A3DResCache::AddRes(AFILEATOM atom, LPVOID pRes, DWORD dwSize, DWORD dwLoadTime)
+{
+	A3DRESKEY key;
+	ZeroMemory(&key, sizeof(key));
+	key.atom = atom;
+	return AddRes(key, pRes, dwSize, dwLoadTime);
+}
+
+A3DRESHANDLE A3DResCache::AddRes(const A3DRESKEY& key, LPVOID pRes, DWORD dwSize, DWORD dwLoadTime)
+{
+	A3DRESCACHE_NODE * pNode = new A3DRESCACHE_NODE;
+	if( NULL == pNode )
+	{
+		g_pA3DErrLog->ErrLog("A3DResCache::AddRes(), Not enough memory!");
+		return A3DRESHANDLE_NULL;
+	}
+
+	ZeroMemory(pNode, sizeof(A3DRESCACHE_NODE));
+	pNode->key			= key;
+	pNode->pRes			= pRes;
+	pNode->dwSize		= dwSize;
+	pNode->nRefCount	= 1;
+
+	if( !m_ListNode.Append(pNode, &pNode->hRes) )
+	{
+		delete pNode;
+		return A3DRESHANDLE_NULL;
+	}
+
+	if( AFILEATOM_NULL != key.atom )
+		m_KeyTab.put(key, pNode);
+	m_ResTab.put(pRes, pNode);
+
+	m_stats.dwLoadTime += dwLoadTime;
+	m_stats.dwResidentBytes += dwSize;
+	m_stats.nNumRes ++;
+	m_stats.nNumReferenced ++;
+
+	// Make room for the new one;
+	A3DRESHANDLE hRes = pNode->hRes;
+	Trim();
+	return hRes;
+}
+
+bool A3DResCache::AddRef(A3DRESHANDLE hRes)
+{
+	A3DRESCACHE_NODE * pNode = GetNode(hRes);
+	if( NULL == pNode )
+		return false;
+
+	if( 0 == pNode->nRefCount ++ )
+	{
+		RemoveFromLRU(pNode);
+		m_stats.nNumReferenced ++;
+	}
+	return true;
+}
+
+bool A3DResCache::ReleaseRes(A3DRESHANDLE hRes)
+{
+	A3DRESCACHE_NODE * pNode = GetNode(hRes);
+	if( NULL == pNode || pNode->nRefCount <= 0 )
+		return false;
+
+	if( 0 == -- pNode->nRefCount )
+	{
+		// Keep it as the most recently used one;
+		m_stats.nNumReferenced --;
+		AddToLRU(pNode);
+		Trim();
+	}
+	return true;
+}
+
+bool A3DResCache::FreeRes(A3DRESHANDLE hRes)
+{
+	A3DRESCACHE_NODE * pNode = GetNode(hRes);
+	if( NULL == pNode )
+		return false;
+
+	FreeNode(pNode);
+	return true;
+}
+
+A3DRESHANDLE A3DResCache::FindHandle(LPVOID pRes)
+{
+	abase::pair<A3DRESCACHE_NODE **, bool> result = m_ResTab.get(pRes);
+	if( !result.second )
+		return A3DRESHANDLE_NULL;
+
+	return (*result.first)->hRes;
+}
+
+LPVOID A3DResCache::GetRes(A3DRESHANDLE hRes)
+{
+	A3DRESCACHE_NODE * pNode = GetNode(hRes);
+	return pNode ? pNode->pRes : NULL;
+}
+
+int A3DResCache::GetRefCount(A3DRESHANDLE hRes)
+{
+	A3DRESCACHE_NODE * pNode = GetNode(hRes);
+	return pNode ? pNode->nRefCount : 0;
+}
+
+void A3DResCache::Flush()
+{
+	while( m_pLRUHead )
+		FreeNode(m_pLRUHead);
+}
+
+void A3DResCache::SetBudget(DWORD dwBudget)
+{
+	m_dwBudget = dwBudget;
+	Trim();
+}
@@ -15,21 +15,48 @@ bool A3DSurfaceMan::Init(A3DDevice * pA3DDevice)
 {	
 	strcpy(m_szFolderName, "Surfaces");
 	m_pA3DDevice = pA3DDevice;
-	return true;
+	return m_ResCache.Init(A3DSURFACEMAN_CACHEBUDGET, FreeSurface, this);
 }
 
 bool A3DSurfaceMan::Release()
 {
+	m_ResCache.Release();
 	return true;
 }
 
 bool A3DSurfaceMan::Reset()
 {
-	return true;
+	// The surfaces which are not used any more are kept warm in the budget;
+	return m_ResCache.Reset();
+}
+
+void A3DSurfaceMan::FreeSurface(LPVOID pRes, LPVOID pArg)
+{
+	A3DSurface * pSurface = (A3DSurface *) pRes;
+	pSurface->Release();
+	delete pSurface;
+}
+
+void A3DSurfaceMan::MakeSurfaceKey(A3DRESKEY * pKey, AFILEATOM atom, int nWidth, int nHeight, A3DCOLOR colorKey, bool bCursor)
+{
+	pKey->atom			= atom;
+	pKey->aParams[0]	= nWidth;
+	pKey->aParams[1]	= nHeight;
+	pKey->aParams[2]	= colorKey;
+	pKey->aParams[3]	= bCursor ? 1 : 0;
 }
 
 bool A3DSurfaceMan::LoadCursorSurfaceFromFile(int nWidth, int nHeight, char * szFileName, A3DCOLOR colorKey, A3DSurface ** ppSurface)
 {
+	A3DRESKEY key;
+	MakeSurfaceKey(&key, AFileAtom_Find(szFileName), nWidth, nHeight, colorKey, true);
+
+	// A file name which has never been interned can not have been loaded;
+	*ppSurface = (A3DSurface *) m_ResCache.AcquireRes(key);
+	if( *ppSurface )
+		return true;
+
+	DWORD dwLoadStart = timeGetTime();
 	IDirect3DSurface8 * pDXSurface = NULL;
 
 	if( g_pA3DConfig->GetRunEnv() == A3DRUNENV_PURESERVER )
@@ -90,12 +117,30 @@ bool A3DSurfaceMan::LoadCursorSurfaceFromFile(int nWidth, int nHeight, char * sz
 		return false;
 	}
 
+	// A cursor surface has 4 bytes a pixel;
+	key.atom = AFileAtom_Get(szFileName);
+	if( A3DRESHANDLE_NULL == m_ResCache.AddRes(key, pA3DSurface, nWidth * nHeight * 4, timeGetTime() - dwLoadStart) )
+	{
+		g_pA3DErrLog->ErrLog("A3DSurfaceMan::LoadCursorSurfaceFromFile Not enough memory!");
+		FreeSurface(pA3DSurface, this);
+		return false;
+	}
+
 	*ppSurface = pA3DSurface;
 	return true;
 }
 
 bool A3DSurfaceMan::LoadSurfaceFromFile(int nWidth, int nHeight, char * szFileName, A3DCOLOR colorKey, A3DSurface ** ppSurface)
 {
+	A3DRESKEY key;
+	MakeSurfaceKey(&key, AFileAtom_Find(szFileName), nWidth, nHeight, colorKey, false);
+
+	// A file name which has never been interned can not have been loaded;
+	*ppSurface = (A3DSurface *) m_ResCache.AcquireRes(key);
+	if( *ppSurface )
+		return true;
+
+	DWORD dwLoadStart = timeGetTime();
 	IDirect3DSurface8 * pDXSurface = NULL;
 
 	if( g_pA3DConfig->GetRunEnv() == A3DRUNENV_PURESERVER )
@@ -176,14 +221,27 @@ bool A3DSurfaceMan::LoadSurfaceFromFile(int nWidth, int nHeight, char * szFileNa
 		return false;
 	}
 
+	// A surface has 4 bytes a pixel at most;
+	key.atom = AFileAtom_Get(szFileName);
+	if( A3DRESHANDLE_NULL == m_ResCache.AddRes(key, pA3DSurface, nWidth * nHeight * 4, timeGetTime() - dwLoadStart) )
+	{
+		g_pA3DErrLog->ErrLog("A3DSurfaceMan::LoadSurfaceFromFile Not enough memory!");
+		FreeSurface(pA3DSurface, this);
+		return false;
+	}
+
 	*ppSurface = pA3DSurface;
 	return true;
 }
 
 bool A3DSurfaceMan::ReleaseSurface(PA3DSurface& pSurface)
 {
-	pSurface->Release();
-	delete pSurface;
+	// The surface is kept in the cache after the last reference is released;
+	if( !m_ResCache.ReleaseRes(m_ResCache.FindHandle(pSurface)) )
+	{
+		pSurface->Release();
+		delete pSurface;
+	}
 
 	pSurface = NULL;
 	return true;
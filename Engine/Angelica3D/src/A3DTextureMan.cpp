@@ -4,6 +4,7 @@
 #include "A3DEngine.h"
 #include "A3DShaderMan.h"
 #include "A3DGDI.h"
+#include "vector.h"
 
 A3DTextureMan::A3DTextureMan()
 {
@@ -17,70 +18,54 @@ A3DTextureMan::~A3DTextureMan()
 bool A3DTextureMan::Init(A3DDevice * pDevice)
 {
 	m_pA3DDevice = pDevice;
-	m_ListTexture.Init();
-	return true;
+	return m_ResCache.Init(A3DTEXTUREMAN_CACHEBUDGET, FreeTexture, this);
 }
 
 bool A3DTextureMan::Release()
 {
-	ALISTELEMENT * pThisTextureElement = m_ListTexture.GetFirst();
-
-	// We should release shader texture first, or it will cause access violation
-	while( pThisTextureElement != m_ListTexture.GetTail() )
+	// We should release shader texture first, or it will cause access violation;
+	// A shader releases its stage textures, which may free some textures, so we collect
+	// the handles before any one is freed;
+	abase::vector<A3DRESHANDLE> aShaders;
+	for(int i=0; i<m_ResCache.GetResCount(); i++)
 	{
-		TEXTURERECORD * pTextureRecord = (TEXTURERECORD *) pThisTextureElement->pData;
-		
-		A3DTexture * pA3DTexture = pTextureRecord->pA3DTexture;
-
-		if( pA3DTexture && pA3DTexture->IsShaderTexture() )
-		{
-			pA3DTexture->Release();
-			delete pA3DTexture;
-			pA3DTexture = NULL;
-			pTextureRecord->pA3DTexture = NULL;
-		}
-
-		pThisTextureElement = pThisTextureElement->pNext;
+		A3DTexture * pA3DTexture = (A3DTexture *) m_ResCache.GetResAt(i);
+		if( pA3DTexture->IsShaderTexture() )
+			aShaders.push_back(m_ResCache.GetHandleAt(i));
 	}
 
-	while( pThisTextureElement != m_ListTexture.GetTail() )
-	{
-		TEXTURERECORD * pTextureRecord = (TEXTURERECORD *) pThisTextureElement->pData;
-		
-		A3DTexture * pA3DTexture = pTextureRecord->pA3DTexture;
-
-		if( pA3DTexture )
-		{
-			pA3DTexture->Release();
-			delete pA3DTexture;
-			pA3DTexture = NULL;
-		}
-
-		free(pTextureRecord);
-		pThisTextureElement = pThisTextureElement->pNext;
-	}
+	for(size_t n=0; n<aShaders.size(); n++)
+		m_ResCache.FreeRes(aShaders[n]);
 
-	m_ListTexture.Release();
+	m_ResCache.Release();
 	return true;
 }
 
-bool A3DTextureMan::FindTexture(char * szFilename, A3DTexture ** ppA3DTexture)
+void A3DTextureMan::FreeTexture(LPVOID pRes, LPVOID pArg)
 {
-	ALISTELEMENT * pThisTextureElement = m_ListTexture.GetFirst();
+	A3DTexture * pA3DTexture = (A3DTexture *) pRes;
+	pA3DTexture->Release();
+	delete pA3DTexture;
+}
 
-	while( pThisTextureElement != m_ListTexture.GetTail() )
-	{
-		TEXTURERECORD * pTextureRecord = (TEXTURERECORD *) pThisTextureElement->pData;
+DWORD A3DTextureMan::GetTextureSize(A3DTexture * pTexture)
+{
+	DWORD dwSize = sizeof(A3DTexture);
 
-		if( 0 == _stricmp(szFilename, pTextureRecord->szFilename) )
+	// Shader textures and textures in pure server mode have no surface;
+	IDirect3DTexture8 * pDXTexture = pTexture->GetD3DTexture();
+	if( pDXTexture )
+	{
+		D3DSURFACE_DESC desc;
+		DWORD dwLevels = pDXTexture->GetLevelCount();
+		for(DWORD i=0; i<dwLevels; i++)
 		{
-			pTextureRecord->nRefCount ++;
-			*ppA3DTexture = pTextureRecord->pA3DTexture;
+			if( D3D_OK == pDXTexture->GetLevelDesc(i, &desc) )
+				dwSize += desc.Size;
 		}
-
-		pThisTextureElement = pThisTextureElement->pNext;
 	}
-	return true;
+
+	return dwSize;
 }
 
 bool A3DTextureMan::LoadTextureFromFileInFolder(char * pszFilename, char * szFolder, A3DTexture ** ppA3DTexture, DWORD dwTextureFlags, int nMipLevel)
@@ -98,14 +83,14 @@ bool A3DTextureMan::LoadTextureFromFile(char * pszFilename, A3DTexture ** ppA3DT
 		return true;
 
 	A3DTexture * pNewA3DTexture;
-	*ppA3DTexture = NULL;
 
-	if( !FindTexture(pszFilename, ppA3DTexture) )
-		return false;
-	
+	// A name which has never been interned can not have been loaded;
+	*ppA3DTexture = (A3DTexture *) m_ResCache.AcquireRes(AFileAtom_Find(pszFilename));
 	if( *ppA3DTexture )
 		return true;
 
+	DWORD dwLoadStart = timeGetTime();
+
 	char  szNameLwr[MAX_PATH];
 	char  *pChar;
 	strncpy(szNameLwr, pszFilename, MAX_PATH);
@@ -148,18 +133,12 @@ bool A3DTextureMan::LoadTextureFromFile(char * pszFilename, A3DTexture ** ppA3DT
 	}
 
 RECORD:
-	TEXTURERECORD * pNewTextureRecord = (TEXTURERECORD *) malloc(sizeof(TEXTURERECORD));
-	if( NULL == pNewTextureRecord ) 
+	if( A3DRESHANDLE_NULL == m_ResCache.AddRes(AFileAtom_Get(pszFilename), pNewA3DTexture, GetTextureSize(pNewA3DTexture), timeGetTime() - dwLoadStart) )
 	{
 		g_pA3DErrLog->ErrLog("A3DTextureMan::LoadTextureFile Not enough Memory!");
+		FreeTexture(pNewA3DTexture, this);
 		return false;
 	}
-	strncpy(pNewTextureRecord->szFilename, pszFilename, MAX_PATH);
-	pNewTextureRecord->pA3DTexture = pNewA3DTexture;
-	pNewTextureRecord->nRefCount = 1;
-	
-	if( !m_ListTexture.Append((LPVOID)pNewTextureRecord) )
-		return false;
 
 	pNewA3DTexture->TickAnimation();
 	*ppA3DTexture = pNewA3DTexture;
@@ -168,70 +147,31 @@ RECORD:
 
 bool A3DTextureMan::ReleaseTexture(PA3DTexture& pA3DTexture)
 {
-	ALISTELEMENT * pThisTextureElement = m_ListTexture.GetFirst();
-
-	while( pThisTextureElement != m_ListTexture.GetTail() )
+	// The texture is kept in the cache after the last reference is released, so it
+	// can be used again without loading;
+	if( !m_ResCache.ReleaseRes(m_ResCache.FindHandle(pA3DTexture)) )
 	{
-		TEXTURERECORD * pTextureRecord = (TEXTURERECORD *) pThisTextureElement->pData;
-
-		if( pTextureRecord->pA3DTexture == pA3DTexture )
-		{
-			pTextureRecord->nRefCount --;
-			if( 0 == pTextureRecord->nRefCount )
-			{
-				pA3DTexture->Release();
-				delete pA3DTexture;
-				pA3DTexture = NULL;
-
-				free(pTextureRecord);
-				pTextureRecord = NULL;
-				m_ListTexture.Delete(pThisTextureElement);
-			}
-			else
-				pA3DTexture = NULL;
-			return true;
-		}
-
-		pThisTextureElement = pThisTextureElement->pNext;
+		g_pA3DErrLog->ErrLog("A3DTextureMan::ReleaseTexture(), Can not find texture [%x]", pA3DTexture);
+		return true;
 	}
 
-	g_pA3DErrLog->ErrLog("A3DTextureMan::ReleaseTexture(), Can not find texture [%x]", pA3DTexture);
+	pA3DTexture = NULL;
 	return true;
 }
 
 bool A3DTextureMan::Reset()
 {
-	ALISTELEMENT * pThisTextureElement = m_ListTexture.GetFirst();
-
-	while( pThisTextureElement != m_ListTexture.GetTail() )
-	{
-		TEXTURERECORD * pTextureRecord = (TEXTURERECORD *) pThisTextureElement->pData;
-		
-		A3DTexture * pA3DTexture = pTextureRecord->pA3DTexture;
-		pA3DTexture->Release();
-		delete pA3DTexture;
-		pA3DTexture = NULL;
-
-		free(pTextureRecord);
-		pThisTextureElement = pThisTextureElement->pNext;
-	}
-
-	m_ListTexture.Reset();
-	return true;
+	// The textures which are not used any more are kept warm in the budget, so the next
+	// scene need not load them again;
+	return m_ResCache.Reset();
 }
 
 bool A3DTextureMan::TickAnimation()
 {
-	ALISTELEMENT * pThisTextureElement = m_ListTexture.GetFirst();
-
-	while( pThisTextureElement != m_ListTexture.GetTail() )
+	for(int i=0; i<m_ResCache.GetResCount(); i++)
 	{
-		TEXTURERECORD * pTextureRecord = (TEXTURERECORD *) pThisTextureElement->pData;
-		A3DTexture * pA3DTexture = pTextureRecord->pA3DTexture;
-		
+		A3DTexture * pA3DTexture = (A3DTexture *) m_ResCache.GetResAt(i);
 		pA3DTexture->TickAnimation();
-		
-		pThisTextureElement = pThisTextureElement->pNext;
 	}
 
 	return true;
@@ -242,8 +182,6 @@ bool A3DTextureMan::PrecacheAllTexture()
 	if( !m_pA3DDevice->GetD3DDevice() )
 		return true;
 
-	ALISTELEMENT * pElement = m_ListTexture.GetFirst();
-
 	// We use a L vertex rectange to make all MIP-MAP level rendered;
 	A3DLVERTEX		verts[6];
 	verts[0] = A3DLVERTEX(A3DVECTOR3(-100.0f, -10.0f, 0.0f), 0xffffffff, 0xff000000, 0.0f, 0.0f);
@@ -266,10 +204,9 @@ bool A3DTextureMan::PrecacheAllTexture()
 	m_pA3DDevice->SetViewMatrix(IdentityMatrix());
 
 	m_pA3DDevice->GetD3DDevice()->SetVertexShader(A3DFVF_A3DLVERTEX);
-	while( pElement != m_ListTexture.GetTail() )
+	for(int i=0; i<m_ResCache.GetResCount(); i++)
 	{
-		TEXTURERECORD * pTextureRecord = (TEXTURERECORD *) pElement->pData;
-		A3DTexture * pTexture = pTextureRecord->pA3DTexture;
+		A3DTexture * pTexture = (A3DTexture *) m_ResCache.GetResAt(i);
 
 		m_pA3DDevice->BeginRender();
 
@@ -289,8 +226,6 @@ bool A3DTextureMan::PrecacheAllTexture()
 		m_pA3DDevice->EndRender();
 
 		m_pA3DDevice->Present();
-
-		pElement = pElement->pNext;
 	}
 
 	m_pA3DDevice->SetLightingEnable(true);
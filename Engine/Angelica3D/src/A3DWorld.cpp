@@ -53,6 +53,7 @@ bool A3DWorld::Init(A3DDevice * pA3DDevice, char * szWorldFile)
 
 	m_ListBuildingModels.Init();
 	m_ListObjectModels.Init();
+	m_ObjectTree.Init();
 
 	AFile theFile;
 
@@ -179,7 +180,10 @@ bool A3DWorld::Init(A3DDevice * pA3DDevice, char * szWorldFile)
 				theFile.ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
 				sscanf(szLineBuffer, "(%f, %f, %f)", &vecUp.x, &vecUp.y, &vecUp.z);
 				if( !AddBuildingModel(pBuildingModel, vecPos, vecDir, vecUp, NULL) )
+				{
+					m_pA3DDevice->GetA3DEngine()->GetA3DModelMan()->ReleaseModel(pBuildingModel);
 					return false;
+				}
 			}
 			theFile.ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
 			if( strcmp(szLineBuffer, "}") )
@@ -214,7 +218,10 @@ bool A3DWorld::Init(A3DDevice * pA3DDevice, char * szWorldFile)
 				theFile.ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
 				sscanf(szLineBuffer, "(%f, %f, %f)", &vecUp.x, &vecUp.y, &vecUp.z);
 				if( !AddObjectModel(pObjectModel, vecPos, vecDir,vecUp, NULL) )
+				{
+					m_pA3DDevice->GetA3DEngine()->GetA3DModelMan()->ReleaseModel(pObjectModel);
 					return false;
+				}
 			}
 			theFile.ReadLine(szLineBuffer, AFILE_LINEMAXLEN, &dwReadLen);
 			if( strcmp(szLineBuffer, "}") )
@@ -324,6 +331,7 @@ bool A3DWorld::Create(A3DDevice * pA3DDevice, bool bCreateTerrain, bool bCreateS
 	
 	m_ListBuildingModels.Init();
 	m_ListObjectModels.Init();
+	m_ObjectTree.Init();
 
 	if( bCreateTerrain )
 	{
@@ -375,6 +383,7 @@ bool A3DWorld::Init(A3DDevice * pA3DDevice, A3DWORLD_CONFIG& worldConfig)
 
 	m_ListBuildingModels.Init();
 	m_ListObjectModels.Init();
+	m_ObjectTree.Init();
 
 	m_pA3DTerrain = new A3DTerrain();
 	if( NULL == m_pA3DTerrain )
@@ -505,26 +514,21 @@ bool A3DWorld::Release()
 	// Release models;
 	// All Models in A3DWorld should be release by seperate class;
 	// But perhaps some models have not been released, so just release what ever is left here;
-	ALISTELEMENT * pThisBuildingModelElement = m_ListBuildingModels.GetFirst();
-	while( pThisBuildingModelElement != m_ListBuildingModels.GetTail() )
+	for(int i=0; i<m_ListBuildingModels.GetSize(); i++)
 	{
-		A3DModel * pA3DModel = (A3DModel *)pThisBuildingModelElement->pData;
+		A3DModel * pA3DModel = (A3DModel *) m_ListBuildingModels.GetAt(i);
 		
 		pA3DModel->SetContainer(A3DCONTAINER_NULL);
 		m_pA3DDevice->GetA3DEngine()->GetA3DModelMan()->ReleaseModel(pA3DModel);
-		
-		pThisBuildingModelElement = pThisBuildingModelElement->pNext;
 	}
 
-	ALISTELEMENT * pThisObjectModelElement = m_ListObjectModels.GetFirst();
-	while( pThisObjectModelElement != m_ListObjectModels.GetTail() )
+	for(int i=0; i<m_ListObjectModels.GetSize(); i++)
 	{
-		A3DModel * pA3DModel = (A3DModel *) pThisObjectModelElement->pData;
+		A3DModel * pA3DModel = (A3DModel *) m_ListObjectModels.GetAt(i);
 		
 		pA3DModel->SetContainer(A3DCONTAINER_NULL);
+		pA3DModel->SetTraceTree(NULL);
 		m_pA3DDevice->GetA3DEngine()->GetA3DModelMan()->ReleaseModel(pA3DModel);
-
-		pThisObjectModelElement = pThisObjectModelElement->pNext;
 	}
 
 	m_pA3DDevice->GetA3DEngine()->SetA3DCDS(NULL);
@@ -534,6 +538,7 @@ bool A3DWorld::Release()
 
 	m_ListBuildingModels.Release();
 	m_ListObjectModels.Release();
+	m_ObjectTree.Release();
 	return true;
 }
 
@@ -560,13 +565,11 @@ bool A3DWorld::Render(A3DViewport * pCurrentViewport)
 	m_pA3DDevice->GetA3DEngine()->SetBuildingRenderFlag(true);
 	//m_pA3DDevice->SetSpecularEnable(false);
 
-	ALISTELEMENT * pThisBuildingModelElement = m_ListBuildingModels.GetFirst();
-	while( pThisBuildingModelElement != m_ListBuildingModels.GetTail() )
+	for(int i=0; i<m_ListBuildingModels.GetSize(); i++)
 	{
-		A3DModel * pA3DModel = (A3DModel *)pThisBuildingModelElement->pData;
+		A3DModel * pA3DModel = (A3DModel *) m_ListBuildingModels.GetAt(i);
 		if( !pA3DModel->Render(pCurrentViewport) )
 			return false;
-		pThisBuildingModelElement = pThisBuildingModelElement->pNext;
 	}
 
 	m_pA3DScene->UpdateVisibleSets(pCurrentViewport);
@@ -583,10 +586,9 @@ bool A3DWorld::Render(A3DViewport * pCurrentViewport)
 	//m_pA3DDevice->SetSpecularEnable(true);
 	m_pA3DDevice->GetA3DEngine()->SetBuildingRenderFlag(false);
 
-	ALISTELEMENT * pThisObjectModelElement = m_ListObjectModels.GetFirst();
-	while( pThisObjectModelElement != m_ListObjectModels.GetTail() )
+	for(int i=0; i<m_ListObjectModels.GetSize(); i++)
 	{
-		A3DModel * pA3DModel = (A3DModel *) pThisObjectModelElement->pData;
+		A3DModel * pA3DModel = (A3DModel *) m_ListObjectModels.GetAt(i);
 
 		// For large objects, we assume it is visible
 		// we only calculate small objects' visibility by BSP PVS
@@ -594,13 +596,11 @@ bool A3DWorld::Render(A3DViewport * pCurrentViewport)
 		if( max(max(vecExt.x, vecExt.y), vecExt.z) < 50.0f )
 		{
 			if( !m_pA3DScene->IsVisiblePos(pA3DModel->GetModelAABB().Center) )
-				goto NEXT;
+				continue;
 		}
 
 		if( !pA3DModel->Render(pCurrentViewport) )
 			return false;
-NEXT:
-		pThisObjectModelElement = pThisObjectModelElement->pNext;
 	}
 
 	m_pA3DScene->Render(pCurrentViewport, A3DSCENE_RENDER_ALPHA);
@@ -619,55 +619,84 @@ bool A3DWorld::TickAnimation()
 			m_pA3DStars[i]->TickAnimation();
 	}
 
-	ALISTELEMENT * pThisBuildingModelElement = m_ListBuildingModels.GetFirst();
-	while( pThisBuildingModelElement != m_ListBuildingModels.GetTail() )
+	for(int i=0; i<m_ListBuildingModels.GetSize(); i++)
 	{
-		A3DModel * pA3DModel = (A3DModel *)pThisBuildingModelElement->pData;
+		A3DModel * pA3DModel = (A3DModel *) m_ListBuildingModels.GetAt(i);
 		if( !pA3DModel->TickAnimation() )
 			return false;
-		pThisBuildingModelElement = pThisBuildingModelElement->pNext;
 	}
 
-	ALISTELEMENT * pThisObjectModelElement = m_ListObjectModels.GetFirst();
-	while( pThisObjectModelElement != m_ListObjectModels.GetTail() )
+	for(int i=0; i<m_ListObjectModels.GetSize(); i++)
 	{
-		A3DModel * pA3DModel = (A3DModel *) pThisObjectModelElement->pData;
+		A3DModel * pA3DModel = (A3DModel *) m_ListObjectModels.GetAt(i);
 		if( !pA3DModel->TickAnimation() )
 			return false;
-		pThisObjectModelElement = pThisObjectModelElement->pNext;
 	}
 
 	return true;
 }
 
-bool A3DWorld::AddBuildingModel(A3DModel * pBuildingModel, A3DVECTOR3 vecPos, A3DVECTOR3 vecDir, A3DVECTOR3 vecUp, ALISTELEMENT ** ppElement)
+bool A3DWorld::AddBuildingModel(A3DModel * pBuildingModel, A3DVECTOR3 vecPos, A3DVECTOR3 vecDir, A3DVECTOR3 vecUp, ASLOTHANDLE * phSlot)
 {
 	assert(pBuildingModel->GetContainer() == A3DCONTAINER_NULL);
 	pBuildingModel->SetContainer(A3DCONTAINER_WORLD_BUILDINGLIST);
 
-	m_ListBuildingModels.Append((LPVOID) pBuildingModel, ppElement);
+	ASLOTHANDLE hSlot = ASLOTHANDLE_NULL;
+	if( !m_ListBuildingModels.Append((LPVOID) pBuildingModel, &hSlot) )
+	{
+		g_pA3DErrLog->ErrLog("A3DWorld::AddBuildingModel(), Can not append the model!");
+		pBuildingModel->SetContainer(A3DCONTAINER_NULL);
+		return false;
+	}
+
+	pBuildingModel->SetContainerSlot(hSlot);
+	if( phSlot )
+		*phSlot = hSlot;
 
 	pBuildingModel->SetPos(vecPos);
 	pBuildingModel->SetDirAndUp(vecDir, vecUp);
 	return true;
 }
 
-bool A3DWorld::AddObjectModel(A3DModel * pObjectModel, A3DVECTOR3 vecPos, A3DVECTOR3 vecDir, A3DVECTOR3 vecUp, ALISTELEMENT ** ppElement)
+bool A3DWorld::AddObjectModel(A3DModel * pObjectModel, A3DVECTOR3 vecPos, A3DVECTOR3 vecDir, A3DVECTOR3 vecUp, ASLOTHANDLE * phSlot)
 {
 	assert(pObjectModel->GetContainer() == A3DCONTAINER_NULL);
 	pObjectModel->SetContainer(A3DCONTAINER_WORLD_OBJECTLIST);
 
-	m_ListObjectModels.Append((LPVOID) pObjectModel, ppElement);
+	ASLOTHANDLE hSlot = ASLOTHANDLE_NULL;
+	if( !m_ListObjectModels.Append((LPVOID) pObjectModel, &hSlot) )
+	{
+		g_pA3DErrLog->ErrLog("A3DWorld::AddObjectModel(), Can not append the model!");
+		pObjectModel->SetContainer(A3DCONTAINER_NULL);
+		return false;
+	}
+
+	// The traces only test the models in the object tree, so a model which is not in it
+	// must not be in the world either;
+	if( !pObjectModel->SetTraceTree(&m_ObjectTree) )
+	{
+		g_pA3DErrLog->ErrLog("A3DWorld::AddObjectModel(), Can not add the model into the object tree!");
+		m_ListObjectModels.Delete(hSlot);
+		pObjectModel->SetContainer(A3DCONTAINER_NULL);
+		return false;
+	}
+
+	pObjectModel->SetContainerSlot(hSlot);
+	if( phSlot )
+		*phSlot = hSlot;
 
 	pObjectModel->SetPos(vecPos);
 	pObjectModel->SetDirAndUp(vecDir, vecUp);
 	return true;
 }
 
-bool A3DWorld::DeleteObjectModel(ALISTELEMENT * pElement)
+bool A3DWorld::DeleteObjectModel(ASLOTHANDLE hSlot)
 {
-	//We just remove the object from the world's list;
-	return m_ListObjectModels.Delete(pElement);
+	A3DModel * pModel = (A3DModel *) m_ListObjectModels.GetData(hSlot);
+	if( NULL == pModel )
+		return false;
+
+	return DeleteObjectModel(pModel);
 }
 
 bool A3DWorld::GetFirstCollision(A3DModel * pModel, A3DVECTOR3 vecDelta, A3DWORLD_COLLISION * pCollision)
@@ -684,14 +713,15 @@ bool A3DWorld::GetFirstCollision(A3DModel * pModel, A3DVECTOR3 vecDelta, A3DWORL
 	aabbSource.Maxs = aabbSource.Maxs + vecDelta;
 	CompleteAABB(&aabbSource);
 
-	ALISTELEMENT * pObjectElement = m_ListObjectModels.GetFirst();
-	while( pObjectElement != m_ListObjectModels.GetTail() )
+	m_aTraceModels.clear();
+	m_ObjectTree.QueryAABB(aabbSource.Mins, aabbSource.Maxs, m_aTraceModels);
+	for(int i=0; i<(int)m_aTraceModels.size(); i++)
 	{
-		A3DModel * pTargetModel = (A3DModel *) pObjectElement->pData;
+		A3DModel * pTargetModel = (A3DModel *) m_aTraceModels[i];
 
 		//Do not collide with my self;
 		if( pTargetModel == pModel )
-			goto NEXT;
+			continue;
 
 		aabbTarget = pTargetModel->GetModelAABB();
 		
@@ -715,9 +745,6 @@ bool A3DWorld::GetFirstCollision(A3DModel * pModel, A3DVECTOR3 vecDelta, A3DWORL
 				bClipped = true;
 			}
 		}
-
-NEXT:
-		pObjectElement = pObjectElement->pNext;
 	}
 
 	return bClipped;
@@ -807,16 +834,18 @@ bool A3DWorld::RayTrace(A3DVECTOR3& vecStart, A3DVECTOR3& vecVelocity, FLOAT vTi
 	}
 
 	//Last test if the ray intersect with objects;
-	//Maybe we can add this check into class A3DTerrain, and check only the cell's contained;
-	ALISTELEMENT * pObjectElement = m_ListObjectModels.GetFirst();
-	while( pObjectElement != m_ListObjectModels.GetTail() )
+	//Only the objects which the object tree finds near the ray are tested;
+	A3DVECTOR3 vecDelta = vecVelocity * vTime;
+	m_aTraceModels.clear();
+	m_ObjectTree.QueryRay(vecStart, vecDelta, m_aTraceModels);
+	for(int i=0; i<(int)m_aTraceModels.size(); i++)
 	{
-		A3DModel * pModel = (A3DModel *)pObjectElement->pData;
+		A3DModel * pModel = (A3DModel *) m_aTraceModels[i];
 
 		if( pModelMe == pModel )  //It's me, Don't fire;
-			goto Next;
+			continue;
 
-		if( pModel->RayTrace(vecStart, vecVelocity * vTime, &rayTrace, m_dwModelRayTraceMask) )
+		if( pModel->RayTrace(vecStart, vecDelta, &rayTrace, m_dwModelRayTraceMask) )
 		{
 			if( rayTrace.fFraction < pRayTrace->fFraction )
 			{
@@ -824,9 +853,6 @@ bool A3DWorld::RayTrace(A3DVECTOR3& vecStart, A3DVECTOR3& vecVelocity, FLOAT vTi
 				*pRayTrace = rayTrace;
 			}
 		}
-
-Next:
- 		pObjectElement = pObjectElement->pNext;
 	}
 	
 	m_pA3DDevice->GetA3DEngine()->EndPerformanceRecord(A3DENGINE_PERFORMANCE_WORLD_RAYTRACE);
@@ -864,14 +890,19 @@ bool A3DWorld::OBBTrace(A3DVECTOR3& vecStart, A3DVECTOR3& vecVelocity, FLOAT vTi
 //	}
 
 	//Last test if the ray intersects with objects;
-	//Maybe we can add this check into class A3DTerrain, and check only the cell's contained;
-	ALISTELEMENT * pObjectElement = m_ListObjectModels.GetFirst();
-	while( pObjectElement != m_ListObjectModels.GetTail() )
+	//Only the objects which the object tree finds near the obb are tested;
+	A3DVECTOR3 vecMins, vecMaxs;
+	ClearAABB(vecMins, vecMaxs);
+	ExpandAABB(vecMins, vecMaxs, obb);
+
+	m_aTraceModels.clear();
+	m_ObjectTree.QueryAABB(vecMins, vecMaxs, m_aTraceModels);
+	for(int i=0; i<(int)m_aTraceModels.size(); i++)
 	{
-		A3DModel * pModel = (A3DModel *)pObjectElement->pData;
+		A3DModel * pModel = (A3DModel *) m_aTraceModels[i];
 
 		if( pModelMe == pModel || !pModel->GetVisibility() )  //It's me, Don't Collide;
-			goto Next;
+			continue;
 
 		if( pModel->OBBTrace(obb, obbShape, &obbTrace, m_dwModelAABBTraceMask) )
 		{
@@ -881,9 +912,6 @@ bool A3DWorld::OBBTrace(A3DVECTOR3& vecStart, A3DVECTOR3& vecVelocity, FLOAT vTi
 				*pOBBTrace = obbTrace;
 			}
 		}
-
-Next:
- 		pObjectElement = pObjectElement->pNext;
 	}
 	
 	if( pOBBTrace->fFraction < 1.0f )
@@ -933,14 +961,15 @@ bool A3DWorld::AABBTrace(A3DVECTOR3& vStart, A3DVECTOR3& vExts, A3DVECTOR3& vVel
 	}
 
 	//	Last test if the ray intersects with objects;
-	//	Maybe we can add this check into class A3DTerrain, and check only the cell's contained;
-	ALISTELEMENT * pObjectElement = m_ListObjectModels.GetFirst();
-	while (pObjectElement != m_ListObjectModels.GetTail())
+	//	Only the objects which the object tree finds in the bound of the move are tested;
+	m_aTraceModels.clear();
+	m_ObjectTree.QueryAABB(Info.BoundAABB.Mins, Info.BoundAABB.Maxs, m_aTraceModels);
+	for(int i=0; i<(int)m_aTraceModels.size(); i++)
 	{
-		A3DModel* pModel = (A3DModel*)pObjectElement->pData;
+		A3DModel * pModel = (A3DModel *) m_aTraceModels[i];
 
 		if (pModelMe == pModel/* || !pModel->GetVisibility()*/)	//	It's me, Don't Collide;
-			goto Next;
+			continue;
 
 		if (pModel->AABBTrace(&Info, &Trace, m_dwModelAABBTraceMask))
 		{
@@ -949,9 +978,6 @@ bool A3DWorld::AABBTrace(A3DVECTOR3& vStart, A3DVECTOR3& vExts, A3DVECTOR3& vVel
 			if (Trace.fFraction < pTrace->fFraction)
 				*pTrace = Trace;
 		}
-
-Next:
- 		pObjectElement = pObjectElement->pNext;
 	}
 
 	m_pA3DDevice->GetA3DEngine()->EndPerformanceRecord(A3DENGINE_PERFORMANCE_WORLD_AABBTRACE);
@@ -967,13 +993,15 @@ bool A3DWorld::DeleteObjectModel(A3DModel * pModel)
 {
 	assert(pModel->GetContainer() == A3DCONTAINER_WORLD_OBJECTLIST);
 	pModel->SetContainer(A3DCONTAINER_NULL);
+	pModel->SetTraceTree(NULL);
 
 	//We just remove the object from the world's list;
-	ALISTELEMENT * pElement = m_ListObjectModels.FindElementByData(pModel);
-	if( NULL == pElement )
-		return false;
+	ASLOTHANDLE hSlot = pModel->GetContainerSlot();
+	pModel->SetContainerSlot(ASLOTHANDLE_NULL);
+	if( m_ListObjectModels.GetData(hSlot) == pModel )
+		return m_ListObjectModels.Delete(hSlot);
 
-	return m_ListObjectModels.Delete(pElement);
+	return m_ListObjectModels.DeleteByData(pModel);
 }
 
 bool A3DWorld::DeleteBuildingModel(A3DModel * pModel)
@@ -982,11 +1010,12 @@ bool A3DWorld::DeleteBuildingModel(A3DModel * pModel)
 	pModel->SetContainer(A3DCONTAINER_NULL);
 
 	//We just remove the object from the world's list;
-	ALISTELEMENT * pElement = m_ListBuildingModels.FindElementByData(pModel);
-	if( NULL == pElement )
-		return false;
+	ASLOTHANDLE hSlot = pModel->GetContainerSlot();
+	pModel->SetContainerSlot(ASLOTHANDLE_NULL);
+	if( m_ListBuildingModels.GetData(hSlot) == pModel )
+		return m_ListBuildingModels.Delete(hSlot);
 
-	return m_ListBuildingModels.Delete(pElement);
+	return m_ListBuildingModels.DeleteByData(pModel);
 }
 
 //	szESPFile = NULL means release ESP file
@@ -58,6 +58,11 @@ const char * AFileMod_GetBaseDir()
 
 bool AFileMod_Finalize()
 {
+	AFileMod_StopTrace();
+	AFileMod_StopPrefetch();
+	AFileMod_DisableImageCache();
+	AFileMod_UnmountAll();
+
 	if( g_pAFErrLog )
 	{
 		g_pAFErrLog->Release();
@@ -140,3 +145,32 @@ bool AFileMod_GetFilePath(char * lpszFile, char * lpszPath, WORD cbBuf)
     *pszTemp = '\0';
     return true;
 }
+
+bool AFileMod_CreateFilePath(char * szFileName)
+{
+	char szPath[MAX_PATH];
+	AFileMod_GetFilePath(szFileName, szPath, MAX_PATH);
+	if( szPath[0] == '\0' )
+		return true;
+
+	// Create each folder from the root, the ones already there are just skipped;
+	for(char * pch=szPath + 1; ; pch++)
+	{
+		if( *pch != '\\' && *pch != '/' && *pch != '\0' )
+			continue;
+
+		char ch = *pch;
+		if( *(pch - 1) != ':' )
+		{
+			*pch = '\0';
+			CreateDirectory(szPath, NULL);
+			*pch = ch;
+		}
+
+		if( ch == '\0' )
+			break;
+	}
+
+	DWORD dwAttributes = GetFileAttributes(szPath);
+	return dwAttributes != INVALID_FILE_ATTRIBUTES && (dwAttributes & FILE_ATTRIBUTE_DIRECTORY);
+}
@@ -0,0 +1,27 @@
+/*
+ * FILE: AFLZ4.cpp
+ *
+ * DESCRIPTION: The LZ4 block codec used by the file package for files which should be
+ *				uncompressed as fast as possible, it calls the lz4 library in Dependency
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "AFLZ4.h"
+#include "lz4\lz4.h"
+
+int AFLZ4_Compress(const BYTE * pSrc, int nSrcLength, BYTE * pDest, int nDestCapacity)
+{
+	// lz4 returns 0 when the result does not fit, just as we do;
+	return LZ4_compress_default((const char *) pSrc, (char *) pDest, nSrcLength, nDestCapacity);
+}
+
+int AFLZ4_Uncompress(const BYTE * pSrc, int nSrcLength, BYTE * pDest, int nDestCapacity)
+{
+	int nLength = LZ4_decompress_safe((const char *) pSrc, (char *) pDest, nSrcLength, nDestCapacity);
+	return nLength < 0 ? -1 : nLength;
+}
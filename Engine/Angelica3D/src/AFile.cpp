@@ -10,6 +10,14 @@ AFile::AFile()
 	m_pFile				= NULL;
 	m_dwFlags			= 0;
 
+	m_pReadBuffer		= NULL;
+	m_dwBufferStart		= 0;
+	m_dwBufferLen		= 0;
+	m_dwBufferPtr		= 0;
+	m_bBufferEOF		= false;
+	m_pLineBuffer		= NULL;
+	m_dwLineBytes		= 0;
+
 	m_bHasOpened		= false;
 }
 
@@ -93,7 +101,19 @@ bool AFile::Open(char * szFullPath, DWORD dwFlags)
 			fseek(m_pFile, 0, SEEK_SET);
 		}
 	}
+
+	// The files only for reading are read through a large buffer, so lines and strings can
+	// be taken out of it without calling fread for each of them;
+	if( (dwFlags & AFILE_OPENEXIST) && !(dwFlags & (AFILE_CREATENEW | AFILE_OPENAPPEND | AFILE_TEXT)) )
+	{
+		m_pReadBuffer = (LPBYTE) malloc(AFILE_READBUFFERSIZE);
+		m_dwBufferStart	= (DWORD) ftell(m_pFile);
+		m_dwBufferLen	= 0;
+		m_dwBufferPtr	= 0;
+		m_bBufferEOF	= false;
+	}
 	
+	AFSTAT_INC(dwFileOpens);
 	m_bHasOpened = true;
 	return true;
 }
@@ -106,13 +126,115 @@ bool AFile::Close()
 		m_pFile = NULL;
 	}
 
+	if( m_pReadBuffer )
+	{
+		free(m_pReadBuffer);
+		m_pReadBuffer = NULL;
+	}
+
+	if( m_pLineBuffer )
+	{
+		free(m_pLineBuffer);
+		m_pLineBuffer = NULL;
+	}
+
+	// Lines are counted without a locked add for each one;
+	if( m_dwLineBytes )
+	{
+		AFSTAT_ADD(dwFileBytesRead, m_dwLineBytes);
+		m_dwLineBytes = 0;
+	}
+
 	m_bHasOpened = false;
 	return true;
 }
 
+bool AFile::FillReadBuffer()
+{
+	if( m_bBufferEOF )
+		return false;
+
+	if( m_dwBufferPtr > 0 )
+	{
+		memmove(m_pReadBuffer, m_pReadBuffer + m_dwBufferPtr, m_dwBufferLen - m_dwBufferPtr);
+		m_dwBufferStart += m_dwBufferPtr;
+		m_dwBufferLen -= m_dwBufferPtr;
+		m_dwBufferPtr = 0;
+	}
+
+	DWORD dwToRead = AFILE_READBUFFERSIZE - m_dwBufferLen;
+	if( dwToRead == 0 )
+		return false;
+
+	DWORD dwRead = fread(m_pReadBuffer + m_dwBufferLen, 1, dwToRead, m_pFile);
+	if( dwRead < dwToRead )
+		m_bBufferEOF = true;
+
+	m_dwBufferLen += dwRead;
+	return dwRead > 0;
+}
+
+DWORD AFile::LocateLine(DWORD dwMaxLength)
+{
+	if( dwMaxLength > AFILE_READBUFFERSIZE )
+		dwMaxLength = AFILE_READBUFFERSIZE;
+
+	while( true )
+	{
+		DWORD dwAvail = m_dwBufferLen - m_dwBufferPtr;
+		DWORD dwSearch = min(dwAvail, dwMaxLength);
+		LPBYTE pEnd = (LPBYTE) memchr(m_pReadBuffer + m_dwBufferPtr, '\n', dwSearch);
+		if( pEnd )
+			return (DWORD) (pEnd - (m_pReadBuffer + m_dwBufferPtr)) + 1;
+
+		if( dwAvail >= dwMaxLength || !FillReadBuffer() )
+			return dwSearch;
+	}
+}
+
 bool AFile::Read(LPVOID pBuffer, DWORD dwBufferLength, DWORD * pReadLength)
 {
-	*pReadLength = fread(pBuffer, 1, dwBufferLength, m_pFile);
+	if( !m_pReadBuffer )
+	{
+		*pReadLength = fread(pBuffer, 1, dwBufferLength, m_pFile);
+		AFSTAT_ADD(dwFileBytesRead, *pReadLength);
+		return true;
+	}
+
+	LPBYTE pDest = (LPBYTE) pBuffer;
+	DWORD dwLeft = dwBufferLength;
+
+	while( dwLeft > 0 )
+	{
+		DWORD dwAvail = m_dwBufferLen - m_dwBufferPtr;
+		if( dwAvail > 0 )
+		{
+			DWORD dwCopy = min(dwAvail, dwLeft);
+			memcpy(pDest, m_pReadBuffer + m_dwBufferPtr, dwCopy);
+			m_dwBufferPtr += dwCopy;
+			pDest += dwCopy;
+			dwLeft -= dwCopy;
+		}
+		else if( dwLeft >= AFILE_READBUFFERSIZE / 2 && !m_bBufferEOF )
+		{
+			// Large blocks are read into the destination directly, the buffer is empty
+			// and the file pointer is just after it;
+			DWORD dwRead = fread(pDest, 1, dwLeft, m_pFile);
+			m_dwBufferStart += m_dwBufferLen + dwRead;
+			m_dwBufferLen = 0;
+			m_dwBufferPtr = 0;
+			if( dwRead < dwLeft )
+				m_bBufferEOF = true;
+			pDest += dwRead;
+			dwLeft -= dwRead;
+			break;
+		}
+		else if( !FillReadBuffer() )
+			break;
+	}
+
+	*pReadLength = dwBufferLength - dwLeft;
+	AFSTAT_ADD(dwFileBytesRead, *pReadLength);
 	return true;
 }
 
@@ -124,22 +246,110 @@ bool AFile::Write(LPVOID pBuffer, DWORD dwBufferLength, DWORD * pWriteLength)
 
 bool AFile::ReadLine(char * szLineBuffer, DWORD dwBufferLength, DWORD * pdwReadLength)
 {
-	if( !fgets(szLineBuffer, dwBufferLength, m_pFile) )
-		return false;
+	DWORD dwLength;
+
+	if( m_pReadBuffer )
+	{
+		// The same as fgets, at most dwBufferLength - 1 characters including \n are taken;
+		if( dwBufferLength < 2 )
+			return false;
+
+		DWORD dwLineLength = LocateLine(dwBufferLength - 1);
+		if( dwLineLength == 0 )
+			return false;
 
-	//chop the \n\r
-	if( szLineBuffer[strlen(szLineBuffer) - 1] == '\n' || szLineBuffer[strlen(szLineBuffer) - 1] == '\r' )
-		szLineBuffer[strlen(szLineBuffer) - 1] = '\0';
+		const char * pLine = (const char *) m_pReadBuffer + m_dwBufferPtr;
+		m_dwBufferPtr += dwLineLength;
 
-	if( szLineBuffer[strlen(szLineBuffer) - 1] == '\n' || szLineBuffer[strlen(szLineBuffer) - 1] == '\r' )
-		szLineBuffer[strlen(szLineBuffer) - 1] = '\0';
+		dwLength = ChopLineEnd(pLine, dwLineLength);
+		memcpy(szLineBuffer, pLine, dwLength);
+		szLineBuffer[dwLength] = '\0';
+	}
+	else
+	{
+		if( !fgets(szLineBuffer, dwBufferLength, m_pFile) )
+			return false;
+
+		//chop the \n\r
+		dwLength = ChopLineEnd(szLineBuffer, strlen(szLineBuffer));
+		szLineBuffer[dwLength] = '\0';
+	}
+
+	*pdwReadLength = dwLength + 1;
+	m_dwLineBytes += *pdwReadLength;
+	return true;
+}
+
+bool AFile::ReadLineView(const char ** ppLine, DWORD * pdwLength)
+{
+	if( !m_pReadBuffer )
+	{
+		// Files opened for writing or in text mode have no buffer, so just read a copy;
+		if( !m_pLineBuffer )
+		{
+			m_pLineBuffer = (char *) malloc(AFILE_LINEMAXLEN);
+			if( !m_pLineBuffer )
+				return false;
+		}
+
+		DWORD dwReadLength;
+		if( !ReadLine(m_pLineBuffer, AFILE_LINEMAXLEN, &dwReadLength) )
+			return false;
+
+		*ppLine = m_pLineBuffer;
+		*pdwLength = dwReadLength - 1;
+		return true;
+	}
 
-	*pdwReadLength = strlen(szLineBuffer) + 1;
+	DWORD dwLineLength = LocateLine(AFILE_READBUFFERSIZE);
+	if( dwLineLength == 0 )
+		return false;
+
+	const char * pLine = (const char *) m_pReadBuffer + m_dwBufferPtr;
+	m_dwBufferPtr += dwLineLength;
+
+	*ppLine = pLine;
+	*pdwLength = ChopLineEnd(pLine, dwLineLength);
+	m_dwLineBytes += *pdwLength + 1;
 	return true;
 }
 
 bool AFile::ReadString(char * szLineBuffer, DWORD dwBufferLength, DWORD * pdwReadLength)
 {
+	if( m_pReadBuffer )
+	{
+		while( true )
+		{
+			const char * pStart = (const char *) m_pReadBuffer + m_dwBufferPtr;
+			DWORD dwAvail = m_dwBufferLen - m_dwBufferPtr;
+			const char * pEnd = (const char *) memchr(pStart, 0, min(dwAvail, dwBufferLength));
+			if( pEnd )
+			{
+				DWORD dwStrLen = (DWORD) (pEnd - pStart);
+				memcpy(szLineBuffer, pStart, dwStrLen + 1);
+				m_dwBufferPtr += dwStrLen + 1;
+
+				*pdwReadLength = dwStrLen + 1;
+				m_dwLineBytes += *pdwReadLength;
+				return true;
+			}
+
+			// The string is too long for the buffer, or the file ends without a '\0';
+			if( dwAvail >= dwBufferLength || !FillReadBuffer() )
+			{
+				DWORD dwSkip = min(dwAvail, dwBufferLength);
+				if( dwBufferLength > 0 )
+				{
+					DWORD dwCopy = min(dwSkip, dwBufferLength - 1);
+					memcpy(szLineBuffer, pStart, dwCopy);
+					szLineBuffer[dwCopy] = '\0';
+				}
+				m_dwBufferPtr += dwSkip;
+				return false;
+			}
+		}
+	}
+
 	char ch;
 	DWORD nStrLen = 0;
 
@@ -158,6 +368,7 @@ bool AFile::ReadString(char * szLineBuffer, DWORD dwBufferLength, DWORD * pdwRea
 	szLineBuffer[nStrLen] = '\0';
 
 	*pdwReadLength = nStrLen + 1;
+	m_dwLineBytes += *pdwReadLength;
 	return true;
 }
 
@@ -172,6 +383,9 @@ DWORD AFile::GetPos()
 {
 	DWORD dwPos;
 
+	if( m_pReadBuffer )
+		return m_dwBufferStart + m_dwBufferPtr;
+
 	dwPos = (DWORD) ftell(m_pFile);
 
 	return dwPos;
@@ -190,9 +404,45 @@ bool AFile::Seek(DWORD dwBytes, int iOrigin)
 		return false;
 	}
 
+	if( m_pReadBuffer )
+	{
+		// Seek in the buffer if we can, the file pointer is always at the end of the buffer;
+		if( iStart != SEEK_END )
+		{
+			long nTarget = (long) dwBytes;
+			if( iStart == SEEK_CUR )
+				nTarget += (long) (m_dwBufferStart + m_dwBufferPtr);
+
+			if( nTarget < 0 )
+				return false;
+
+			if( (DWORD) nTarget >= m_dwBufferStart && (DWORD) nTarget <= m_dwBufferStart + m_dwBufferLen )
+			{
+				m_dwBufferPtr = (DWORD) nTarget - m_dwBufferStart;
+				AFSTAT_INC(dwFileSeeks);
+				return true;
+			}
+
+			dwBytes = (DWORD) nTarget;
+			iStart = SEEK_SET;
+		}
+
+		if( 0 != fseek(m_pFile, (long) dwBytes, iStart) )
+			return false;
+
+		m_dwBufferStart = (DWORD) ftell(m_pFile);
+		m_dwBufferLen = 0;
+		m_dwBufferPtr = 0;
+		m_bBufferEOF = false;
+		AFSTAT_INC(dwFileSeeks);
+		return true;
+	}
+
 	if( 0 != fseek(m_pFile, dwBytes, iStart) )
 		return false;
 
+	AFSTAT_INC(dwFileSeeks);
+
 	return true;
 }
 
@@ -201,17 +451,37 @@ bool AFile::GetStringAfter(char * szBuffer, char * szTag, char * szResult)
 	char * pch;
 
 	szResult[0] = '\0';
-	pch = strstr(szBuffer, szTag);
-	if( pch != szBuffer )
-		return false;
 
-	pch += strlen(szTag);
+	// Only a prefix counts, so there is no need to search the whole line;
+	pch = szBuffer;
+	while( *szTag )
+	{
+		if( *pch != *szTag )
+			return false;
+		pch ++;
+		szTag ++;
+	}
+
 	strcpy(szResult, pch);
 	return true;
 }
 
 bool AFile::ResetPointer()
 {
+	if( m_pReadBuffer )
+	{
+		if( m_dwBufferStart == 0 )
+		{
+			m_dwBufferPtr = 0;
+			return true;
+		}
+
+		m_dwBufferStart = 0;
+		m_dwBufferLen = 0;
+		m_dwBufferPtr = 0;
+		m_bBufferEOF = false;
+	}
+
 	fseek(m_pFile, 0, SEEK_SET);
 	return true;
 }
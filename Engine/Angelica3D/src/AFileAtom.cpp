@@ -0,0 +1,166 @@
+/*
+ * FILE: AFileAtom.cpp
+ *
+ * DESCRIPTION: A process wide table which interns file names into 32-bit atoms
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "AFPI.h"
+#include "AFileAtom.h"
+#include "AFilePackage.h"
+
+#define ATOM_NAMEBLOCKSIZE		65536
+
+AFileAtomTable g_AFileAtomTable;
+
+AFileAtomTable::AFileAtomTable() : m_AtomTab(1024)
+{
+	m_aAtoms		= NULL;
+	m_nNumAtoms		= 0;
+	m_nMaxAtoms		= 0;
+
+	m_pNameBlock	= NULL;
+	m_dwBlockUsed	= 0;
+	m_dwNameBytes	= 0;
+
+	InitializeCriticalSection(&m_csAccess);
+}
+
+AFileAtomTable::~AFileAtomTable()
+{
+	while( m_pNameBlock )
+	{
+		LPBYTE pLastBlock = *(LPBYTE *) m_pNameBlock;
+		free(m_pNameBlock);
+		m_pNameBlock = pLastBlock;
+	}
+
+	if( m_aAtoms )
+	{
+		free(m_aAtoms);
+		m_aAtoms = NULL;
+	}
+
+	DeleteCriticalSection(&m_csAccess);
+}
+
+DWORD AFileAtomTable::MakeKey(const char * szFileName, char * szKey)
+{
+	AFilePackage_NormalizeFileName(szFileName, szKey);
+
+	for(char * pch=szKey; *pch; pch++)
+	{
+		if( *pch >= 'A' && *pch <= 'Z' )
+			*pch += 'a' - 'A';
+	}
+
+	return AFilePackage_HashFileName(szKey);
+}
+
+AFILEATOM AFileAtomTable::FindKey(const ATOMKEY& key)
+{
+	abase::pair<AFILEATOM *, bool> result = m_AtomTab.get(key);
+	if( !result.second )
+		return AFILEATOM_NULL;
+
+	return *result.first;
+}
+
+const char * AFileAtomTable::CopyName(const char * szName, int nLength)
+{
+	DWORD dwSize = nLength + 1;
+	if( NULL == m_pNameBlock || m_dwBlockUsed + dwSize > ATOM_NAMEBLOCKSIZE )
+	{
+		// The name is never longer than MAX_PATH, so it always fits in a new block;
+		LPBYTE pNewBlock = (LPBYTE) malloc(ATOM_NAMEBLOCKSIZE);
+		if( NULL == pNewBlock )
+			return NULL;
+
+		*(LPBYTE *) pNewBlock = m_pNameBlock;
+		m_pNameBlock = pNewBlock;
+		m_dwBlockUsed = sizeof(LPBYTE);
+	}
+
+	char * szCopy = (char *) (m_pNameBlock + m_dwBlockUsed);
+	memcpy(szCopy, szName, dwSize);
+	m_dwBlockUsed += dwSize;
+	m_dwNameBytes += dwSize;
+	return szCopy;
+}
+
+AFILEATOM AFileAtomTable::GetAtom(const char * szFileName)
+{
+	char szKey[MAX_PATH];
+	ATOMKEY key;
+	key.dwHash = MakeKey(szFileName, szKey);
+	key.szName = szKey;
+
+	EnterCriticalSection(&m_csAccess);
+
+	AFILEATOM atom = FindKey(key);
+	if( AFILEATOM_NULL != atom )
+	{
+		LeaveCriticalSection(&m_csAccess);
+		return atom;
+	}
+
+	if( m_nNumAtoms == m_nMaxAtoms )
+	{
+		int nNewMax = m_nMaxAtoms ? m_nMaxAtoms * 2 : 1024;
+		ATOMKEY * aNewAtoms = (ATOMKEY *) realloc(m_aAtoms, sizeof(ATOMKEY) * nNewMax);
+		if( NULL == aNewAtoms )
+		{
+			LeaveCriticalSection(&m_csAccess);
+			AFERRLOG(("AFileAtomTable::GetAtom(), Not enough memory!"));
+			return AFILEATOM_NULL;
+		}
+		m_aAtoms = aNewAtoms;
+		m_nMaxAtoms = nNewMax;
+	}
+
+	key.szName = CopyName(szKey, strlen(szKey));
+	if( NULL == key.szName )
+	{
+		LeaveCriticalSection(&m_csAccess);
+		AFERRLOG(("AFileAtomTable::GetAtom(), Not enough memory!"));
+		return AFILEATOM_NULL;
+	}
+
+	m_aAtoms[m_nNumAtoms] = key;
+	m_nNumAtoms ++;
+	atom = (AFILEATOM) m_nNumAtoms;
+	m_AtomTab.put(key, atom);
+
+	LeaveCriticalSection(&m_csAccess);
+	return atom;
+}
+
+AFILEATOM AFileAtomTable::FindAtom(const char * szFileName)
+{
+	char szKey[MAX_PATH];
+	ATOMKEY key;
+	key.dwHash = MakeKey(szFileName, szKey);
+	key.szName = szKey;
+
+	EnterCriticalSection(&m_csAccess);
+	AFILEATOM atom = FindKey(key);
+	LeaveCriticalSection(&m_csAccess);
+	return atom;
+}
+
+const char * AFileAtomTable::GetName(AFILEATOM atom)
+{
+	const char * szName = NULL;
+
+	EnterCriticalSection(&m_csAccess);
+	if( atom > 0 && atom <= (AFILEATOM) m_nNumAtoms )
+		szName = m_aAtoms[atom - 1].szName;
+	LeaveCriticalSection(&m_csAccess);
+
+	return szName;
+}
@@ -13,6 +13,10 @@
 #include "AFPI.h"
 #include "AFileImage.h"
 #include "AFilePackage.h"
+#include "AFilePrefetch.h"
+#include "AFileImageCache.h"
+#include "AFileMount.h"
+#include "AFileTrace.h"
 #include "AFI.h"
 
 AFileImage::AFileImage() : AFile()
@@ -20,6 +24,8 @@ AFileImage::AFileImage() : AFile()
 	m_pFileImage	= NULL;
 	m_nCurPtr		= 0;
 	m_nFileLength	= NULL;
+	m_bMappedImage	= false;
+	m_hCachedImage	= NULL;
 }
 
 AFileImage::~AFileImage()
@@ -27,66 +33,142 @@ AFileImage::~AFileImage()
 	Close();
 }
 
-bool AFileImage::Init(char * szFullName)
+bool AFileImage::ReadDiskImage(char * szFullName, LPBYTE * ppImage, int * pnLength)
 {
-	strncpy(m_szFileName, szFullName, MAX_PATH);
-	AFileMod_GetRelativePath(szFullName, m_szRelativeName);
-	
-	// If g_pAFilePackage is set, this means that we are using a file package, 
-	// instead of seperate files;
-	if( !g_pAFilePackage )
+	FILE * pFile;
+
+	pFile = fopen(szFullName, "rb");
+	if( NULL == pFile )
 	{
-		FILE * pFile;
+		AFERRLOG(("AFileImage::ReadImage Can't open file [%s] to create image in memory", szFullName));		
+		return false;
+	}
 
-		pFile = fopen(szFullName, "rb");
-		if( NULL == pFile )
-		{
-			AFERRLOG(("AFileImage::Init Can't open file [%s] to create image in memory", szFullName));		
-			return false;
-		}
+	fseek(pFile, 0, SEEK_END);
+	int nFileLength = ftell(pFile);
+	if( 0 == nFileLength )
+	{
+		AFERRLOG(("AFileImage::ReadImage The file [%s] is zero length!", szFullName));
+		fclose(pFile);
+		return false;
+	}
 
-		fseek(pFile, 0, SEEK_END);
-		m_nFileLength = ftell(pFile);
-		if( 0 == m_nFileLength )
-		{
-			AFERRLOG(("AFileImage::Init The file [%s] is zero length!"));
-			return false;
-		}
+	fseek(pFile, 0, SEEK_SET);
+	LPBYTE pImage = (LPBYTE) malloc(nFileLength * sizeof(BYTE));
+	if( NULL == pImage )
+	{
+		AFERRLOG(("AFileImage::ReadImage Not enough memory!"));
+		fclose(pFile);
+		return false;
+	}
+	fread(pImage, nFileLength, 1, pFile);
+
+	fclose(pFile);
+
+	*ppImage = pImage;
+	*pnLength = nFileLength;
+	return true;
+}
 
-		fseek(pFile, 0, SEEK_SET);
-		m_pFileImage = (LPBYTE) malloc(m_nFileLength * sizeof(BYTE));
-		if( NULL == m_pFileImage )
+bool AFileImage::ReadPackageImage(AFilePackage * pPackage, AFPCK_FILEENTRY& fileEntry, LPBYTE * ppImage, int * pnLength, bool * pbMapped)
+{
+	// If the package is mapped and the file is stored, just point to the mapped data;
+	if( pPackage->IsMapped() )
+	{
+		const BYTE * pMappedFile = pPackage->GetMappedFile(fileEntry);
+		if( pMappedFile )
 		{
-			AFERRLOG(("AFileImage::Init Not enough memory!"));
-			return false;
+			*ppImage = (LPBYTE) pMappedFile;
+			*pnLength = fileEntry.dwLength;
+			*pbMapped = true;
+			return true;
 		}
-		fread(m_pFileImage, m_nFileLength, 1, pFile);
+	}
 
-		fclose(pFile);
+	DWORD dwFileLength = fileEntry.dwLength;
+	LPBYTE pImage = (LPBYTE) malloc(dwFileLength * sizeof(BYTE));
+	if( NULL == pImage )
+	{
+		AFERRLOG(("AFileImage::ReadImage(), Not enough memory!"));
+		return false;
 	}
-	else
+	// Use the concurrent read, so file images can be created from several threads;
+	if( !pPackage->ReadFileConcurrent(fileEntry, pImage, 0, &dwFileLength) )
 	{
-		// Init from a package;
-		AFPCK_FILEENTRY fileEntry;
-		if( !g_pAFilePackage->GetFileEntry(m_szRelativeName, &fileEntry) )
-		{
-			AFERRLOG(("AFileImage::Can not locate file [%s] in the package!", m_szRelativeName));
-			return false;
-		}
-		m_nFileLength = fileEntry.dwLength;
-		m_pFileImage = (LPBYTE) malloc(m_nFileLength * sizeof(BYTE));
-		if( NULL == m_pFileImage )
-		{
-			AFERRLOG(("AFileImage::Init(), Not enough memory!"));
-			return false;
-		}
-		if( !g_pAFilePackage->ReadFile(fileEntry, m_pFileImage, 0, (DWORD *)&m_nFileLength) )
+		AFERRLOG(("AFileImage::ReadImage(), Error Reading file [%s] from package!", fileEntry.szFileName));
+		free(pImage);
+		return false;
+	}
+
+	*ppImage = pImage;
+	*pnLength = (int) dwFileLength;
+	return true;
+}
+
+bool AFileImage::ReadImage(char * szFullName, char * szRelativeName, LPBYTE * ppImage, int * pnLength, bool * pbMapped)
+{
+	*ppImage = NULL;
+	*pnLength = 0;
+	*pbMapped = false;
+
+	// The mounted layers come first, the files not in them are looked for in the old way;
+	if( g_pAFileMountTable && g_pAFileMountTable->GetNumLayers() > 0 )
+	{
+		AFMOUNT_FILE file;
+		if( g_pAFileMountTable->FindFile(szRelativeName, &file) )
 		{
-			AFERRLOG(("AFileImage::Init(), Error Reading file [%s] from package!", m_szRelativeName));
-			return false;
+			if( file.pPackage )
+				return ReadPackageImage(file.pPackage, file.fileEntry, ppImage, pnLength, pbMapped);
+			else
+				return ReadDiskImage(file.szDiskPath, ppImage, pnLength);
 		}
 	}
 
+	// If g_pAFilePackage is set, this means that we are using a file package, 
+	// instead of seperate files;
+	if( !g_pAFilePackage )
+		return ReadDiskImage(szFullName, ppImage, pnLength);
+
+	// Init from a package;
+	AFPCK_FILEENTRY fileEntry;
+	if( !g_pAFilePackage->GetFileEntry(szRelativeName, &fileEntry) )
+	{
+		AFERRLOG(("AFileImage::Can not locate file [%s] in the package!", szRelativeName));
+		return false;
+	}
+
+	return ReadPackageImage(g_pAFilePackage, fileEntry, ppImage, pnLength, pbMapped);
+}
+
+bool AFileImage::Init(char * szFullName)
+{
+	strncpy(m_szFileName, szFullName, MAX_PATH);
+	AFileMod_GetRelativePath(szFullName, m_szRelativeName);
+
+	bool bLoaded = false;
+
+	// Share the image with other opens of the same file if the cache is enabled;
+	if( g_pAFileImageCache )
+	{
+		m_hCachedImage = g_pAFileImageCache->AcquireImage(m_szRelativeName, &m_pFileImage, &m_nFileLength);
+		bLoaded = m_hCachedImage != NULL;
+	}
+
+	// If this file has been prefetched, just take the image;
+	if( !bLoaded && g_pAFilePrefetcher && g_pAFilePrefetcher->TakeFile(m_szRelativeName, &m_pFileImage, &m_nFileLength) )
+	{
+		AFSTAT_INC(dwPrefetchHits);
+		bLoaded = true;
+	}
+
+	if( !bLoaded && !ReadImage(szFullName, m_szRelativeName, &m_pFileImage, &m_nFileLength, &m_bMappedImage) )
+		return false;
+
+	AFSTAT_INC(dwImageOpens);
+	AFSTAT_ADD(dwImageBytes, m_nFileLength);
+
+	if( g_pAFileTracer )
+		g_pAFileTracer->RecordOpen(m_szRelativeName);
 	return true;
 }
 
@@ -94,10 +176,16 @@ bool AFileImage::Release()
 {
 	if( m_pFileImage )
 	{
-		free(m_pFileImage);
+		if( m_hCachedImage )
+			AFileImageCache::ReleaseImage(m_hCachedImage);
+		else if( !m_bMappedImage )
+			free(m_pFileImage);
 		m_pFileImage = NULL;
 	}
 
+	m_bMappedImage = false;
+	m_hCachedImage = NULL;
+
 	return true;
 }
 
@@ -186,46 +274,52 @@ bool AFileImage::fimg_read(LPBYTE pBuffer, int nSize, int * pReadSize)
 	return true;
 }
 
-bool AFileImage::fimg_read_line(char * szLineBuffer, int nMaxLength, int * pReadSize)
+int AFileImage::fimg_locate_line(int nMaxLength, int * pnLineLength)
 {
-	int nSizeRead = 0;
-
-	ZeroMemory(szLineBuffer, nMaxLength);
-	while( m_nCurPtr < m_nFileLength )
+	int nAvail = m_nFileLength - m_nCurPtr;
+	if( nAvail <= 0 )
 	{
-		BYTE byteThis = m_pFileImage[m_nCurPtr];
+		*pnLineLength = 0;
+		return 0;
+	}
 
-		if( byteThis != 0x0d && byteThis != 0x0a )
-		{
-			// Not \n or \r, so copy it into the buffer;
-			szLineBuffer[nSizeRead ++] = m_pFileImage[m_nCurPtr ++];
-		}
-		else
-		{
-			// We also need to copy \n into the buffer;
-			szLineBuffer[nSizeRead ++] = m_pFileImage[m_nCurPtr ++];
-			szLineBuffer[nSizeRead] = '\0';
-			if( byteThis == 0x0d )
-			{
-				// We need to check if next byte is \r, if so, just remove it;
-				if( m_nCurPtr < m_nFileLength )
-				{
-					if( m_pFileImage[m_nCurPtr] == 0x0a )
-					{
-						m_nCurPtr ++;
-						nSizeRead ++;
-					}
-				}
-			}
-			
-			break;
-		}
+	if( nAvail > nMaxLength )
+		nAvail = nMaxLength;
+
+	// A line ends with \n, \r or \r\n, look for \n first, then for \r before it;
+	const BYTE * pStart = m_pFileImage + m_nCurPtr;
+	const BYTE * pEnd = (const BYTE *) memchr(pStart, 0x0a, nAvail);
+	int nSearch = pEnd ? (int)(pEnd - pStart) : nAvail;
+	const BYTE * pCR = (const BYTE *) memchr(pStart, 0x0d, nSearch);
+	if( pCR )
+	{
+		*pnLineLength = (int)(pCR - pStart);
+		if( m_nCurPtr + *pnLineLength + 1 < m_nFileLength && pCR[1] == 0x0a )
+			return *pnLineLength + 2;
+		return *pnLineLength + 1;
 	}
 
-	*pReadSize = nSizeRead;
+	*pnLineLength = nSearch;
+	return pEnd ? nSearch + 1 : nSearch;
+}
 
+bool AFileImage::fimg_read_line(char * szLineBuffer, int nMaxLength, int * pReadSize)
+{
+	int nLineLength;
+
+	*pReadSize = 0;
+	if( nMaxLength < 2 )
+		return false;
+
+	int nSizeRead = fimg_locate_line(nMaxLength - 1, &nLineLength);
 	if( nSizeRead <= 0 )
 		return false;
+
+	memcpy(szLineBuffer, m_pFileImage + m_nCurPtr, nLineLength);
+	szLineBuffer[nLineLength] = '\0';
+	m_nCurPtr += nSizeRead;
+
+	*pReadSize = nSizeRead;
 	return true;
 }
 
@@ -256,17 +350,24 @@ bool AFileImage::ReadLine(char * szLineBuffer, DWORD dwBufferLength, DWORD * pdw
 {
 	int nReadSize;
 
+	// fimg_read_line has chopped the \n\r already;
 	if( !fimg_read_line(szLineBuffer, dwBufferLength, &nReadSize) )
 		return false;
 
-	//chop the \n\r
-	if( szLineBuffer[strlen(szLineBuffer) - 1] == '\n' || szLineBuffer[strlen(szLineBuffer) - 1] == '\r' )
-		szLineBuffer[strlen(szLineBuffer) - 1] = '\0';
+	*pdwReadLength = strlen(szLineBuffer) + 1;
+	return true;
+}
 
-	if( szLineBuffer[strlen(szLineBuffer) - 1] == '\n' || szLineBuffer[strlen(szLineBuffer) - 1] == '\r' )
-		szLineBuffer[strlen(szLineBuffer) - 1] = '\0';
+bool AFileImage::ReadLineView(const char ** ppLine, DWORD * pdwLength)
+{
+	int nLineLength;
+	int nSizeRead = fimg_locate_line(m_nFileLength, &nLineLength);
+	if( nSizeRead <= 0 )
+		return false;
 
-	*pdwReadLength = strlen(szLineBuffer) + 1;
+	*ppLine = (const char *) m_pFileImage + m_nCurPtr;
+	*pdwLength = (DWORD) nLineLength;
+	m_nCurPtr += nSizeRead;
 	return true;
 }
 
@@ -301,24 +402,28 @@ bool AFileImage::WriteLine(char * szLineBuffer)
 
 bool AFileImage::ReadString(char * szLineBuffer, DWORD dwBufferLength, DWORD * pdwReadLength)
 {
-	char ch;
-	DWORD dwReadLength;
-	DWORD nStrLen = 0;
-
-	Read(&ch, 1, &dwReadLength);
-	while( ch )
-	{
-		szLineBuffer[nStrLen] = ch;
-		nStrLen ++;
+	int nAvail = m_nFileLength - m_nCurPtr;
+	if( nAvail <= 0 || dwBufferLength == 0 )
+		return false;
 
-		if( nStrLen >= dwBufferLength )
-			return false;
+	if( (DWORD) nAvail > dwBufferLength )
+		nAvail = (int) dwBufferLength;
 
-		Read(&ch, 1, &dwReadLength);
+	const BYTE * pStart = m_pFileImage + m_nCurPtr;
+	const BYTE * pEnd = (const BYTE *) memchr(pStart, 0, nAvail);
+	if( !pEnd )
+	{
+		// Too long for the buffer or no '\0' before the end of the file;
+		memcpy(szLineBuffer, pStart, nAvail - 1);
+		szLineBuffer[nAvail - 1] = '\0';
+		m_nCurPtr += nAvail;
+		return false;
 	}
 
-	szLineBuffer[nStrLen] = '\0';
+	DWORD nStrLen = (DWORD) (pEnd - pStart);
+	memcpy(szLineBuffer, pStart, nStrLen + 1);
+	m_nCurPtr += nStrLen + 1;
 
 	*pdwReadLength = nStrLen + 1;
-	return false;
+	return true;
 }
@@ -0,0 +1,393 @@
+/*
+ * FILE: AFileImageCache.cpp
+ *
+ * DESCRIPTION: A cache of uncompressed package file images shared by AFileImage
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "AFPI.h"
+#include "AFileImageCache.h"
+#include "AFilePackage.h"
+#include "AFilePrefetch.h"
+#include "AFileMount.h"
+#include "AFI.h"
+
+AFileImageCache * g_pAFileImageCache = NULL;
+
+AFileImageCache::AFileImageCache()
+{
+	ZeroMemory(m_aBuckets, sizeof(m_aBuckets));
+	m_pLRUHead	= NULL;
+	m_pLRUTail	= NULL;
+
+	m_dwBudget	= 0;
+	ZeroMemory(&m_stats, sizeof(m_stats));
+
+	m_nNumOrphans	= 0;
+	m_bDetached		= false;
+
+	InitializeCriticalSection(&m_csAccess);
+}
+
+AFileImageCache::~AFileImageCache()
+{
+	DeleteCriticalSection(&m_csAccess);
+}
+
+bool AFileImageCache::Init(DWORD dwBudget)
+{
+	m_dwBudget = dwBudget;
+	return true;
+}
+
+bool AFileImageCache::Release()
+{
+	Flush();
+	return true;
+}
+
+AFileImageCache::AFIMAGECACHE_NODE * AFileImageCache::FindNode(AFilePackage * pPackage, DWORD dwOffset, DWORD dwLength)
+{
+	AFIMAGECACHE_NODE * pNode = m_aBuckets[(dwOffset >> 4) & (AFIMAGECACHE_BUCKETNUM - 1)];
+	while( pNode )
+	{
+		if( pNode->dwOffset == dwOffset && pNode->dwLength == dwLength && pNode->pPackage == pPackage )
+			return pNode;
+
+		pNode = pNode->pNextInBucket;
+	}
+
+	return NULL;
+}
+
+void AFileImageCache::RemoveFromTable(AFIMAGECACHE_NODE * pNode)
+{
+	AFIMAGECACHE_NODE ** ppNode = &m_aBuckets[(pNode->dwOffset >> 4) & (AFIMAGECACHE_BUCKETNUM - 1)];
+	while( *ppNode )
+	{
+		if( *ppNode == pNode )
+		{
+			*ppNode = pNode->pNextInBucket;
+			break;
+		}
+
+		ppNode = &(*ppNode)->pNextInBucket;
+	}
+
+	pNode->pNextInBucket = NULL;
+}
+
+void AFileImageCache::AddToLRU(AFIMAGECACHE_NODE * pNode)
+{
+	pNode->pPrevLRU = m_pLRUTail;
+	pNode->pNextLRU = NULL;
+	if( m_pLRUTail )
+		m_pLRUTail->pNextLRU = pNode;
+	else
+		m_pLRUHead = pNode;
+	m_pLRUTail = pNode;
+}
+
+void AFileImageCache::RemoveFromLRU(AFIMAGECACHE_NODE * pNode)
+{
+	if( pNode->pPrevLRU )
+		pNode->pPrevLRU->pNextLRU = pNode->pNextLRU;
+	else
+		m_pLRUHead = pNode->pNextLRU;
+
+	if( pNode->pNextLRU )
+		pNode->pNextLRU->pPrevLRU = pNode->pPrevLRU;
+	else
+		m_pLRUTail = pNode->pPrevLRU;
+
+	pNode->pPrevLRU = NULL;
+	pNode->pNextLRU = NULL;
+}
+
+void AFileImageCache::FreeNode(AFIMAGECACHE_NODE * pNode)
+{
+	if( pNode->pImage )
+		free(pNode->pImage);
+
+	delete pNode;
+}
+
+void AFileImageCache::Trim()
+{
+	while( m_pLRUHead && m_stats.dwResidentBytes > m_dwBudget )
+	{
+		AFIMAGECACHE_NODE * pNode = m_pLRUHead;
+		RemoveFromLRU(pNode);
+		RemoveFromTable(pNode);
+
+		m_stats.dwResidentBytes -= pNode->dwLength;
+		m_stats.nNumImages --;
+		m_stats.dwEvictions ++;
+		FreeNode(pNode);
+	}
+}
+
+LPVOID AFileImageCache::AcquireImage(char * szRelativeName, LPBYTE * ppImage, int * pnLength)
+{
+	// Find the package in the same way as AFileImage::ReadImage;
+	AFilePackage *	pPackage = NULL;
+	AFPCK_FILEENTRY	fileEntry;
+	AFMOUNT_FILE	file;
+	if( g_pAFileMountTable && g_pAFileMountTable->GetNumLayers() > 0 && g_pAFileMountTable->FindFile(szRelativeName, &file) )
+	{
+		pPackage = file.pPackage;
+		fileEntry = file.fileEntry;
+	}
+	else if( g_pAFilePackage && g_pAFilePackage->GetFileEntry(szRelativeName, &fileEntry) )
+		pPackage = g_pAFilePackage;
+
+	if( NULL == pPackage )
+		return NULL;
+
+	// A stored file in a mapped package need not be cached at all;
+	if( pPackage->IsMapped() && fileEntry.dwLength <= fileEntry.dwCompressedLength )
+		return NULL;
+
+	EnterCriticalSection(&m_csAccess);
+
+	AFIMAGECACHE_NODE * pNode = FindNode(pPackage, fileEntry.dwOffset, fileEntry.dwLength);
+	if( pNode )
+	{
+		if( 0 == pNode->nRefCount ++ )
+		{
+			RemoveFromLRU(pNode);
+			m_stats.nNumReferenced ++;
+		}
+
+		m_stats.dwHits ++;
+		LeaveCriticalSection(&m_csAccess);
+
+		*ppImage = pNode->pImage;
+		*pnLength = pNode->dwLength;
+		return pNode;
+	}
+
+	m_stats.dwMisses ++;
+	LeaveCriticalSection(&m_csAccess);
+
+	// Read the image outside the lock, it may has been prefetched;
+	LPBYTE	pImage = NULL;
+	int		nLength = 0;
+	if( !g_pAFilePrefetcher || !g_pAFilePrefetcher->TakeFile(szRelativeName, &pImage, &nLength) )
+	{
+		DWORD dwLength = fileEntry.dwLength;
+		pImage = (LPBYTE) malloc(dwLength);
+		if( NULL == pImage )
+		{
+			AFERRLOG(("AFileImageCache::AcquireImage(), Not enough memory!"));
+			return NULL;
+		}
+
+		if( !pPackage->ReadFileConcurrent(fileEntry, pImage, 0, &dwLength) )
+		{
+			AFERRLOG(("AFileImageCache::AcquireImage(), Error Reading file [%s] from package!", szRelativeName));
+			free(pImage);
+			return NULL;
+		}
+	}
+
+	EnterCriticalSection(&m_csAccess);
+
+	// Another thread may have read it at the same time;
+	pNode = FindNode(pPackage, fileEntry.dwOffset, fileEntry.dwLength);
+	if( pNode )
+	{
+		free(pImage);
+		if( 0 == pNode->nRefCount ++ )
+		{
+			RemoveFromLRU(pNode);
+			m_stats.nNumReferenced ++;
+		}
+	}
+	else
+	{
+		pNode = new AFIMAGECACHE_NODE;
+		if( NULL == pNode )
+		{
+			LeaveCriticalSection(&m_csAccess);
+			AFERRLOG(("AFileImageCache::AcquireImage(), Not enough memory!"));
+			free(pImage);
+			return NULL;
+		}
+
+		ZeroMemory(pNode, sizeof(AFIMAGECACHE_NODE));
+		pNode->pCache		= this;
+		pNode->pPackage		= pPackage;
+		pNode->dwOffset		= fileEntry.dwOffset;
+		pNode->dwLength		= fileEntry.dwLength;
+		pNode->pImage		= pImage;
+		pNode->nRefCount	= 1;
+
+		AFIMAGECACHE_NODE ** ppBucket = &m_aBuckets[(pNode->dwOffset >> 4) & (AFIMAGECACHE_BUCKETNUM - 1)];
+		pNode->pNextInBucket = *ppBucket;
+		*ppBucket = pNode;
+
+		m_stats.dwResidentBytes += pNode->dwLength;
+		m_stats.nNumImages ++;
+		m_stats.nNumReferenced ++;
+
+		// Make room for the new one;
+		Trim();
+	}
+
+	LeaveCriticalSection(&m_csAccess);
+
+	*ppImage = pNode->pImage;
+	*pnLength = pNode->dwLength;
+	return pNode;
+}
+
+void AFileImageCache::ReleaseImage(LPVOID hImage)
+{
+	AFIMAGECACHE_NODE * pNode = (AFIMAGECACHE_NODE *) hImage;
+	if( NULL == pNode )
+		return;
+
+	// A referenced node keeps its cache alive, so the cache is still there;
+	AFileImageCache * pCache = pNode->pCache;
+	if( pCache->ReleaseNode(pNode) )
+		delete pCache;
+}
+
+bool AFileImageCache::ReleaseNode(AFIMAGECACHE_NODE * pNode)
+{
+	bool bLastOrphan = false;
+
+	EnterCriticalSection(&m_csAccess);
+
+	if( 0 == -- pNode->nRefCount )
+	{
+		if( pNode->bOrphan )
+		{
+			FreeNode(pNode);
+			m_nNumOrphans --;
+			bLastOrphan = m_bDetached && 0 == m_nNumOrphans;
+		}
+		else
+		{
+			// Keep it as the most recently used one;
+			m_stats.nNumReferenced --;
+			AddToLRU(pNode);
+			Trim();
+		}
+	}
+
+	LeaveCriticalSection(&m_csAccess);
+	return bLastOrphan;
+}
+
+void AFileImageCache::Flush()
+{
+	EnterCriticalSection(&m_csAccess);
+
+	for(int i=0; i<AFIMAGECACHE_BUCKETNUM; i++)
+	{
+		AFIMAGECACHE_NODE * pNode = m_aBuckets[i];
+		while( pNode )
+		{
+			AFIMAGECACHE_NODE * pNext = pNode->pNextInBucket;
+
+			pNode->pNextInBucket = NULL;
+			if( pNode->nRefCount > 0 )
+			{
+				pNode->bOrphan = true;
+				m_nNumOrphans ++;
+			}
+			else
+			{
+				RemoveFromLRU(pNode);
+				FreeNode(pNode);
+			}
+
+			pNode = pNext;
+		}
+		m_aBuckets[i] = NULL;
+	}
+
+	m_pLRUHead = m_pLRUTail = NULL;
+	m_stats.dwResidentBytes = 0;
+	m_stats.nNumImages = 0;
+	m_stats.nNumReferenced = 0;
+
+	LeaveCriticalSection(&m_csAccess);
+}
+
+bool AFileImageCache::Detach()
+{
+	Flush();
+
+	EnterCriticalSection(&m_csAccess);
+	m_bDetached = true;
+	bool bUnused = 0 == m_nNumOrphans;
+	LeaveCriticalSection(&m_csAccess);
+
+	return bUnused;
+}
+
+void AFileImageCache::SetBudget(DWORD dwBudget)
+{
+	EnterCriticalSection(&m_csAccess);
+	m_dwBudget = dwBudget;
+	Trim();
+	LeaveCriticalSection(&m_csAccess);
+}
+
+void AFileImageCache::GetStats(AFIMAGECACHE_STATS * pStats)
+{
+	EnterCriticalSection(&m_csAccess);
+	*pStats = m_stats;
+	LeaveCriticalSection(&m_csAccess);
+}
+
+bool AFileMod_EnableImageCache(DWORD dwBudget)
+{
+	if( g_pAFileImageCache )
+	{
+		g_pAFileImageCache->SetBudget(dwBudget);
+		return true;
+	}
+
+	g_pAFileImageCache = new AFileImageCache();
+	if( NULL == g_pAFileImageCache )
+	{
+		AFERRLOG(("AFileMod_EnableImageCache(), Not enough memory!"));
+		return false;
+	}
+
+	return g_pAFileImageCache->Init(dwBudget);
+}
+
+bool AFileMod_DisableImageCache()
+{
+	if( g_pAFileImageCache )
+	{
+		// Images still opened keep the cache until they are closed;
+		AFileImageCache * pCache = g_pAFileImageCache;
+		g_pAFileImageCache = NULL;
+		if( pCache->Detach() )
+			delete pCache;
+	}
+	return true;
+}
+
+bool AFileMod_GetImageCacheStats(AFIMAGECACHE_STATS * pStats)
+{
+	if( !g_pAFileImageCache )
+	{
+		ZeroMemory(pStats, sizeof(AFIMAGECACHE_STATS));
+		return false;
+	}
+
+	g_pAFileImageCache->GetStats(pStats);
+	return true;
+}
@@ -0,0 +1,557 @@
+/*
+ * FILE: AFileMount.cpp
+ *
+ * DESCRIPTION: A mount table which layers several packages and directories into one
+ *				file system, with a merged file name index
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "AFPI.h"
+#include "AFileMount.h"
+#include "AFileImageCache.h"
+#include "AFI.h"
+
+AFileMountTable * g_pAFileMountTable = NULL;
+
+AFileMountTable::AFileMountTable()
+{
+	ZeroMemory(m_aLayers, sizeof(m_aLayers));
+	m_nNumLayers	= 0;
+
+	m_pNodes		= NULL;
+	m_nNumNodes		= 0;
+	m_nMaxNodes		= 0;
+	m_pHashBuckets	= NULL;
+	m_pHashNext		= NULL;
+	m_nNumBuckets	= 0;
+	m_pNamePool		= NULL;
+	m_nNamePoolSize	= 0;
+	m_nNamePoolUsed	= 0;
+
+	InitializeCriticalSection(&m_csAccess);
+}
+
+AFileMountTable::~AFileMountTable()
+{
+	DeleteCriticalSection(&m_csAccess);
+}
+
+bool AFileMountTable::Init()
+{
+	return true;
+}
+
+bool AFileMountTable::Release()
+{
+	UnmountAll();
+	return true;
+}
+
+int AFileMountTable::InsertLayer(const char * szPath, int nPriority)
+{
+	if( m_nNumLayers >= AFMOUNT_MAXLAYER )
+	{
+		AFERRLOG(("AFileMountTable::InsertLayer(), Too many layers!"));
+		return -1;
+	}
+
+	// After all layers of the same or lower priority;
+	int nLayer = m_nNumLayers;
+	while( nLayer > 0 && m_aLayers[nLayer - 1].nPriority > nPriority )
+	{
+		m_aLayers[nLayer] = m_aLayers[nLayer - 1];
+		nLayer --;
+	}
+
+	ZeroMemory(&m_aLayers[nLayer], sizeof(AFMOUNT_LAYER));
+	strncpy(m_aLayers[nLayer].szPath, szPath, MAX_PATH);
+	m_aLayers[nLayer].szPath[MAX_PATH - 1] = '\0';
+	m_aLayers[nLayer].nPriority = nPriority;
+
+	m_nNumLayers ++;
+	return nLayer;
+}
+
+void AFileMountTable::RemoveLayer(int nLayer)
+{
+	AFMOUNT_LAYER * pLayer = &m_aLayers[nLayer];
+	if( pLayer->pPackage )
+	{
+		// The cached images are keyed by the offsets in this package;
+		if( g_pAFileImageCache )
+			g_pAFileImageCache->Flush();
+
+		pLayer->pPackage->Close();
+		delete pLayer->pPackage;
+	}
+
+	if( pLayer->pDirNames )
+		free(pLayer->pDirNames);
+
+	for(int i=nLayer; i<m_nNumLayers - 1; i++)
+		m_aLayers[i] = m_aLayers[i + 1];
+
+	m_nNumLayers --;
+}
+
+bool AFileMountTable::ScanDir(AFMOUNT_LAYER * pLayer, const char * szSubDir)
+{
+	char			szPattern[MAX_PATH];
+	WIN32_FIND_DATA	findData;
+
+	_snprintf(szPattern, MAX_PATH, "%s\\%s*", pLayer->szPath, szSubDir);
+	szPattern[MAX_PATH - 1] = '\0';
+
+	HANDLE hFind = FindFirstFile(szPattern, &findData);
+	if( INVALID_HANDLE_VALUE == hFind )
+		return true;
+
+	bool bRet = true;
+	do
+	{
+		if( 0 == strcmp(findData.cFileName, ".") || 0 == strcmp(findData.cFileName, "..") )
+			continue;
+
+		char szName[MAX_PATH];
+		_snprintf(szName, MAX_PATH, "%s%s", szSubDir, findData.cFileName);
+		szName[MAX_PATH - 1] = '\0';
+
+		if( findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+		{
+			strncat(szName, "\\", MAX_PATH - 1 - strlen(szName));
+			if( !ScanDir(pLayer, szName) )
+			{
+				bRet = false;
+				break;
+			}
+		}
+		else
+		{
+			int nLength = strlen(szName) + 1;
+			if( pLayer->nDirNamesSize + nLength > pLayer->nDirNamesCapacity )
+			{
+				int nNewSize = max(pLayer->nDirNamesCapacity * 2, pLayer->nDirNamesSize + nLength);
+				char * pNewNames = (char *) realloc(pLayer->pDirNames, nNewSize);
+				if( NULL == pNewNames )
+				{
+					AFERRLOG(("AFileMountTable::ScanDir(), Not enough memory!"));
+					bRet = false;
+					break;
+				}
+				pLayer->pDirNames = pNewNames;
+				pLayer->nDirNamesCapacity = nNewSize;
+			}
+
+			memcpy(pLayer->pDirNames + pLayer->nDirNamesSize, szName, nLength);
+			pLayer->nDirNamesSize += nLength;
+			pLayer->nNumDirNames ++;
+		}
+	} while( FindNextFile(hFind, &findData) );
+
+	FindClose(hFind);
+	return bRet;
+}
+
+void AFileMountTable::ReleaseIndex()
+{
+	if( m_pNodes )
+	{
+		free(m_pNodes);
+		m_pNodes = NULL;
+	}
+	if( m_pHashBuckets )
+	{
+		free(m_pHashBuckets);
+		m_pHashBuckets = NULL;
+	}
+	if( m_pHashNext )
+	{
+		free(m_pHashNext);
+		m_pHashNext = NULL;
+	}
+	if( m_pNamePool )
+	{
+		free(m_pNamePool);
+		m_pNamePool = NULL;
+	}
+
+	m_nNumNodes		= 0;
+	m_nMaxNodes		= 0;
+	m_nNumBuckets	= 0;
+	m_nNamePoolSize	= 0;
+	m_nNamePoolUsed	= 0;
+}
+
+const char * AFileMountTable::GetNodeName(int nNode, char * szBuffer)
+{
+	AFMOUNT_NODE * pNode = &m_pNodes[nNode];
+	if( pNode->nNameOffset >= 0 )
+		return m_pNamePool + pNode->nNameOffset;
+
+	AFilePackage_NormalizeFileName(m_aLayers[pNode->nLayer].pPackage->GetFileName(pNode->nEntry), szBuffer);
+	return szBuffer;
+}
+
+int AFileMountTable::FindNode(DWORD dwNameHash, const char * szNormalizedName)
+{
+	if( 0 == m_nNumBuckets )
+		return -1;
+
+	char szNodeName[MAX_PATH];
+	int nNode = m_pHashBuckets[dwNameHash & (m_nNumBuckets - 1)];
+	while( nNode >= 0 )
+	{
+		// Hash matched, now make sure the names are really the same;
+		if( m_pNodes[nNode].dwNameHash == dwNameHash && 
+			0 == _stricmp(GetNodeName(nNode, szNodeName), szNormalizedName) )
+			return nNode;
+
+		nNode = m_pHashNext[nNode];
+	}
+
+	return -1;
+}
+
+int AFileMountTable::AddToNamePool(const char * szNormalizedName)
+{
+	int nLength = strlen(szNormalizedName) + 1;
+	if( m_nNamePoolUsed + nLength > m_nNamePoolSize )
+	{
+		int nNewSize = max(m_nNamePoolSize * 2, m_nNamePoolUsed + nLength);
+		char * pNewPool = (char *) realloc(m_pNamePool, nNewSize);
+		if( NULL == pNewPool )
+		{
+			AFERRLOG(("AFileMountTable::AddToNamePool(), Not enough memory!"));
+			return -1;
+		}
+		m_pNamePool = pNewPool;
+		m_nNamePoolSize = nNewSize;
+	}
+	memcpy(m_pNamePool + m_nNamePoolUsed, szNormalizedName, nLength);
+
+	int nOffset = m_nNamePoolUsed;
+	m_nNamePoolUsed += nLength;
+	return nOffset;
+}
+
+bool AFileMountTable::AddNode(DWORD dwNameHash, int nNameOffset, int nLayer, int nEntry)
+{
+	AFMOUNT_NODE * pNode = &m_pNodes[m_nNumNodes];
+	pNode->dwNameHash	= dwNameHash;
+	pNode->nNameOffset	= nNameOffset;
+	pNode->nLayer		= nLayer;
+	pNode->nEntry		= nEntry;
+
+	int nBucket = dwNameHash & (m_nNumBuckets - 1);
+	m_pHashNext[m_nNumNodes] = m_pHashBuckets[nBucket];
+	m_pHashBuckets[nBucket] = m_nNumNodes;
+	m_nNumNodes ++;
+	return true;
+}
+
+bool AFileMountTable::AddName(const char * szFileName, int nLayer)
+{
+	char szNormalized[MAX_PATH];
+	DWORD dwHash = AFilePackage_NormalizeFileName(szFileName, szNormalized);
+
+	// A layer added later always has a higher priority, so it hides the old one;
+	int nNode = FindNode(dwHash, szNormalized);
+	if( nNode >= 0 )
+	{
+		// The disk path is made from the name, so keep it if a package had it only;
+		if( m_pNodes[nNode].nNameOffset < 0 )
+		{
+			m_pNodes[nNode].nNameOffset = AddToNamePool(szNormalized);
+			if( m_pNodes[nNode].nNameOffset < 0 )
+				return false;
+		}
+
+		m_pNodes[nNode].nLayer = nLayer;
+		m_pNodes[nNode].nEntry = -1;
+		return true;
+	}
+
+	int nNameOffset = AddToNamePool(szNormalized);
+	if( nNameOffset < 0 )
+		return false;
+
+	return AddNode(dwHash, nNameOffset, nLayer, -1);
+}
+
+bool AFileMountTable::AddEntry(int nLayer, int nEntry)
+{
+	AFilePackage * pPackage = m_aLayers[nLayer].pPackage;
+	DWORD dwHash = pPackage->GetFileNameHash(nEntry);
+
+	// The name is only normalized when another file has the same hash, most files have none;
+	int nNode = m_pHashBuckets[dwHash & (m_nNumBuckets - 1)];
+	while( nNode >= 0 && m_pNodes[nNode].dwNameHash != dwHash )
+		nNode = m_pHashNext[nNode];
+
+	if( nNode >= 0 )
+	{
+		char szNormalized[MAX_PATH];
+		AFilePackage_NormalizeFileName(pPackage->GetFileName(nEntry), szNormalized);
+
+		nNode = FindNode(dwHash, szNormalized);
+		if( nNode >= 0 )
+		{
+			m_pNodes[nNode].nLayer = nLayer;
+			m_pNodes[nNode].nEntry = nEntry;
+			return true;
+		}
+	}
+
+	return AddNode(dwHash, -1, nLayer, nEntry);
+}
+
+bool AFileMountTable::BuildIndex()
+{
+	ReleaseIndex();
+
+	int i, j;
+	for(i=0; i<m_nNumLayers; i++)
+	{
+		if( m_aLayers[i].pPackage )
+			m_nMaxNodes += m_aLayers[i].pPackage->GetFileNumber();
+		else
+			m_nMaxNodes += m_aLayers[i].nNumDirNames;
+	}
+
+	// Keep the load factor below 0.5 so most buckets contain only one file;
+	m_nNumBuckets = 256;
+	while( m_nNumBuckets < m_nMaxNodes * 2 )
+		m_nNumBuckets <<= 1;
+
+	m_pNodes = (AFMOUNT_NODE *) malloc(sizeof(AFMOUNT_NODE) * (m_nMaxNodes + 1));
+	m_pHashNext = (int *) malloc(sizeof(int) * (m_nMaxNodes + 1));
+	m_pHashBuckets = (int *) malloc(sizeof(int) * m_nNumBuckets);
+	if( NULL == m_pNodes || NULL == m_pHashNext || NULL == m_pHashBuckets )
+	{
+		AFERRLOG(("AFileMountTable::BuildIndex(), Not enough memory!"));
+		ReleaseIndex();
+		return false;
+	}
+	memset(m_pHashBuckets, 0xff, sizeof(int) * m_nNumBuckets);
+
+	// From the lowest priority to the highest, so the files of higher layers replace the lower ones;
+	for(i=0; i<m_nNumLayers; i++)
+	{
+		AFMOUNT_LAYER * pLayer = &m_aLayers[i];
+		if( pLayer->pPackage )
+		{
+			int nNumFiles = pLayer->pPackage->GetFileNumber();
+			for(j=0; j<nNumFiles; j++)
+			{
+				if( !AddEntry(i, j) )
+				{
+					ReleaseIndex();
+					return false;
+				}
+			}
+		}
+		else
+		{
+			const char * szName = pLayer->pDirNames;
+			for(j=0; j<pLayer->nNumDirNames; j++)
+			{
+				if( !AddName(szName, i) )
+				{
+					ReleaseIndex();
+					return false;
+				}
+				szName += strlen(szName) + 1;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool AFileMountTable::MountPackage(char * szPackFile, int nPriority, AFPCK_OPENMODE mode)
+{
+	if( AFPCK_CREATENEW == mode )
+	{
+		AFERRLOG(("AFileMountTable::MountPackage(), Can not mount a package being created!"));
+		return false;
+	}
+
+	AFilePackage * pPackage = new AFilePackage();
+	if( NULL == pPackage )
+	{
+		AFERRLOG(("AFileMountTable::MountPackage(), Not enough memory!"));
+		return false;
+	}
+
+	if( !pPackage->Open(szPackFile, mode) )
+	{
+		AFERRLOG(("AFileMountTable::MountPackage(), Can not open package [%s]", szPackFile));
+		pPackage->Close();
+		delete pPackage;
+		return false;
+	}
+
+	EnterCriticalSection(&m_csAccess);
+
+	bool bRet = false;
+	int nLayer = InsertLayer(szPackFile, nPriority);
+	if( nLayer < 0 )
+	{
+		pPackage->Close();
+		delete pPackage;
+	}
+	else
+	{
+		m_aLayers[nLayer].pPackage = pPackage;
+		bRet = BuildIndex();
+		if( !bRet )
+			RemoveLayer(nLayer);
+	}
+
+	LeaveCriticalSection(&m_csAccess);
+	return bRet;
+}
+
+bool AFileMountTable::MountDir(char * szDir, int nPriority)
+{
+	EnterCriticalSection(&m_csAccess);
+
+	bool bRet = false;
+	int nLayer = InsertLayer(szDir, nPriority);
+	if( nLayer >= 0 )
+	{
+		// Get rid of last '\\'
+		AFMOUNT_LAYER * pLayer = &m_aLayers[nLayer];
+		int nLength = strlen(pLayer->szPath);
+		if( nLength > 0 && pLayer->szPath[nLength - 1] == '\\' )
+			pLayer->szPath[nLength - 1] = '\0';
+
+		bRet = ScanDir(pLayer, "") && BuildIndex();
+		if( !bRet )
+		{
+			AFERRLOG(("AFileMountTable::MountDir(), Can not mount directory [%s]", szDir));
+			RemoveLayer(nLayer);
+		}
+	}
+
+	LeaveCriticalSection(&m_csAccess);
+	return bRet;
+}
+
+bool AFileMountTable::Unmount(char * szPath)
+{
+	EnterCriticalSection(&m_csAccess);
+
+	bool bRet = false;
+	for(int i=m_nNumLayers - 1; i>=0; i--)
+	{
+		if( 0 == _stricmp(m_aLayers[i].szPath, szPath) )
+		{
+			RemoveLayer(i);
+			bRet = BuildIndex();
+			break;
+		}
+	}
+
+	LeaveCriticalSection(&m_csAccess);
+	return bRet;
+}
+
+void AFileMountTable::UnmountAll()
+{
+	EnterCriticalSection(&m_csAccess);
+
+	while( m_nNumLayers > 0 )
+		RemoveLayer(m_nNumLayers - 1);
+
+	ReleaseIndex();
+
+	LeaveCriticalSection(&m_csAccess);
+}
+
+bool AFileMountTable::FindFile(const char * szRelativeName, AFMOUNT_FILE * pFile)
+{
+	char szNormalized[MAX_PATH];
+	DWORD dwHash = AFilePackage_NormalizeFileName(szRelativeName, szNormalized);
+
+	EnterCriticalSection(&m_csAccess);
+
+	int nNode = FindNode(dwHash, szNormalized);
+	if( nNode < 0 )
+	{
+		LeaveCriticalSection(&m_csAccess);
+		return false;
+	}
+
+	AFMOUNT_NODE * pNode = &m_pNodes[nNode];
+	AFMOUNT_LAYER * pLayer = &m_aLayers[pNode->nLayer];
+	pFile->pPackage = pLayer->pPackage;
+	if( pLayer->pPackage )
+	{
+		pLayer->pPackage->GetFileEntryByIndex(pNode->nEntry, &pFile->fileEntry);
+		pFile->szDiskPath[0] = '\0';
+	}
+	else
+	{
+		_snprintf(pFile->szDiskPath, MAX_PATH, "%s\\%s", pLayer->szPath, m_pNamePool + pNode->nNameOffset);
+		pFile->szDiskPath[MAX_PATH - 1] = '\0';
+	}
+
+	LeaveCriticalSection(&m_csAccess);
+	return true;
+}
+
+static bool AFileMod_CreateMountTable()
+{
+	if( g_pAFileMountTable )
+		return true;
+
+	g_pAFileMountTable = new AFileMountTable();
+	if( NULL == g_pAFileMountTable )
+	{
+		AFERRLOG(("AFileMod_CreateMountTable(), Not enough memory!"));
+		return false;
+	}
+
+	return g_pAFileMountTable->Init();
+}
+
+bool AFileMod_MountPackage(char * szPackFile, int nPriority, bool bMapped)
+{
+	if( !AFileMod_CreateMountTable() )
+		return false;
+
+	return g_pAFileMountTable->MountPackage(szPackFile, nPriority, bMapped ? AFPCK_OPENMAPPED : AFPCK_OPENEXIST);
+}
+
+bool AFileMod_MountDir(char * szDir, int nPriority)
+{
+	if( !AFileMod_CreateMountTable() )
+		return false;
+
+	return g_pAFileMountTable->MountDir(szDir, nPriority);
+}
+
+bool AFileMod_Unmount(char * szPath)
+{
+	if( !g_pAFileMountTable )
+		return false;
+
+	return g_pAFileMountTable->Unmount(szPath);
+}
+
+bool AFileMod_UnmountAll()
+{
+	if( g_pAFileMountTable )
+	{
+		g_pAFileMountTable->Release();
+		delete g_pAFileMountTable;
+		g_pAFileMountTable = NULL;
+	}
+	return true;
+}
@@ -12,23 +12,101 @@
 
 #include "AFPI.h"
 #include "AFilePackage.h"
+#include "AFileImageCache.h"
+#include "AFLZ4.h"
+#include "allocator.h"
 #include <IO.h>
 
 AFilePackage * g_pAFilePackage = NULL;
 
+DWORD AFilePackage_NormalizeFileName(const char * szFileName, char * szNormalized)
+{
+	int nLength;
+	int i;
+
+	// Get rid of the preceding .\ string
+	if( (szFileName[0] == '.') && (szFileName[1] == '\\' || szFileName[1] == '/') && szFileName[2] )
+		szFileName += 2;
+
+	// Unite the path seperator to '\';
+	for(nLength=0; nLength<MAX_PATH - 1 && szFileName[nLength]; nLength++)
+	{
+		char ch = szFileName[nLength];
+		if( ch == '/' )
+			ch = '\\';
+		szNormalized[nLength] = ch;
+	}
+	szNormalized[nLength] = '\0';
+
+	// Get rid of extra space at the tail of the string;
+	for(i=nLength - 1; i>=0; i--)
+	{
+		if( szNormalized[i] != ' ' )
+			break;
+		else
+			szNormalized[i] = '\0';
+	}
+
+	return AFilePackage_HashFileName(szNormalized);
+}
+
+DWORD AFilePackage_HashFileName(const char * szFileName)
+{
+	// FNV-1a on lower case characters, so it matches the _stricmp compare;
+	DWORD dwHash = 2166136261;
+	for(const char * pch=szFileName; *pch; pch++)
+	{
+		BYTE ch = (BYTE) *pch;
+		if( ch >= 'A' && ch <= 'Z' )
+			ch += 'a' - 'A';
+		dwHash = (dwHash ^ ch) * 16777619;
+	}
+
+	return dwHash;
+}
+
 AFilePackage::AFilePackage()
 {
 	m_bHasChanged	= false;
 	m_bReadOnly		= false;
+	m_mode			= AFPCK_OPENEXIST;
 
 	m_nNumFiles		= 0;
-	m_pFileEntries	= NULL;
+	m_pEntries		= NULL;
+	m_pEntryNames	= NULL;
+	m_pNamePool		= NULL;
+	m_dwNamePoolSize = 0;
+	m_dwNamePoolCapacity = 0;
 	m_fpPackageFile = NULL;
+	m_hReadFile		= INVALID_HANDLE_VALUE;
 
 	m_pBuffer		= NULL;
 	m_dwBufferLen	= 0;
-
-	m_bHasSorted	= false;
+	m_nCompressLevel = 1;
+	m_dwDefaultCodec = AFPCK_CODEC_ZLIB;
+	m_nNumExtCodecs = 0;
+
+	m_pHashBuckets	= NULL;
+	m_nNumBuckets	= 0;
+	m_pHashNext		= NULL;
+
+	m_hFileMapping	= NULL;
+	m_pMappedBase	= NULL;
+	m_dwMappedSize	= 0;
+
+	m_pEntryStats	= NULL;
+	m_dwLastReadEnd	= 0;
+	m_nNumSeeks		= 0;
+	m_dwQuietThread	= 0;
+
+	m_bShareData	= true;
+	m_pDataRegions	= NULL;
+	m_nNumDataRegions = 0;
+	m_nMaxDataRegions = 0;
+	m_pDataBuckets	= NULL;
+	m_nNumDataBuckets = 0;
+	m_nNumSharedFiles = 0;
+	m_dwSharedBytes	= 0;
 }
 
 AFilePackage::~AFilePackage()
@@ -51,9 +129,304 @@ bool AFilePackage::PrepareBuffer(DWORD dwBufferLen)
 	return true;
 }
 
+bool AFilePackage::ResizeEntries(int nNumFiles)
+{
+	// Keep at least one entry, so a realloc of 0 bytes will not free the arrays;
+	int nNumAlloc = max(nNumFiles, 1);
+
+	AFPCK_PACKEDENTRY * pEntries = (AFPCK_PACKEDENTRY *) realloc(m_pEntries, sizeof(AFPCK_PACKEDENTRY) * nNumAlloc);
+	if( NULL == pEntries )
+		return false;
+	m_pEntries = pEntries;
+
+	DWORD * pEntryNames = (DWORD *) realloc(m_pEntryNames, sizeof(DWORD) * nNumAlloc);
+	if( NULL == pEntryNames )
+		return false;
+	m_pEntryNames = pEntryNames;
+
+	// The statistics are not necessary, so we go on without them if there is no memory;
+	AFPCK_ENTRYSTATS * pEntryStats = (AFPCK_ENTRYSTATS *) realloc(m_pEntryStats, sizeof(AFPCK_ENTRYSTATS) * nNumAlloc);
+	if( pEntryStats )
+	{
+		int nNumOld = m_pEntryStats ? m_nNumFiles : 0;
+		if( nNumFiles > nNumOld )
+			ZeroMemory(&pEntryStats[nNumOld], sizeof(AFPCK_ENTRYSTATS) * (nNumFiles - nNumOld));
+		m_pEntryStats = pEntryStats;
+	}
+	else if( m_pEntryStats )
+	{
+		free(m_pEntryStats);
+		m_pEntryStats = NULL;
+	}
+
+	return true;
+}
+
+bool AFilePackage::SetEntryName(int nIndex, const char * szFileName, DWORD dwCodec)
+{
+	DWORD dwNameLength = strlen(szFileName) + 1;
+	if( dwNameLength > MAX_PATH || m_dwNamePoolSize + dwNameLength > AFPCK_NAMEOFFSETMASK )
+	{
+		AFERRLOG(("AFilePackage::SetEntryName(), File name [%s] is too long!", szFileName));
+		return false;
+	}
+
+	if( m_dwNamePoolSize + dwNameLength > m_dwNamePoolCapacity )
+	{
+		DWORD dwCapacity = max(m_dwNamePoolCapacity * 2, 4096);
+		while( dwCapacity < m_dwNamePoolSize + dwNameLength )
+			dwCapacity *= 2;
+
+		char * pNamePool = (char *) realloc(m_pNamePool, dwCapacity);
+		if( NULL == pNamePool )
+		{
+			AFERRLOG(("AFilePackage::SetEntryName(), Not enough memory!"));
+			return false;
+		}
+
+		m_pNamePool = pNamePool;
+		m_dwNamePoolCapacity = dwCapacity;
+	}
+
+	memcpy(m_pNamePool + m_dwNamePoolSize, szFileName, dwNameLength);
+	m_pEntryNames[nIndex] = m_dwNamePoolSize | (dwCodec << AFPCK_NAMECODECSHIFT);
+	m_dwNamePoolSize += dwNameLength;
+	return true;
+}
+
+void AFilePackage::FillFileEntry(int nIndex, AFPCK_FILEENTRY * pFileEntry)
+{
+	strncpy(pFileEntry->szFileName, GetEntryName(nIndex), MAX_PATH);
+	pFileEntry->dwOffset			= m_pEntries[nIndex].dwOffset;
+	pFileEntry->dwLength			= m_pEntries[nIndex].dwLength;
+	pFileEntry->dwCompressedLength	= m_pEntries[nIndex].dwCompressedLength;
+	pFileEntry->dwCodec				= GetEntryCodec(nIndex);
+	pFileEntry->nIndex				= nIndex;
+}
+
+bool AFilePackage::LoadEntries()
+{
+	// Now analyse the file entries of the package;
+	DWORD		dwVersion;
+
+	fseek(m_fpPackageFile, 0 - sizeof(DWORD), SEEK_END);
+	fread(&dwVersion, sizeof(DWORD), 1, m_fpPackageFile);
+	if( dwVersion == 0x00010003 || dwVersion == 0x00010004 || dwVersion == 0x00010005 || dwVersion == 0x00010006 )
+	{
+		// Version 1.4 only changes the compressed file data, the entry list is the same as 1.3;
+		// version 1.5 adds the codec of each entry; version 1.6 saves the entries with a name pool;
+		// Now read file number;
+		fseek(m_fpPackageFile, 0 - (sizeof(int) + sizeof(DWORD)), SEEK_END);
+		fread(&m_nNumFiles, sizeof(int), 1, m_fpPackageFile);
+		fseek(m_fpPackageFile, 0 - (sizeof(AFPCK_FILEHEADER) + sizeof(DWORD) + sizeof(int)), SEEK_END);
+		fread(&m_header, sizeof(AFPCK_FILEHEADER), 1, m_fpPackageFile);
+
+		int nNumFiles = m_nNumFiles;
+		m_nNumFiles = 0;
+		if( nNumFiles < 0 || !ResizeEntries(nNumFiles) )
+		{
+			AFERRLOG(("AFilePackage::LoadEntries(), Not enough memory!"));
+			return false;
+		}
+		m_nNumFiles = nNumFiles;
+
+		// Seek to entry list;
+		fseek(m_fpPackageFile, m_header.dwEntryOffset, SEEK_SET); 
+		if( dwVersion >= 0x00010006 )
+		{
+			if( !LoadPackedEntries() )
+				return false;
+		}
+		else
+		{
+			for(int i=0; i<m_nNumFiles; i++)
+			{
+				char	szFileName[MAX_PATH];
+				int		nNameLength;
+				DWORD	dwCodec;
+
+				fread(&nNameLength, sizeof(int), 1, m_fpPackageFile);
+				if( nNameLength <= 0 || nNameLength > MAX_PATH )
+				{
+					AFERRLOG(("AFilePackage::LoadEntries(), Bad entry list!"));
+					return false;
+				}
+				fread(szFileName, nNameLength, 1, m_fpPackageFile);
+				szFileName[nNameLength - 1] = '\0';
+
+				AFPCK_PACKEDENTRY& entry = m_pEntries[i];
+				fread(&entry.dwOffset, sizeof(DWORD), 1, m_fpPackageFile);
+				fread(&entry.dwLength, sizeof(DWORD), 1, m_fpPackageFile);
+				fread(&entry.dwCompressedLength, sizeof(DWORD), 1, m_fpPackageFile);
+
+				if( dwVersion >= 0x00010005 )
+					fread(&dwCodec, sizeof(DWORD), 1, m_fpPackageFile);
+				else if( entry.dwLength > entry.dwCompressedLength )
+					dwCodec = AFPCK_CODEC_ZLIB;
+				else
+					dwCodec = AFPCK_CODEC_STORED;
+
+				char szName[MAX_PATH];
+				entry.dwNameHash = AFilePackage_NormalizeFileName(szFileName, szName);
+				if( !SetEntryName(i, szFileName, dwCodec) )
+					return false;
+			}
+		}
+
+		if( !BuildIndex() )
+			return false;
+	}
+	else
+	{
+		AFERRLOG(("AFilePackage::LoadEntries(), Incorrect version!"));
+		return false;
+	}
+
+	return true;
+}
+
+bool AFilePackage::LoadPackedEntries()
+{
+	// The arrays are read as they are, so no name need to be hashed or copied one by one;
+	if( m_nNumFiles > 0 )
+	{
+		if( 1 != fread(m_pEntries, sizeof(AFPCK_PACKEDENTRY) * m_nNumFiles, 1, m_fpPackageFile) ||
+			1 != fread(m_pEntryNames, sizeof(DWORD) * m_nNumFiles, 1, m_fpPackageFile) )
+		{
+			AFERRLOG(("AFilePackage::LoadPackedEntries(), Can not read entry list!"));
+			return false;
+		}
+	}
+
+	DWORD dwNamePoolSize;
+	if( 1 != fread(&dwNamePoolSize, sizeof(DWORD), 1, m_fpPackageFile) || dwNamePoolSize > AFPCK_NAMEOFFSETMASK )
+	{
+		AFERRLOG(("AFilePackage::LoadPackedEntries(), Bad name pool!"));
+		return false;
+	}
+
+	m_pNamePool = (char *) malloc(dwNamePoolSize + 1);
+	if( NULL == m_pNamePool )
+	{
+		AFERRLOG(("AFilePackage::LoadPackedEntries(), Not enough memory!"));
+		return false;
+	}
+	m_dwNamePoolSize = dwNamePoolSize;
+	m_dwNamePoolCapacity = dwNamePoolSize + 1;
+
+	if( dwNamePoolSize && 1 != fread(m_pNamePool, dwNamePoolSize, 1, m_fpPackageFile) )
+	{
+		AFERRLOG(("AFilePackage::LoadPackedEntries(), Can not read name pool!"));
+		return false;
+	}
+	m_pNamePool[dwNamePoolSize] = '\0';
+
+	for(int i=0; i<m_nNumFiles; i++)
+	{
+		if( (m_pEntryNames[i] & AFPCK_NAMEOFFSETMASK) >= dwNamePoolSize || GetEntryCodec(i) >= AFPCK_NUMCODECS )
+		{
+			AFERRLOG(("AFilePackage::LoadPackedEntries(), Bad entry [%d]!", i));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+DWORD AFilePackage::WriteEntries()
+{
+	DWORD	dwSize = 0;
+	int		i;
+
+	fseek(m_fpPackageFile, m_header.dwEntryOffset, SEEK_SET);
+	if( m_header.dwVersion >= 0x00010006 )
+	{
+		// The names of removed entries are left in the pool, so the pool is written again without them;
+		DWORD dwNamePoolSize = 0;
+		fwrite(m_pEntries, sizeof(AFPCK_PACKEDENTRY), m_nNumFiles, m_fpPackageFile);
+		for(i=0; i<m_nNumFiles; i++)
+		{
+			DWORD dwEntryName = dwNamePoolSize | (GetEntryCodec(i) << AFPCK_NAMECODECSHIFT);
+			fwrite(&dwEntryName, sizeof(DWORD), 1, m_fpPackageFile);
+			dwNamePoolSize += strlen(GetEntryName(i)) + 1;
+		}
+
+		fwrite(&dwNamePoolSize, sizeof(DWORD), 1, m_fpPackageFile);
+		for(i=0; i<m_nNumFiles; i++)
+			fwrite(GetEntryName(i), strlen(GetEntryName(i)) + 1, 1, m_fpPackageFile);
+
+		dwSize = (sizeof(AFPCK_PACKEDENTRY) + sizeof(DWORD)) * m_nNumFiles + sizeof(DWORD) + dwNamePoolSize;
+	}
+	else
+	{
+		for(i=0; i<m_nNumFiles; i++)
+		{
+			int nNameLength = strlen(GetEntryName(i)) + 1; // Plus '\0'
+			fwrite(&nNameLength, sizeof(int), 1, m_fpPackageFile);
+			fwrite(GetEntryName(i), nNameLength, 1, m_fpPackageFile);
+			fwrite(&m_pEntries[i].dwOffset, sizeof(DWORD), 1, m_fpPackageFile);
+			fwrite(&m_pEntries[i].dwLength, sizeof(DWORD), 1, m_fpPackageFile);
+			fwrite(&m_pEntries[i].dwCompressedLength, sizeof(DWORD), 1, m_fpPackageFile);
+			dwSize += sizeof(int) + nNameLength + sizeof(DWORD) * 3;
+
+			if( m_header.dwVersion >= 0x00010005 )
+			{
+				DWORD dwCodec = GetEntryCodec(i);
+				fwrite(&dwCodec, sizeof(DWORD), 1, m_fpPackageFile);
+				dwSize += sizeof(DWORD);
+			}
+		}
+	}
+
+	return dwSize;
+}
+
+bool AFilePackage::MapPackage()
+{
+	HANDLE hFile = (HANDLE) _get_osfhandle(_fileno(m_fpPackageFile));
+	if( INVALID_HANDLE_VALUE == hFile )
+		return false;
+
+	m_dwMappedSize = GetFileSize(hFile, NULL);
+	if( INVALID_FILE_SIZE == m_dwMappedSize || 0 == m_dwMappedSize )
+		return false;
+
+	m_hFileMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if( NULL == m_hFileMapping )
+		return false;
+
+	m_pMappedBase = (const BYTE *) MapViewOfFile(m_hFileMapping, FILE_MAP_READ, 0, 0, 0);
+	if( NULL == m_pMappedBase )
+	{
+		CloseHandle(m_hFileMapping);
+		m_hFileMapping = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+void AFilePackage::UnmapPackage()
+{
+	if( m_pMappedBase )
+	{
+		UnmapViewOfFile(m_pMappedBase);
+		m_pMappedBase = NULL;
+	}
+
+	if( m_hFileMapping )
+	{
+		CloseHandle(m_hFileMapping);
+		m_hFileMapping = NULL;
+	}
+
+	m_dwMappedSize = 0;
+}
+
 bool AFilePackage::Open(char * szPckPath, AFPCK_OPENMODE mode)
 {
-	if( g_bCompressEnable )
+	// A mapped package uncompress directly from the mapped view, so no buffer is needed;
+	if( g_bCompressEnable && mode != AFPCK_OPENMAPPED )
 	{
 		if( !PrepareBuffer(1024 * 1024) )
 		{
@@ -77,51 +450,48 @@ bool AFilePackage::Open(char * szPckPath, AFPCK_OPENMODE mode)
 			m_bReadOnly = true;
 		}
 
-		// Now analyse the file entries of the package;
-		DWORD		dwVersion;
-
-		fseek(m_fpPackageFile, 0 - sizeof(DWORD), SEEK_END);
-		fread(&dwVersion, sizeof(DWORD), 1, m_fpPackageFile);
-		if( dwVersion == 0x00010003 )
+		if( !LoadEntries() )
 		{
-			// First version;
-			// Now read file number;
-			fseek(m_fpPackageFile, 0 - (sizeof(int) + sizeof(DWORD)), SEEK_END);
-			fread(&m_nNumFiles, sizeof(int), 1, m_fpPackageFile);
-			fseek(m_fpPackageFile, 0 - (sizeof(AFPCK_FILEHEADER) + sizeof(DWORD) + sizeof(int)), SEEK_END);
-			fread(&m_header, sizeof(AFPCK_FILEHEADER), 1, m_fpPackageFile);
+			AFERRLOG(("AFilePackage::Open(), Can not load file entries of [%s]", szPckPath));
+			return false;
+		}
 
-			m_pFileEntries = (AFPCK_FILEENTRY *) malloc(sizeof(AFPCK_FILEENTRY) * m_nNumFiles);
-			if( NULL == m_pFileEntries )
-			{
-				AFERRLOG(("AFilePackage::Open(), Not enough memory!"));
-				return false;
-			}
+		// Open another handle for concurrent reading, the FILE's pointer can not be shared;
+		m_hReadFile = CreateFile(szPckPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, 
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+		if( INVALID_HANDLE_VALUE == m_hReadFile )
+		{
+			AFERRLOG(("AFilePackage::Open(), Can not open file [%s] for concurrent reading", szPckPath));
+			return false;
+		}
+		break;
 
-			// Seek to entry list;
-			fseek(m_fpPackageFile, m_header.dwEntryOffset, SEEK_SET); 
-			for(int i=0; i<m_nNumFiles; i++)
-			{
-				int nNameLength;
-				fread(&nNameLength, sizeof(int), 1, m_fpPackageFile);
-				fread(m_pFileEntries[i].szFileName, nNameLength, 1, m_fpPackageFile);
-				fread(&m_pFileEntries[i].dwOffset, sizeof(DWORD), 1, m_fpPackageFile);
-				fread(&m_pFileEntries[i].dwLength, sizeof(DWORD), 1, m_fpPackageFile);
-				fread(&m_pFileEntries[i].dwCompressedLength, sizeof(DWORD), 1, m_fpPackageFile);
-			}
+	case AFPCK_OPENMAPPED:
+		m_bReadOnly = true;
+		m_fpPackageFile = fopen(szPckPath, "rb");
+		if( NULL == m_fpPackageFile )
+		{
+			AFERRLOG(("AFilePackage::Open(), Can not open file [%s]", szPckPath));
+			return false;
+		}
 
-			ResortEntries();
+		if( !LoadEntries() )
+		{
+			AFERRLOG(("AFilePackage::Open(), Can not load file entries of [%s]", szPckPath));
+			return false;
 		}
-		else
+
+		if( !MapPackage() )
 		{
-			AFERRLOG(("AFilePackage::Open(), Incorrect version!"));
+			AFERRLOG(("AFilePackage::Open(), Can not map file [%s] into memory", szPckPath));
 			return false;
 		}
 		break;
 
 	case AFPCK_CREATENEW:
 		m_bReadOnly = false;
-		m_fpPackageFile = fopen(szPckPath, "wb");
+		// It is opened for reading too, so the data written can be compared with the files appended later;
+		m_fpPackageFile = fopen(szPckPath, "w+b");
 		if( NULL == m_fpPackageFile )
 		{
 			AFERRLOG(("AFilePackage::Open(), Can not create file [%s]", szPckPath));
@@ -135,7 +505,6 @@ bool AFilePackage::Open(char * szPckPath, AFPCK_OPENMODE mode)
 		strncpy(m_header.szDescription, "Angelica File Package, Beijing E-Pie Entertainment Corporation 2002~2008. All Rights Reserved. ", 256);
 
 		m_nNumFiles = 0;
-		m_pFileEntries = NULL;
 		break;
 
 	default:
@@ -158,21 +527,7 @@ bool AFilePackage::Close()
 			DWORD dwFileSize = m_header.dwEntryOffset;
 
 			// Rewrite file entries and file header here;
-			fseek(m_fpPackageFile, m_header.dwEntryOffset, SEEK_SET);
-			for(int i=0; i<m_nNumFiles; i++)
-			{
-				int nNameLength = strlen(m_pFileEntries[i].szFileName) + 1; // Plus '\0'
-				fwrite(&nNameLength, sizeof(int), 1, m_fpPackageFile);
-				dwFileSize += sizeof(int);
-				fwrite(m_pFileEntries[i].szFileName, nNameLength, 1, m_fpPackageFile);
-				dwFileSize += nNameLength;
-				fwrite(&m_pFileEntries[i].dwOffset, sizeof(DWORD), 1, m_fpPackageFile);
-				dwFileSize += sizeof(DWORD);
-				fwrite(&m_pFileEntries[i].dwLength, sizeof(DWORD), 1, m_fpPackageFile);
-				dwFileSize += sizeof(DWORD);
-				fwrite(&m_pFileEntries[i].dwCompressedLength, sizeof(DWORD), 1, m_fpPackageFile);
-				dwFileSize += sizeof(DWORD);
-			}
+			dwFileSize += WriteEntries();
 
 			// Write file header here;
 			fwrite(&m_header, sizeof(AFPCK_FILEHEADER), 1, m_fpPackageFile);
@@ -190,22 +545,24 @@ bool AFilePackage::Close()
 		break;
 	case AFPCK_CREATENEW:
 		// Write file entries and file header here;
-		fseek(m_fpPackageFile, m_header.dwEntryOffset, SEEK_SET);
-		for(int i=0; i<m_nNumFiles; i++)
-		{
-			int nNameLength = strlen(m_pFileEntries[i].szFileName) + 1; // Plus '\0'
-			fwrite(&nNameLength, sizeof(int), 1, m_fpPackageFile);
-			fwrite(m_pFileEntries[i].szFileName, nNameLength, 1, m_fpPackageFile);
-			fwrite(&m_pFileEntries[i].dwOffset, sizeof(DWORD), 1, m_fpPackageFile);
-			fwrite(&m_pFileEntries[i].dwLength, sizeof(DWORD), 1, m_fpPackageFile);
-			fwrite(&m_pFileEntries[i].dwCompressedLength, sizeof(DWORD), 1, m_fpPackageFile);
-		}
+		WriteEntries();
 
 		// Write file header here;
 		fwrite(&m_header, sizeof(AFPCK_FILEHEADER), 1, m_fpPackageFile);
 		fwrite(&m_nNumFiles, sizeof(int), 1, m_fpPackageFile);
 		fwrite(&m_header.dwVersion, sizeof(DWORD), 1, m_fpPackageFile);
 		break;
+	case AFPCK_OPENMAPPED:
+		// Read only, nothing to write back;
+		break;
+	}
+
+	UnmapPackage();
+
+	if( INVALID_HANDLE_VALUE != m_hReadFile )
+	{
+		CloseHandle(m_hReadFile);
+		m_hReadFile = INVALID_HANDLE_VALUE;
 	}
 
 	if( m_fpPackageFile )
@@ -213,12 +570,32 @@ bool AFilePackage::Close()
 		fclose(m_fpPackageFile);
 		m_fpPackageFile = NULL;
 	}
-	if( m_pFileEntries )
+	if( m_pEntries )
+	{
+		free(m_pEntries);
+		m_pEntries = NULL;
+	}
+	if( m_pEntryNames )
+	{
+		free(m_pEntryNames);
+		m_pEntryNames = NULL;
+	}
+	if( m_pNamePool )
 	{
-		free(m_pFileEntries);
-		m_pFileEntries = NULL;
+		free(m_pNamePool);
+		m_pNamePool = NULL;
+	}
+	m_dwNamePoolSize = 0;
+	m_dwNamePoolCapacity = 0;
+	if( m_pEntryStats )
+	{
+		free(m_pEntryStats);
+		m_pEntryStats = NULL;
 	}
 
+	ReleaseIndex();
+	ReleaseDataRegions();
+
 	if( m_pBuffer )
 	{
 		free(m_pBuffer);
@@ -232,149 +609,1044 @@ bool AFilePackage::Close()
 
 bool AFilePackage::GetFileEntryByIndex(int nIndex, AFPCK_FILEENTRY * pFileEntry)
 {
-	if( nIndex >= m_nNumFiles )
+	if( nIndex < 0 || nIndex >= m_nNumFiles )
 		return false;
 
-	*pFileEntry = m_pFileEntries[nIndex];
+	FillFileEntry(nIndex, pFileEntry);
 	return true;
 }
 
-bool AFilePackage::GetFileEntry(char * szFileName, AFPCK_FILEENTRY * pFileEntry, int * pnIndex)
+bool AFilePackage::BuildIndex()
 {
-	char szFindName[MAX_PATH];
-	int nLength;
-	int i;
-
-	strncpy(szFindName, szFileName, MAX_PATH);
-	
-	// First we should unite the path seperator to '\'
-	nLength = strlen(szFindName);
-	for(i=0; i<nLength; i++)
-	{
-		if( szFindName[i] == '/' )
-			szFindName[i] = '\\';
-	}
+	ReleaseIndex();
 
-	// Get rid of the preceding .\ string
-	if( nLength > 2 && szFindName[0] == '.' && szFindName[1] == '\\' )
-	{
-		for(i=0; i<nLength - 2; i++)
-			szFindName[i] = szFindName[i + 2];
-		szFindName[i] = '\0';
-	}
+	// Keep the load factor below 0.5 so most buckets contain only one entry;
+	m_nNumBuckets = 256;
+	while( m_nNumBuckets < m_nNumFiles * 2 )
+		m_nNumBuckets <<= 1;
 
-	// Get rid of extra space at the tail of the string;
-	nLength = strlen(szFindName);
-	for(i=nLength - 1; i>=0; i--)
+	m_pHashBuckets = (int *) malloc(sizeof(int) * m_nNumBuckets);
+	if( NULL == m_pHashBuckets )
 	{
-		if( szFindName[i] != ' ' )
-			break;
-		else
-			szFindName[i] = '\0';
+		AFERRLOG(("AFilePackage::BuildIndex(), Not enough memory!"));
+		return false;
 	}
+	memset(m_pHashBuckets, 0xff, sizeof(int) * m_nNumBuckets);
 
-	// We should also get rid of the preceding space;
-	// TrimString()...
-
-	ZeroMemory(pFileEntry, sizeof(AFPCK_FILEENTRY));
-
-	if( !m_bHasSorted )
+	if( m_nNumFiles > 0 )
 	{
-		// Use a linear search now
-		// For better performance we should use a binary search, that you need call ResortEntry
-		for(i=0; i<m_nNumFiles; i++)
+		m_pHashNext = (int *) malloc(sizeof(int) * m_nNumFiles);
+		if( NULL == m_pHashNext )
 		{
-			if( 0 == _stricmp(szFindName, m_pFileEntries[i].szFileName) )
-			{
-				*pFileEntry = m_pFileEntries[i];
-				if( pnIndex )
-					*pnIndex = i;
-				return true;
-			}
+			AFERRLOG(("AFilePackage::BuildIndex(), Not enough memory!"));
+			ReleaseIndex();
+			return false;
 		}
 	}
-	else
+
+	// The name hashes are kept in the entries, so no name need to be normalized here; insert
+	// from the last entry, so each chain is in entry order and a duplicate name finds the first;
+	for(int i=m_nNumFiles-1; i>=0; i--)
 	{
-		// Use binary search;
-		if( m_nNumFiles == 0 )
-			return false;
+		int nBucket = m_pEntries[i].dwNameHash & (m_nNumBuckets - 1);
 
-		int		nLeft = 0; 
-		int		nRight = m_nNumFiles - 1;
-		int		nMiddle;
-		
-		while(nLeft <= nRight)
-		{
-			nMiddle = (nLeft + nRight) / 2;
-			
-			int nCompare = _stricmp(m_pFileEntries[nMiddle].szFileName, szFindName);
-			if( nCompare == 0 )
-			{
-				*pFileEntry = m_pFileEntries[nMiddle];
-				if( pnIndex )
-					*pnIndex = nMiddle;
-				return true;
-			}
-			else if( nCompare < 0 )
-				nLeft = nMiddle + 1;
-			else if( nCompare > 0 )
-				nRight = nMiddle - 1;
-		}
+		m_pHashNext[i] = m_pHashBuckets[nBucket];
+		m_pHashBuckets[nBucket] = i;
 	}
 
-	return false;
+	return true;
 }
 
-bool AFilePackage::ReadFile(char * szFileName, LPBYTE pFileBuffer, DWORD dwOffset, DWORD * pdwBufferLen)
+bool AFilePackage::AddToIndex(int nIndex)
 {
-	AFPCK_FILEENTRY fileEntry;
+	// If the index is too crowded, just rebuild it with more buckets;
+	if( NULL == m_pHashBuckets || nIndex + 1 > m_nNumBuckets / 2 )
+		return BuildIndex();
 
-	if( !GetFileEntry(szFileName, &fileEntry) )
+	// Keep the old chain if the block can not grow, so the index is still usable;
+	int * pHashNext = (int *) realloc(m_pHashNext, sizeof(int) * (nIndex + 1));
+	if( NULL == pHashNext )
 	{
-		AFERRLOG(("AFilePackage::ReadFile(), Can not find file entry [%s]!", szFileName));
+		AFERRLOG(("AFilePackage::AddToIndex(), Not enough memory!"));
 		return false;
 	}
 
-	return ReadFile(fileEntry, pFileBuffer, dwOffset, pdwBufferLen);
+	m_pHashNext = pHashNext;
+
+	int nBucket = m_pEntries[nIndex].dwNameHash & (m_nNumBuckets - 1);
+
+	// Append to the end of the chain, so an earlier entry of the same name is still found first;
+	m_pHashNext[nIndex] = -1;
+	if( m_pHashBuckets[nBucket] < 0 )
+		m_pHashBuckets[nBucket] = nIndex;
+	else
+	{
+		int i = m_pHashBuckets[nBucket];
+		while( m_pHashNext[i] >= 0 )
+			i = m_pHashNext[i];
+		m_pHashNext[i] = nIndex;
+	}
+	return true;
 }
 
-bool AFilePackage::ReadFile(AFPCK_FILEENTRY& fileEntry, LPBYTE pFileBuffer, DWORD dwOffset, DWORD * pdwBufferLen)
+void AFilePackage::ReleaseIndex()
 {
-	if( fileEntry.dwLength < dwOffset )
+	if( m_pHashBuckets )
 	{
-		AFERRLOG(("AFilePackage::ReadFile(), Offset [%d] beyond the end of the file!", dwOffset));
-		return false;
+		free(m_pHashBuckets);
+		m_pHashBuckets = NULL;
 	}
-
-	if( *pdwBufferLen < fileEntry.dwLength - dwOffset )
+	if( m_pHashNext )
 	{
-		AFERRLOG(("AFilePackage::ReadFile(), Buffer is too small!"));
-		return false;
+		free(m_pHashNext);
+		m_pHashNext = NULL;
 	}
 
-	fseek(m_fpPackageFile, fileEntry.dwOffset + dwOffset, SEEK_SET);
+	m_nNumBuckets = 0;
+}
+
+int AFilePackage::FindEntry(DWORD dwNameHash, const char * szNormalizedName)
+{
+	if( NULL == m_pHashBuckets )
+		return -1;
+
+	char szEntryName[MAX_PATH];
+	for(int i=m_pHashBuckets[dwNameHash & (m_nNumBuckets - 1)]; i>=0; i=m_pHashNext[i])
+	{
+		if( m_pEntries[i].dwNameHash != dwNameHash )
+			continue;
+
+		// Hash matched, now make sure the names are really the same;
+		AFilePackage_NormalizeFileName(GetEntryName(i), szEntryName);
+		if( 0 == _stricmp(szNormalizedName, szEntryName) )
+			return i;
+	}
+
+	return -1;
+}
+
+bool AFilePackage::GetFileEntry(char * szFileName, AFPCK_FILEENTRY * pFileEntry, int * pnIndex)
+{
+	char szFindName[MAX_PATH];
+	DWORD dwHash = AFilePackage_NormalizeFileName(szFileName, szFindName);
+
+	ZeroMemory(pFileEntry, sizeof(AFPCK_FILEENTRY));
+
+	int nIndex = FindEntry(dwHash, szFindName);
+	if( nIndex < 0 )
+		return false;
+
+	FillFileEntry(nIndex, pFileEntry);
+	if( pnIndex )
+		*pnIndex = nIndex;
+	return true;
+}
+
+bool AFilePackage::GetFileEntry(DWORD dwNameHash, char * szFileName, AFPCK_FILEENTRY * pFileEntry, int * pnIndex)
+{
+	char szFindName[MAX_PATH];
+	AFilePackage_NormalizeFileName(szFileName, szFindName);
+
+	ZeroMemory(pFileEntry, sizeof(AFPCK_FILEENTRY));
+
+	int nIndex = FindEntry(dwNameHash, szFindName);
+	if( nIndex < 0 )
+		return false;
+
+	FillFileEntry(nIndex, pFileEntry);
+	if( pnIndex )
+		*pnIndex = nIndex;
+	return true;
+}
+
+bool AFilePackage::ReadFile(char * szFileName, LPBYTE pFileBuffer, DWORD dwOffset, DWORD * pdwBufferLen)
+{
+	AFPCK_FILEENTRY fileEntry;
+
+	if( !GetFileEntry(szFileName, &fileEntry) )
+	{
+		AFERRLOG(("AFilePackage::ReadFile(), Can not find file entry [%s]!", szFileName));
+		return false;
+	}
+
+	return ReadFile(fileEntry, pFileBuffer, dwOffset, pdwBufferLen);
+}
+
+bool AFilePackage::ReadFile(AFPCK_FILEENTRY& fileEntry, LPBYTE pFileBuffer, DWORD dwOffset, DWORD * pdwBufferLen)
+{
+	if( fileEntry.dwLength < dwOffset )
+	{
+		AFERRLOG(("AFilePackage::ReadFile(), Offset [%d] beyond the end of the file!", dwOffset));
+		return false;
+	}
+
+	if( *pdwBufferLen < fileEntry.dwLength - dwOffset )
+	{
+		AFERRLOG(("AFilePackage::ReadFile(), Buffer is too small!"));
+		return false;
+	}
+
+	if( IsChunked(fileEntry) )
+	{
+		DWORD dwReadLen;
+		return ReadFilePart(fileEntry, pFileBuffer, dwOffset, fileEntry.dwLength - dwOffset, &dwReadLen);
+	}
+
+	if( m_pMappedBase )
+	{
+		// Read from the mapped view directly, there is no need to seek or use the compression buffer;
+		if( fileEntry.dwOffset > m_dwMappedSize || fileEntry.dwCompressedLength > m_dwMappedSize - fileEntry.dwOffset )
+		{
+			AFERRLOG(("AFilePackage::ReadFile(), File [%s] beyond the end of the package!", fileEntry.szFileName));
+			return false;
+		}
+
+		if( fileEntry.dwLength > fileEntry.dwCompressedLength )
+		{
+			DWORD dwFileLength = fileEntry.dwLength;
+			if( dwOffset > 0 )
+			{
+				AFERRLOG(("AFilePackage::ReadFile(), use a offset for read is not allowed when using a compressed package!"));
+				return false;
+			}
+
+			LONGLONG nStartTicks = AFileStat_GetTicks();
+			int nResult = uncompress(pFileBuffer, &dwFileLength, m_pMappedBase + fileEntry.dwOffset, fileEntry.dwCompressedLength);
+			RecordAccess(fileEntry.dwOffset, fileEntry.dwCompressedLength);
+			if( Z_OK != nResult || dwFileLength != fileEntry.dwLength )
+			{
+				AFERRLOG(("AFilePackage::ReadFile(), Can not uncompress file [%s]!", fileEntry.szFileName));
+				return false;
+			}
+			RecordRead(fileEntry, fileEntry.dwLength, fileEntry.dwCompressedLength, AFileStat_GetMicroSec(nStartTicks));
+		}
+		else
+		{
+			memcpy(pFileBuffer, m_pMappedBase + fileEntry.dwOffset + dwOffset, fileEntry.dwLength - dwOffset);
+			RecordAccess(fileEntry.dwOffset + dwOffset, fileEntry.dwLength - dwOffset);
+			RecordRead(fileEntry, fileEntry.dwLength - dwOffset, fileEntry.dwLength - dwOffset, 0);
+		}
+		return true;
+	}
+
+	fseek(m_fpPackageFile, fileEntry.dwOffset + dwOffset, SEEK_SET);
 
 	// We can automaticly determine whether compression has been used;
 	if( fileEntry.dwLength > fileEntry.dwCompressedLength )
 	{
-		DWORD dwFileLength = fileEntry.dwLength;
-		if( !PrepareBuffer(fileEntry.dwCompressedLength) )
-			return false;
+		DWORD dwFileLength = fileEntry.dwLength;
+		if( !PrepareBuffer(fileEntry.dwCompressedLength) )
+			return false;
+
+		if( dwOffset > 0 )
+		{
+			AFERRLOG(("AFilePackage::ReadFile(), use a offset for read is not allowed when using a compressed package!"));
+			return false;
+		}
+
+		fread(m_pBuffer, fileEntry.dwCompressedLength, 1, m_fpPackageFile);
+		RecordAccess(fileEntry.dwOffset, fileEntry.dwCompressedLength);
+
+		LONGLONG nStartTicks = AFileStat_GetTicks();
+		if( Z_OK != uncompress(pFileBuffer, &dwFileLength, m_pBuffer, fileEntry.dwCompressedLength) ||
+			dwFileLength != fileEntry.dwLength )
+		{
+			AFERRLOG(("AFilePackage::ReadFile(), Can not uncompress file [%s]!", fileEntry.szFileName));
+			return false;
+		}
+		RecordRead(fileEntry, fileEntry.dwLength, fileEntry.dwCompressedLength, AFileStat_GetMicroSec(nStartTicks));
+	}
+	else
+	{
+		fread(pFileBuffer, fileEntry.dwLength - dwOffset, 1, m_fpPackageFile);
+		RecordAccess(fileEntry.dwOffset + dwOffset, fileEntry.dwLength - dwOffset);
+		RecordRead(fileEntry, fileEntry.dwLength - dwOffset, fileEntry.dwLength - dwOffset, 0);
+	}
+	return true;
+}
+
+bool AFilePackage::ReadPackageAt(DWORD dwPos, LPVOID pBuffer, DWORD dwSize)
+{
+	RecordAccess(dwPos, dwSize);
+
+	if( m_pMappedBase )
+	{
+		if( dwPos > m_dwMappedSize || dwSize > m_dwMappedSize - dwPos )
+			return false;
+
+		memcpy(pBuffer, m_pMappedBase + dwPos, dwSize);
+		return true;
+	}
+
+	// A changed package may have data in the FILE's buffer, so read it through the FILE;
+	if( INVALID_HANDLE_VALUE == m_hReadFile || m_bHasChanged )
+	{
+		fseek(m_fpPackageFile, dwPos, SEEK_SET);
+		return fread(pBuffer, dwSize, 1, m_fpPackageFile) == 1;
+	}
+
+	// A synchronous read with an OVERLAPPED offset will not use the shared file pointer;
+	OVERLAPPED	overlapped;
+	DWORD		dwRead = 0;
+
+	ZeroMemory(&overlapped, sizeof(OVERLAPPED));
+	overlapped.Offset = dwPos;
+	if( !::ReadFile(m_hReadFile, pBuffer, dwSize, &dwRead, &overlapped) || dwRead != dwSize )
+		return false;
+
+	return true;
+}
+
+bool AFilePackage::ReadFileConcurrent(char * szFileName, LPBYTE pFileBuffer, DWORD dwOffset, DWORD * pdwBufferLen)
+{
+	AFPCK_FILEENTRY fileEntry;
+
+	if( !GetFileEntry(szFileName, &fileEntry) )
+	{
+		AFERRLOG(("AFilePackage::ReadFileConcurrent(), Can not find file entry [%s]!", szFileName));
+		return false;
+	}
+
+	return ReadFileConcurrent(fileEntry, pFileBuffer, dwOffset, pdwBufferLen);
+}
+
+bool AFilePackage::ReadFileConcurrent(AFPCK_FILEENTRY& fileEntry, LPBYTE pFileBuffer, DWORD dwOffset, DWORD * pdwBufferLen)
+{
+	// A newly created package has no read handle, it can only be read the normal way;
+	if( !m_pMappedBase && INVALID_HANDLE_VALUE == m_hReadFile )
+		return ReadFile(fileEntry, pFileBuffer, dwOffset, pdwBufferLen);
+
+	if( fileEntry.dwLength < dwOffset )
+	{
+		AFERRLOG(("AFilePackage::ReadFileConcurrent(), Offset [%d] beyond the end of the file!", dwOffset));
+		return false;
+	}
+
+	if( *pdwBufferLen < fileEntry.dwLength - dwOffset )
+	{
+		AFERRLOG(("AFilePackage::ReadFileConcurrent(), Buffer is too small!"));
+		return false;
+	}
+
+	if( IsChunked(fileEntry) )
+	{
+		DWORD dwReadLen;
+		return ReadFilePart(fileEntry, pFileBuffer, dwOffset, fileEntry.dwLength - dwOffset, &dwReadLen);
+	}
+
+	if( fileEntry.dwLength > fileEntry.dwCompressedLength )
+	{
+		if( dwOffset > 0 )
+		{
+			AFERRLOG(("AFilePackage::ReadFileConcurrent(), use a offset for read is not allowed when using a compressed package!"));
+			return false;
+		}
+
+		// m_pBuffer is shared, so we use the mapped data directly or a private buffer of this call;
+		const BYTE *	pCompressed;
+		LPBYTE			pPrivateBuffer = NULL;
+
+		if( m_pMappedBase )
+		{
+			if( fileEntry.dwOffset > m_dwMappedSize || fileEntry.dwCompressedLength > m_dwMappedSize - fileEntry.dwOffset )
+			{
+				AFERRLOG(("AFilePackage::ReadFileConcurrent(), File [%s] beyond the end of the package!", fileEntry.szFileName));
+				return false;
+			}
+			pCompressed = m_pMappedBase + fileEntry.dwOffset;
+			RecordAccess(fileEntry.dwOffset, fileEntry.dwCompressedLength);
+		}
+		else
+		{
+			pPrivateBuffer = (LPBYTE) malloc(fileEntry.dwCompressedLength);
+			if( NULL == pPrivateBuffer )
+			{
+				AFERRLOG(("AFilePackage::ReadFileConcurrent(), Not enough memory!"));
+				return false;
+			}
+
+			if( !ReadPackageAt(fileEntry.dwOffset, pPrivateBuffer, fileEntry.dwCompressedLength) )
+			{
+				AFERRLOG(("AFilePackage::ReadFileConcurrent(), Can not read file [%s]!", fileEntry.szFileName));
+				free(pPrivateBuffer);
+				return false;
+			}
+			pCompressed = pPrivateBuffer;
+		}
+
+		DWORD dwFileLength = fileEntry.dwLength;
+		LONGLONG nStartTicks = AFileStat_GetTicks();
+		int nResult = uncompress(pFileBuffer, &dwFileLength, pCompressed, fileEntry.dwCompressedLength);
+		DWORD dwUncompressTime = AFileStat_GetMicroSec(nStartTicks);
+
+		if( pPrivateBuffer )
+			free(pPrivateBuffer);
+
+		if( Z_OK != nResult || dwFileLength != fileEntry.dwLength )
+		{
+			AFERRLOG(("AFilePackage::ReadFileConcurrent(), Can not uncompress file [%s]!", fileEntry.szFileName));
+			return false;
+		}
+
+		RecordRead(fileEntry, fileEntry.dwLength, fileEntry.dwCompressedLength, dwUncompressTime);
+	}
+	else
+	{
+		if( !ReadPackageAt(fileEntry.dwOffset + dwOffset, pFileBuffer, fileEntry.dwLength - dwOffset) )
+		{
+			AFERRLOG(("AFilePackage::ReadFileConcurrent(), Can not read file [%s]!", fileEntry.szFileName));
+			return false;
+		}
+
+		RecordRead(fileEntry, fileEntry.dwLength - dwOffset, fileEntry.dwLength - dwOffset, 0);
+	}
+
+	return true;
+}
+
+const BYTE * AFilePackage::GetPackageData(DWORD dwPos, DWORD dwSize, LPBYTE * ppPrivateBuffer)
+{
+	*ppPrivateBuffer = NULL;
+
+	if( m_pMappedBase )
+	{
+		if( dwPos > m_dwMappedSize || dwSize > m_dwMappedSize - dwPos )
+			return NULL;
+
+		RecordAccess(dwPos, dwSize);
+		return m_pMappedBase + dwPos;
+	}
+
+	*ppPrivateBuffer = (LPBYTE) malloc(dwSize);
+	if( NULL == *ppPrivateBuffer )
+		return NULL;
+
+	if( !ReadPackageAt(dwPos, *ppPrivateBuffer, dwSize) )
+	{
+		free(*ppPrivateBuffer);
+		*ppPrivateBuffer = NULL;
+		return NULL;
+	}
+
+	return *ppPrivateBuffer;
+}
+
+bool AFilePackage::ReadFilePart(AFPCK_FILEENTRY& fileEntry, LPBYTE pBuffer, DWORD dwOffset, DWORD dwSize, DWORD * pdwReadLen)
+{
+	*pdwReadLen = 0;
+
+	if( fileEntry.dwLength < dwOffset )
+	{
+		AFERRLOG(("AFilePackage::ReadFilePart(), Offset [%d] beyond the end of the file!", dwOffset));
+		return false;
+	}
+
+	if( dwSize > fileEntry.dwLength - dwOffset )
+		dwSize = fileEntry.dwLength - dwOffset;
+	if( 0 == dwSize )
+		return true;
+
+	// A stored file, just read the part;
+	if( fileEntry.dwLength <= fileEntry.dwCompressedLength )
+	{
+		if( !ReadPackageAt(fileEntry.dwOffset + dwOffset, pBuffer, dwSize) )
+		{
+			AFERRLOG(("AFilePackage::ReadFilePart(), Can not read file [%s]!", fileEntry.szFileName));
+			return false;
+		}
+
+		RecordRead(fileEntry, dwSize, dwSize, 0);
+		*pdwReadLen = dwSize;
+		return true;
+	}
+
+	LPBYTE	pTableBuffer = NULL;
+	LPBYTE	pDataBuffer = NULL;
+	LPBYTE	pChunkBuffer = NULL;
+	bool	bResult = false;
+	DWORD	dwPackageBytes = 0;
+	DWORD	dwUncompressTime = 0;
+
+	if( !IsChunked(fileEntry) )
+	{
+		// An old version package which compress the file as a whole, we have to uncompress all of it;
+		const BYTE * pData = GetPackageData(fileEntry.dwOffset, fileEntry.dwCompressedLength, &pDataBuffer);
+		pChunkBuffer = (LPBYTE) malloc(fileEntry.dwLength);
+		if( NULL == pData || NULL == pChunkBuffer )
+		{
+			AFERRLOG(("AFilePackage::ReadFilePart(), Can not read file [%s]!", fileEntry.szFileName));
+			goto EXIT;
+		}
+
+		DWORD dwFileLength = fileEntry.dwLength;
+		LONGLONG nStartTicks = AFileStat_GetTicks();
+		if( Z_OK != uncompress(pChunkBuffer, &dwFileLength, pData, fileEntry.dwCompressedLength) ||
+			dwFileLength != fileEntry.dwLength )
+		{
+			AFERRLOG(("AFilePackage::ReadFilePart(), Can not uncompress file [%s]!", fileEntry.szFileName));
+			goto EXIT;
+		}
+
+		dwUncompressTime = AFileStat_GetMicroSec(nStartTicks);
+		dwPackageBytes = fileEntry.dwCompressedLength;
+
+		memcpy(pBuffer, pChunkBuffer + dwOffset, dwSize);
+	}
+	else
+	{
+		// Only read the offsets and data of the chunks touched;
+		int nFirstChunk = dwOffset / AFPCK_CHUNKSIZE;
+		int nLastChunk = (dwOffset + dwSize - 1) / AFPCK_CHUNKSIZE;
+		int nNumChunks = nLastChunk - nFirstChunk + 1;
+
+		const DWORD * pChunkOffsets = (const DWORD *) GetPackageData(fileEntry.dwOffset + nFirstChunk * sizeof(DWORD), 
+			(nNumChunks + 1) * sizeof(DWORD), &pTableBuffer);
+		if( NULL == pChunkOffsets )
+		{
+			AFERRLOG(("AFilePackage::ReadFilePart(), Can not read chunk table of file [%s]!", fileEntry.szFileName));
+			goto EXIT;
+		}
+
+		// A broken table would make us read outside the file's data or the buffers;
+		int nTotalChunks = (fileEntry.dwLength + AFPCK_CHUNKSIZE - 1) / AFPCK_CHUNKSIZE;
+		bool bBadTable = pChunkOffsets[0] < (nTotalChunks + 1) * sizeof(DWORD) || pChunkOffsets[nNumChunks] > fileEntry.dwCompressedLength;
+		for(int i=0; i<nNumChunks && !bBadTable; i++)
+		{
+			if( pChunkOffsets[i + 1] < pChunkOffsets[i] )
+				bBadTable = true;
+		}
+
+		if( bBadTable )
+		{
+			AFERRLOG(("AFilePackage::ReadFilePart(), Chunk table of file [%s] is broken!", fileEntry.szFileName));
+			goto EXIT;
+		}
+
+		DWORD dwDataBegin = pChunkOffsets[0];
+		const BYTE * pData = GetPackageData(fileEntry.dwOffset + dwDataBegin, pChunkOffsets[nNumChunks] - dwDataBegin, &pDataBuffer);
+		if( NULL == pData )
+		{
+			AFERRLOG(("AFilePackage::ReadFilePart(), Can not read file [%s]!", fileEntry.szFileName));
+			goto EXIT;
+		}
+
+		dwPackageBytes = (nNumChunks + 1) * sizeof(DWORD) + pChunkOffsets[nNumChunks] - dwDataBegin;
+		LONGLONG nStartTicks = AFileStat_GetTicks();
+
+		for(int i=0; i<nNumChunks; i++)
+		{
+			DWORD dwChunkBegin = (nFirstChunk + i) * AFPCK_CHUNKSIZE;
+			DWORD dwChunkLength = min((DWORD) AFPCK_CHUNKSIZE, fileEntry.dwLength - dwChunkBegin);
+			const BYTE * pChunkData = pData + pChunkOffsets[i] - dwDataBegin;
+			DWORD dwChunkDataLength = pChunkOffsets[i + 1] - pChunkOffsets[i];
+
+			// The part of this chunk we need;
+			DWORD dwFrom = max(dwOffset, dwChunkBegin) - dwChunkBegin;
+			DWORD dwTo = min(dwOffset + dwSize, dwChunkBegin + dwChunkLength) - dwChunkBegin;
+			LPBYTE pDest = pBuffer + dwChunkBegin + dwFrom - dwOffset;
+
+			if( dwChunkDataLength == dwChunkLength )
+			{
+				// This chunk is stored;
+				memcpy(pDest, pChunkData + dwFrom, dwTo - dwFrom);
+			}
+			else if( dwFrom == 0 && dwTo == dwChunkLength )
+			{
+				// The whole chunk is needed, so uncompress it into the buffer directly;
+				if( !UncompressChunk(fileEntry.dwCodec, pDest, dwChunkLength, pChunkData, dwChunkDataLength) )
+				{
+					AFERRLOG(("AFilePackage::ReadFilePart(), Can not uncompress file [%s]!", fileEntry.szFileName));
+					goto EXIT;
+				}
+			}
+			else
+			{
+				if( NULL == pChunkBuffer )
+				{
+					pChunkBuffer = (LPBYTE) malloc(AFPCK_CHUNKSIZE);
+					if( NULL == pChunkBuffer )
+					{
+						AFERRLOG(("AFilePackage::ReadFilePart(), Not enough memory!"));
+						goto EXIT;
+					}
+				}
+
+				if( !UncompressChunk(fileEntry.dwCodec, pChunkBuffer, dwChunkLength, pChunkData, dwChunkDataLength) )
+				{
+					AFERRLOG(("AFilePackage::ReadFilePart(), Can not uncompress file [%s]!", fileEntry.szFileName));
+					goto EXIT;
+				}
+				memcpy(pDest, pChunkBuffer + dwFrom, dwTo - dwFrom);
+			}
+		}
+
+		dwUncompressTime = AFileStat_GetMicroSec(nStartTicks);
+	}
+
+	RecordRead(fileEntry, dwSize, dwPackageBytes, dwUncompressTime);
+	*pdwReadLen = dwSize;
+	bResult = true;
+
+EXIT:
+	if( pTableBuffer )
+		free(pTableBuffer);
+	if( pDataBuffer )
+		free(pDataBuffer);
+	if( pChunkBuffer )
+		free(pChunkBuffer);
+	return bResult;
+}
+
+const BYTE * AFilePackage::GetMappedFile(AFPCK_FILEENTRY& fileEntry)
+{
+	if( !m_pMappedBase )
+		return NULL;
+
+	// Compressed file must be uncompressed into a buffer by ReadFile;
+	if( fileEntry.dwLength > fileEntry.dwCompressedLength )
+		return NULL;
+
+	if( fileEntry.dwOffset > m_dwMappedSize || fileEntry.dwLength > m_dwMappedSize - fileEntry.dwOffset )
+	{
+		AFERRLOG(("AFilePackage::GetMappedFile(), File [%s] beyond the end of the package!", fileEntry.szFileName));
+		return NULL;
+	}
+
+	// The caller will read the file from the mapped view;
+	RecordAccess(fileEntry.dwOffset, fileEntry.dwLength);
+	RecordRead(fileEntry, fileEntry.dwLength, fileEntry.dwLength, 0);
+	return m_pMappedBase + fileEntry.dwOffset;
+}
+
+void AFilePackage::RecordAccess(DWORD dwPos, DWORD dwSize)
+{
+	if( m_dwQuietThread && m_dwQuietThread == GetCurrentThreadId() )
+		return;
+
+	// Not exact when several threads read at the same time, but enough to see how the reads jump;
+	if( dwPos != m_dwLastReadEnd )
+	{
+		InterlockedIncrement(&m_nNumSeeks);
+		AFSTAT_INC(dwPackageSeeks);
+	}
+	m_dwLastReadEnd = dwPos + dwSize;
+}
+
+void AFilePackage::RecordRead(AFPCK_FILEENTRY& fileEntry, DWORD dwBytes, DWORD dwPackageBytes, DWORD dwUncompressTime)
+{
+	if( m_dwQuietThread && m_dwQuietThread == GetCurrentThreadId() )
+		return;
+
+	AFSTAT_INC(dwPackageReads);
+	AFSTAT_ADD(dwPackageBytes, dwBytes);
+	AFSTAT_ADD(dwPackageCompressedBytes, dwPackageBytes);
+	AFSTAT_ADD(dwUncompressTime, dwUncompressTime);
+
+	// The entry may be copied before the entries are changed, so check it is still the same one;
+	int nIndex = fileEntry.nIndex;
+	if( NULL == m_pEntryStats || nIndex < 0 || nIndex >= m_nNumFiles || 
+		m_pEntries[nIndex].dwOffset != fileEntry.dwOffset )
+		return;
+
+	AFPCK_ENTRYSTATS * pStats = &m_pEntryStats[nIndex];
+	InterlockedIncrement((LONG volatile *) &pStats->dwReads);
+	InterlockedExchangeAdd((LONG volatile *) &pStats->dwBytes, (LONG) dwBytes);
+	InterlockedExchangeAdd((LONG volatile *) &pStats->dwPackageBytes, (LONG) dwPackageBytes);
+	InterlockedExchangeAdd((LONG volatile *) &pStats->dwUncompressTime, (LONG) dwUncompressTime);
+}
+
+bool AFilePackage::GetEntryStats(int nIndex, AFPCK_ENTRYSTATS * pStats)
+{
+	if( nIndex < 0 || nIndex >= m_nNumFiles )
+		return false;
+
+	if( m_pEntryStats )
+		*pStats = m_pEntryStats[nIndex];
+	else
+		ZeroMemory(pStats, sizeof(AFPCK_ENTRYSTATS));
+	return true;
+}
+
+bool AFilePackage::DumpStats(FILE * fpDump)
+{
+	if( NULL == m_pEntryStats )
+		return false;
+
+	DWORD dwTotalReads = 0;
+	DWORD dwTotalBytes = 0;
+	DWORD dwTotalPackageBytes = 0;
+	DWORD dwTotalUncompressTime = 0;
+	int nNumRead = 0;
+
+	fprintf(fpDump, "%-8s %-10s %-10s %-10s %s\n", "reads", "bytes", "pckbytes", "unzip(us)", "file");
+	for(int i=0; i<m_nNumFiles; i++)
+	{
+		AFPCK_ENTRYSTATS * pStats = &m_pEntryStats[i];
+		if( 0 == pStats->dwReads )
+			continue;
+
+		fprintf(fpDump, "%-8u %-10u %-10u %-10u %s\n", pStats->dwReads, pStats->dwBytes, pStats->dwPackageBytes, 
+			pStats->dwUncompressTime, GetEntryName(i));
+
+		dwTotalReads += pStats->dwReads;
+		dwTotalBytes += pStats->dwBytes;
+		dwTotalPackageBytes += pStats->dwPackageBytes;
+		dwTotalUncompressTime += pStats->dwUncompressTime;
+		nNumRead ++;
+	}
+
+	fprintf(fpDump, "%d of %d files read, %u reads, %u bytes, %u package bytes, %u us uncompressing, %d seeks\n", 
+		nNumRead, m_nNumFiles, dwTotalReads, dwTotalBytes, dwTotalPackageBytes, dwTotalUncompressTime, m_nNumSeeks);
+	return true;
+}
+
+DWORD AFilePackage::GetCompressBound(DWORD dwFileLength)
+{
+	if( m_header.dwVersion >= 0x00010004 )
+	{
+		DWORD dwNumChunks = (dwFileLength + AFPCK_CHUNKSIZE - 1) / AFPCK_CHUNKSIZE;
+		return (dwNumChunks + 1) * sizeof(DWORD) + dwNumChunks * compressBound(AFPCK_CHUNKSIZE);
+	}
+
+	return compressBound(dwFileLength);
+}
+
+bool AFilePackage::UncompressChunk(DWORD dwCodec, LPBYTE pDest, DWORD dwDestLength, const BYTE * pSrc, DWORD dwSrcLength)
+{
+	switch( dwCodec )
+	{
+	case AFPCK_CODEC_ZLIB:
+	{
+		DWORD dwLength = dwDestLength;
+		return Z_OK == uncompress(pDest, &dwLength, pSrc, dwSrcLength) && dwLength == dwDestLength;
+	}
+	case AFPCK_CODEC_LZ4:
+		return AFLZ4_Uncompress(pSrc, dwSrcLength, pDest, dwDestLength) == (int) dwDestLength;
+	}
+
+	AFERRLOG(("AFilePackage::UncompressChunk(), Unknown codec [%d]!", dwCodec));
+	return false;
+}
+
+DWORD AFilePackage::GetFileCodec(const char * szFileName)
+{
+	const char * szExt = strrchr(szFileName, '.');
+	if( szExt )
+	{
+		for(int i=0; i<m_nNumExtCodecs; i++)
+		{
+			if( 0 == _stricmp(szExt, m_aExtCodecs[i].szExt) )
+				return m_aExtCodecs[i].dwCodec;
+		}
+	}
+
+	return m_dwDefaultCodec;
+}
+
+bool AFilePackage::SetFileCodec(const char * szExt, DWORD dwCodec)
+{
+	if( dwCodec >= AFPCK_NUMCODECS || NULL == szExt || '.' != szExt[0] || strlen(szExt) >= sizeof(m_aExtCodecs[0].szExt) )
+	{
+		AFERRLOG(("AFilePackage::SetFileCodec(), Invalid extension or codec!"));
+		return false;
+	}
+
+	int i;
+	for(i=0; i<m_nNumExtCodecs; i++)
+	{
+		if( 0 == _stricmp(szExt, m_aExtCodecs[i].szExt) )
+			break;
+	}
+
+	if( i == m_nNumExtCodecs )
+	{
+		if( m_nNumExtCodecs >= AFPCK_MAXEXTCODECS )
+		{
+			AFERRLOG(("AFilePackage::SetFileCodec(), Too many extensions!"));
+			return false;
+		}
+
+		strcpy(m_aExtCodecs[i].szExt, szExt);
+		m_nNumExtCodecs ++;
+	}
+
+	m_aExtCodecs[i].dwCodec = dwCodec;
+	return true;
+}
+
+bool AFilePackage::SetDefaultCodec(DWORD dwCodec)
+{
+	if( dwCodec >= AFPCK_NUMCODECS )
+	{
+		AFERRLOG(("AFilePackage::SetDefaultCodec(), Unknown codec [%d]!", dwCodec));
+		return false;
+	}
+
+	m_dwDefaultCodec = dwCodec;
+	return true;
+}
+
+DWORD AFilePackage::CompressFile(LPBYTE pFileBuffer, DWORD dwFileLength, DWORD dwCodec)
+{
+	if( !g_bCompressEnable )
+		return dwFileLength;
+
+	if( !PrepareBuffer(GetCompressBound(dwFileLength)) )
+		return dwFileLength;
+
+	return CompressFileInto(pFileBuffer, dwFileLength, m_pBuffer, dwCodec);
+}
+
+DWORD AFilePackage::CompressFileInto(LPBYTE pFileBuffer, DWORD dwFileLength, LPBYTE pOutBuffer, DWORD dwCodec)
+{
+	if( AFPCK_CODEC_STORED == dwCodec )
+		return dwFileLength;
+
+	if( m_header.dwVersion >= 0x00010004 )
+	{
+		// Only zlib can be used before version 1.5;
+		if( m_header.dwVersion < 0x00010005 )
+			dwCodec = AFPCK_CODEC_ZLIB;
+		return CompressFileChunked(pFileBuffer, dwFileLength, pOutBuffer, dwCodec);
+	}
+
+	// Old version package, compress the file as a whole;
+	DWORD dwCompressedLength = GetCompressBound(dwFileLength);
+	if( Z_OK != compress2(pOutBuffer, &dwCompressedLength, pFileBuffer, dwFileLength, m_nCompressLevel) ||
+		dwCompressedLength >= dwFileLength )
+		return dwFileLength;
+
+	return dwCompressedLength;
+}
+
+DWORD AFilePackage::CompressFileChunked(LPBYTE pFileBuffer, DWORD dwFileLength, LPBYTE pOutBuffer, DWORD dwCodec)
+{
+	int nNumChunks = (dwFileLength + AFPCK_CHUNKSIZE - 1) / AFPCK_CHUNKSIZE;
+	DWORD dwTableSize = (nNumChunks + 1) * sizeof(DWORD);
+	if( dwTableSize >= dwFileLength )
+		return dwFileLength;
+
+	DWORD dwChunkBound = compressBound(AFPCK_CHUNKSIZE);
+	DWORD * pChunkOffsets = (DWORD *) pOutBuffer;
+	DWORD dwPos = dwTableSize;
+	for(int i=0; i<nNumChunks; i++)
+	{
+		DWORD dwChunkBegin = i * AFPCK_CHUNKSIZE;
+		DWORD dwChunkLength = min((DWORD) AFPCK_CHUNKSIZE, dwFileLength - dwChunkBegin);
+		DWORD dwCompressedLength = dwChunkBound;
+
+		pChunkOffsets[i] = dwPos;
+
+		bool bCompressed;
+		if( AFPCK_CODEC_LZ4 == dwCodec )
+		{
+			// Only a result smaller than the chunk is useful;
+			int nLength = AFLZ4_Compress(pFileBuffer + dwChunkBegin, dwChunkLength, pOutBuffer + dwPos, dwChunkLength - 1);
+			bCompressed = nLength > 0;
+			dwCompressedLength = nLength;
+		}
+		else
+		{
+			bCompressed = Z_OK == compress2(pOutBuffer + dwPos, &dwCompressedLength, pFileBuffer + dwChunkBegin, dwChunkLength, m_nCompressLevel) &&
+				dwCompressedLength < dwChunkLength;
+		}
+
+		// If a chunk can not be compressed smaller, we store it as it is;
+		if( bCompressed )
+			dwPos += dwCompressedLength;
+		else
+		{
+			memcpy(pOutBuffer + dwPos, pFileBuffer + dwChunkBegin, dwChunkLength);
+			dwPos += dwChunkLength;
+		}
+
+		// No gain at all, just store the whole file;
+		if( dwPos >= dwFileLength )
+			return dwFileLength;
+	}
+	pChunkOffsets[nNumChunks] = dwPos;
+
+	return dwPos;
+}
+
+bool AFilePackage::AddEntry(char * szFileName, DWORD dwOffset, DWORD dwLength, DWORD dwCompressedLength, DWORD dwCodec)
+{
+	// Realloc the file entries;
+	if( !ResizeEntries(m_nNumFiles + 1) )
+	{
+		AFERRLOG(("AFilePackage::AddEntry(), Not enough memory!"));
+		return false;
+	}
 
-		if( dwOffset > 0 )
+	// store this file;			
+	int nIndex = m_nNumFiles;
+	char szName[MAX_PATH];
+	m_pEntries[nIndex].dwOffset = dwOffset;
+	m_pEntries[nIndex].dwLength = dwLength;
+	m_pEntries[nIndex].dwCompressedLength = dwCompressedLength;
+	m_pEntries[nIndex].dwNameHash = AFilePackage_NormalizeFileName(szFileName, szName);
+	if( !SetEntryName(nIndex, szFileName, dwCompressedLength < dwLength ? dwCodec : AFPCK_CODEC_STORED) )
+		return false;
+	m_nNumFiles ++;
+
+	if( !AddToIndex(nIndex) )
+		return false;
+
+	m_bHasChanged = true;
+	return true;
+}
+
+bool AFilePackage::AppendFileData(char * szFileName, LPBYTE pData, DWORD dwFileLength, DWORD dwCompressedLength, DWORD dwCodec)
+{
+	if( !AddEntry(szFileName, m_header.dwEntryOffset, dwFileLength, dwCompressedLength, dwCodec) )
+		return false;
+
+	DWORD dwDataLength = min(dwFileLength, dwCompressedLength);
+	fseek(m_fpPackageFile, m_header.dwEntryOffset, SEEK_SET);
+	fwrite(pData, dwDataLength, 1, m_fpPackageFile);
+	m_header.dwEntryOffset += dwDataLength;
+	return true;
+}
+
+// Data of an entry written since the package is opened;
+typedef struct _AFPCK_DATAREGION
+{
+	DWORD		dwCRC;				// CRC32 of the uncompressed data;
+	DWORD		dwOffset;
+	DWORD		dwLength;
+	DWORD		dwCompressedLength;
+	DWORD		dwCodec;
+	int			nNext;				// Next region in the same bucket, -1 means end;
+} AFPCK_DATAREGION;
+
+int AFilePackage::FindDataRegion(LPBYTE pFileBuffer, DWORD dwFileLength, DWORD dwCRC)
+{
+	if( NULL == m_pDataBuckets || 0 == dwFileLength )
+		return -1;
+
+	LPBYTE	pData = NULL;
+	int		nFound = -1;
+
+	// The data is read back only to compare it, it is not a read of the package's files;
+	m_dwQuietThread = GetCurrentThreadId();
+
+	for(int i=m_pDataBuckets[dwCRC & (m_nNumDataBuckets - 1)]; i>=0; i=m_pDataRegions[i].nNext)
+	{
+		AFPCK_DATAREGION& region = m_pDataRegions[i];
+		if( region.dwCRC != dwCRC || region.dwLength != dwFileLength )
+			continue;
+
+		// CRC matched, now read the data back to make sure it is really the same;
+		if( NULL == pData )
 		{
-			AFERRLOG(("AFilePackage::ReadFile(), use a offset for read is not allowed when using a compressed package!"));
-			return false;
+			pData = (LPBYTE) malloc(dwFileLength);
+			if( NULL == pData )
+				break;
 		}
 
-		fread(m_pBuffer, fileEntry.dwCompressedLength, 1, m_fpPackageFile);
-		uncompress(pFileBuffer, &dwFileLength, m_pBuffer, fileEntry.dwCompressedLength);
+		AFPCK_FILEENTRY entry;
+		ZeroMemory(&entry, sizeof(AFPCK_FILEENTRY));
+		entry.dwOffset = region.dwOffset;
+		entry.dwLength = region.dwLength;
+		entry.dwCompressedLength = region.dwCompressedLength;
+		entry.dwCodec = region.dwCodec;
+		entry.nIndex = -1;
+
+		DWORD dwReadLength = dwFileLength;
+		if( ReadFile(entry, pData, 0, &dwReadLength) && 0 == memcmp(pData, pFileBuffer, dwFileLength) )
+		{
+			nFound = i;
+			break;
+		}
 	}
-	else
-		fread(pFileBuffer, fileEntry.dwLength - dwOffset, 1, m_fpPackageFile);
+
+	m_dwQuietThread = 0;
+
+	if( pData )
+		free(pData);
+	return nFound;
+}
+
+void AFilePackage::AddDataRegion(DWORD dwCRC, int nIndex)
+{
+	if( 0 == m_pEntries[nIndex].dwLength )
+		return;
+
+	if( m_nNumDataRegions >= m_nMaxDataRegions )
+	{
+		int nMaxRegions = max(m_nMaxDataRegions * 2, 256);
+		AFPCK_DATAREGION * pRegions = (AFPCK_DATAREGION *) realloc(m_pDataRegions, sizeof(AFPCK_DATAREGION) * nMaxRegions);
+		if( NULL == pRegions )
+			return;
+
+		m_pDataRegions = pRegions;
+		m_nMaxDataRegions = nMaxRegions;
+	}
+
+	// Keep the load factor below 0.5, rehash all regions when it is too crowded;
+	if( m_nNumDataRegions + 1 > m_nNumDataBuckets / 2 )
+	{
+		int nNumBuckets = max(m_nNumDataBuckets * 2, 512);
+		int * pBuckets = (int *) malloc(sizeof(int) * nNumBuckets);
+		if( NULL == pBuckets )
+			return;
+
+		memset(pBuckets, 0xff, sizeof(int) * nNumBuckets);
+		for(int i=0; i<m_nNumDataRegions; i++)
+		{
+			int nBucket = m_pDataRegions[i].dwCRC & (nNumBuckets - 1);
+			m_pDataRegions[i].nNext = pBuckets[nBucket];
+			pBuckets[nBucket] = i;
+		}
+
+		if( m_pDataBuckets )
+			free(m_pDataBuckets);
+		m_pDataBuckets = pBuckets;
+		m_nNumDataBuckets = nNumBuckets;
+	}
+
+	AFPCK_DATAREGION& region = m_pDataRegions[m_nNumDataRegions];
+	region.dwCRC = dwCRC;
+	region.dwOffset = m_pEntries[nIndex].dwOffset;
+	region.dwLength = m_pEntries[nIndex].dwLength;
+	region.dwCompressedLength = m_pEntries[nIndex].dwCompressedLength;
+	region.dwCodec = GetEntryCodec(nIndex);
+
+	int nBucket = dwCRC & (m_nNumDataBuckets - 1);
+	region.nNext = m_pDataBuckets[nBucket];
+	m_pDataBuckets[nBucket] = m_nNumDataRegions;
+	m_nNumDataRegions ++;
+}
+
+bool AFilePackage::AddSharedEntry(char * szFileName, int nRegion)
+{
+	AFPCK_DATAREGION& region = m_pDataRegions[nRegion];
+	if( !AddEntry(szFileName, region.dwOffset, region.dwLength, region.dwCompressedLength, region.dwCodec) )
+		return false;
+
+	m_nNumSharedFiles ++;
+	m_dwSharedBytes += min(region.dwLength, region.dwCompressedLength);
 	return true;
 }
 
+void AFilePackage::ReleaseDataRegions()
+{
+	if( m_pDataRegions )
+	{
+		free(m_pDataRegions);
+		m_pDataRegions = NULL;
+	}
+	if( m_pDataBuckets )
+	{
+		free(m_pDataBuckets);
+		m_pDataBuckets = NULL;
+	}
+
+	m_nNumDataRegions = 0;
+	m_nMaxDataRegions = 0;
+	m_nNumDataBuckets = 0;
+}
+
 bool AFilePackage::AppendFile(char * szFileName, LPBYTE pFileBuffer, DWORD dwFileLength)
 {
 	// We should use a function to check whether szFileName has been added into the package;
@@ -384,50 +1656,257 @@ bool AFilePackage::AppendFile(char * szFileName, LPBYTE pFileBuffer, DWORD dwFil
 		return false;
 	}
 
-	// Realloc the file entries;
-	m_nNumFiles ++;
-	m_pFileEntries = (AFPCK_FILEENTRY *) realloc(m_pFileEntries, sizeof(AFPCK_FILEENTRY) * m_nNumFiles);
-	if( NULL == m_pFileEntries )
+	// Identical data written before is shared instead of written again;
+	DWORD dwCRC = 0;
+	if( m_bShareData && dwFileLength > 0 )
 	{
-		AFERRLOG(("AFilePackage::AppendFile(), Not enough memory!"));
-		return false;
+		dwCRC = crc32(0, pFileBuffer, dwFileLength);
+		int nRegion = FindDataRegion(pFileBuffer, dwFileLength, dwCRC);
+		if( nRegion >= 0 )
+			return AddSharedEntry(szFileName, nRegion);
 	}
 
-	DWORD dwCompressedLength = dwFileLength;
 	// First we should compress the file if needed;
-	if( g_bCompressEnable )
+	DWORD dwCodec = GetFileCodec(szFileName);
+	DWORD dwCompressedLength = CompressFile(pFileBuffer, dwFileLength, dwCodec);
+
+	// If can't compress, we will use the origin file buffer directly;
+	if( !AppendFileData(szFileName, dwCompressedLength < dwFileLength ? m_pBuffer : pFileBuffer, dwFileLength, dwCompressedLength, dwCodec) )
+		return false;
+
+	if( m_bShareData )
+		AddDataRegion(dwCRC, m_nNumFiles - 1);
+	return true;
+}
+
+// A file to be read and compressed by the build threads of AppendFiles;
+typedef struct _AFPCK_BUILDJOB
+{
+	LPBYTE			pFileBuffer;
+	DWORD			dwFileLength;
+	LPBYTE			pCompressed;
+	DWORD			dwCompressedLength;
+	DWORD			dwCodec;
+	DWORD			dwCRC;			// CRC32 of the file if the data can be shared;
+	volatile bool	bDone;
+	bool			bFailed;
+} AFPCK_BUILDJOB;
+
+typedef struct _AFPCK_BUILDCONTEXT
+{
+	AFilePackage *	pPackage;
+	char **			aFileNames;
+	char **			aDiskFiles;
+	AFPCK_BUILDJOB *	pJobs;
+	int				nNumJobs;
+	volatile LONG	nNextJob;
+	volatile bool	bQuit;
+	HANDLE			hSlots;		// Limit the jobs being held in memory;
+	HANDLE			hProgress;	// Signaled when a job is done;
+} AFPCK_BUILDCONTEXT;
+
+DWORD WINAPI AFilePackage::BuildThread(LPVOID pArg)
+{
+	AFPCK_BUILDCONTEXT * pContext = (AFPCK_BUILDCONTEXT *) pArg;
+
+	while( true )
 	{
-		if( !PrepareBuffer(dwFileLength) )
-			return false;
+		WaitForSingleObject(pContext->hSlots, INFINITE);
+
+		// Jobs are taken in order, so the one being written is always taken before the later ones;
+		int nIndex = InterlockedIncrement(&pContext->nNextJob) - 1;
+		if( pContext->bQuit || nIndex >= pContext->nNumJobs )
+		{
+			ReleaseSemaphore(pContext->hSlots, 1, NULL);
+			break;
+		}
 
-		compress2(m_pBuffer, &dwCompressedLength, pFileBuffer, dwFileLength, 1);
+		AFPCK_BUILDJOB * pJob = &pContext->pJobs[nIndex];
+		pJob->bFailed = !pContext->pPackage->PrepareBuildJob(pContext->aFileNames[nIndex], pContext->aDiskFiles[nIndex], pJob);
+		pJob->bDone = true;
+		SetEvent(pContext->hProgress);
 	}
 
-	// store this file;			
-	strncpy(m_pFileEntries[m_nNumFiles - 1].szFileName, szFileName, MAX_PATH);
-	m_pFileEntries[m_nNumFiles - 1].dwOffset = m_header.dwEntryOffset;
-	m_pFileEntries[m_nNumFiles - 1].dwLength = dwFileLength;
-	m_pFileEntries[m_nNumFiles - 1].dwCompressedLength = dwCompressedLength;
-	
-	fseek(m_fpPackageFile, m_header.dwEntryOffset, SEEK_SET);
-	// If can't compress, we will use the origin file buffer directly;
-	if( dwCompressedLength < dwFileLength )
+	// Return what this build thread has cached, or it is lost when the thread exits;
+	afastflush();
+	return 0;
+}
+
+bool AFilePackage::PrepareBuildJob(char * szFileName, char * szDiskFile, AFPCK_BUILDJOB * pJob)
+{
+	FILE * pFile = fopen(szDiskFile, "rb");
+	if( NULL == pFile )
 	{
-		// We write the compressed buffer into the disk;
-		fwrite(m_pBuffer, dwCompressedLength, 1, m_fpPackageFile);
-		m_header.dwEntryOffset += dwCompressedLength;
+		AFERRLOG(("AFilePackage::AppendFiles(), Can not open file [%s]!", szDiskFile));
+		return false;
 	}
-	else
+
+	fseek(pFile, 0, SEEK_END);
+	pJob->dwFileLength = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+
+	pJob->pFileBuffer = (LPBYTE) malloc(pJob->dwFileLength + 1);
+	if( NULL == pJob->pFileBuffer )
 	{
-		fwrite(pFileBuffer, dwFileLength, 1, m_fpPackageFile);
-		m_header.dwEntryOffset += dwFileLength;
+		AFERRLOG(("AFilePackage::AppendFiles(), Not enough memory!"));
+		fclose(pFile);
+		return false;
 	}
 
-	m_bHasChanged = true;
-	m_bHasSorted = false;
+	if( pJob->dwFileLength && 1 != fread(pJob->pFileBuffer, pJob->dwFileLength, 1, pFile) )
+	{
+		AFERRLOG(("AFilePackage::AppendFiles(), Can not read file [%s]!", szDiskFile));
+		fclose(pFile);
+		return false;
+	}
+	fclose(pFile);
+
+	if( m_bShareData && pJob->dwFileLength > 0 )
+		pJob->dwCRC = crc32(0, pJob->pFileBuffer, pJob->dwFileLength);
+
+	pJob->dwCompressedLength = pJob->dwFileLength;
+	if( !g_bCompressEnable )
+		return true;
+
+	pJob->pCompressed = (LPBYTE) malloc(GetCompressBound(pJob->dwFileLength));
+	if( NULL == pJob->pCompressed )
+	{
+		AFERRLOG(("AFilePackage::AppendFiles(), Not enough memory!"));
+		return false;
+	}
+
+	pJob->dwCodec = GetFileCodec(szFileName);
+	pJob->dwCompressedLength = CompressFileInto(pJob->pFileBuffer, pJob->dwFileLength, pJob->pCompressed, pJob->dwCodec);
 	return true;
 }
 
+bool AFilePackage::AppendFiles(char ** aFileNames, char ** aDiskFiles, int nNumFiles, int nNumThreads)
+{
+	if( m_bReadOnly )
+	{
+		AFERRLOG(("AFilePackage::AppendFiles(), Read only package, can not append!"));
+		return false;
+	}
+
+	if( nNumFiles <= 0 )
+		return true;
+
+	if( nNumThreads <= 0 )
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		nNumThreads = info.dwNumberOfProcessors;
+	}
+	nNumThreads = max(1, min(nNumThreads, AFPCK_MAXBUILDTHREAD));
+
+	bool				bRet = false;
+	int					nNumCreated = 0;
+	int					i;
+	HANDLE				aThreads[AFPCK_MAXBUILDTHREAD];
+	AFPCK_BUILDCONTEXT	context;
+
+	ZeroMemory(&context, sizeof(context));
+	context.pPackage	= this;
+	context.aFileNames	= aFileNames;
+	context.aDiskFiles	= aDiskFiles ? aDiskFiles : aFileNames;
+	context.nNumJobs	= nNumFiles;
+	context.pJobs		= (AFPCK_BUILDJOB *) malloc(sizeof(AFPCK_BUILDJOB) * nNumFiles);
+	context.hSlots		= CreateSemaphore(NULL, nNumThreads * 2, nNumThreads * 3, NULL);
+	context.hProgress	= CreateEvent(NULL, FALSE, FALSE, NULL);
+	if( NULL == context.pJobs || NULL == context.hSlots || NULL == context.hProgress )
+	{
+		AFERRLOG(("AFilePackage::AppendFiles(), Not enough memory!"));
+		goto EXIT;
+	}
+	ZeroMemory(context.pJobs, sizeof(AFPCK_BUILDJOB) * nNumFiles);
+
+	for(nNumCreated=0; nNumCreated<nNumThreads; nNumCreated++)
+	{
+		DWORD dwThreadID;
+		aThreads[nNumCreated] = CreateThread(NULL, 0, BuildThread, &context, 0, &dwThreadID);
+		if( NULL == aThreads[nNumCreated] )
+		{
+			AFERRLOG(("AFilePackage::AppendFiles(), Can not create build thread!"));
+			context.bQuit = true;
+			goto EXIT;
+		}
+	}
+
+	// Write the files in the given order, whichever thread compressed them;
+	for(i=0; i<nNumFiles; i++)
+	{
+		AFPCK_BUILDJOB * pJob = &context.pJobs[i];
+		while( !pJob->bDone )
+			WaitForSingleObject(context.hProgress, INFINITE);
+
+		if( pJob->bFailed )
+		{
+			context.bQuit = true;
+			goto EXIT;
+		}
+
+		// The data of identical files is shared, this is decided here so the package does not
+		// depend on which thread finishes first;
+		int nRegion = m_bShareData ? FindDataRegion(pJob->pFileBuffer, pJob->dwFileLength, pJob->dwCRC) : -1;
+		bool bCompressed = pJob->dwCompressedLength < pJob->dwFileLength;
+		bool bAdded;
+		if( nRegion >= 0 )
+			bAdded = AddSharedEntry(aFileNames[i], nRegion);
+		else
+		{
+			bAdded = AppendFileData(aFileNames[i], bCompressed ? pJob->pCompressed : pJob->pFileBuffer, pJob->dwFileLength, pJob->dwCompressedLength, pJob->dwCodec);
+			if( bAdded && m_bShareData )
+				AddDataRegion(pJob->dwCRC, m_nNumFiles - 1);
+		}
+
+		if( !bAdded )
+		{
+			context.bQuit = true;
+			goto EXIT;
+		}
+
+		free(pJob->pFileBuffer);
+		pJob->pFileBuffer = NULL;
+		if( pJob->pCompressed )
+		{
+			free(pJob->pCompressed);
+			pJob->pCompressed = NULL;
+		}
+
+		ReleaseSemaphore(context.hSlots, 1, NULL);
+	}
+
+	bRet = true;
+
+EXIT:
+	// Threads waiting for a slot will see bQuit when they get one;
+	if( !bRet && context.hSlots )
+		ReleaseSemaphore(context.hSlots, nNumThreads, NULL);
+
+	if( nNumCreated > 0 )
+		WaitForMultipleObjects(nNumCreated, aThreads, TRUE, INFINITE);
+	for(i=0; i<nNumCreated; i++)
+		CloseHandle(aThreads[i]);
+
+	if( context.pJobs )
+	{
+		for(i=0; i<nNumFiles; i++)
+		{
+			if( context.pJobs[i].pFileBuffer )
+				free(context.pJobs[i].pFileBuffer);
+			if( context.pJobs[i].pCompressed )
+				free(context.pJobs[i].pCompressed);
+		}
+		free(context.pJobs);
+	}
+
+	if( context.hSlots )
+		CloseHandle(context.hSlots);
+	if( context.hProgress )
+		CloseHandle(context.hProgress);
+	return bRet;
+}
+
 bool AFilePackage::RemoveFile(char * szFileName)
 {
 	if( m_bReadOnly )
@@ -444,22 +1923,21 @@ bool AFilePackage::RemoveFile(char * szFileName)
 		return false;
 	}
 	
-	// We only remove the file's entry, but leave the file's body there
-	for(int i=nIndex; i<m_nNumFiles-1; i++)
-	{
-		memcpy(&m_pFileEntries[i], &m_pFileEntries[i + 1], sizeof(AFPCK_FILEENTRY));	
-	}
+	// We only remove the file's entry, but leave the file's body there, and its name is
+	// left in the name pool until the entry list is written;
+	int nNumMoved = m_nNumFiles - 1 - nIndex;
+	memmove(&m_pEntries[nIndex], &m_pEntries[nIndex + 1], sizeof(AFPCK_PACKEDENTRY) * nNumMoved);
+	memmove(&m_pEntryNames[nIndex], &m_pEntryNames[nIndex + 1], sizeof(DWORD) * nNumMoved);
+	if( m_pEntryStats )
+		memmove(&m_pEntryStats[nIndex], &m_pEntryStats[nIndex + 1], sizeof(AFPCK_ENTRYSTATS) * nNumMoved);
 
 	m_nNumFiles --;
-	m_pFileEntries = (AFPCK_FILEENTRY *) realloc(m_pFileEntries, sizeof(AFPCK_FILEENTRY) * m_nNumFiles);
-	if( NULL == m_pFileEntries )
-	{
-		AFERRLOG(("AFilePackage::AppendFile(), Not enough memory!"));
+
+	// The entries after the removed one have been moved, so rehash them all;
+	if( !BuildIndex() )
 		return false;
-	}
 
 	m_bHasChanged = true;
-	m_bHasSorted = false;
 	return true;
 }
 
@@ -480,22 +1958,39 @@ bool AFilePackage::ReplaceFile(char * szFileName, LPBYTE pFileBuffer, DWORD dwFi
 		return false;
 	}
 
+	// Identical data written before is shared, the entry just points to it;
+	DWORD dwCRC = 0;
+	if( m_bShareData && dwFileLength > 0 )
+	{
+		dwCRC = crc32(0, pFileBuffer, dwFileLength);
+		int nRegion = FindDataRegion(pFileBuffer, dwFileLength, dwCRC);
+		if( nRegion >= 0 )
+		{
+			AFPCK_DATAREGION& region = m_pDataRegions[nRegion];
+			m_pEntries[nIndex].dwOffset = region.dwOffset;
+			m_pEntries[nIndex].dwLength = region.dwLength;
+			m_pEntries[nIndex].dwCompressedLength = region.dwCompressedLength;
+			m_pEntryNames[nIndex] = (m_pEntryNames[nIndex] & AFPCK_NAMEOFFSETMASK) | (region.dwCodec << AFPCK_NAMECODECSHIFT);
+
+			m_nNumSharedFiles ++;
+			m_dwSharedBytes += min(region.dwLength, region.dwCompressedLength);
+			m_bHasChanged = true;
+			return true;
+		}
+	}
+
 	// we only add a new file copy at the end of the file part, and modify the 
 	// file entry point to that file body;
-	DWORD dwCompressedLength = dwFileLength;
 	// First we should compress the file if needed;
-	if( g_bCompressEnable )
-	{
-		if( !PrepareBuffer(dwFileLength) )
-			return false;
-
-		compress2(m_pBuffer, &dwCompressedLength, pFileBuffer, dwFileLength, 1);
-	}
+	DWORD dwCodec = GetFileCodec(szFileName);
+	DWORD dwCompressedLength = CompressFile(pFileBuffer, dwFileLength, dwCodec);
 
 	// modify this file entry to point to the new file body;			
-	m_pFileEntries[nIndex].dwOffset = m_header.dwEntryOffset;
-	m_pFileEntries[nIndex].dwLength = dwFileLength;
-	m_pFileEntries[nIndex].dwCompressedLength = dwCompressedLength;
+	m_pEntries[nIndex].dwOffset = m_header.dwEntryOffset;
+	m_pEntries[nIndex].dwLength = dwFileLength;
+	m_pEntries[nIndex].dwCompressedLength = dwCompressedLength;
+	m_pEntryNames[nIndex] = (m_pEntryNames[nIndex] & AFPCK_NAMEOFFSETMASK) | 
+		((dwCompressedLength < dwFileLength ? dwCodec : AFPCK_CODEC_STORED) << AFPCK_NAMECODECSHIFT);
 	
 	fseek(m_fpPackageFile, m_header.dwEntryOffset, SEEK_SET);
 	// If can't compress, we will use the origin file buffer directly;
@@ -511,43 +2006,263 @@ bool AFilePackage::ReplaceFile(char * szFileName, LPBYTE pFileBuffer, DWORD dwFi
 		m_header.dwEntryOffset += dwFileLength;
 	}
 
+	if( m_bShareData )
+		AddDataRegion(dwCRC, nIndex);
+
+	// The file name is not changed, so the hashed index is still valid;
 	m_bHasChanged = true;
-	m_bHasSorted = false;
 	return true;
 }
 
+// The context is the name pool and the array of entry names;
+typedef struct _AFPCK_SORTCONTEXT
+{
+	const char *	pNamePool;
+	const DWORD *	pEntryNames;
+} AFPCK_SORTCONTEXT;
+
+static int EntryCompare(void * pContext, const void * p1, const void * p2)
+{
+	AFPCK_SORTCONTEXT * pSort = (AFPCK_SORTCONTEXT *) pContext;
+	const char * szName1 = pSort->pNamePool + (pSort->pEntryNames[*(int *) p1] & AFPCK_NAMEOFFSETMASK);
+	const char * szName2 = pSort->pNamePool + (pSort->pEntryNames[*(int *) p2] & AFPCK_NAMEOFFSETMASK);
+	return _stricmp(szName1, szName2);
+}
+
 bool AFilePackage::ResortEntries()
 {
-	int					nBestIndex;
-	char				*szBestName;
-	AFPCK_FILEENTRY		temp;
+	if( m_nNumFiles > 1 )
+	{
+		// Sort the entry indices by name, then move the entries into that order;
+		int * pOrder = (int *) malloc(sizeof(int) * m_nNumFiles);
+		AFPCK_PACKEDENTRY * pEntries = (AFPCK_PACKEDENTRY *) malloc(sizeof(AFPCK_PACKEDENTRY) * m_nNumFiles);
+		DWORD * pEntryNames = (DWORD *) malloc(sizeof(DWORD) * m_nNumFiles);
+		if( NULL == pOrder || NULL == pEntries || NULL == pEntryNames )
+		{
+			AFERRLOG(("AFilePackage::ResortEntries(), Not enough memory!"));
+			if( pOrder ) free(pOrder);
+			if( pEntries ) free(pEntries);
+			if( pEntryNames ) free(pEntryNames);
+			return false;
+		}
+
+		int i;
+		for(i=0; i<m_nNumFiles; i++)
+			pOrder[i] = i;
+
+		AFPCK_SORTCONTEXT context;
+		context.pNamePool = m_pNamePool;
+		context.pEntryNames = m_pEntryNames;
+		qsort_s(pOrder, m_nNumFiles, sizeof(int), EntryCompare, &context);
+
+		for(i=0; i<m_nNumFiles; i++)
+		{
+			pEntries[i] = m_pEntries[pOrder[i]];
+			pEntryNames[i] = m_pEntryNames[pOrder[i]];
+		}
+
+		free(m_pEntries);
+		free(m_pEntryNames);
+		free(pOrder);
+		m_pEntries = pEntries;
+		m_pEntryNames = pEntryNames;
+	}
+
+	// Entry indices have been changed, and the statistics can not follow them;
+	if( m_pEntryStats )
+		ZeroMemory(m_pEntryStats, sizeof(AFPCK_ENTRYSTATS) * m_nNumFiles);
+
+	return BuildIndex();
+}
+
+typedef struct _AFPCK_COMPACTITEM
+{
+	DWORD		dwOffset;
+	int			nIndex;
+} AFPCK_COMPACTITEM;
+
+static int CompactItemCompare(const void * p1, const void * p2)
+{
+	DWORD dwOffset1 = ((AFPCK_COMPACTITEM *) p1)->dwOffset;
+	DWORD dwOffset2 = ((AFPCK_COMPACTITEM *) p2)->dwOffset;
+	if( dwOffset1 != dwOffset2 )
+		return dwOffset1 < dwOffset2 ? -1 : 1;
+
+	return ((AFPCK_COMPACTITEM *) p1)->nIndex - ((AFPCK_COMPACTITEM *) p2)->nIndex;
+}
+
+bool AFilePackage::Compact(char * szNewPckPath, char ** aOrderNames, int nNumOrderNames, DWORD * pdwSavedBytes)
+{
+	if( pdwSavedBytes )
+		*pdwSavedBytes = 0;
+
+	if( m_mode == AFPCK_CREATENEW )
+	{
+		AFERRLOG(("AFilePackage::Compact(), Can not compact a package being created!"));
+		return false;
+	}
+
+	bool					bRet = false;
+	int						nNumPlaced = 0;
+	int						nNumRest = 0;
+	int						i;
+	AFilePackage			newPack;
+	AFPCK_COMPACTITEM *		pItems = NULL;
+	int *					pDataOrder = (int *) malloc(sizeof(int) * (m_nNumFiles + 1));
+	BYTE *					pPlaced = (BYTE *) malloc(m_nNumFiles + 1);
+	int						nNumCopiedBuckets = 256;
+	int *					pCopiedBuckets = NULL;	// Entries whose data has been copied, hashed by the old offset;
+	int *					pCopiedNext = NULL;
+
+	while( nNumCopiedBuckets < m_nNumFiles * 2 )
+		nNumCopiedBuckets <<= 1;
+	pCopiedBuckets = (int *) malloc(sizeof(int) * nNumCopiedBuckets);
+	pCopiedNext = (int *) malloc(sizeof(int) * (m_nNumFiles + 1));
+	if( NULL == pDataOrder || NULL == pPlaced || NULL == pCopiedBuckets || NULL == pCopiedNext )
+	{
+		AFERRLOG(("AFilePackage::Compact(), Not enough memory!"));
+		goto EXIT;
+	}
+	ZeroMemory(pPlaced, m_nNumFiles + 1);
+	memset(pCopiedBuckets, 0xff, sizeof(int) * nNumCopiedBuckets);
 
-	for(int i=0; i<m_nNumFiles-1; i++)
+	// First the files in the given order;
+	for(i=0; i<nNumOrderNames; i++)
 	{
-		nBestIndex = i;
-		szBestName = m_pFileEntries[i].szFileName;
-		for(int j=i+1; j<m_nNumFiles; j++)
+		AFPCK_FILEENTRY	entry;
+		int				nIndex;
+		if( !GetFileEntry(aOrderNames[i], &entry, &nIndex) || pPlaced[nIndex] )
+			continue;
+
+		pPlaced[nIndex] = 1;
+		pDataOrder[nNumPlaced ++] = nIndex;
+	}
+
+	// Then the others in the order of their old offsets, so the old package is read sequentially;
+	pItems = (AFPCK_COMPACTITEM *) malloc(sizeof(AFPCK_COMPACTITEM) * (m_nNumFiles - nNumPlaced + 1));
+	if( NULL == pItems )
+	{
+		AFERRLOG(("AFilePackage::Compact(), Not enough memory!"));
+		goto EXIT;
+	}
+
+	for(i=0; i<m_nNumFiles; i++)
+	{
+		if( pPlaced[i] )
+			continue;
+
+		pItems[nNumRest].dwOffset = m_pEntries[i].dwOffset;
+		pItems[nNumRest].nIndex = i;
+		nNumRest ++;
+	}
+
+	if( nNumRest > 1 )
+		qsort(pItems, nNumRest, sizeof(AFPCK_COMPACTITEM), CompactItemCompare);
+
+	for(i=0; i<nNumRest; i++)
+		pDataOrder[nNumPlaced ++] = pItems[i].nIndex;
+
+	if( !newPack.Open(szNewPckPath, AFPCK_CREATENEW) )
+	{
+		AFERRLOG(("AFilePackage::Compact(), Can not create package [%s]!", szNewPckPath));
+		goto EXIT;
+	}
+
+	// The data is copied as it is, so the new package must keep this package's version;
+	newPack.m_header = m_header;
+	newPack.m_header.dwEntryOffset = 0;
+
+	newPack.m_pEntries = (AFPCK_PACKEDENTRY *) malloc(sizeof(AFPCK_PACKEDENTRY) * (m_nNumFiles + 1));
+	newPack.m_pEntryNames = (DWORD *) malloc(sizeof(DWORD) * (m_nNumFiles + 1));
+	newPack.m_pNamePool = (char *) malloc(m_dwNamePoolSize + 1);
+	if( NULL == newPack.m_pEntries || NULL == newPack.m_pEntryNames || NULL == newPack.m_pNamePool )
+	{
+		AFERRLOG(("AFilePackage::Compact(), Not enough memory!"));
+		newPack.Close();
+		goto EXIT;
+	}
+	memcpy(newPack.m_pEntries, m_pEntries, sizeof(AFPCK_PACKEDENTRY) * m_nNumFiles);
+	memcpy(newPack.m_pEntryNames, m_pEntryNames, sizeof(DWORD) * m_nNumFiles);
+	memcpy(newPack.m_pNamePool, m_pNamePool, m_dwNamePoolSize);
+	newPack.m_dwNamePoolSize = m_dwNamePoolSize;
+	newPack.m_dwNamePoolCapacity = m_dwNamePoolSize + 1;
+	newPack.m_nNumFiles = m_nNumFiles;
+
+	for(i=0; i<m_nNumFiles; i++)
+	{
+		AFPCK_PACKEDENTRY& entry = newPack.m_pEntries[pDataOrder[i]];
+		DWORD dwOldOffset = m_pEntries[pDataOrder[i]].dwOffset;
+		DWORD dwDataLength = min(entry.dwLength, entry.dwCompressedLength);
+
+		// Entries sharing data in this package share it in the new package too;
+		int nBucket = (dwOldOffset ^ (dwOldOffset >> 12)) & (nNumCopiedBuckets - 1);
+		int nCopied;
+		for(nCopied=pCopiedBuckets[nBucket]; nCopied>=0; nCopied=pCopiedNext[nCopied])
 		{
-			if( _stricmp(m_pFileEntries[j].szFileName, szBestName) < 0 )
-			{
-				nBestIndex = j;
-				szBestName = m_pFileEntries[j].szFileName;
-			}
+			if( m_pEntries[nCopied].dwOffset == dwOldOffset && m_pEntries[nCopied].dwLength == entry.dwLength &&
+				m_pEntries[nCopied].dwCompressedLength == entry.dwCompressedLength )
+				break;
+		}
+		if( nCopied >= 0 )
+		{
+			entry.dwOffset = newPack.m_pEntries[nCopied].dwOffset;
+			continue;
+		}
+
+		pCopiedNext[pDataOrder[i]] = pCopiedBuckets[nBucket];
+		pCopiedBuckets[nBucket] = pDataOrder[i];
+
+		entry.dwOffset = newPack.m_header.dwEntryOffset;
+		if( 0 == dwDataLength )
+			continue;
+
+		LPBYTE pPrivate;
+		const BYTE * pData = GetPackageData(m_pEntries[pDataOrder[i]].dwOffset, dwDataLength, &pPrivate);
+		if( NULL == pData )
+		{
+			AFERRLOG(("AFilePackage::Compact(), Can not read file [%s]!", GetEntryName(pDataOrder[i])));
+			newPack.Close();
+			DeleteFile(szNewPckPath);
+			goto EXIT;
 		}
 
-		if( nBestIndex != i )
+		bool bWritten = 1 == fwrite(pData, dwDataLength, 1, newPack.m_fpPackageFile);
+		if( pPrivate )
+			free(pPrivate);
+
+		if( !bWritten )
 		{
-			temp = m_pFileEntries[i];
-			m_pFileEntries[i] = m_pFileEntries[nBestIndex];
-			m_pFileEntries[nBestIndex] = temp;
+			AFERRLOG(("AFilePackage::Compact(), Can not write file [%s] into package [%s]!", GetEntryName(pDataOrder[i]), szNewPckPath));
+			newPack.Close();
+			DeleteFile(szNewPckPath);
+			goto EXIT;
 		}
+
+		newPack.m_header.dwEntryOffset += dwDataLength;
 	}
 
-	m_bHasSorted = true;
-	return true;
+	if( pdwSavedBytes )
+		*pdwSavedBytes = m_header.dwEntryOffset - newPack.m_header.dwEntryOffset;
+
+	// The entry list and the header are written when closing;
+	newPack.Close();
+	bRet = true;
+
+EXIT:
+	if( pCopiedBuckets )
+		free(pCopiedBuckets);
+	if( pCopiedNext )
+		free(pCopiedNext);
+	if( pItems )
+		free(pItems);
+	if( pPlaced )
+		free(pPlaced);
+	if( pDataOrder )
+		free(pDataOrder);
+	return bRet;
 }
 
-bool OpenFilePackage(char * szPackFile)
+bool OpenFilePackage(char * szPackFile, AFPCK_OPENMODE mode)
 {
 	if( g_pAFilePackage )
 		CloseFilePackage();
@@ -559,7 +2274,7 @@ bool OpenFilePackage(char * szPackFile)
 		return false;
 	}
 
-	if( !g_pAFilePackage->Open(szPackFile, AFPCK_OPENEXIST) )
+	if( !g_pAFilePackage->Open(szPackFile, mode) )
 	{
 		AFERRLOG(("OpenFilePackage(), Can not open package [%s]", szPackFile));
 		return false;
@@ -569,6 +2284,10 @@ bool OpenFilePackage(char * szPackFile)
 
 bool CloseFilePackage()
 {
+	// The cached images are keyed by the offsets in this package;
+	if( g_pAFileImageCache )
+		g_pAFileImageCache->Flush();
+
 	if( g_pAFilePackage )
 	{
 		g_pAFilePackage->Close();
@@ -0,0 +1,475 @@
+/*
+ * FILE: AFilePrefetch.cpp
+ *
+ * DESCRIPTION: A class which loads file images ahead of time on background threads
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "AFPI.h"
+#include "AFilePrefetch.h"
+#include "AFileImage.h"
+#include "AFilePackage.h"
+#include "AFI.h"
+#include "allocator.h"
+
+AFilePrefetcher * g_pAFilePrefetcher = NULL;
+
+AFilePrefetcher::AFilePrefetcher()
+{
+	m_hQueueSemaphore	= NULL;
+	m_hIdleEvent		= NULL;
+
+	ZeroMemory(m_aThreads, sizeof(m_aThreads));
+	m_nNumThreads		= 0;
+	m_bQuit				= false;
+
+	m_pQueueHead		= NULL;
+	m_pQueueTail		= NULL;
+	ZeroMemory(m_aBuckets, sizeof(m_aBuckets));
+	m_nNumBusy			= 0;
+	m_dwReadyBytes		= 0;
+
+	InitializeCriticalSection(&m_csAccess);
+}
+
+AFilePrefetcher::~AFilePrefetcher()
+{
+	DeleteCriticalSection(&m_csAccess);
+}
+
+bool AFilePrefetcher::Init(int nNumThreads)
+{
+	if( nNumThreads < 1 )
+		nNumThreads = 1;
+	else if( nNumThreads > AFPREFETCH_MAXTHREAD )
+		nNumThreads = AFPREFETCH_MAXTHREAD;
+
+	m_bQuit = false;
+
+	m_hQueueSemaphore = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+	m_hIdleEvent = CreateEvent(NULL, TRUE, TRUE, NULL);
+	if( NULL == m_hQueueSemaphore || NULL == m_hIdleEvent )
+	{
+		AFERRLOG(("AFilePrefetcher::Init(), Can not create synchronization objects!"));
+		return false;
+	}
+
+	for(int i=0; i<nNumThreads; i++)
+	{
+		DWORD dwThreadID;
+		m_aThreads[i] = CreateThread(NULL, 0, IOThread, this, 0, &dwThreadID);
+		if( NULL == m_aThreads[i] )
+		{
+			AFERRLOG(("AFilePrefetcher::Init(), Can not create IO thread!"));
+			return false;
+		}
+
+		// IO threads should not take time from the render thread;
+		SetThreadPriority(m_aThreads[i], THREAD_PRIORITY_BELOW_NORMAL);
+		m_nNumThreads ++;
+	}
+
+	return true;
+}
+
+bool AFilePrefetcher::Release()
+{
+	// Let all IO threads quit;
+	m_bQuit = true;
+	if( m_hQueueSemaphore && m_nNumThreads )
+		ReleaseSemaphore(m_hQueueSemaphore, m_nNumThreads, NULL);
+
+	for(int i=0; i<m_nNumThreads; i++)
+	{
+		WaitForSingleObject(m_aThreads[i], INFINITE);
+		CloseHandle(m_aThreads[i]);
+		m_aThreads[i] = NULL;
+	}
+	m_nNumThreads = 0;
+
+	// Now no one else is using the items;
+	DiscardAll();
+
+	AFPREFETCH_ITEM * pItem = m_pQueueHead;
+	while( pItem )
+	{
+		AFPREFETCH_ITEM * pNext = pItem->pNextInQueue;
+		pItem->bInQueue = false;
+		FreeItemIfUnused(pItem);
+		pItem = pNext;
+	}
+	m_pQueueHead = m_pQueueTail = NULL;
+	m_nNumBusy = 0;
+
+	// Nothing is pending now, so wake up anyone still waiting for the queue to be idle;
+	if( m_hIdleEvent )
+		SetEvent(m_hIdleEvent);
+
+	if( m_hQueueSemaphore )
+	{
+		CloseHandle(m_hQueueSemaphore);
+		m_hQueueSemaphore = NULL;
+	}
+	if( m_hIdleEvent )
+	{
+		CloseHandle(m_hIdleEvent);
+		m_hIdleEvent = NULL;
+	}
+
+	return true;
+}
+
+AFilePrefetcher::AFPREFETCH_ITEM * AFilePrefetcher::FindItem(DWORD dwNameHash, const char * szRelativeName)
+{
+	AFPREFETCH_ITEM * pItem = m_aBuckets[dwNameHash & (AFPREFETCH_BUCKETNUM - 1)];
+	while( pItem )
+	{
+		if( pItem->dwNameHash == dwNameHash && 0 == _stricmp(pItem->szRelativeName, szRelativeName) )
+			return pItem;
+
+		pItem = pItem->pNextInBucket;
+	}
+
+	return NULL;
+}
+
+void AFilePrefetcher::RemoveFromTable(AFPREFETCH_ITEM * pItem)
+{
+	AFPREFETCH_ITEM ** ppItem = &m_aBuckets[pItem->dwNameHash & (AFPREFETCH_BUCKETNUM - 1)];
+	while( *ppItem )
+	{
+		if( *ppItem == pItem )
+		{
+			*ppItem = pItem->pNextInBucket;
+			break;
+		}
+
+		ppItem = &(*ppItem)->pNextInBucket;
+	}
+
+	pItem->pNextInBucket = NULL;
+	pItem->nState = AFPREFETCH_TAKEN;
+}
+
+void AFilePrefetcher::FreeItemIfUnused(AFPREFETCH_ITEM * pItem)
+{
+	// The queue or a waiting thread still holds this item;
+	if( pItem->nState != AFPREFETCH_TAKEN || pItem->bInQueue || pItem->nNumWaiters > 0 )
+		return;
+
+	if( pItem->pImage )
+	{
+		free(pItem->pImage);
+		pItem->pImage = NULL;
+	}
+
+	if( pItem->hDone )
+		CloseHandle(pItem->hDone);
+
+	delete pItem;
+}
+
+int AFilePrefetcher::Prefetch(char ** aFileNames, int nNumFiles, AFPREFETCH_CALLBACK pfnCallback, LPVOID pArg)
+{
+	int nNumQueued = 0;
+
+	EnterCriticalSection(&m_csAccess);
+
+	for(int i=0; i<nNumFiles; i++)
+	{
+		char szRelativeName[MAX_PATH];
+		char szNormalizedName[MAX_PATH];
+
+		AFileMod_GetRelativePath(aFileNames[i], szRelativeName);
+		DWORD dwNameHash = AFilePackage_NormalizeFileName(szRelativeName, szNormalizedName);
+
+		if( FindItem(dwNameHash, szNormalizedName) )
+			continue;
+
+		AFPREFETCH_ITEM * pItem = new AFPREFETCH_ITEM;
+		if( NULL == pItem )
+		{
+			AFERRLOG(("AFilePrefetcher::Prefetch(), Not enough memory!"));
+			break;
+		}
+
+		ZeroMemory(pItem, sizeof(AFPREFETCH_ITEM));
+		strncpy(pItem->szFullName, aFileNames[i], MAX_PATH);
+		strncpy(pItem->szRelativeName, szNormalizedName, MAX_PATH);
+		pItem->dwNameHash	= dwNameHash;
+		pItem->nState		= AFPREFETCH_QUEUED;
+		pItem->pfnCallback	= pfnCallback;
+		pItem->pArg			= pArg;
+		pItem->hDone		= CreateEvent(NULL, TRUE, FALSE, NULL);
+		pItem->bInQueue		= true;
+
+		// Add to name table;
+		AFPREFETCH_ITEM ** ppBucket = &m_aBuckets[dwNameHash & (AFPREFETCH_BUCKETNUM - 1)];
+		pItem->pNextInBucket = *ppBucket;
+		*ppBucket = pItem;
+
+		// Add to the tail of the queue;
+		if( m_pQueueTail )
+			m_pQueueTail->pNextInQueue = pItem;
+		else
+			m_pQueueHead = pItem;
+		m_pQueueTail = pItem;
+
+		if( 0 == m_nNumBusy ++ )
+			ResetEvent(m_hIdleEvent);
+
+		nNumQueued ++;
+	}
+
+	LeaveCriticalSection(&m_csAccess);
+
+	if( nNumQueued )
+		ReleaseSemaphore(m_hQueueSemaphore, nNumQueued, NULL);
+
+	return nNumQueued;
+}
+
+void AFilePrefetcher::LoadItem(AFPREFETCH_ITEM * pItem)
+{
+	LPBYTE	pImage;
+	int		nLength;
+	bool	bMapped;
+	bool	bSuccess = AFileImage::ReadImage(pItem->szFullName, pItem->szRelativeName, &pImage, &nLength, &bMapped);
+
+	if( bSuccess && bMapped )
+	{
+		// The file is in a mapped package, we only touch every page so that it is in memory,
+		// AFileImage will use the mapped data directly;
+		volatile BYTE byteSum = 0;
+		for(int i=0; i<nLength; i+=4096)
+			byteSum += pImage[i];
+		pImage = NULL;
+		nLength = 0;
+	}
+
+	AFPREFETCH_CALLBACK	pfnCallback = pItem->pfnCallback;
+	LPVOID				pArg = pItem->pArg;
+	char				szFullName[MAX_PATH];
+
+	strncpy(szFullName, pItem->szFullName, MAX_PATH);
+
+	EnterCriticalSection(&m_csAccess);
+
+	if( bSuccess && pImage )
+	{
+		pItem->pImage = pImage;
+		pItem->nLength = nLength;
+		pItem->nState = AFPREFETCH_READY;
+		m_dwReadyBytes += nLength;
+	}
+	else
+	{
+		// Failed or nothing to keep, so there is nothing to take;
+		RemoveFromTable(pItem);
+	}
+
+	SetEvent(pItem->hDone);
+	FreeItemIfUnused(pItem);
+
+	if( 0 == -- m_nNumBusy )
+		SetEvent(m_hIdleEvent);
+
+	LeaveCriticalSection(&m_csAccess);
+
+	if( pfnCallback )
+		(*pfnCallback)(szFullName, bSuccess, pArg);
+}
+
+DWORD WINAPI AFilePrefetcher::IOThread(LPVOID pArg)
+{
+	AFilePrefetcher * pThis = (AFilePrefetcher *) pArg;
+
+	while( true )
+	{
+		WaitForSingleObject(pThis->m_hQueueSemaphore, INFINITE);
+		if( pThis->m_bQuit )
+			break;
+
+		EnterCriticalSection(&pThis->m_csAccess);
+
+		AFPREFETCH_ITEM * pItem = pThis->m_pQueueHead;
+		if( NULL == pItem )
+		{
+			LeaveCriticalSection(&pThis->m_csAccess);
+			continue;
+		}
+
+		pThis->m_pQueueHead = pItem->pNextInQueue;
+		if( NULL == pThis->m_pQueueHead )
+			pThis->m_pQueueTail = NULL;
+		pItem->pNextInQueue = NULL;
+		pItem->bInQueue = false;
+
+		if( pItem->nState == AFPREFETCH_TAKEN )
+		{
+			// It has been taken or discarded before we read it;
+			pThis->FreeItemIfUnused(pItem);
+			if( 0 == -- pThis->m_nNumBusy )
+				SetEvent(pThis->m_hIdleEvent);
+
+			LeaveCriticalSection(&pThis->m_csAccess);
+			continue;
+		}
+
+		pItem->nState = AFPREFETCH_LOADING;
+		LeaveCriticalSection(&pThis->m_csAccess);
+
+		pThis->LoadItem(pItem);
+	}
+
+	// The IO thread frees image buffers, the blocks it has cached go back to the central pools;
+	afastflush();
+	return 0;
+}
+
+bool AFilePrefetcher::TakeFile(char * szRelativeName, LPBYTE * ppImage, int * pnLength)
+{
+	char szNormalizedName[MAX_PATH];
+	DWORD dwNameHash = AFilePackage_NormalizeFileName(szRelativeName, szNormalizedName);
+	bool bResult = false;
+
+	EnterCriticalSection(&m_csAccess);
+
+	AFPREFETCH_ITEM * pItem = FindItem(dwNameHash, szNormalizedName);
+	if( NULL == pItem )
+	{
+		LeaveCriticalSection(&m_csAccess);
+		return false;
+	}
+
+	if( pItem->nState == AFPREFETCH_LOADING )
+	{
+		// An IO thread is reading it, so wait rather than reading it again;
+		pItem->nNumWaiters ++;
+		LeaveCriticalSection(&m_csAccess);
+
+		WaitForSingleObject(pItem->hDone, INFINITE);
+
+		EnterCriticalSection(&m_csAccess);
+		pItem->nNumWaiters --;
+	}
+
+	switch( pItem->nState )
+	{
+	case AFPREFETCH_READY:
+		*ppImage = pItem->pImage;
+		*pnLength = pItem->nLength;
+		m_dwReadyBytes -= pItem->nLength;
+		pItem->pImage = NULL;
+		RemoveFromTable(pItem);
+		bResult = true;
+		break;
+
+	case AFPREFETCH_QUEUED:
+		// Not started yet, the caller will read it itself, so cancel it;
+		RemoveFromTable(pItem);
+		break;
+
+	default:
+		// Failed, or taken by another thread;
+		break;
+	}
+
+	FreeItemIfUnused(pItem);
+
+	LeaveCriticalSection(&m_csAccess);
+	return bResult;
+}
+
+bool AFilePrefetcher::WaitIdle(DWORD dwTimeOut)
+{
+	return WAIT_OBJECT_0 == WaitForSingleObject(m_hIdleEvent, dwTimeOut);
+}
+
+void AFilePrefetcher::DiscardAll()
+{
+	EnterCriticalSection(&m_csAccess);
+
+	for(int i=0; i<AFPREFETCH_BUCKETNUM; i++)
+	{
+		AFPREFETCH_ITEM * pItem = m_aBuckets[i];
+		while( pItem )
+		{
+			AFPREFETCH_ITEM * pNext = pItem->pNextInBucket;
+
+			// Loading items will be ready later, just leave them there;
+			if( pItem->nState != AFPREFETCH_LOADING )
+			{
+				if( pItem->nState == AFPREFETCH_READY )
+					m_dwReadyBytes -= pItem->nLength;
+
+				RemoveFromTable(pItem);
+				FreeItemIfUnused(pItem);
+			}
+
+			pItem = pNext;
+		}
+	}
+
+	LeaveCriticalSection(&m_csAccess);
+}
+
+bool AFileMod_StartPrefetch(int nNumThreads)
+{
+	if( g_pAFilePrefetcher )
+		AFileMod_StopPrefetch();
+
+	g_pAFilePrefetcher = new AFilePrefetcher();
+	if( NULL == g_pAFilePrefetcher )
+	{
+		AFERRLOG(("AFileMod_StartPrefetch(), Not enough memory!"));
+		return false;
+	}
+
+	if( !g_pAFilePrefetcher->Init(nNumThreads) )
+	{
+		AFERRLOG(("AFileMod_StartPrefetch(), Can not init the prefetcher!"));
+		AFileMod_StopPrefetch();
+		return false;
+	}
+
+	return true;
+}
+
+bool AFileMod_StopPrefetch()
+{
+	if( g_pAFilePrefetcher )
+	{
+		g_pAFilePrefetcher->Release();
+		delete g_pAFilePrefetcher;
+		g_pAFilePrefetcher = NULL;
+	}
+	return true;
+}
+
+int AFileMod_Prefetch(char ** aFileNames, int nNumFiles, AFPREFETCH_CALLBACK pfnCallback, LPVOID pArg)
+{
+	if( !g_pAFilePrefetcher )
+		return 0;
+
+	return g_pAFilePrefetcher->Prefetch(aFileNames, nNumFiles, pfnCallback, pArg);
+}
+
+bool AFileMod_WaitPrefetch(DWORD dwTimeOut)
+{
+	if( !g_pAFilePrefetcher )
+		return true;
+
+	return g_pAFilePrefetcher->WaitIdle(dwTimeOut);
+}
+
+void AFileMod_DiscardPrefetch()
+{
+	if( g_pAFilePrefetcher )
+		g_pAFilePrefetcher->DiscardAll();
+}
@@ -0,0 +1,213 @@
+/*
+ * FILE: AFileTokenizer.cpp
+ *
+ * DESCRIPTION: A tokenizer which parses the lines returned by AFile::ReadLineView in place
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "AFPI.h"
+#include "AFileTokenizer.h"
+#include <math.h>
+
+// Powers of ten which can be represented exactly in a double;
+static const double l_aPow10[] =
+{
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+void AFileTokenizer::SkipBlanks()
+{
+	while( m_pCur < m_pEnd && (*m_pCur == ' ' || *m_pCur == '\t') )
+		m_pCur ++;
+}
+
+void AFileTokenizer::SkipSeparators()
+{
+	while( m_pCur < m_pEnd )
+	{
+		switch( *m_pCur )
+		{
+		case ' ':	case '\t':	case ',':	case ':':
+		case '(':	case ')':	case '[':	case ']':
+		case '{':	case '}':
+			m_pCur ++;
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+bool AFileTokenizer::SkipPrefix(const char * szTag)
+{
+	const char * p = m_pCur;
+	while( *szTag )
+	{
+		if( p >= m_pEnd || *p != *szTag )
+			return false;
+		p ++;
+		szTag ++;
+	}
+
+	m_pCur = p;
+	return true;
+}
+
+bool AFileTokenizer::GetInt(int * pnValue)
+{
+	SkipSeparators();
+
+	const char * p = m_pCur;
+	bool bNegative = false;
+	if( p < m_pEnd && (*p == '-' || *p == '+') )
+	{
+		bNegative = *p == '-';
+		p ++;
+	}
+
+	if( p >= m_pEnd || *p < '0' || *p > '9' )
+		return false;
+
+	int nValue = 0;
+	while( p < m_pEnd && *p >= '0' && *p <= '9' )
+	{
+		nValue = nValue * 10 + (*p - '0');
+		p ++;
+	}
+
+	*pnValue = bNegative ? -nValue : nValue;
+	m_pCur = p;
+	return true;
+}
+
+bool AFileTokenizer::GetFloat(FLOAT * pvValue)
+{
+	SkipSeparators();
+
+	const char * p = m_pCur;
+	bool bNegative = false;
+	if( p < m_pEnd && (*p == '-' || *p == '+') )
+	{
+		bNegative = *p == '-';
+		p ++;
+	}
+
+	// The mantissa is kept as an integer in a double, the digits after the 17th can not
+	// change a float, so they are only counted into the exponent;
+	double vMantissa = 0.0;
+	int nExp = 0;
+	int nDigits = 0;
+	int nSignificant = 0;
+
+	while( p < m_pEnd && *p >= '0' && *p <= '9' )
+	{
+		if( nSignificant < 17 )
+		{
+			vMantissa = vMantissa * 10.0 + (*p - '0');
+			if( vMantissa != 0.0 )
+				nSignificant ++;
+		}
+		else
+			nExp ++;
+		nDigits ++;
+		p ++;
+	}
+
+	if( p < m_pEnd && *p == '.' )
+	{
+		p ++;
+		while( p < m_pEnd && *p >= '0' && *p <= '9' )
+		{
+			if( nSignificant < 17 )
+			{
+				vMantissa = vMantissa * 10.0 + (*p - '0');
+				if( vMantissa != 0.0 )
+					nSignificant ++;
+				nExp --;
+			}
+			nDigits ++;
+			p ++;
+		}
+	}
+
+	if( nDigits == 0 )
+		return false;
+
+	if( p < m_pEnd && (*p == 'e' || *p == 'E') )
+	{
+		const char * pExp = p + 1;
+		bool bNegExp = false;
+		if( pExp < m_pEnd && (*pExp == '-' || *pExp == '+') )
+		{
+			bNegExp = *pExp == '-';
+			pExp ++;
+		}
+
+		// Only take it as an exponent when there are digits, as sscanf does;
+		if( pExp < m_pEnd && *pExp >= '0' && *pExp <= '9' )
+		{
+			int nExpValue = 0;
+			while( pExp < m_pEnd && *pExp >= '0' && *pExp <= '9' )
+			{
+				if( nExpValue < 10000 )
+					nExpValue = nExpValue * 10 + (*pExp - '0');
+				pExp ++;
+			}
+			nExp += bNegExp ? -nExpValue : nExpValue;
+			p = pExp;
+		}
+	}
+
+	double vValue = vMantissa;
+	if( vValue != 0.0 && nExp != 0 )
+	{
+		if( nExp > 0 && nExp <= 22 )
+			vValue *= l_aPow10[nExp];
+		else if( nExp < 0 && nExp >= -22 )
+			vValue /= l_aPow10[-nExp];
+		else
+			vValue *= pow(10.0, nExp);
+	}
+
+	*pvValue = (FLOAT) (bNegative ? -vValue : vValue);
+	m_pCur = p;
+	return true;
+}
+
+void AFileTokenizer::GetRest(const char ** ppText, DWORD * pdwLength)
+{
+	*ppText = m_pCur;
+	*pdwLength = (DWORD) (m_pEnd - m_pCur);
+}
+
+bool AFileTokenizer::CopyRest(char * szBuffer, DWORD dwBufferLength)
+{
+	DWORD dwLength = (DWORD) (m_pEnd - m_pCur);
+	if( dwLength >= dwBufferLength )
+	{
+		szBuffer[0] = '\0';
+		return false;
+	}
+
+	memcpy(szBuffer, m_pCur, dwLength);
+	szBuffer[dwLength] = '\0';
+	return true;
+}
+
+bool AFileTokenizer::IsEqual(const char * pText, DWORD dwLength, const char * szString)
+{
+	DWORD i;
+	for(i=0; i<dwLength; i++)
+	{
+		if( szString[i] == '\0' || szString[i] != pText[i] )
+			return false;
+	}
+
+	return szString[dwLength] == '\0';
+}
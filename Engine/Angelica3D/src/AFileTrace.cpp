@@ -0,0 +1,278 @@
+/*
+ * FILE: AFileTrace.cpp
+ *
+ * DESCRIPTION: A class which records the sequence of opened files into a trace file
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "AFPI.h"
+#include "AFileTrace.h"
+#include "AFilePackage.h"
+#include "AFileMount.h"
+#include "AFI.h"
+
+AFILE_IOSTATS	g_AFileIOStats = {0};
+AFileTracer *	g_pAFileTracer = NULL;
+
+static LONGLONG	l_nTicksPerSecond = 0;
+
+LONGLONG AFileStat_GetTicks()
+{
+	LARGE_INTEGER liTicks;
+	QueryPerformanceCounter(&liTicks);
+	return liTicks.QuadPart;
+}
+
+DWORD AFileStat_GetMicroSec(LONGLONG nStartTicks)
+{
+	if( 0 == l_nTicksPerSecond )
+	{
+		LARGE_INTEGER liFrequency;
+		QueryPerformanceFrequency(&liFrequency);
+		l_nTicksPerSecond = liFrequency.QuadPart;
+	}
+
+	return (DWORD) ((AFileStat_GetTicks() - nStartTicks) * 1000000 / l_nTicksPerSecond);
+}
+
+AFileTracer::AFileTracer()
+{
+	m_fpTrace		= NULL;
+	m_dwStartTime	= 0;
+	m_dwNumRecords	= 0;
+
+	InitializeCriticalSection(&m_csAccess);
+}
+
+AFileTracer::~AFileTracer()
+{
+	DeleteCriticalSection(&m_csAccess);
+}
+
+bool AFileTracer::Init(char * szTraceFile)
+{
+	m_fpTrace = fopen(szTraceFile, "wb");
+	if( NULL == m_fpTrace )
+	{
+		AFERRLOG(("AFileTracer::Init(), Can not create trace file [%s]!", szTraceFile));
+		return false;
+	}
+
+	AFTRACE_HEADER header;
+	header.dwMagic		= AFTRACE_MAGIC;
+	header.dwVersion	= AFTRACE_VERSION;
+	header.dwNumRecords	= 0;
+	fwrite(&header, sizeof(AFTRACE_HEADER), 1, m_fpTrace);
+
+	m_dwStartTime	= timeGetTime();
+	m_dwNumRecords	= 0;
+	return true;
+}
+
+bool AFileTracer::Release()
+{
+	if( m_fpTrace )
+	{
+		// Now we know how many records there are;
+		fseek(m_fpTrace, sizeof(DWORD) * 2, SEEK_SET);
+		fwrite(&m_dwNumRecords, sizeof(DWORD), 1, m_fpTrace);
+
+		fclose(m_fpTrace);
+		m_fpTrace = NULL;
+	}
+
+	return true;
+}
+
+void AFileTracer::RecordOpen(const char * szRelativeName)
+{
+	DWORD dwTime = timeGetTime() - m_dwStartTime;
+	WORD wNameLength = (WORD) strlen(szRelativeName);
+
+	EnterCriticalSection(&m_csAccess);
+
+	if( m_fpTrace )
+	{
+		fwrite(&dwTime, sizeof(DWORD), 1, m_fpTrace);
+		fwrite(&wNameLength, sizeof(WORD), 1, m_fpTrace);
+		fwrite(szRelativeName, wNameLength, 1, m_fpTrace);
+		m_dwNumRecords ++;
+	}
+
+	LeaveCriticalSection(&m_csAccess);
+}
+
+int AFileTrace_LoadNames(char * szTraceFile, char ** aNames, int nMaxNames)
+{
+	FILE * fpTrace = fopen(szTraceFile, "rb");
+	if( NULL == fpTrace )
+	{
+		AFERRLOG(("AFileTrace_LoadNames(), Can not open trace file [%s]!", szTraceFile));
+		return -1;
+	}
+
+	AFTRACE_HEADER header;
+	if( 1 != fread(&header, sizeof(AFTRACE_HEADER), 1, fpTrace) || 
+		header.dwMagic != AFTRACE_MAGIC || header.dwVersion != AFTRACE_VERSION )
+	{
+		fclose(fpTrace);
+		return -1;
+	}
+
+	// A hash table of the names got to skip the files opened again;
+	int nNumBuckets = 1;
+	while( nNumBuckets < nMaxNames * 2 )
+		nNumBuckets <<= 1;
+
+	int * pBuckets = (int *) malloc(sizeof(int) * nNumBuckets);
+	int * pNext = (int *) malloc(sizeof(int) * max(nMaxNames, 1));
+	DWORD * pHashes = (DWORD *) malloc(sizeof(DWORD) * max(nMaxNames, 1));
+	if( NULL == pBuckets || NULL == pNext || NULL == pHashes )
+	{
+		AFERRLOG(("AFileTrace_LoadNames(), Not enough memory!"));
+		if( pBuckets ) free(pBuckets);
+		if( pNext ) free(pNext);
+		if( pHashes ) free(pHashes);
+		fclose(fpTrace);
+		return -1;
+	}
+	memset(pBuckets, 0xff, sizeof(int) * nNumBuckets);
+
+	int nNumNames = 0;
+	for(DWORD i=0; i<header.dwNumRecords && nNumNames < nMaxNames; i++)
+	{
+		DWORD	dwTime;
+		WORD	wNameLength;
+		char	szName[MAX_PATH];
+
+		if( 1 != fread(&dwTime, sizeof(DWORD), 1, fpTrace) ||
+			1 != fread(&wNameLength, sizeof(WORD), 1, fpTrace) || wNameLength >= MAX_PATH )
+		{
+			AFERRLOG(("AFileTrace_LoadNames(), Trace file [%s] is broken!", szTraceFile));
+			break;
+		}
+
+		if( wNameLength && 1 != fread(szName, wNameLength, 1, fpTrace) )
+		{
+			AFERRLOG(("AFileTrace_LoadNames(), Trace file [%s] is broken!", szTraceFile));
+			break;
+		}
+		szName[wNameLength] = '\0';
+
+		DWORD dwHash = AFilePackage_HashFileName(szName);
+		int nBucket = dwHash & (nNumBuckets - 1);
+		int nFind = pBuckets[nBucket];
+		while( nFind >= 0 )
+		{
+			if( pHashes[nFind] == dwHash && 0 == _stricmp(aNames[nFind], szName) )
+				break;
+			nFind = pNext[nFind];
+		}
+		if( nFind >= 0 )
+			continue;
+
+		aNames[nNumNames] = _strdup(szName);
+		if( NULL == aNames[nNumNames] )
+		{
+			AFERRLOG(("AFileTrace_LoadNames(), Not enough memory!"));
+			break;
+		}
+
+		pHashes[nNumNames] = dwHash;
+		pNext[nNumNames] = pBuckets[nBucket];
+		pBuckets[nBucket] = nNumNames;
+		nNumNames ++;
+	}
+
+	free(pBuckets);
+	free(pNext);
+	free(pHashes);
+	fclose(fpTrace);
+	return nNumNames;
+}
+
+bool AFileMod_StartTrace(char * szTraceFile)
+{
+	AFileMod_StopTrace();
+
+	g_pAFileTracer = new AFileTracer();
+	if( NULL == g_pAFileTracer )
+	{
+		AFERRLOG(("AFileMod_StartTrace(), Not enough memory!"));
+		return false;
+	}
+
+	if( !g_pAFileTracer->Init(szTraceFile) )
+	{
+		delete g_pAFileTracer;
+		g_pAFileTracer = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool AFileMod_StopTrace()
+{
+	if( g_pAFileTracer )
+	{
+		g_pAFileTracer->Release();
+		delete g_pAFileTracer;
+		g_pAFileTracer = NULL;
+	}
+	return true;
+}
+
+bool AFileMod_GetIOStats(AFILE_IOSTATS * pStats)
+{
+	*pStats = g_AFileIOStats;
+	return true;
+}
+
+void AFileMod_ResetIOStats()
+{
+	ZeroMemory(&g_AFileIOStats, sizeof(AFILE_IOSTATS));
+}
+
+bool AFileMod_DumpIOStats(char * szDumpFile)
+{
+	FILE * fpDump = fopen(szDumpFile, "wt");
+	if( NULL == fpDump )
+	{
+		AFERRLOG(("AFileMod_DumpIOStats(), Can not create file [%s]!", szDumpFile));
+		return false;
+	}
+
+	AFILE_IOSTATS stats = g_AFileIOStats;
+	fprintf(fpDump, "AFile: %u opens, %u bytes read, %u seeks\n", stats.dwFileOpens, stats.dwFileBytesRead, stats.dwFileSeeks);
+	fprintf(fpDump, "AFileImage: %u opens, %u bytes, %u prefetched\n", stats.dwImageOpens, stats.dwImageBytes, stats.dwPrefetchHits);
+	fprintf(fpDump, "Package: %u reads, %u bytes, %u package bytes, %u seeks, %u us uncompressing\n", stats.dwPackageReads, 
+		stats.dwPackageBytes, stats.dwPackageCompressedBytes, stats.dwPackageSeeks, stats.dwUncompressTime);
+
+	if( g_pAFilePackage )
+	{
+		fprintf(fpDump, "\ng_pAFilePackage:\n");
+		g_pAFilePackage->DumpStats(fpDump);
+	}
+
+	if( g_pAFileMountTable )
+	{
+		for(int i=0; i<g_pAFileMountTable->GetNumLayers(); i++)
+		{
+			AFilePackage * pPackage = g_pAFileMountTable->GetLayerPackage(i);
+			if( NULL == pPackage || pPackage == g_pAFilePackage )
+				continue;
+
+			fprintf(fpDump, "\n%s:\n", g_pAFileMountTable->GetLayerPath(i));
+			pPackage->DumpStats(fpDump);
+		}
+	}
+
+	fclose(fpDump);
+	return true;
+}
@@ -1,4 +1,5 @@
 #include "AList.h"
+#include "allocator.h"
 
 AList::AList()
 {
@@ -13,11 +14,11 @@ AList::~AList()
 
 bool AList::Init()
 {
-	m_pHead = (ALISTELEMENT *) malloc(sizeof(ALISTELEMENT));
+	m_pHead = (ALISTELEMENT *) afastalloc(sizeof(ALISTELEMENT));
 	if( NULL == m_pHead )
 		return false;
 
-	m_pTail = (ALISTELEMENT *) malloc(sizeof(ALISTELEMENT));
+	m_pTail = (ALISTELEMENT *) afastalloc(sizeof(ALISTELEMENT));
 	if( NULL == m_pTail )
 		return false;
 
@@ -41,7 +42,7 @@ bool AList::Release()
 		pElementToDel = pThisElement;
 		pThisElement = pThisElement->pNext;
 
-		free(pElementToDel);
+		afastfree(pElementToDel, sizeof(ALISTELEMENT));
 	}
 
 	m_pHead = m_pTail = NULL;
@@ -60,7 +61,7 @@ bool AList::Insert(LPVOID pDataToInsert, ALISTELEMENT * pElement, ALISTELEMENT *
 	if( NULL == pElement )
 		return false;
 
-	pNewElement = (ALISTELEMENT *) malloc(sizeof(ALISTELEMENT));
+	pNewElement = (ALISTELEMENT *) afastalloc(sizeof(ALISTELEMENT));
 	if( NULL == pNewElement )
 		return false;
 
@@ -98,7 +99,7 @@ bool AList::Delete(ALISTELEMENT * pElement)
 	pElement->pLast->pNext = pElement->pNext;
 	pElement->pNext->pLast = pElement->pLast;
 
-	free(pElement);
+	afastfree(pElement, sizeof(ALISTELEMENT));
 	m_nSize --;
 	return true;
 }
@@ -159,7 +160,7 @@ bool AList::Reset()
 		pElementToDel = pThisElement;
 		pThisElement = pThisElement->pNext;
 
-		free(pElementToDel);
+		afastfree(pElementToDel, sizeof(ALISTELEMENT));
 	}
 
 	m_pHead->pData = m_pTail->pData = NULL;
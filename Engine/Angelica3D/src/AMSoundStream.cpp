@@ -15,6 +15,7 @@
 #include "AMSoundStream.h"
 #include "AMWaveFile.h"
 #include "AMMp3File.h"
+#include "allocator.h"
 
 CRITICAL_SECTION	l_csExit;
 bool				l_bQuit;
@@ -222,6 +223,9 @@ DWORD WINAPI BgmHandle(LPVOID pArg)
 	}
 
 	LeaveCriticalSection(&l_csExit);
+
+	// Give the blocks cached by this thread back before it exits;
+	afastflush();
 	return 0x88;
 }
 
@@ -0,0 +1,242 @@
+/*
+ * FILE: ASlotList.cpp
+ *
+ * DESCRIPTION: A class which keeps a list of pointers in one dense array and hands out
+ *				stable handles to them;
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "ASlotList.h"
+#include "A3DErrLog.h"
+#include "amemory.h"
+
+ASlotList::ASlotList()
+{
+	m_aData		= NULL;
+	m_aSlotOf	= NULL;
+	m_aSlots	= NULL;
+	m_nSize		= 0;
+	m_nMaxSize	= 0;
+	m_nNumSlots	= 0;
+	m_nFreeSlot	= -1;
+}
+
+ASlotList::~ASlotList()
+{
+	Release();
+}
+
+bool ASlotList::Init(int nInitSize)
+{
+	Release();
+
+	if( nInitSize < 4 )
+		nInitSize = 4;
+
+	m_aData		= (LPVOID *) amalloc(sizeof(LPVOID) * nInitSize);
+	m_aSlotOf	= (int *) amalloc(sizeof(int) * nInitSize);
+	m_aSlots	= (ASLOT *) amalloc(sizeof(ASLOT) * nInitSize);
+	if( NULL == m_aData || NULL == m_aSlotOf || NULL == m_aSlots )
+	{
+		g_pA3DErrLog->ErrLog("ASlotList::Init(), Not enough memory!");
+		Release();
+		return false;
+	}
+
+	m_nMaxSize = nInitSize;
+	return true;
+}
+
+bool ASlotList::Release()
+{
+	//We do not carry out the work to release the data, that is the caller's task;
+	if( m_aData )
+	{
+		afree(m_aData);
+		m_aData = NULL;
+	}
+	if( m_aSlotOf )
+	{
+		afree(m_aSlotOf);
+		m_aSlotOf = NULL;
+	}
+	if( m_aSlots )
+	{
+		afree(m_aSlots);
+		m_aSlots = NULL;
+	}
+
+	m_nSize		= 0;
+	m_nMaxSize	= 0;
+	m_nNumSlots	= 0;
+	m_nFreeSlot	= -1;
+	return true;
+}
+
+bool ASlotList::Reset()
+{
+	// Free all used slots, so that all handles given out become invalid;
+	while( m_nSize > 0 )
+		DeleteAt(m_nSize - 1);
+
+	return true;
+}
+
+bool ASlotList::Grow()
+{
+	int nNewSize = m_nMaxSize + (m_nMaxSize >> 1);
+	if( nNewSize < 16 )
+		nNewSize = 16;
+	if( nNewSize > ASLOT_MAXSIZE )
+		nNewSize = ASLOT_MAXSIZE;
+	if( nNewSize <= m_nMaxSize )
+	{
+		g_pA3DErrLog->ErrLog("ASlotList::Grow(), Too many elements!");
+		return false;
+	}
+
+	LPVOID *	aData	= (LPVOID *) amalloc(sizeof(LPVOID) * nNewSize);
+	int *		aSlotOf	= (int *) amalloc(sizeof(int) * nNewSize);
+	ASLOT *		aSlots	= (ASLOT *) amalloc(sizeof(ASLOT) * nNewSize);
+	if( NULL == aData || NULL == aSlotOf || NULL == aSlots )
+	{
+		if( aData )		afree(aData);
+		if( aSlotOf )	afree(aSlotOf);
+		if( aSlots )	afree(aSlots);
+		g_pA3DErrLog->ErrLog("ASlotList::Grow(), Not enough memory!");
+		return false;
+	}
+
+	if( m_aData )
+	{
+		memcpy(aData, m_aData, sizeof(LPVOID) * m_nSize);
+		memcpy(aSlotOf, m_aSlotOf, sizeof(int) * m_nSize);
+		memcpy(aSlots, m_aSlots, sizeof(ASLOT) * m_nNumSlots);
+		afree(m_aData);
+		afree(m_aSlotOf);
+		afree(m_aSlots);
+	}
+
+	m_aData		= aData;
+	m_aSlotOf	= aSlotOf;
+	m_aSlots	= aSlots;
+	m_nMaxSize	= nNewSize;
+	return true;
+}
+
+bool ASlotList::Append(LPVOID pDataToAppend, ASLOTHANDLE * phSlot)
+{
+	int nSlot;
+	if( m_nFreeSlot >= 0 )
+	{
+		nSlot = m_nFreeSlot;
+		m_nFreeSlot = m_aSlots[nSlot].nIndex;
+	}
+	else
+	{
+		// The slots are never more than the elements can be, so when there is no free slot
+		// the three arrays are all full or all have room;
+		if( m_nNumSlots == m_nMaxSize && !Grow() )
+			return false;
+
+		nSlot = m_nNumSlots ++;
+		m_aSlots[nSlot].dwGeneration = 1;
+	}
+
+	m_aSlots[nSlot].nIndex	= m_nSize;
+	m_aData[m_nSize]		= pDataToAppend;
+	m_aSlotOf[m_nSize]		= nSlot;
+	m_nSize ++;
+
+	if( phSlot )
+		*phSlot = MakeHandle(nSlot);
+
+	return true;
+}
+
+bool ASlotList::DeleteAt(int nIndex)
+{
+	if( nIndex < 0 || nIndex >= m_nSize )
+		return false;
+
+	int nSlot = m_aSlotOf[nIndex];
+
+	// Move the last element into the hole;
+	m_nSize --;
+	if( nIndex != m_nSize )
+	{
+		m_aData[nIndex]		= m_aData[m_nSize];
+		m_aSlotOf[nIndex]	= m_aSlotOf[m_nSize];
+		m_aSlots[m_aSlotOf[nIndex]].nIndex = nIndex;
+	}
+
+	// A new generation makes all handles to this slot invalid. The generation does not wrap,
+	// or an old handle would be valid again, so a slot which has used up all generations is
+	// retired with generation 0, which no handle has, and never put in the free list;
+	if( m_aSlots[nSlot].dwGeneration == ASLOT_GENMASK )
+	{
+		m_aSlots[nSlot].dwGeneration = 0;
+		m_aSlots[nSlot].nIndex = -1;
+		return true;
+	}
+
+	m_aSlots[nSlot].dwGeneration ++;
+	m_aSlots[nSlot].nIndex = m_nFreeSlot;
+	m_nFreeSlot = nSlot;
+	return true;
+}
+
+bool ASlotList::Delete(ASLOTHANDLE hSlot)
+{
+	if( !IsValid(hSlot) )
+		return false;
+
+	return DeleteAt(m_aSlots[hSlot & ASLOT_INDEXMASK].nIndex);
+}
+
+bool ASlotList::DeleteByData(LPVOID pData)
+{
+	return DeleteAt(FindIndexByData(pData));
+}
+
+bool ASlotList::IsValid(ASLOTHANDLE hSlot)
+{
+	int nSlot = (int) (hSlot & ASLOT_INDEXMASK);
+	DWORD dwGeneration = hSlot >> ASLOT_INDEXBITS;
+	if( 0 == dwGeneration || nSlot >= m_nNumSlots )
+		return false;
+
+	return m_aSlots[nSlot].dwGeneration == dwGeneration;
+}
+
+LPVOID ASlotList::GetData(ASLOTHANDLE hSlot)
+{
+	if( !IsValid(hSlot) )
+		return NULL;
+
+	return m_aData[m_aSlots[hSlot & ASLOT_INDEXMASK].nIndex];
+}
+
+int ASlotList::FindIndexByData(LPVOID pData)
+{
+	for(int i=0; i<m_nSize; i++)
+	{
+		if( m_aData[i] == pData )
+			return i;
+	}
+
+	return -1;
+}
+
+ASLOTHANDLE ASlotList::GetHandleByIndex(int nIndex)
+{
+	if( nIndex < 0 || nIndex >= m_nSize )
+		return ASLOTHANDLE_NULL;
+
+	return MakeHandle(m_aSlotOf[nIndex]);
+}
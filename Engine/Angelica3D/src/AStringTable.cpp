@@ -15,6 +15,57 @@
 #include "AScriptFile.h"
 #include "AFPI.h"
 
+// The keys being compiled by BuildTable();
+typedef struct _ASTRTAB_KEY
+{
+	const char *	szName;
+	const char *	szData;
+	DWORD			dwDataLen;
+	DWORD			dwHash1;		// Selects the bucket;
+	DWORD			dwHash2;		// Moved by the displacement to select the slot;
+	DWORD			dwName;			// Offsets in the new blob;
+	DWORD			dwData;
+
+} ASTRTAB_KEY;
+
+// Max displacements tried for one bucket, it is only reached when two different names have
+// the same two hashes;
+#define ASTRTAB_MAXTRIES		0x100000
+
+static inline DWORD MixHash(DWORD dwHash)
+{
+	dwHash ^= dwHash >> 16;
+	dwHash *= 0x85ebca6b;
+	dwHash ^= dwHash >> 13;
+	dwHash *= 0xc2b2ae35;
+	dwHash ^= dwHash >> 16;
+	return dwHash;
+}
+
+// Two independent hashes of the lower case name in one pass, so they match the _stricmp compare;
+static void HashName(const char * szName, DWORD * pdwHash1, DWORD * pdwHash2)
+{
+	DWORD dwHash1 = 2166136261;
+	DWORD dwHash2 = 0x9747b28c;
+	for(const char * pch=szName; *pch; pch++)
+	{
+		BYTE ch = (BYTE) *pch;
+		if( ch >= 'A' && ch <= 'Z' )
+			ch += 'a' - 'A';
+		dwHash1 = (dwHash1 ^ ch) * 16777619;
+		dwHash2 = (dwHash2 + ch) * 0x5bd1e995;
+		dwHash2 ^= dwHash2 >> 15;
+	}
+
+	*pdwHash1 = dwHash1;
+	*pdwHash2 = MixHash(dwHash2);
+}
+
+static inline DWORD GetSlotOf(DWORD dwHash2, DWORD dwDisp, DWORD dwNumSlots)
+{
+	return MixHash(dwHash2 ^ (dwDisp * 0x9e3779b9)) % dwNumSlots;
+}
+
 AStringTable::AStringTable()
 {
 	m_pStringEntries		= NULL;
@@ -26,25 +77,58 @@ AStringTable::AStringTable()
 	m_nCharBufferLen		= 0;
 
 	m_bHasSorted			= true;
+
+	m_pTable				= NULL;
+	m_dwTableSize			= 0;
+	m_pTableImage			= NULL;
+	m_aDisps				= NULL;
+	m_aSlots				= NULL;
+	m_pBlob					= NULL;
 }
 
 AStringTable::~AStringTable()
 {
+	Release();
 }
 
 bool AStringTable::Init(char * szFileName)
 {
-	AFileImage fileImage;
-	if( !fileImage.Open(szFileName, AFILE_OPENEXIST | AFILE_BINARY) )
+	Release();
+
+	AFileImage * pFileImage = new AFileImage;
+	if( NULL == pFileImage )
 	{
+		AFERRLOG(("AStringTable::Init(), Not enough memory!"));
+		return false;
+	}
+
+	if( !pFileImage->Open(szFileName, AFILE_OPENEXIST | AFILE_BINARY) )
+	{
+		delete pFileImage;
 		AFERRLOG(("AStringTable::Init(), Can not open file [%s]", szFileName));
 		return false;
 	}
 
+	// A binary table is used in place, so the image is kept open until the table is released;
+	if( pFileImage->GetFileLength() >= (int) sizeof(ASTRTAB_HEADER) && 
+		ASTRTAB_MAGIC == ((ASTRTAB_HEADER *) pFileImage->GetFileBuffer())->dwMagic )
+	{
+		if( !LoadTable(pFileImage) )
+		{
+			pFileImage->Close();
+			delete pFileImage;
+			AFERRLOG(("AStringTable::Init(), Bad string table file [%s]", szFileName));
+			return false;
+		}
+		return true;
+	}
+
 	AScriptFile scriptFile;
-	if( !scriptFile.Open(&fileImage) )
+	if( !scriptFile.Open(pFileImage) )
 	{
-		AFERRLOG(("AStringTable::Init(), Can not open script file!", szFileName));
+		pFileImage->Close();
+		delete pFileImage;
+		AFERRLOG(("AStringTable::Init(), Can not open script file [%s]!", szFileName));
 		return false;
 	}
 
@@ -67,19 +151,66 @@ bool AStringTable::Init(char * szFileName)
 	}
 
 	scriptFile.Close();
-	fileImage.Close();
+	pFileImage->Close();
+	delete pFileImage;
 
-	ResortEntry();
+	// The entries can still be found by binary search if the table can not be built;
+	if( !BuildTable() )
+		ResortEntry();
 
 	return true;
 
 Failure:
 	scriptFile.Close();
-	fileImage.Close();
+	pFileImage->Close();
+	delete pFileImage;
 	return false;
 }
 
-bool AStringTable::Release()
+bool AStringTable::LoadTable(AFileImage * pImage)
+{
+	const BYTE * pTable = pImage->GetFileBuffer();
+	DWORD dwSize = (DWORD) pImage->GetFileLength();
+	const ASTRTAB_HEADER * pHeader = (const ASTRTAB_HEADER *) pTable;
+
+	if( ASTRTAB_VERSION != pHeader->dwVersion )
+	{
+		AFERRLOG(("AStringTable::LoadTable(), Unknown version %d!", pHeader->dwVersion));
+		return false;
+	}
+
+	if( 0 == pHeader->dwNumBuckets || pHeader->dwNumEntries >= ASTRTAB_DIRECTSLOT ||
+		pHeader->dwDispOffset > dwSize || pHeader->dwSlotOffset > dwSize || pHeader->dwBlobOffset > dwSize ||
+		pHeader->dwNumBuckets > (dwSize - pHeader->dwDispOffset) / sizeof(DWORD) ||
+		pHeader->dwNumEntries > (dwSize - pHeader->dwSlotOffset) / sizeof(ASTRTAB_SLOT) ||
+		pHeader->dwBlobSize > dwSize - pHeader->dwBlobOffset ||
+		(pHeader->dwBlobSize && pTable[pHeader->dwBlobOffset + pHeader->dwBlobSize - 1]) )
+		return false;
+
+	// The lookups trust the offsets in the slots, so check them once here; the blob ends
+	// with '\0', so a name or data which starts in it is terminated in it;
+	const ASTRTAB_SLOT * aSlots = (const ASTRTAB_SLOT *) (pTable + pHeader->dwSlotOffset);
+	for(DWORD i=0; i<pHeader->dwNumEntries; i++)
+	{
+		const ASTRTAB_SLOT& slot = aSlots[i];
+		if( slot.dwName >= pHeader->dwBlobSize || slot.dwData >= pHeader->dwBlobSize ||
+			slot.dwDataLen >= pHeader->dwBlobSize - slot.dwData )
+		{
+			AFERRLOG(("AStringTable::LoadTable(), Slot %d is out of the string blob!", i));
+			return false;
+		}
+	}
+
+	m_pTableImage	= pImage;
+	m_pTable		= pTable;
+	m_dwTableSize	= dwSize;
+	m_aDisps		= (DWORD *) (pTable + pHeader->dwDispOffset);
+	m_aSlots		= (ASTRTAB_SLOT *) (pTable + pHeader->dwSlotOffset);
+	m_pBlob			= (const char *) (pTable + pHeader->dwBlobOffset);
+	return true;
+}
+
+void AStringTable::FreeEntries()
 {
 	if( m_pStringEntries )
 	{
@@ -97,30 +228,80 @@ bool AStringTable::Release()
 	
 	m_nCharBufferLen = 0;
 	m_pNextCharBuffer = NULL;
+	m_bHasSorted = true;
+}
+
+void AStringTable::FreeTable()
+{
+	// A table loaded from a binary file is the image of that file;
+	if( m_pTableImage )
+	{
+		m_pTableImage->Close();
+		delete m_pTableImage;
+		m_pTableImage = NULL;
+	}
+	else if( m_pTable )
+		free((LPVOID) m_pTable);
+
+	m_pTable		= NULL;
+	m_dwTableSize	= 0;
+	m_aDisps		= NULL;
+	m_aSlots		= NULL;
+	m_pBlob			= NULL;
+}
+
+bool AStringTable::Release()
+{
+	FreeTable();
+	FreeEntries();
 	return true;
 }
 
-bool AStringTable::GetEntry(char * szEntryName, char * pszEntryData, DWORD dwBufLen, DWORD * pdwBufOutLen)
+const ASTRTAB_SLOT * AStringTable::FindSlot(const char * szEntryName)
 {
-	pszEntryData[0] = '\0';
+	if( NULL == m_pTable )
+		return NULL;
+
+	ASTRTAB_HEADER * pHeader = (ASTRTAB_HEADER *) m_pTable;
+	if( 0 == pHeader->dwNumEntries )
+		return NULL;
 
+	DWORD dwHash1, dwHash2;
+	HashName(szEntryName, &dwHash1, &dwHash2);
+
+	DWORD dwDisp = m_aDisps[dwHash1 % pHeader->dwNumBuckets];
+	DWORD dwSlot;
+	if( dwDisp & ASTRTAB_DIRECTSLOT )
+	{
+		dwSlot = dwDisp & ~ASTRTAB_DIRECTSLOT;
+		if( dwSlot >= pHeader->dwNumEntries )
+			return NULL;
+	}
+	else
+		dwSlot = GetSlotOf(dwHash2, dwDisp, pHeader->dwNumEntries);
+
+	// Any name is hashed into some slot, so the name in it must be compared;
+	const ASTRTAB_SLOT * pSlot = m_aSlots + dwSlot;
+	if( pSlot->dwHash != dwHash1 || 0 != _stricmp(m_pBlob + pSlot->dwName, szEntryName) )
+		return NULL;
+
+	return pSlot;
+}
+
+int AStringTable::FindEntry(const char * szEntryName)
+{
 	if( !m_bHasSorted )
 	{
 		// Use linear search;
 		for(int i=0; i<m_nEntryCount; i++)
 		{
 			if( 0 == _stricmp(m_pCharBuffer + m_pStringEntries[i].pEntryName, szEntryName) )
-			{
-				return GetEntryDataByIndex(i, pszEntryData, dwBufLen, pdwBufOutLen);
-			}
+				return i;
 		}
 	}
 	else
 	{
 		// Use binary search;
-		if( m_nEntryCount == 0 )
-			return false;
-
 		int		nLeft = 0; 
 		int		nRight = m_nEntryCount - 1;
 
@@ -134,39 +315,98 @@ bool AStringTable::GetEntry(char * szEntryName, char * pszEntryData, DWORD dwBuf
 
 			int nCompare = _stricmp(szName, szEntryName);
 			if( nCompare == 0 )
-				return GetEntryDataByIndex(nMiddle, pszEntryData, dwBufLen, pdwBufOutLen);
+				return nMiddle;
 			else if( nCompare < 0 )
 				nLeft = nMiddle + 1;
 			else if( nCompare > 0 )
 				nRight = nMiddle - 1;
 		}
 	}
-	return false;
+	return -1;
+}
+
+const char * AStringTable::GetEntry(const char * szEntryName, DWORD * pdwDataLen)
+{
+	const ASTRTAB_SLOT * pSlot = FindSlot(szEntryName);
+	if( pSlot )
+	{
+		if( pdwDataLen )
+			*pdwDataLen = pSlot->dwDataLen;
+		return m_pBlob + pSlot->dwData;
+	}
+
+	// Then the entries added after the table was built;
+	int nIndex = FindEntry(szEntryName);
+	if( nIndex < 0 )
+		return NULL;
+
+	const char * szData = m_pCharBuffer + m_pStringEntries[nIndex].pEntryData;
+	if( pdwDataLen )
+		*pdwDataLen = strlen(szData);
+	return szData;
+}
+
+bool AStringTable::GetEntry(char * szEntryName, char * pszEntryData, DWORD dwBufLen, DWORD * pdwBufOutLen)
+{
+	pszEntryData[0] = '\0';
+
+	DWORD dwDataLen;
+	const char * szData = GetEntry((const char *) szEntryName, &dwDataLen);
+	if( NULL == szData )
+		return false;
+
+	if( pdwBufOutLen )
+		*pdwBufOutLen = dwDataLen + 1;
+
+	if( dwBufLen < dwDataLen + 1 )
+		return false;
+	memcpy(pszEntryData, szData, dwDataLen + 1);
+	return true;
+}
+
+const char * AStringTable::GetEntryNamePtr(int nIndex)
+{
+	int nNumCompiled = GetNumCompiled();
+	if( nIndex < nNumCompiled )
+		return m_pBlob + m_aSlots[nIndex].dwName;
+
+	return m_pCharBuffer + m_pStringEntries[nIndex - nNumCompiled].pEntryName;
+}
+
+const char * AStringTable::GetEntryDataPtr(int nIndex)
+{
+	int nNumCompiled = GetNumCompiled();
+	if( nIndex < nNumCompiled )
+		return m_pBlob + m_aSlots[nIndex].dwData;
+
+	return m_pCharBuffer + m_pStringEntries[nIndex - nNumCompiled].pEntryData;
 }
 
 bool AStringTable::GetEntryDataByIndex(int nIndex, char * pszEntryData, DWORD dwBufLen, DWORD * pdwBufOutLen)
 {
-	int nDataLen = strlen(m_pCharBuffer + m_pStringEntries[nIndex].pEntryData) + 1;
+	const char * szData = GetEntryDataPtr(nIndex);
+	int nDataLen = strlen(szData) + 1;
 
 	if( pdwBufOutLen )
 		*pdwBufOutLen = nDataLen;
 
 	if( dwBufLen < (DWORD)nDataLen )
 		return false;
-	strcpy(pszEntryData, m_pCharBuffer + m_pStringEntries[nIndex].pEntryData);
+	strcpy(pszEntryData, szData);
 	return true;
 }
 
 bool AStringTable::GetEntryNameByIndex(int nIndex, char * pszEntryName, DWORD dwBufLen, DWORD * pdwBufOutLen)
 {
-	int nNameLen = strlen(m_pCharBuffer + m_pStringEntries[nIndex].pEntryName) + 1;
+	const char * szName = GetEntryNamePtr(nIndex);
+	int nNameLen = strlen(szName) + 1;
 
 	if( pdwBufOutLen )
 		*pdwBufOutLen = nNameLen;
 
 	if( dwBufLen < (DWORD)nNameLen )
 		return false;
-	strcpy(pszEntryName, m_pCharBuffer + m_pStringEntries[nIndex].pEntryName);
+	strcpy(pszEntryName, szName);
 	return true;
 }
 
@@ -264,3 +504,268 @@ int AStringTable::CompareTwoEntry(int nEntry1, int nEntry2)
 
 	return _stricmp(szName1, szName2);
 }
+
+/*
+	The entries are hashed into about half as many buckets, the buckets are placed from the
+	largest one down: a bucket of several names tries displacements until all its names
+	fall into free slots, then each bucket of one name takes a free slot directly. When
+	a name appears more than once the first one is kept.
+*/
+bool AStringTable::BuildTable()
+{
+	int i, j, b;
+	int nNumKeys = GetNumCompiled() + m_nEntryCount;
+	DWORD dwNumBuckets = nNumKeys / 2 + 1;
+
+	ASTRTAB_KEY * aKeys = (ASTRTAB_KEY *) malloc(sizeof(ASTRTAB_KEY) * (nNumKeys + 1));
+	// The start of each bucket in aOrder, the number of keys of each bucket and the keys in order of buckets;
+	int * aBucketStart = (int *) malloc(sizeof(int) * (dwNumBuckets * 2 + 1 + nNumKeys));
+	if( NULL == aKeys || NULL == aBucketStart )
+	{
+		if( aKeys )			free(aKeys);
+		if( aBucketStart )	free(aBucketStart);
+		AFERRLOG(("AStringTable::BuildTable(), Not enough memory!"));
+		return false;
+	}
+
+	int * aBucketSize = aBucketStart + dwNumBuckets + 1;
+	int * aOrder = aBucketSize + dwNumBuckets;
+
+	for(i=0; i<nNumKeys; i++)
+	{
+		ASTRTAB_KEY * pKey = &aKeys[i];
+		pKey->szName = GetEntryNamePtr(i);
+		pKey->szData = GetEntryDataPtr(i);
+		pKey->dwDataLen = strlen(pKey->szData);
+		HashName(pKey->szName, &pKey->dwHash1, &pKey->dwHash2);
+	}
+
+	// Group the keys by buckets, the keys in a bucket keep their order;
+	memset(aBucketSize, 0, sizeof(int) * dwNumBuckets);
+	for(i=0; i<nNumKeys; i++)
+		aBucketSize[aKeys[i].dwHash1 % dwNumBuckets] ++;
+
+	aBucketStart[0] = 0;
+	for(b=0; b<(int)dwNumBuckets; b++)
+	{
+		aBucketStart[b + 1] = aBucketStart[b] + aBucketSize[b];
+		aBucketSize[b] = 0;
+	}
+
+	for(i=0; i<nNumKeys; i++)
+	{
+		b = aKeys[i].dwHash1 % dwNumBuckets;
+		aOrder[aBucketStart[b] + aBucketSize[b]] = i;
+		aBucketSize[b] ++;
+	}
+
+	// Drop the repeated names, the same names are always in the same bucket;
+	int nNumEntries = 0;
+	int nMaxBucketSize = 0;
+	DWORD dwBlobSize = 0;
+	for(b=0; b<(int)dwNumBuckets; b++)
+	{
+		int * aBucket = aOrder + aBucketStart[b];
+		int nNumKept = 0;
+		for(i=0; i<aBucketSize[b]; i++)
+		{
+			ASTRTAB_KEY * pKey = &aKeys[aBucket[i]];
+			for(j=0; j<nNumKept; j++)
+			{
+				ASTRTAB_KEY * pKept = &aKeys[aBucket[j]];
+				if( pKept->dwHash1 == pKey->dwHash1 && pKept->dwHash2 == pKey->dwHash2 &&
+					0 == _stricmp(pKept->szName, pKey->szName) )
+					break;
+			}
+
+			if( j == nNumKept )
+			{
+				aBucket[nNumKept ++] = aBucket[i];
+				dwBlobSize += strlen(pKey->szName) + 1 + pKey->dwDataLen + 1;
+			}
+		}
+
+		aBucketSize[b] = nNumKept;
+		nNumEntries += nNumKept;
+		if( nNumKept > nMaxBucketSize )
+			nMaxBucketSize = nNumKept;
+	}
+
+	DWORD dwDispOffset = sizeof(ASTRTAB_HEADER);
+	DWORD dwSlotOffset = dwDispOffset + sizeof(DWORD) * dwNumBuckets;
+	DWORD dwBlobOffset = dwSlotOffset + sizeof(ASTRTAB_SLOT) * nNumEntries;
+	DWORD dwTableSize = dwBlobOffset + dwBlobSize;
+
+	LPBYTE pTable = (LPBYTE) malloc(dwTableSize);
+	bool * aUsed = (bool *) malloc(sizeof(bool) * (nNumEntries + 1));
+	DWORD * aTrySlots = (DWORD *) malloc(sizeof(DWORD) * (nMaxBucketSize + 1));
+	if( NULL == pTable || NULL == aUsed || NULL == aTrySlots )
+	{
+		if( pTable )	free(pTable);
+		if( aUsed )		free(aUsed);
+		if( aTrySlots )	free(aTrySlots);
+		free(aKeys);
+		free(aBucketStart);
+		AFERRLOG(("AStringTable::BuildTable(), Not enough memory!"));
+		return false;
+	}
+
+	ASTRTAB_HEADER * pHeader = (ASTRTAB_HEADER *) pTable;
+	pHeader->dwMagic		= ASTRTAB_MAGIC;
+	pHeader->dwVersion		= ASTRTAB_VERSION;
+	pHeader->dwNumEntries	= nNumEntries;
+	pHeader->dwNumBuckets	= dwNumBuckets;
+	pHeader->dwDispOffset	= dwDispOffset;
+	pHeader->dwSlotOffset	= dwSlotOffset;
+	pHeader->dwBlobOffset	= dwBlobOffset;
+	pHeader->dwBlobSize		= dwBlobSize;
+
+	DWORD * aDisps = (DWORD *) (pTable + dwDispOffset);
+	ASTRTAB_SLOT * aSlots = (ASTRTAB_SLOT *) (pTable + dwSlotOffset);
+	char * pBlob = (char *) (pTable + dwBlobOffset);
+
+	// Copy the strings before the old table and entries are freed;
+	DWORD dwBlobUsed = 0;
+	for(b=0; b<(int)dwNumBuckets; b++)
+	{
+		for(i=0; i<aBucketSize[b]; i++)
+		{
+			ASTRTAB_KEY * pKey = &aKeys[aOrder[aBucketStart[b] + i]];
+			DWORD dwNameLen = strlen(pKey->szName);
+
+			pKey->dwName = dwBlobUsed;
+			memcpy(pBlob + dwBlobUsed, pKey->szName, dwNameLen + 1);
+			dwBlobUsed += dwNameLen + 1;
+
+			pKey->dwData = dwBlobUsed;
+			memcpy(pBlob + dwBlobUsed, pKey->szData, pKey->dwDataLen + 1);
+			dwBlobUsed += pKey->dwDataLen + 1;
+		}
+	}
+
+	memset(aDisps, 0, sizeof(DWORD) * dwNumBuckets);
+	memset(aUsed, 0, sizeof(bool) * nNumEntries);
+
+	bool bPlaced = true;
+	int nSize;
+	for(nSize=nMaxBucketSize; nSize>=2 && bPlaced; nSize--)
+	{
+		for(b=0; b<(int)dwNumBuckets; b++)
+		{
+			if( aBucketSize[b] != nSize )
+				continue;
+
+			int * aBucket = aOrder + aBucketStart[b];
+			DWORD dwDisp;
+			for(dwDisp=0; dwDisp<ASTRTAB_MAXTRIES; dwDisp++)
+			{
+				for(i=0; i<nSize; i++)
+				{
+					aTrySlots[i] = GetSlotOf(aKeys[aBucket[i]].dwHash2, dwDisp, nNumEntries);
+					if( aUsed[aTrySlots[i]] )
+						break;
+					for(j=0; j<i; j++)
+					{
+						if( aTrySlots[j] == aTrySlots[i] )
+							break;
+					}
+					if( j < i )
+						break;
+				}
+
+				if( i == nSize )
+					break;
+			}
+
+			if( dwDisp == ASTRTAB_MAXTRIES )
+			{
+				AFERRLOG(("AStringTable::BuildTable(), Can not place the entry [%s], too many hash collisions!", aKeys[aBucket[0]].szName));
+				bPlaced = false;
+				break;
+			}
+
+			aDisps[b] = dwDisp;
+			for(i=0; i<nSize; i++)
+			{
+				ASTRTAB_KEY * pKey = &aKeys[aBucket[i]];
+				ASTRTAB_SLOT * pSlot = &aSlots[aTrySlots[i]];
+				pSlot->dwHash		= pKey->dwHash1;
+				pSlot->dwName		= pKey->dwName;
+				pSlot->dwData		= pKey->dwData;
+				pSlot->dwDataLen	= pKey->dwDataLen;
+				aUsed[aTrySlots[i]] = true;
+			}
+		}
+	}
+
+	if( bPlaced )
+	{
+		// The free slots left are just enough for the buckets of one name;
+		int nFreeSlot = 0;
+		for(b=0; b<(int)dwNumBuckets; b++)
+		{
+			if( aBucketSize[b] != 1 )
+				continue;
+
+			while( aUsed[nFreeSlot] )
+				nFreeSlot ++;
+
+			ASTRTAB_KEY * pKey = &aKeys[aOrder[aBucketStart[b]]];
+			ASTRTAB_SLOT * pSlot = &aSlots[nFreeSlot];
+			pSlot->dwHash		= pKey->dwHash1;
+			pSlot->dwName		= pKey->dwName;
+			pSlot->dwData		= pKey->dwData;
+			pSlot->dwDataLen	= pKey->dwDataLen;
+			aUsed[nFreeSlot] = true;
+
+			aDisps[b] = ASTRTAB_DIRECTSLOT | nFreeSlot;
+		}
+	}
+
+	free(aKeys);
+	free(aBucketStart);
+	free(aUsed);
+	free(aTrySlots);
+
+	if( !bPlaced )
+	{
+		free(pTable);
+		return false;
+	}
+
+	FreeTable();
+	FreeEntries();
+
+	m_pTable		= pTable;
+	m_dwTableSize	= dwTableSize;
+	m_aDisps		= aDisps;
+	m_aSlots		= aSlots;
+	m_pBlob			= pBlob;
+	return true;
+}
+
+bool AStringTable::SaveTable(char * szFileName)
+{
+	if( (NULL == m_pTable || m_nEntryCount > 0) && !BuildTable() )
+	{
+		AFERRLOG(("AStringTable::SaveTable(), Can not build the table!"));
+		return false;
+	}
+
+	FILE * fpFile = fopen(szFileName, "wb");
+	if( NULL == fpFile )
+	{
+		AFERRLOG(("AStringTable::SaveTable(), Can not create file [%s]", szFileName));
+		return false;
+	}
+
+	bool bWritten = 1 == fwrite(m_pTable, m_dwTableSize, 1, fpFile);
+	fclose(fpFile);
+
+	if( !bWritten )
+	{
+		AFERRLOG(("AStringTable::SaveTable(), Can not write file [%s]", szFileName));
+		return false;
+	}
+	return true;
+}
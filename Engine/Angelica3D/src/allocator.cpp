@@ -1,3 +1,4 @@
+#include <windows.h>
 #include <assert.h>
 #include <stdlib.h>
 
@@ -5,12 +6,14 @@
 #include "allocator.h"
 
 namespace abase{
-allocator::allocator(size_t __size, size_t __n, size_t __grow)
+allocator::allocator(size_t __size, size_t __n, size_t __grow, size_t __align)
 {
 	_total_size	= 0;
 	_buf_chain	= NULL;
 	_grow		= __grow;
+	_align		= __align>0?__align:1;
 	_block_size	= __size>0?__size:1;
+	_block_size	= (_block_size + _align - 1) / _align * _align;
 	_fbuf_head 	= NULL;
 	//_block_size
 	
@@ -36,7 +39,7 @@ void allocator::_M_allocate(size_t __n,size_t __block_size)
 	if(!_buf_chain){
 		_buf_chain = new abuf_node();
 		if(!_buf_chain) return;
-		_buf_chain->_buffer	= malloc(__n * __block_size);
+		_buf_chain->_buffer	= align_malloc(__n * __block_size, _align);
 		if(!_buf_chain->_buffer) return ;
 		_buf_chain->_next	= NULL;
 		_buf_chain->_size	= __n * __block_size;
@@ -47,7 +50,7 @@ void allocator::_M_allocate(size_t __n,size_t __block_size)
 		struct abuf_node *nnode;
 		nnode = new abuf_node();
 		if(!nnode) return;
-		nnode->_buffer = malloc(__n * __block_size);
+		nnode->_buffer = align_malloc(__n * __block_size, _align);
 		if(!nnode->_buffer) {
 			delete nnode; 
 			return;
@@ -146,7 +149,7 @@ void	allocator::release()
 	{
 		struct abuf_node * nextnode;
 		nextnode = nnode->_next;
-		free(nnode->_buffer);
+		align_free(nnode->_buffer);
 		delete nnode;
 		nnode = nextnode;
 	}
@@ -154,4 +157,343 @@ void	allocator::release()
 	_total_size = 0;
 	_fbuf_head = NULL;
 }
+
+/*
+	fast_allocator
+*/
+static const size_t fa_class_size[] =
+{
+	16,		32,		48,		64,		80,		96,		112,	128,
+	160,	192,	224,	256,	320,	384,	448,	512,
+	640,	768,	896,	1024,	1280,	1536,	1792,	2048,
+	2560,	3072,	3584,	4096
+};
+
+enum{
+	FA_NUM_CLASS	= sizeof(fa_class_size) / sizeof(fa_class_size[0]),
+	FA_HEADER_SIZE	= 64,		//the chunk header, keep the blocks after it aligned
+	FA_BATCH_BYTES	= 16384,	//bytes moved between a thread cache and a central pool at one time
+	FA_CHUNK_MAGIC	= 0x4b4e4843	//'CHNK', marks the chunks so the debug build can check a freed size
+};
+
+struct fa_block{
+	fa_block *	_next;
+};
+
+//the header at the start of each chunk, a block finds its chunk by masking its address
+struct fa_chunk{
+	fa_chunk *	_prev;		//link in the partial list of the class
+	fa_chunk *	_next;
+	fa_block *	_free;
+	size_t		_magic;
+	size_t		_class;
+	size_t		_used;		//blocks handed out
+	size_t		_count;		//total blocks in the chunk
+};
+
+struct fa_central{
+	CRITICAL_SECTION	_lock;
+	fa_chunk *			_partial;	//chunks which have free blocks
+	size_t				_chunk_count;
+};
+
+struct fa_thread_cache{
+	fa_block *	_list[FA_NUM_CLASS];
+	size_t		_count[FA_NUM_CLASS];
+};
+
+static fa_central		fa_pools[FA_NUM_CLASS];
+static size_t			fa_batch[FA_NUM_CLASS];
+static unsigned char	fa_size_to_class[fast_allocator::MAX_SIZE / 16 + 1];
+static DWORD			fa_tls = TLS_OUT_OF_INDEXES;
+static volatile LONG	fa_init_state = 0;	//0 not initialized, 1 initializing, 2 done
+static volatile LONG	fa_large_count = 0;
+
+static void fa_initialize()
+{
+	if(fa_init_state == 2) return;
+
+	if(InterlockedCompareExchange(&fa_init_state, 1, 0) == 0)
+	{
+		size_t c = 0;
+		for(size_t i = 0; i <= fast_allocator::MAX_SIZE / 16; i++)
+		{
+			while(fa_class_size[c] < i * 16) c++;
+			fa_size_to_class[i] = (unsigned char)c;
+		}
+
+		for(c = 0; c < FA_NUM_CLASS; c++)
+		{
+			InitializeCriticalSection(&fa_pools[c]._lock);
+			fa_pools[c]._partial		= NULL;
+			fa_pools[c]._chunk_count	= 0;
+
+			size_t n = FA_BATCH_BYTES / fa_class_size[c];
+			fa_batch[c] = n < 4 ? 4 : (n > 128 ? 128 : n);
+		}
+
+		fa_tls = TlsAlloc();
+		InterlockedExchange(&fa_init_state, 2);
+	}
+	else
+	{
+		while(fa_init_state != 2) Sleep(0);
+	}
+}
+
+static inline size_t fa_get_class(size_t __size)
+{
+	return fa_size_to_class[(__size + 15) >> 4];
+}
+
+static inline fa_chunk * fa_get_chunk(void * __p)
+{
+	return (fa_chunk *)((size_t)__p & ~(size_t)(fast_allocator::CHUNK_SIZE - 1));
+}
+
+static void fa_link(fa_central & __pool, fa_chunk * __chunk)
+{
+	__chunk->_prev = NULL;
+	__chunk->_next = __pool._partial;
+	if(__pool._partial) __pool._partial->_prev = __chunk;
+	__pool._partial = __chunk;
+}
+
+static void fa_unlink(fa_central & __pool, fa_chunk * __chunk)
+{
+	if(__chunk->_prev)
+		__chunk->_prev->_next = __chunk->_next;
+	else
+		__pool._partial = __chunk->_next;
+	if(__chunk->_next) __chunk->_next->_prev = __chunk->_prev;
+}
+
+static fa_chunk * fa_new_chunk(size_t __class)
+{
+	//VirtualAlloc returns addresses aligned to 64K, so one chunk is one allocation
+	fa_chunk * chunk = (fa_chunk *)VirtualAlloc(NULL, fast_allocator::CHUNK_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if(!chunk) return NULL;
+	assert(fa_get_chunk(chunk) == chunk);
+
+	size_t size		= fa_class_size[__class];
+	chunk->_magic	= FA_CHUNK_MAGIC;
+	chunk->_class	= __class;
+	chunk->_used	= 0;
+	chunk->_count	= (fast_allocator::CHUNK_SIZE - FA_HEADER_SIZE) / size;
+	chunk->_free	= NULL;
+
+	//build the free list from the end, so the blocks are handed out by address
+	char * p = (char *)chunk + FA_HEADER_SIZE + (chunk->_count - 1) * size;
+	for(size_t i = 0; i < chunk->_count; i++, p -= size)
+	{
+		((fa_block *)p)->_next = chunk->_free;
+		chunk->_free = (fa_block *)p;
+	}
+	return chunk;
+}
+
+//take at most __n blocks of a class from its central pool, return the number of blocks taken
+static size_t fa_fetch(size_t __class, size_t __n, fa_block ** __list)
+{
+	fa_central & pool = fa_pools[__class];
+	fa_block * list = NULL;
+	size_t count = 0;
+
+	EnterCriticalSection(&pool._lock);
+	while(count < __n)
+	{
+		fa_chunk * chunk = pool._partial;
+		if(!chunk)
+		{
+			chunk = fa_new_chunk(__class);
+			if(!chunk) break;
+			fa_link(pool, chunk);
+			pool._chunk_count++;
+		}
+
+		while(count < __n && chunk->_free)
+		{
+			fa_block * block = chunk->_free;
+			chunk->_free = block->_next;
+			block->_next = list;
+			list = block;
+			chunk->_used++;
+			count++;
+		}
+		if(!chunk->_free) fa_unlink(pool, chunk);
+	}
+	LeaveCriticalSection(&pool._lock);
+
+	*__list = list;
+	return count;
+}
+
+//give a list of blocks back to the central pool of their class
+static void fa_release(size_t __class, fa_block * __list)
+{
+	fa_central & pool = fa_pools[__class];
+
+	EnterCriticalSection(&pool._lock);
+	while(__list)
+	{
+		fa_block * block = __list;
+		__list = block->_next;
+
+		fa_chunk * chunk = fa_get_chunk(block);
+		assert(chunk->_class == __class && chunk->_used > 0);
+		if(!chunk->_free) fa_link(pool, chunk);
+		block->_next = chunk->_free;
+		chunk->_free = block;
+		chunk->_used--;
+
+		//keep the last chunk of the class, or one chunk may be got and freed again and again
+		if(chunk->_used == 0 && pool._chunk_count > 1)
+		{
+			fa_unlink(pool, chunk);
+			pool._chunk_count--;
+			VirtualFree(chunk, 0, MEM_RELEASE);
+		}
+	}
+	LeaveCriticalSection(&pool._lock);
+}
+
+static fa_thread_cache * fa_get_thread_cache()
+{
+	if(fa_tls == TLS_OUT_OF_INDEXES) return NULL;
+
+	fa_thread_cache * cache = (fa_thread_cache *)TlsGetValue(fa_tls);
+	if(!cache)
+	{
+		cache = (fa_thread_cache *)calloc(1, sizeof(fa_thread_cache));
+		if(cache) TlsSetValue(fa_tls, cache);
+	}
+	return cache;
+}
+
+void * fast_allocator::alloc(size_t __size)
+{
+	if(__size > MAX_SIZE)
+	{
+		void * p = align_malloc(__size, ALIGN);
+		if(p) InterlockedIncrement(&fa_large_count);
+		return p;
+	}
+
+	fa_initialize();
+
+	size_t c = fa_get_class(__size);
+	fa_block * block;
+	fa_thread_cache * cache = fa_get_thread_cache();
+	if(!cache)
+		return fa_fetch(c, 1, &block) ? block : NULL;
+
+	if(!cache->_list[c])
+	{
+		cache->_count[c] = fa_fetch(c, fa_batch[c], &cache->_list[c]);
+		if(!cache->_list[c]) return NULL;
+	}
+
+	block = cache->_list[c];
+	cache->_list[c] = block->_next;
+	cache->_count[c]--;
+	return block;
+}
+
+void fast_allocator::free(void * __p, size_t __size)
+{
+	if(!__p) return;
+
+#ifdef _DEBUG
+	//a size other than the one given to alloc() puts the block into the wrong class or heap
+	fa_chunk * owner = fa_get_chunk(__p);
+	if(__size > MAX_SIZE)
+		assert(owner->_magic != FA_CHUNK_MAGIC && "fast_allocator::free(), the block was allocated with a small size");
+	else
+		assert(owner->_magic == FA_CHUNK_MAGIC && owner->_class == fa_get_class(__size) && "fast_allocator::free(), the size is not the one given to alloc()");
+#endif
+
+	if(__size > MAX_SIZE)
+	{
+		InterlockedDecrement(&fa_large_count);
+		align_free(__p);
+		return;
+	}
+
+	size_t c = fa_get_class(__size);
+	fa_block * block = (fa_block *)__p;
+	fa_thread_cache * cache = fa_get_thread_cache();
+	if(!cache)
+	{
+		block->_next = NULL;
+		fa_release(c, block);
+		return;
+	}
+
+	block->_next = cache->_list[c];
+	cache->_list[c] = block;
+	cache->_count[c]++;
+
+	//keep one batch in the cache and give the rest back
+	if(cache->_count[c] >= fa_batch[c] * 2)
+	{
+		fa_block * last = cache->_list[c];
+		for(size_t i = 1; i < fa_batch[c]; i++) last = last->_next;
+		fa_release(c, last->_next);
+		last->_next = NULL;
+		cache->_count[c] = fa_batch[c];
+	}
+}
+
+void fast_allocator::flush_thread_cache()
+{
+	if(fa_init_state != 2 || fa_tls == TLS_OUT_OF_INDEXES) return;
+
+	fa_thread_cache * cache = (fa_thread_cache *)TlsGetValue(fa_tls);
+	if(!cache) return;
+
+	for(size_t c = 0; c < FA_NUM_CLASS; c++)
+	{
+		if(cache->_list[c]) fa_release(c, cache->_list[c]);
+	}
+	::free(cache);
+	TlsSetValue(fa_tls, NULL);
+}
+
+void fast_allocator::trim()
+{
+	if(fa_init_state != 2) return;
+
+	for(size_t c = 0; c < FA_NUM_CLASS; c++)
+	{
+		fa_central & pool = fa_pools[c];
+		EnterCriticalSection(&pool._lock);
+		fa_chunk * chunk = pool._partial;
+		while(chunk)
+		{
+			fa_chunk * next = chunk->_next;
+			if(chunk->_used == 0)
+			{
+				fa_unlink(pool, chunk);
+				pool._chunk_count--;
+				VirtualFree(chunk, 0, MEM_RELEASE);
+			}
+			chunk = next;
+		}
+		LeaveCriticalSection(&pool._lock);
+	}
+}
+
+void fast_allocator::get_stats(stats * __stats)
+{
+	__stats->chunk_count = 0;
+	__stats->large_count = fa_large_count;
+	if(fa_init_state != 2) return;
+
+	for(size_t c = 0; c < FA_NUM_CLASS; c++)
+	{
+		EnterCriticalSection(&fa_pools[c]._lock);
+		__stats->chunk_count += fa_pools[c]._chunk_count;
+		LeaveCriticalSection(&fa_pools[c]._lock);
+	}
+}
 }
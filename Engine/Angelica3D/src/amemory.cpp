@@ -1,3 +1,4 @@
+#include <windows.h>
 #include <stdlib.h>
 #include <memory.h>
 #include <string.h>
@@ -6,7 +7,7 @@
 #include <stdarg.h>
 
 #include "amemory.h"
-#include "hashtab.h"
+#include "flat_hashtab.h"
 
 /*internal data structure and variable*/
 
@@ -34,6 +35,7 @@ public:
 		if(file) fclose(file);
 		file = fopen(filename,"w");
 	}
+	//the log is not flushed here, call flush() after the messages which must not be lost
 	void write_log(const char * fmt, ...)
 	{
 		va_list ap;
@@ -42,19 +44,79 @@ public:
 		output = file?file:stdout;
 		(void) vfprintf(output, fmt, ap);
 		va_end(ap);
-		fflush(output);
+	}
+	void flush()
+	{
+		fflush(file?file:stdout);
 	}
 };//memory log end
 
+/*
+	every block is put in the tables, so a_free and a_realloc look a pointer up before they
+	touch anything around it. Only the sampled blocks are counted to the site (file and line)
+	which allocated them. The counters of a site are weighted by the sample rate when the
+	block was taken, so they are estimates of all blocks.
+*/
+
+struct amemory_site_key
+{
+	const char *_file;		//__FILE__ of the site, compared by address
+	int  _line;
+
+	inline bool operator==(const amemory_site_key & rhs) const
+	{
+		return _file == rhs._file && _line == rhs._line;
+	}
+};
+
+struct amemory_site_hash
+{
+	inline unsigned long operator()(const amemory_site_key & key) const
+	{
+		return (unsigned long)(size_t)key._file ^ ((unsigned long)key._line * 2654435761UL);
+	}
+};
+
+struct amemory_site
+{
+	const char *_file;
+	int  _line;
+	size_t _live_count;		//estimated blocks and bytes which are not freed
+	size_t _live_bytes;
+	unsigned __int64 _total_count;	//estimated blocks and bytes ever allocated
+	unsigned __int64 _total_bytes;
+};//memory site end
+
 struct amemory_node
 {
 	const char *_file;
 	int  _line;
 	void *_block;
 	size_t _size;
+	int  _band;				//bytes of each guard band, 0 if there is no band
+	int  _weight;			//sample rate when the block was taken, 0 if it is not counted
+	amemory_site *_site;	//NULL if it is not counted
 };//memory node end
 
+//sites are never freed, the pointers in the site table and in the nodes are always valid
+typedef abase::flat_hashtab<amemory_node, void *, abase::_hash_function> amemory_block_tab;
+typedef abase::flat_hashtab<amemory_site *, amemory_site_key, amemory_site_hash> amemory_site_tab;
+
+//blocks are put in the shard of their address and sites in the shard of their key, each
+//shard has its own lock so threads seldom wait for each other
+struct amemory_shard
+{
+	CRITICAL_SECTION	_lock;
+	amemory_block_tab	_blocks;
+	amemory_site_tab	_sites;
 
+	amemory_shard():_blocks(97),_sites(53)
+	{
+		InitializeCriticalSection(&_lock);
+	}
+};
+
+enum { AMEM_SHARD_NUM = 16 };	//must be power of 2
 
 static const char * AMEMLOGFILE="amemory.log";
 static const int overflow_block = 32;
@@ -63,38 +125,224 @@ static const int band_magic_number = 0xdd;
 int amemory_vebose_level = 0;
 static amemory_log amem_log;
 
+static amemory_shard *	amem_shards = NULL;			//never freed, blocks may be freed after exit
+static volatile int		amem_sample_rate = 1;
+static volatile int		amem_guard_band = 1;
+static DWORD			amem_tls = TLS_OUT_OF_INDEXES;	//allocations left before next sample
+static volatile LONG	amem_sample_seed = 0;
+static volatile LONG	amem_init_state = 0;	//0 not initialized, 1 initializing, 2 done
+
 class amemory_func
 {
 public:
-	inline void operator()(const amemory_node & __node) const{
-		amem_log.write_log("Memory leak detected in file %s, line %d , a %d bytes block at address %p\n",__node._file,__node._line,__node._size,__node._block);
+	inline void operator()(const amemory_node & __node){
+		amem_log.write_log("Memory leak detected in file %s, line %d , a %d bytes block at address %p\n",__node._file,__node._line,__node._size,(char*)__node._block);
 	}
 };// hashfunc end
 
+class amemory_site_collector
+{
+public:
+	abase::vector<amemory_site> _sites;
+	inline void operator()(amemory_site * __site){
+		if(__site->_total_count) _sites.push_back(*__site);
+	}
+};
+
+static inline amemory_shard & amem_block_shard(void * p)
+{
+	return amem_shards[(((unsigned int)(size_t)p >> 4) * 2654435761u >> 16) & (AMEM_SHARD_NUM - 1)];
+}
 
-static abase::hashtab<amemory_node, void *, abase::_hash_function> amem_tab(10);
+static inline amemory_shard & amem_site_shard(const amemory_site_key & key)
+{
+	return amem_shards[(amemory_site_hash()(key) >> 16) & (AMEM_SHARD_NUM - 1)];
+}
+
+static inline char * amem_get_raw(void * data, const amemory_node & node)
+{
+	return (char *)data - node._band;
+}
 
 /* function definition here*/
 static void amem_exitproc()
 {
-	if(!amem_tab.empty())
+	int i;
+	size_t count = 0;
+	for(i = 0; i < AMEM_SHARD_NUM; i++) count += amem_shards[i]._blocks.size();
+	if(count)
 	{
 		amem_log.write_log("\n-----------------------------------------------------------\n");
-		amem_log.write_log("%d blocks memory leak found.\n",amem_tab.size());
+		amem_log.write_log("%d blocks memory leak found.\n",count);
 		amemory_func enum_obj;
-		amem_tab.enum_element(enum_obj);
+		for(i = 0; i < AMEM_SHARD_NUM; i++)
+		{
+			EnterCriticalSection(&amem_shards[i]._lock);
+			amem_shards[i]._blocks.enum_element(enum_obj);
+			LeaveCriticalSection(&amem_shards[i]._lock);
+		}
 	}
+	amem_log.flush();
+}
+
+static int amem_get_env(const char * name, int def)
+{
+	const char * value = getenv(name);
+	return value ? atoi(value) : def;
 }
 
 static void amem_initialize()
 {
-	static int initonce = 0;
-	if(!initonce)
+	if(amem_init_state == 2) return;
+
+	if(InterlockedCompareExchange(&amem_init_state, 1, 0) == 0)
 	{
-		initonce = 1;
+		amem_shards = new amemory_shard[AMEM_SHARD_NUM];
+		amem_tls = TlsAlloc();
+
+		//the test machines can turn down the tracking without a rebuild
+		amem_sample_rate = amem_get_env("AMEMORY_SAMPLE_RATE", amem_sample_rate);
+		amem_guard_band = amem_get_env("AMEMORY_GUARD_BAND", amem_guard_band);
+
 		amem_log.open(AMEMLOGFILE);
 		atexit(amem_exitproc);
+		InterlockedExchange(&amem_init_state, 2);
+	}
+	else
+	{
+		while(amem_init_state != 2) Sleep(0);
+	}
+}
+
+//return the weight of the new block if it should be sampled, or 0
+static inline int amem_should_sample()
+{
+	int rate = amem_sample_rate;
+	if(rate <= 1) return rate > 0 ? 1 : 0;
+	if(amem_tls == TLS_OUT_OF_INDEXES) return 0;
+
+	//a random interval with mean of rate, so a fixed pattern of allocations is not always missed
+	int left = (int)(size_t)TlsGetValue(amem_tls);
+	if(left > 0)
+	{
+		TlsSetValue(amem_tls, (LPVOID)(size_t)(left - 1));
+		return 0;
+	}
+	unsigned int seed = (unsigned int)InterlockedIncrement(&amem_sample_seed) * 2654435761u;
+	seed ^= seed >> 15;
+	TlsSetValue(amem_tls, (LPVOID)(size_t)(seed % (unsigned int)(rate * 2 - 1)));
+	return rate;
+}
+
+//count a block to its site, return the site or NULL if it can not be counted
+static amemory_site * amem_count_site(size_t size, int weight, const char * file, int line)
+{
+	amemory_site_key key;
+	key._file = file;
+	key._line = line;
+
+	amemory_site * site;
+	amemory_shard & site_shard = amem_site_shard(key);
+	EnterCriticalSection(&site_shard._lock);
+	abase::pair<amemory_site **,bool> result = site_shard._sites.get(key);
+	if(result.second)
+	{
+		site = *result.first;
+	}
+	else
+	{
+		site = (amemory_site *)malloc(sizeof(amemory_site));
+		if(!site)
+		{
+			LeaveCriticalSection(&site_shard._lock);
+			return NULL;
+		}
+		memset(site, 0, sizeof(amemory_site));
+		site->_file = file;
+		site->_line = line;
+		if(!site_shard._sites.put(key, site))
+		{
+			LeaveCriticalSection(&site_shard._lock);
+			free(site);
+			return NULL;
+		}
+	}
+	site->_live_count	+= weight;
+	site->_live_bytes	+= size * weight;
+	site->_total_count	+= weight;
+	site->_total_bytes	+= (unsigned __int64)size * weight;
+	LeaveCriticalSection(&site_shard._lock);
+	return site;
+}
+
+//take the counts of a block back from its site, a site is never freed
+static void amem_uncount_site(const amemory_node & node, bool total)
+{
+	amemory_site_key key;
+	key._file = node._site->_file;
+	key._line = node._site->_line;
+	amemory_shard & site_shard = amem_site_shard(key);
+	EnterCriticalSection(&site_shard._lock);
+	node._site->_live_count	-= node._weight;
+	node._site->_live_bytes	-= node._size * node._weight;
+	if(total)
+	{
+		node._site->_total_count	-= node._weight;
+		node._site->_total_bytes	-= (unsigned __int64)node._size * node._weight;
+	}
+	LeaveCriticalSection(&site_shard._lock);
+}
+
+//put a new block in the tables, a block which can not be put must not be handed out
+static bool amem_track(void * data, size_t size, int band, int weight, const char * file, int line)
+{
+	amemory_node node;
+	node._file = file;
+	node._line = line;
+	node._block = data;
+	node._size = size;
+	node._band = band;
+	node._weight = weight;
+	node._site = weight ? amem_count_site(size, weight, file, line) : NULL;
+	if(!node._site) node._weight = 0;
+
+	amemory_shard & block_shard = amem_block_shard(data);
+	EnterCriticalSection(&block_shard._lock);
+	bool tracked = block_shard._blocks.put(data, node);
+	LeaveCriticalSection(&block_shard._lock);
+	if(!tracked && node._site) amem_uncount_site(node, true);
+	return tracked;
+}
+
+//find a block in the tables, and take it out if erase is set
+static bool amem_find(void * data, amemory_node * node, bool erase)
+{
+	amemory_shard & block_shard = amem_block_shard(data);
+	EnterCriticalSection(&block_shard._lock);
+	abase::pair<amemory_node *,bool> result = block_shard._blocks.get(data);
+	if(result.second)
+	{
+		*node = *result.first;
+		if(erase) block_shard._blocks.erase(data);
 	}
+	LeaveCriticalSection(&block_shard._lock);
+	if(!result.second) return false;
+
+	if(erase && node->_site) amem_uncount_site(*node, false);
+	return true;
+}
+
+static bool amem_check_band(void * data, const amemory_node & node)
+{
+	unsigned char *tmp1,*tmp2;
+	tmp1 = (unsigned char*)amem_get_raw(data, node);
+	tmp2 = (unsigned char*)data + node._size;
+	for(int i =0; i < node._band;i++)
+	{
+		if(*tmp1++ != band_magic_number || *tmp2++ !=band_magic_number )
+			return false;
+	}
+	return true;
 }
 
 void	amemory_write_log(const char * fmt, ...)
@@ -105,22 +353,98 @@ void	amemory_write_log(const char * fmt, ...)
 	(void) _vsnprintf(buffer,1024, fmt, ap);
 	va_end(ap);
 	amem_log.write_log("%s",buffer);
+	amem_log.flush();
+}
+
+void	amemory_set_sample_rate(int rate)
+{
+	amem_initialize();
+	amem_sample_rate = rate;
+}
+
+int		amemory_get_sample_rate()
+{
+	amem_initialize();
+	return amem_sample_rate;
+}
+
+void	amemory_set_guard_band(int enable)
+{
+	amem_initialize();
+	amem_guard_band = enable;
+}
+
+static int amem_site_compare(const void * p1, const void * p2)
+{
+	const amemory_site * s1 = (const amemory_site *)p1;
+	const amemory_site * s2 = (const amemory_site *)p2;
+	if(s1->_live_bytes != s2->_live_bytes) return s1->_live_bytes > s2->_live_bytes ? -1 : 1;
+	if(s1->_total_bytes != s2->_total_bytes) return s1->_total_bytes > s2->_total_bytes ? -1 : 1;
+	return 0;
+}
+
+int		amemory_dump_profile(const char * filename)
+{
+	amem_initialize();
+
+	//copy the sites out first, so the file is written without holding any lock
+	amemory_site_collector collector;
+	int i;
+	for(i = 0; i < AMEM_SHARD_NUM; i++)
+	{
+		EnterCriticalSection(&amem_shards[i]._lock);
+		amem_shards[i]._sites.enum_element(collector);
+		LeaveCriticalSection(&amem_shards[i]._lock);
+	}
+	if(collector._sites.size())
+		qsort(collector._sites.begin(), collector._sites.size(), sizeof(amemory_site), amem_site_compare);
+
+	FILE * file = NULL;
+	if(filename)
+	{
+		file = fopen(filename, "w");
+		if(!file) return -1;
+	}
+
+	size_t live_bytes = 0, live_count = 0;
+	for(i = 0; i < (int)collector._sites.size(); i++)
+	{
+		live_bytes += collector._sites[i]._live_bytes;
+		live_count += collector._sites[i]._live_count;
+	}
+
+	char buffer[1024];
+	_snprintf(buffer, 1024, "\nheap profile: %u bytes in %u blocks alive, 1 in %d blocks sampled\n%12s %8s %14s %10s  site\n",
+		live_bytes, live_count, amem_sample_rate, "live bytes", "blocks", "total bytes", "total");
+	if(file) fputs(buffer, file); else amem_log.write_log("%s", buffer);
+
+	for(i = 0; i < (int)collector._sites.size(); i++)
+	{
+		const amemory_site & site = collector._sites[i];
+		_snprintf(buffer, 1024, "%12u %8u %14I64u %10I64u  %s(%d)\n",
+			site._live_bytes, site._live_count, site._total_bytes, site._total_count, site._file, site._line);
+		if(file) fputs(buffer, file); else amem_log.write_log("%s", buffer);
+	}
+
+	if(file) fclose(file); else amem_log.flush();
+	return collector._sites.size();
 }
 
 void	*a_malloc(size_t size, const char *file, int line)
 {
 	void * buf;
-	amemory_node node;
 	amem_initialize();
-	buf = malloc(size + overflow_block*2); //overflow and underflow
+	int band = amem_guard_band ? overflow_block : 0;
+	buf = malloc(size + band*2); //overflow and underflow
 	if(!buf) return NULL;
-	memset(buf,band_magic_number,size + overflow_block*2);
-	node._file = file;
-	node._line = line;
-	node._block = buf;
-	node._size = size;
-	amem_tab.put(node._block,node);
-	buf = (char*)buf + overflow_block;
+	if(band) memset(buf,band_magic_number,size + band*2);
+
+	if(!amem_track((char*)buf + band, size, band, amem_should_sample(), file, line))
+	{
+		free(buf);
+		return NULL;
+	}
+	buf = (char*)buf + band;
 	if(amemory_vebose_level>0)
 	{
 		amem_log.write_log("Alloc successfully, in file:%s,\tline:%d\t, alloc memory %d bytes at %p\n",file,line,size,buf);
@@ -129,36 +453,32 @@ void	*a_malloc(size_t size, const char *file, int line)
 }
 void	a_free(void *data, const char *file, int line)
 {
-	void *p;
-	p = (char*)data -overflow_block;
-	abase::pair<amemory_node *,bool> node = amem_tab.get(p);
-	if(node.second)
+	if(!data) return;
+
+	//only a block found in the tables is ours, the memory around any other pointer may not be readable
+	amemory_node node;
+	if(amem_init_state == 2 && amem_find(data, &node, true))
 	{
 		if(amemory_vebose_level>0)
 		{
 			amem_log.write_log("Free successfully, in file:%s,\tline:%d\t, free memory at %p\n",file,line,data);
 		}
-		
-		unsigned char *tmp1,*tmp2;
-		tmp1 = (unsigned char*)p;
-		tmp2 = tmp1 + node.first->_size + overflow_block;
-		for(int i =0; i < overflow_block;i++)
+
+		if(node._band && !amem_check_band(data, node))
 		{
-			if(*tmp1++ != band_magic_number || *tmp2++ !=band_magic_number )
-			{
-				amem_log.write_log("Overflow Occur, in file:%s,\tline:%d\t, free memory at %p\n",file,line,data);
-				assert(false);
-			}
+			amem_log.write_log("Overflow Occur, in file:%s,\tline:%d\t, free memory at %p\n",file,line,data);
+			amem_log.flush();
+			assert(false);
 		}
 
-		free(node.first->_block);
-		amem_tab.erase(p);
+		free(amem_get_raw(data, node));
 	}
 	else
 	{
 		amem_log.write_log("Free unmatched buffer,in file:%s,\tline:%d\t, memory pointer is %p\n",file,line,data);
+		amem_log.flush();
 		free(data);
-	}	
+	}
 }
 
 void	*a_realloc(void *data, int size,const char *file,int line)
@@ -173,30 +493,28 @@ void	*a_realloc(void *data, int size,const char *file,int line)
 		a_free(data,file,line);
 		return NULL;
 	}
-	void *p = (char*)data - overflow_block;
-	abase::pair<amemory_node *,bool> node = amem_tab.get(p);
-	if(node.second)
+
+	amemory_node node;
+	if(amem_init_state == 2 && amem_find(data, &node, false))
 	{
-		void * tmp;
-		tmp = realloc(node.first->_block,size + overflow_block*2);
-		if(tmp!= NULL)
+		//the old block is freed only after it is copied, so it stays in the tables until its
+		//address is given back and a failed realloc leaves it as it was
+		void * tmp = a_malloc(size,file,line);
+		if(tmp)
 		{
-			node.first->_block	= tmp;
-			node.first->_file	= file;
-			node.first->_line	= line;
-			node.first->_size	= size;
-			tmp = (char*)tmp + overflow_block;
+			memcpy(tmp, data, node._size < (size_t)size ? node._size : size);
+			a_free(data,file,line);
 			if(amemory_vebose_level>0)
 			{
 				amem_log.write_log("Realloc successfully, in file:%s,\tline:%d\t, alloc memory %d bytes at %p\n",file,line,size,tmp);
 			}
-
 		}
 		return tmp;
 	}
-	else	
+	else
 	{
 		amem_log.write_log("Realloc unmatched buffer,in file:%s,\tline:%d\t, memory pointer is %p\n",file,line,data);
+		amem_log.flush();
 		return NULL;
 	}
 }
@@ -260,5 +578,3 @@ void	 align_free_db(void *pdata, const char *file, int line)
 	data2 -= *(int *)(data2 - sizeof(int));
 	a_free(data2,file,line);
 }
-
-
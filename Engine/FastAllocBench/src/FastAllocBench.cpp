@@ -0,0 +1,273 @@
+/*
+ * FILE: FastAllocBench.cpp
+ *
+ * DESCRIPTION: A multithreaded benchmark of abase::fast_allocator against malloc, the threads
+ *				allocate and free random small sizes and check the blocks they get
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocator.h"
+
+#define BENCH_MAXTHREADS		MAXIMUM_WAIT_OBJECTS
+#define BENCH_LIVEBLOCKS		1024	// Blocks a thread holds at most, a freed slot is allocated again;
+
+typedef struct _BENCH_BLOCK
+{
+	BYTE *			pData;
+	DWORD			dwSize;
+
+} BENCH_BLOCK;
+
+typedef struct _BENCH_THREAD
+{
+	bool			bFast;
+	int				nNumOps;
+	DWORD			dwMaxSize;
+	DWORD			dwSeed;
+	BENCH_BLOCK *	aBlocks;		// The blocks still held at the end are freed by the main thread;
+	int				nNumErrors;
+
+} BENCH_THREAD;
+
+static DWORD l_dwSeed = 12345;
+
+// A fixed sequence, so two runs do the same work;
+static DWORD Rand(DWORD * pdwSeed)
+{
+	*pdwSeed = *pdwSeed * 1664525 + 1013904223;
+	return *pdwSeed >> 8;
+}
+
+static double GetSeconds(const LARGE_INTEGER& liStart, const LARGE_INTEGER& liEnd)
+{
+	LARGE_INTEGER liFreq;
+	QueryPerformanceFrequency(&liFreq);
+	return (double) (liEnd.QuadPart - liStart.QuadPart) / (double) liFreq.QuadPart;
+}
+
+static void Usage()
+{
+	printf("Usage: FastAllocBench [-threads <n>] [-ops <n>] [-maxsize <bytes>]\n");
+	printf("    Each thread allocates and frees random sizes up to maxsize, mostly small ones,\n");
+	printf("    with malloc and with abase::fast_allocator; a block is filled when it is got and\n");
+	printf("    checked when it is freed, and the blocks left at the end are freed by the main\n");
+	printf("    thread, so a wrong or overlapping block fails the run\n");
+}
+
+// Most of the engine's small blocks are list elements and records of a few dozen bytes;
+static DWORD RandSize(DWORD * pdwSeed, DWORD dwMaxSize)
+{
+	DWORD dwSize = Rand(pdwSeed) % 4 ? Rand(pdwSeed) % min(dwMaxSize, 128) : Rand(pdwSeed) % dwMaxSize;
+	return dwSize + 1;
+}
+
+static inline BYTE * BenchAlloc(bool bFast, DWORD dwSize)
+{
+	return (BYTE *) (bFast ? abase::fast_allocator::alloc(dwSize) : malloc(dwSize));
+}
+
+static inline void BenchFree(bool bFast, BYTE * pData, DWORD dwSize)
+{
+	if( bFast )
+		abase::fast_allocator::free(pData, dwSize);
+	else
+		free(pData);
+}
+
+// The first and last bytes of a block hold a value from its address and size;
+static inline BYTE BlockTag(const BYTE * pData, DWORD dwSize)
+{
+	return (BYTE) (((size_t) pData >> 4) ^ dwSize);
+}
+
+static bool FillBlock(bool bFast, BENCH_BLOCK& block)
+{
+	if( NULL == block.pData )
+		return false;
+
+	// fast_allocator promises its alignment for every size;
+	if( bFast && ((size_t) block.pData & (abase::fast_allocator::ALIGN - 1)) )
+		return false;
+
+	block.pData[0] = block.pData[block.dwSize - 1] = BlockTag(block.pData, block.dwSize);
+	return true;
+}
+
+static bool CheckBlock(const BENCH_BLOCK& block)
+{
+	BYTE tag = BlockTag(block.pData, block.dwSize);
+	return block.pData[0] == tag && block.pData[block.dwSize - 1] == tag;
+}
+
+static DWORD WINAPI BenchThread(LPVOID pArg)
+{
+	BENCH_THREAD * pThread = (BENCH_THREAD *) pArg;
+
+	for(int i=0; i<pThread->nNumOps; i++)
+	{
+		BENCH_BLOCK& block = pThread->aBlocks[Rand(&pThread->dwSeed) % BENCH_LIVEBLOCKS];
+		if( block.pData )
+		{
+			if( !CheckBlock(block) )
+				pThread->nNumErrors ++;
+			BenchFree(pThread->bFast, block.pData, block.dwSize);
+			block.pData = NULL;
+		}
+		else
+		{
+			block.dwSize = RandSize(&pThread->dwSeed, pThread->dwMaxSize);
+			block.pData = BenchAlloc(pThread->bFast, block.dwSize);
+			if( !FillBlock(pThread->bFast, block) )
+			{
+				pThread->nNumErrors ++;
+				block.pData = NULL;
+			}
+		}
+	}
+
+	if( pThread->bFast )
+		abase::fast_allocator::flush_thread_cache();
+	return 0;
+}
+
+// Run the threads with one of the allocators, return the seconds spent or a negative value if failed;
+static double RunBench(bool bFast, int nNumThreads, int nNumOps, DWORD dwMaxSize, int * pnNumErrors)
+{
+	BENCH_THREAD	aThreads[BENCH_MAXTHREADS];
+	HANDLE			aHandles[BENCH_MAXTHREADS];
+	int				i, j, nNumStarted = 0;
+	DWORD			dwSeed = l_dwSeed;
+	LARGE_INTEGER	liStart, liEnd;
+
+	*pnNumErrors = 0;
+	for(i=0; i<nNumThreads; i++)
+	{
+		aThreads[i].bFast		= bFast;
+		aThreads[i].nNumOps		= nNumOps;
+		aThreads[i].dwMaxSize	= dwMaxSize;
+		aThreads[i].dwSeed		= Rand(&dwSeed);
+		aThreads[i].nNumErrors	= 0;
+		aThreads[i].aBlocks		= (BENCH_BLOCK *) calloc(BENCH_LIVEBLOCKS, sizeof(BENCH_BLOCK));
+		if( NULL == aThreads[i].aBlocks )
+		{
+			printf("Not enough memory!\n");
+			for(j=0; j<i; j++)
+				free(aThreads[j].aBlocks);
+			return -1.0;
+		}
+	}
+
+	QueryPerformanceCounter(&liStart);
+	for(i=0; i<nNumThreads; i++)
+	{
+		aHandles[i] = CreateThread(NULL, 0, BenchThread, &aThreads[i], 0, NULL);
+		if( NULL == aHandles[i] )
+		{
+			printf("Can not create thread!\n");
+			(*pnNumErrors) ++;
+			break;
+		}
+		nNumStarted ++;
+	}
+
+	WaitForMultipleObjects(nNumStarted, aHandles, TRUE, INFINITE);
+	QueryPerformanceCounter(&liEnd);
+
+	// The blocks left are freed by another thread than the one which got them;
+	for(i=0; i<nNumThreads; i++)
+	{
+		if( i < nNumStarted )
+			CloseHandle(aHandles[i]);
+
+		*pnNumErrors += aThreads[i].nNumErrors;
+		for(j=0; j<BENCH_LIVEBLOCKS; j++)
+		{
+			BENCH_BLOCK& block = aThreads[i].aBlocks[j];
+			if( NULL == block.pData )
+				continue;
+			if( !CheckBlock(block) )
+				(*pnNumErrors) ++;
+			BenchFree(bFast, block.pData, block.dwSize);
+		}
+		free(aThreads[i].aBlocks);
+	}
+
+	if( bFast )
+		abase::fast_allocator::flush_thread_cache();
+
+	return nNumStarted == nNumThreads ? GetSeconds(liStart, liEnd) : -1.0;
+}
+
+int main(int argc, char * argv[])
+{
+	int		nNumThreads	= 4;
+	int		nNumOps		= 1000000;
+	DWORD	dwMaxSize	= 512;
+
+	for(int i=1; i<argc; i++)
+	{
+		if( i + 1 < argc && 0 == _stricmp(argv[i], "-threads") )
+			nNumThreads = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-ops") )
+			nNumOps = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-maxsize") )
+			dwMaxSize = (DWORD) atoi(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if( nNumThreads <= 0 || nNumThreads > BENCH_MAXTHREADS || nNumOps <= 0 || dwMaxSize == 0 || dwMaxSize > 65536 )
+	{
+		Usage();
+		return 1;
+	}
+
+	printf("%d threads, %d operations a thread, sizes up to %u bytes\n", nNumThreads, nNumOps, dwMaxSize);
+
+	int nRet = 0;
+	double vTimes[2];
+	for(int nWay=0; nWay<2; nWay++)
+	{
+		bool bFast = nWay == 1;
+		int nNumErrors;
+
+		vTimes[nWay] = RunBench(bFast, nNumThreads, nNumOps, dwMaxSize, &nNumErrors);
+		if( vTimes[nWay] < 0.0 )
+			return 1;
+
+		printf("%-15s %8.2f ms, %6.1f M operations a second", bFast ? "fast_allocator" : "malloc",
+			vTimes[nWay] * 1000.0, (double) nNumThreads * nNumOps / vTimes[nWay] / 1000000.0);
+		if( nNumErrors )
+		{
+			printf(", %d blocks are wrong!", nNumErrors);
+			nRet = 1;
+		}
+		printf("\n");
+	}
+
+	printf("fast_allocator is %.2f times as fast as malloc\n", vTimes[0] / vTimes[1]);
+
+	// Every block is freed and every cache flushed, so trim() must give all chunks back;
+	abase::fast_allocator::stats stats;
+	abase::fast_allocator::trim();
+	abase::fast_allocator::get_stats(&stats);
+	if( stats.chunk_count || stats.large_count )
+	{
+		printf("%u chunks and %u large blocks are not given back!\n", stats.chunk_count, stats.large_count);
+		nRet = 1;
+	}
+
+	return nRet;
+}
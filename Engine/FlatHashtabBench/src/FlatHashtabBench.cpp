@@ -0,0 +1,240 @@
+/*
+ * FILE: FlatHashtabBench.cpp
+ *
+ * DESCRIPTION: A benchmark of abase::flat_hashtab against abase::hashtab, it puts, gets and
+ *				erases shuffled pointer keys as amemory does and checks every result
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "flat_hashtab.h"
+
+typedef abase::hashtab<int, void *, abase::_hash_function>		BENCH_HASHTAB;
+typedef abase::flat_hashtab<int, void *, abase::_hash_function>	BENCH_FLATTAB;
+
+typedef struct _BENCH_TIMES
+{
+	double			vPut;
+	double			vGet;
+	double			vMiss;
+	double			vChurn;			// An erase and a put of the same key;
+	double			vErase;
+
+} BENCH_TIMES;
+
+static DWORD l_dwSeed = 12345;
+
+// A fixed sequence, so two runs do the same work;
+static DWORD Rand()
+{
+	l_dwSeed = l_dwSeed * 1664525 + 1013904223;
+	return l_dwSeed >> 8;
+}
+
+// A random index below n, the sequence has only 24 bits;
+static int RandIndex(int n)
+{
+	DWORD dwHigh = Rand() << 8;
+	return (int) ((dwHigh ^ Rand()) % (DWORD) n);
+}
+
+static double GetSeconds(const LARGE_INTEGER& liStart, const LARGE_INTEGER& liEnd)
+{
+	LARGE_INTEGER liFreq;
+	QueryPerformanceFrequency(&liFreq);
+	return (double) (liEnd.QuadPart - liStart.QuadPart) / (double) liFreq.QuadPart;
+}
+
+static void Usage()
+{
+	printf("Usage: FlatHashtabBench [-keys <n>] [-runs <n>]\n");
+	printf("    Put the addresses of heap blocks in each table in a shuffled order, get them\n");
+	printf("    and some which are not there, erase and put them again, then erase them all;\n");
+	printf("    every result and the size of the table are checked, so a wrong table fails the run\n");
+}
+
+static void Shuffle(void ** aKeys, int nNumKeys)
+{
+	for(int i=nNumKeys-1; i>0; i--)
+	{
+		int j = RandIndex(i + 1);
+		void * p = aKeys[i];
+		aKeys[i] = aKeys[j];
+		aKeys[j] = p;
+	}
+}
+
+// Run the phases on a table, add the seconds of each to pTimes and return the number of errors;
+template <class TAB>
+static int RunTable(void ** aKeys, void ** aMisses, int * aOrder, int nNumKeys, BENCH_TIMES * pTimes)
+{
+	TAB tab(53);
+	LARGE_INTEGER liStart, liEnd;
+	int i, nNumErrors = 0;
+
+	QueryPerformanceCounter(&liStart);
+	for(i=0; i<nNumKeys; i++)
+	{
+		if( !tab.put(aKeys[i], i) )
+			nNumErrors ++;
+	}
+	QueryPerformanceCounter(&liEnd);
+	pTimes->vPut += GetSeconds(liStart, liEnd);
+	if( tab.size() != (size_t) nNumKeys )
+		nNumErrors ++;
+
+	QueryPerformanceCounter(&liStart);
+	for(i=0; i<nNumKeys; i++)
+	{
+		abase::pair<int *, bool> result = tab.get(aKeys[aOrder[i]]);
+		if( !result.second || *result.first != aOrder[i] )
+			nNumErrors ++;
+	}
+	QueryPerformanceCounter(&liEnd);
+	pTimes->vGet += GetSeconds(liStart, liEnd);
+
+	QueryPerformanceCounter(&liStart);
+	for(i=0; i<nNumKeys; i++)
+	{
+		if( tab.get(aMisses[i]).second )
+			nNumErrors ++;
+	}
+	QueryPerformanceCounter(&liEnd);
+	pTimes->vMiss += GetSeconds(liStart, liEnd);
+
+	// A freed block and a new one at the same address, as amemory sees them;
+	QueryPerformanceCounter(&liStart);
+	for(i=0; i<nNumKeys; i++)
+	{
+		if( !tab.erase(aKeys[aOrder[i]]) || !tab.put(aKeys[aOrder[i]], aOrder[i]) )
+			nNumErrors ++;
+	}
+	QueryPerformanceCounter(&liEnd);
+	pTimes->vChurn += GetSeconds(liStart, liEnd);
+	if( tab.size() != (size_t) nNumKeys )
+		nNumErrors ++;
+
+	QueryPerformanceCounter(&liStart);
+	for(i=0; i<nNumKeys; i++)
+	{
+		if( !tab.erase(aKeys[aOrder[i]]) )
+			nNumErrors ++;
+	}
+	QueryPerformanceCounter(&liEnd);
+	pTimes->vErase += GetSeconds(liStart, liEnd);
+	if( tab.size() != 0 )
+		nNumErrors ++;
+
+	return nNumErrors;
+}
+
+static void PrintTimes(const char * szName, const BENCH_TIMES& times, int nNumOps)
+{
+	printf("%-14s %8.1f %8.1f %8.1f %8.1f %8.1f\n", szName, times.vPut * 1e9 / nNumOps, times.vGet * 1e9 / nNumOps,
+		times.vMiss * 1e9 / nNumOps, times.vChurn * 1e9 / nNumOps, times.vErase * 1e9 / nNumOps);
+}
+
+int main(int argc, char * argv[])
+{
+	int		nNumKeys	= 100000;
+	int		nNumRuns	= 5;
+
+	for(int i=1; i<argc; i++)
+	{
+		if( i + 1 < argc && 0 == _stricmp(argv[i], "-keys") )
+			nNumKeys = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-runs") )
+			nNumRuns = atoi(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if( nNumKeys <= 0 || nNumRuns <= 0 )
+	{
+		Usage();
+		return 1;
+	}
+
+	// Real block addresses, so the keys are spread as the ones of amemory are;
+	void **	aKeys	= (void **) malloc(sizeof(void *) * nNumKeys * 2);
+	int *	aOrder	= (int *) malloc(sizeof(int) * nNumKeys);
+	int		i, nNumBlocks = 0, nRet = 0;
+
+	if( NULL == aKeys || NULL == aOrder )
+	{
+		printf("Not enough memory!\n");
+		nRet = 1;
+		goto Exit;
+	}
+
+	for(i=0; i<nNumKeys * 2; i++)
+	{
+		aKeys[i] = malloc(24 + (Rand() % 4) * 16);
+		if( NULL == aKeys[i] )
+		{
+			printf("Not enough memory!\n");
+			nRet = 1;
+			goto Exit;
+		}
+		nNumBlocks ++;
+	}
+
+	// The first half are put in the tables, the other half are the keys which are missed;
+	Shuffle(aKeys, nNumKeys * 2);
+	for(i=0; i<nNumKeys; i++)
+		aOrder[i] = i;
+
+	{
+		BENCH_TIMES timesOld, timesNew;
+		memset(&timesOld, 0, sizeof(timesOld));
+		memset(&timesNew, 0, sizeof(timesNew));
+		int nNumErrors = 0;
+
+		for(i=0; i<nNumRuns; i++)
+		{
+			// The same order for both tables in a run;
+			for(int j=nNumKeys-1; j>0; j--)
+			{
+				int k = RandIndex(j + 1);
+				int t = aOrder[j];
+				aOrder[j] = aOrder[k];
+				aOrder[k] = t;
+			}
+
+			nNumErrors += RunTable<BENCH_HASHTAB>(aKeys, aKeys + nNumKeys, aOrder, nNumKeys, &timesOld);
+			nNumErrors += RunTable<BENCH_FLATTAB>(aKeys, aKeys + nNumKeys, aOrder, nNumKeys, &timesNew);
+		}
+
+		int nNumOps = nNumKeys * nNumRuns;
+		printf("%d pointer keys, %d runs, ns an operation\n", nNumKeys, nNumRuns);
+		printf("%-14s %8s %8s %8s %8s %8s\n", "", "put", "get", "miss", "churn", "erase");
+		PrintTimes("hashtab", timesOld, nNumOps);
+		PrintTimes("flat_hashtab", timesNew, nNumOps);
+
+		if( nNumErrors )
+		{
+			printf("%d results of the tables are wrong!\n", nNumErrors);
+			nRet = 1;
+		}
+	}
+
+Exit:
+	for(i=0; i<nNumBlocks; i++)
+		free(aKeys[i]);
+	if( aKeys )
+		free(aKeys);
+	if( aOrder )
+		free(aOrder);
+	return nRet;
+}
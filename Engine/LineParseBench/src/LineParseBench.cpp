@@ -0,0 +1,342 @@
+/*
+ * FILE: LineParseBench.cpp
+ *
+ * DESCRIPTION: A headless benchmark of the text model line parsing, it parses a generated
+ *				vertex and index list with stdio and sscanf, with AFile::ReadLine and sscanf
+ *				and with ReadLineView and AFileTokenizer of AFile and AFileImage
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include "AF.h"
+#include <float.h>
+#include <math.h>
+
+#define BENCH_TEMPFILE			"LineParseBench.txt"
+#define BENCH_VERTFLOATS		8		// x, y, z, nx, ny, nz, tu, tv;
+#define BENCH_INDEXINTS			3
+
+typedef struct _BENCH_RESULT
+{
+	FLOAT *			pVerts;
+	int *			pIndices;
+
+} BENCH_RESULT;
+
+static DWORD l_dwSeed = 12345;
+
+// A fixed sequence, so two runs do the same work;
+static FLOAT RandFloat(FLOAT vMin, FLOAT vMax)
+{
+	l_dwSeed = l_dwSeed * 1664525 + 1013904223;
+	return vMin + (vMax - vMin) * ((l_dwSeed >> 8) / 16777216.0f);
+}
+
+static double GetSeconds(const LARGE_INTEGER& liStart, const LARGE_INTEGER& liEnd)
+{
+	LARGE_INTEGER liFreq;
+	QueryPerformanceFrequency(&liFreq);
+	return (double) (liEnd.QuadPart - liStart.QuadPart) / (double) liFreq.QuadPart;
+}
+
+static void Usage()
+{
+	printf("Usage: LineParseBench [-lines <n>] [-runs <n>]\n");
+	printf("    Write a text file of vertex lines and index lines as the text models have,\n");
+	printf("    and parse it the old way with fgets and sscanf, with AFile::ReadLine and\n");
+	printf("    sscanf, and with ReadLineView and AFileTokenizer of AFile and AFileImage;\n");
+	printf("    the values of each way are compared with sscanf, so a wrong parse fails the run\n");
+}
+
+// Write the vertex lines in the format of A3DMesh, then the index lines;
+static bool WriteTestFile(char * szFile, int nNumLines, DWORD * pdwFileSize)
+{
+	FILE * pFile = fopen(szFile, "wt");
+	if( NULL == pFile )
+	{
+		printf("Can not create file [%s]!\n", szFile);
+		return false;
+	}
+
+	int i;
+	for(i=0; i<nNumLines; i++)
+	{
+		fprintf(pFile, "(%f, %f, %f, %f, %f, %f, %f, %f)\n",
+			RandFloat(-1000.0f, 1000.0f), RandFloat(-1000.0f, 1000.0f), RandFloat(-1000.0f, 1000.0f),
+			RandFloat(-1.0f, 1.0f), RandFloat(-1.0f, 1.0f), RandFloat(-1.0f, 1.0f),
+			RandFloat(0.0f, 4.0f), RandFloat(0.0f, 4.0f));
+	}
+
+	for(i=0; i<nNumLines; i++)
+	{
+		fprintf(pFile, "%d, %d, %d\n", (int) RandFloat(0.0f, 65535.0f), (int) RandFloat(0.0f, 65535.0f), (int) RandFloat(0.0f, 65535.0f));
+	}
+
+	*pdwFileSize = ftell(pFile);
+	fclose(pFile);
+	return true;
+}
+
+static bool ParseStdio(char * szFile, int nNumLines, BENCH_RESULT& result)
+{
+	FILE * pFile = fopen(szFile, "rt");
+	if( NULL == pFile )
+		return false;
+
+	char szLine[AFILE_LINEMAXLEN];
+	int i;
+	bool bRet = true;
+
+	for(i=0; i<nNumLines && bRet; i++)
+	{
+		FLOAT * v = result.pVerts + i * BENCH_VERTFLOATS;
+		if( !fgets(szLine, AFILE_LINEMAXLEN, pFile) ||
+			8 != sscanf(szLine, "(%f, %f, %f, %f, %f, %f, %f, %f)", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) )
+			bRet = false;
+	}
+
+	for(i=0; i<nNumLines && bRet; i++)
+	{
+		int * n = result.pIndices + i * BENCH_INDEXINTS;
+		if( !fgets(szLine, AFILE_LINEMAXLEN, pFile) || 3 != sscanf(szLine, "%d, %d, %d", &n[0], &n[1], &n[2]) )
+			bRet = false;
+	}
+
+	fclose(pFile);
+	return bRet;
+}
+
+static bool ParseReadLine(char * szFile, int nNumLines, BENCH_RESULT& result)
+{
+	AFile file;
+	if( !file.Open(szFile, AFILE_OPENEXIST | AFILE_TEXT) )
+		return false;
+
+	char szLine[AFILE_LINEMAXLEN];
+	DWORD dwReadLen;
+	int i;
+	bool bRet = true;
+
+	for(i=0; i<nNumLines && bRet; i++)
+	{
+		FLOAT * v = result.pVerts + i * BENCH_VERTFLOATS;
+		if( !file.ReadLine(szLine, AFILE_LINEMAXLEN, &dwReadLen) ||
+			8 != sscanf(szLine, "(%f, %f, %f, %f, %f, %f, %f, %f)", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) )
+			bRet = false;
+	}
+
+	for(i=0; i<nNumLines && bRet; i++)
+	{
+		int * n = result.pIndices + i * BENCH_INDEXINTS;
+		if( !file.ReadLine(szLine, AFILE_LINEMAXLEN, &dwReadLen) || 3 != sscanf(szLine, "%d, %d, %d", &n[0], &n[1], &n[2]) )
+			bRet = false;
+	}
+
+	file.Close();
+	return bRet;
+}
+
+// The way A3DMesh::Load parses the lines now, the file can be an AFile or an AFileImage;
+static bool ParseView(AFile * pFile, char * szFile, int nNumLines, BENCH_RESULT& result)
+{
+	if( !pFile->Open(szFile, AFILE_OPENEXIST | AFILE_TEXT) )
+		return false;
+
+	AFileTokenizer	tokenizer;
+	const char *	pLine;
+	DWORD			dwLineLen;
+	int				i, j;
+	bool			bRet = true;
+
+	for(i=0; i<nNumLines && bRet; i++)
+	{
+		FLOAT * v = result.pVerts + i * BENCH_VERTFLOATS;
+		if( !pFile->ReadLineView(&pLine, &dwLineLen) )
+		{
+			bRet = false;
+			break;
+		}
+		tokenizer.Init(pLine, dwLineLen);
+		for(j=0; j<BENCH_VERTFLOATS && bRet; j++)
+			bRet = tokenizer.GetFloat(&v[j]);
+	}
+
+	for(i=0; i<nNumLines && bRet; i++)
+	{
+		int * n = result.pIndices + i * BENCH_INDEXINTS;
+		if( !pFile->ReadLineView(&pLine, &dwLineLen) )
+		{
+			bRet = false;
+			break;
+		}
+		tokenizer.Init(pLine, dwLineLen);
+		for(j=0; j<BENCH_INDEXINTS && bRet; j++)
+			bRet = tokenizer.GetInt(&n[j]);
+	}
+
+	pFile->Close();
+	return bRet;
+}
+
+// Count the values which are not the same as the reference, a float may differ in the last bit
+// because AFileTokenizer rounds through a double, anything more than that is an error;
+static int CompareResult(const BENCH_RESULT& ref, const BENCH_RESULT& result, int nNumLines, int * pnNumLastBit)
+{
+	int i, nNumErrors = 0;
+
+	*pnNumLastBit = 0;
+	for(i=0; i<nNumLines * BENCH_VERTFLOATS; i++)
+	{
+		if( ref.pVerts[i] == result.pVerts[i] )
+			continue;
+
+		FLOAT vDiff = (FLOAT) fabs(ref.pVerts[i] - result.pVerts[i]);
+		if( vDiff <= FLT_EPSILON * (FLOAT) fabs(ref.pVerts[i]) )
+			(*pnNumLastBit) ++;
+		else
+			nNumErrors ++;
+	}
+
+	for(i=0; i<nNumLines * BENCH_INDEXINTS; i++)
+	{
+		if( ref.pIndices[i] != result.pIndices[i] )
+			nNumErrors ++;
+	}
+
+	return nNumErrors;
+}
+
+static bool AllocResult(BENCH_RESULT& result, int nNumLines)
+{
+	result.pVerts = (FLOAT *) malloc(sizeof(FLOAT) * BENCH_VERTFLOATS * nNumLines);
+	result.pIndices = (int *) malloc(sizeof(int) * BENCH_INDEXINTS * nNumLines);
+	return result.pVerts && result.pIndices;
+}
+
+static void FreeResult(BENCH_RESULT& result)
+{
+	if( result.pVerts )
+		free(result.pVerts);
+	if( result.pIndices )
+		free(result.pIndices);
+	result.pVerts = NULL;
+	result.pIndices = NULL;
+}
+
+int main(int argc, char * argv[])
+{
+	int		nNumLines	= 100000;
+	int		nNumRuns	= 10;
+
+	for(int i=1; i<argc; i++)
+	{
+		if( i + 1 < argc && 0 == _stricmp(argv[i], "-lines") )
+			nNumLines = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-runs") )
+			nNumRuns = atoi(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if( nNumLines <= 0 || nNumRuns <= 0 )
+	{
+		Usage();
+		return 1;
+	}
+
+	AFileMod_Initialize(true);
+
+	static const char * aNames[] =
+	{
+		"fgets and sscanf",
+		"AFile::ReadLine and sscanf",
+		"AFile::ReadLineView",
+		"AFileImage::ReadLineView",
+	};
+	const int nNumWays = sizeof(aNames) / sizeof(aNames[0]);
+
+	BENCH_RESULT	aResults[nNumWays];
+	DWORD			dwFileSize;
+	int				i, nWay, nRet = 0;
+
+	for(nWay=0; nWay<nNumWays; nWay++)
+	{
+		aResults[nWay].pVerts = NULL;
+		aResults[nWay].pIndices = NULL;
+	}
+
+	if( !WriteTestFile(BENCH_TEMPFILE, nNumLines, &dwFileSize) )
+	{
+		nRet = 1;
+		goto Exit;
+	}
+
+	printf("%d vertex lines and %d index lines, %.1f MB, %d runs\n", nNumLines, nNumLines, dwFileSize / 1048576.0, nNumRuns);
+
+	for(nWay=0; nWay<nNumWays; nWay++)
+	{
+		if( !AllocResult(aResults[nWay], nNumLines) )
+		{
+			printf("Not enough memory!\n");
+			nRet = 1;
+			goto Exit;
+		}
+
+		LARGE_INTEGER liStart, liEnd;
+		double vTime = 0.0;
+		bool bParsed = true;
+
+		for(i=0; i<nNumRuns && bParsed; i++)
+		{
+			AFileImage fileImage;
+			AFile file;
+
+			QueryPerformanceCounter(&liStart);
+			switch( nWay )
+			{
+			case 0:	bParsed = ParseStdio(BENCH_TEMPFILE, nNumLines, aResults[nWay]);						break;
+			case 1:	bParsed = ParseReadLine(BENCH_TEMPFILE, nNumLines, aResults[nWay]);					break;
+			case 2:	bParsed = ParseView(&file, BENCH_TEMPFILE, nNumLines, aResults[nWay]);				break;
+			case 3:	bParsed = ParseView(&fileImage, BENCH_TEMPFILE, nNumLines, aResults[nWay]);			break;
+			}
+			QueryPerformanceCounter(&liEnd);
+			vTime += GetSeconds(liStart, liEnd);
+		}
+
+		if( !bParsed )
+		{
+			printf("%-28s can not parse the file!\n", aNames[nWay]);
+			nRet = 1;
+			continue;
+		}
+
+		printf("%-28s %8.2f ms a run, %7.1f MB/s", aNames[nWay], vTime * 1000.0 / nNumRuns, dwFileSize / 1048576.0 * nNumRuns / vTime);
+		if( nWay > 0 )
+		{
+			int nNumLastBit;
+			int nNumErrors = CompareResult(aResults[0], aResults[nWay], nNumLines, &nNumLastBit);
+			printf(", %d values differ in the last bit", nNumLastBit);
+			if( nNumErrors )
+			{
+				printf(", %d values are wrong!", nNumErrors);
+				nRet = 1;
+			}
+		}
+		printf("\n");
+	}
+
+Exit:
+	for(nWay=0; nWay<nNumWays; nWay++)
+		FreeResult(aResults[nWay]);
+
+	DeleteFile(BENCH_TEMPFILE);
+	AFileMod_Finalize();
+	return nRet;
+}
@@ -0,0 +1,270 @@
+/*
+ * FILE: VectorBench.cpp
+ *
+ * DESCRIPTION: A micro benchmark of abase::vector against std::vector, it pushes, appends,
+ *				inserts and erases pointers, vectors and names which own a buffer, and checks
+ *				that both hold the same elements after each step
+ *
+ * CREATED BY: Hedi, 2026/10/17
+ *
+ * HISTORY:
+ *
+ * Copyright (c) 2001 Archosaur Studio, All Rights Reserved.
+ */
+
+#include <vector>
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "A3DTypes.h"
+#include "vector.h"
+
+// A class which owns a buffer, so it has to be copied and destroyed one by one unless it is
+// declared relocatable; the two forms differ only in that;
+template <int RELOCATABLE>
+class BenchName
+{
+public:
+	BenchName() { m_szName = NULL; }
+	BenchName(const BenchName& rhs) { m_szName = rhs.m_szName ? _strdup(rhs.m_szName) : NULL; }
+	~BenchName() { if( m_szName ) free(m_szName); }
+
+	BenchName& operator = (const BenchName& rhs)
+	{
+		if( this != &rhs )
+		{
+			if( m_szName ) free(m_szName);
+			m_szName = rhs.m_szName ? _strdup(rhs.m_szName) : NULL;
+		}
+		return *this;
+	}
+
+	void SetName(const char * szName)
+	{
+		if( m_szName ) free(m_szName);
+		m_szName = _strdup(szName);
+	}
+	const char * GetName() const { return m_szName ? m_szName : ""; }
+
+protected:
+	char *		m_szName;
+};
+
+typedef BenchName<0>	BENCH_NAME;
+typedef BenchName<1>	BENCH_RELOCNAME;
+ABASE_DECLARE_RELOCATABLE(BENCH_RELOCNAME)
+
+typedef struct _BENCH_TIMES
+{
+	double			vPush;
+	double			vAppend;
+	double			vInsert;		// Inserts in the middle;
+	double			vErase;			// Erases in the middle;
+
+} BENCH_TIMES;
+
+static double GetSeconds(const LARGE_INTEGER& liStart, const LARGE_INTEGER& liEnd)
+{
+	LARGE_INTEGER liFreq;
+	QueryPerformanceFrequency(&liFreq);
+	return (double) (liEnd.QuadPart - liStart.QuadPart) / (double) liFreq.QuadPart;
+}
+
+static void Usage()
+{
+	printf("Usage: VectorBench [-elements <n>] [-middle <n>] [-runs <n>]\n");
+	printf("    Push the elements one by one, append them again in one call, then insert middle\n");
+	printf("    elements one by one in the middle and erase them from the middle, with\n");
+	printf("    abase::vector and std::vector; the elements of both are compared after each\n");
+	printf("    step, so a wrong vector fails the run\n");
+}
+
+// Each element is made from its index, so the two vectors can be filled the same way;
+static inline void MakeValue(LPVOID& v, int i) { v = (LPVOID) (size_t) (i * 16); }
+static inline void MakeValue(A3DVECTOR3& v, int i) { v = A3DVECTOR3((FLOAT) i, (FLOAT) -i, 0.5f); }
+
+template <int RELOCATABLE>
+static inline void MakeValue(BenchName<RELOCATABLE>& v, int i)
+{
+	char szName[32];
+	sprintf(szName, "name%d", i);
+	v.SetName(szName);
+}
+
+static inline bool IsEqual(LPVOID v1, LPVOID v2) { return v1 == v2; }
+static inline bool IsEqual(const A3DVECTOR3& v1, const A3DVECTOR3& v2) { return v1.x == v2.x && v1.y == v2.y && v1.z == v2.z; }
+
+template <int RELOCATABLE>
+static inline bool IsEqual(const BenchName<RELOCATABLE>& v1, const BenchName<RELOCATABLE>& v2)
+{
+	return 0 == strcmp(v1.GetName(), v2.GetName());
+}
+
+template <class T>
+static bool IsSame(abase::vector<T>& a, std::vector<T>& b)
+{
+	if( a.size() != b.size() )
+		return false;
+
+	for(size_t i=0; i<b.size(); i++)
+	{
+		if( !IsEqual(a[i], b[i]) )
+			return false;
+	}
+	return true;
+}
+
+static void PrintTimes(const char * szType, const char * szVector, const BENCH_TIMES& times, int nNumElements, int nNumMiddle, int nNumRuns)
+{
+	double vElements = (double) nNumElements * nNumRuns;
+	double vMiddle = (double) nNumMiddle * nNumRuns;
+	printf("%-12s %-14s %8.2f %8.2f %10.1f %10.1f\n", szType, szVector, times.vPush * 1e9 / vElements,
+		times.vAppend * 1e9 / vElements, times.vInsert * 1e9 / vMiddle, times.vErase * 1e9 / vMiddle);
+}
+
+// Run the steps with both vectors of T and return the number of steps whose elements differ;
+// the engine grows its vectors from a small size, so the abase vector starts with room for one;
+template <class T>
+static int RunType(const char * szType, int nNumElements, int nNumMiddle, int nNumRuns)
+{
+	BENCH_TIMES		timesAbase, timesStd;
+	LARGE_INTEGER	liStart, liEnd;
+	int				i, nRun, nNumErrors = 0;
+
+	memset(&timesAbase, 0, sizeof(timesAbase));
+	memset(&timesStd, 0, sizeof(timesStd));
+
+	std::vector<T> aValues(nNumElements);
+	for(i=0; i<nNumElements; i++)
+		MakeValue(aValues[i], i);
+	const T * pFirst = &aValues[0];
+	const T * pLast = pFirst + nNumElements;
+
+	for(nRun=0; nRun<nNumRuns; nRun++)
+	{
+		abase::vector<T>	a(1);
+		std::vector<T>		b;
+
+		QueryPerformanceCounter(&liStart);
+		for(i=0; i<nNumElements; i++)
+			a.push_back(pFirst[i]);
+		QueryPerformanceCounter(&liEnd);
+		timesAbase.vPush += GetSeconds(liStart, liEnd);
+
+		QueryPerformanceCounter(&liStart);
+		for(i=0; i<nNumElements; i++)
+			b.push_back(pFirst[i]);
+		QueryPerformanceCounter(&liEnd);
+		timesStd.vPush += GetSeconds(liStart, liEnd);
+
+		if( !IsSame(a, b) )
+			nNumErrors ++;
+
+		QueryPerformanceCounter(&liStart);
+		a.append(pFirst, pLast);
+		QueryPerformanceCounter(&liEnd);
+		timesAbase.vAppend += GetSeconds(liStart, liEnd);
+
+		QueryPerformanceCounter(&liStart);
+		b.insert(b.end(), pFirst, pLast);
+		QueryPerformanceCounter(&liEnd);
+		timesStd.vAppend += GetSeconds(liStart, liEnd);
+
+		if( !IsSame(a, b) )
+			nNumErrors ++;
+
+		a.clear();
+		b.clear();
+
+		// Every element moves the second half of the vector;
+		QueryPerformanceCounter(&liStart);
+		for(i=0; i<nNumMiddle; i++)
+			a.insert(a.begin() + a.size() / 2, pFirst[i % nNumElements]);
+		QueryPerformanceCounter(&liEnd);
+		timesAbase.vInsert += GetSeconds(liStart, liEnd);
+
+		QueryPerformanceCounter(&liStart);
+		for(i=0; i<nNumMiddle; i++)
+			b.insert(b.begin() + b.size() / 2, pFirst[i % nNumElements]);
+		QueryPerformanceCounter(&liEnd);
+		timesStd.vInsert += GetSeconds(liStart, liEnd);
+
+		if( !IsSame(a, b) )
+			nNumErrors ++;
+
+		// Half of them are erased and checked, then the rest;
+		QueryPerformanceCounter(&liStart);
+		for(i=0; i<nNumMiddle / 2; i++)
+			a.erase(a.begin() + a.size() / 2);
+		QueryPerformanceCounter(&liEnd);
+		timesAbase.vErase += GetSeconds(liStart, liEnd);
+
+		QueryPerformanceCounter(&liStart);
+		for(i=0; i<nNumMiddle / 2; i++)
+			b.erase(b.begin() + b.size() / 2);
+		QueryPerformanceCounter(&liEnd);
+		timesStd.vErase += GetSeconds(liStart, liEnd);
+
+		if( !IsSame(a, b) )
+			nNumErrors ++;
+
+		QueryPerformanceCounter(&liStart);
+		while( a.size() )
+			a.erase(a.begin() + a.size() / 2);
+		QueryPerformanceCounter(&liEnd);
+		timesAbase.vErase += GetSeconds(liStart, liEnd);
+
+		QueryPerformanceCounter(&liStart);
+		while( b.size() )
+			b.erase(b.begin() + b.size() / 2);
+		QueryPerformanceCounter(&liEnd);
+		timesStd.vErase += GetSeconds(liStart, liEnd);
+	}
+
+	PrintTimes(szType, "abase::vector", timesAbase, nNumElements, nNumMiddle, nNumRuns);
+	PrintTimes(szType, "std::vector", timesStd, nNumElements, nNumMiddle, nNumRuns);
+	if( nNumErrors )
+		printf("%d steps of %s left different elements!\n", nNumErrors, szType);
+
+	return nNumErrors;
+}
+
+int main(int argc, char * argv[])
+{
+	int		nNumElements	= 100000;
+	int		nNumMiddle		= 2000;
+	int		nNumRuns		= 10;
+
+	for(int i=1; i<argc; i++)
+	{
+		if( i + 1 < argc && 0 == _stricmp(argv[i], "-elements") )
+			nNumElements = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-middle") )
+			nNumMiddle = atoi(argv[++i]);
+		else if( i + 1 < argc && 0 == _stricmp(argv[i], "-runs") )
+			nNumRuns = atoi(argv[++i]);
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if( nNumElements <= 0 || nNumMiddle <= 0 || nNumRuns <= 0 )
+	{
+		Usage();
+		return 1;
+	}
+
+	printf("%d elements, %d in the middle, %d runs, ns an element\n", nNumElements, nNumMiddle, nNumRuns);
+	printf("%-12s %-14s %8s %8s %10s %10s\n", "", "", "push", "append", "insert", "erase");
+
+	int nNumErrors = 0;
+	nNumErrors += RunType<LPVOID>("pointer", nNumElements, nNumMiddle, nNumRuns);
+	nNumErrors += RunType<A3DVECTOR3>("A3DVECTOR3", nNumElements, nNumMiddle, nNumRuns);
+	nNumErrors += RunType<BENCH_RELOCNAME>("relocatable", nNumElements, nNumMiddle, nNumRuns);
+	nNumErrors += RunType<BENCH_NAME>("name", nNumElements, nNumMiddle, nNumRuns);
+
+	return nNumErrors ? 1 : 0;
+}